@@ -18,11 +18,18 @@
 
 #include "esp_system.h"
 #include "esp_log.h"
-#include "esp_heap_caps_init.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include <new>
 
 #include <Weave/DeviceLayer/WeaveDeviceLayer.h>
 #include <Weave/Support/ErrorStr.h>
+#include <SystemLayer/SystemStats.h>
+
+#include "AliveTimer.h"
+#include "Histogram.h"
 
 using namespace ::nl;
 using namespace ::nl::Inet;
@@ -33,14 +40,182 @@ extern const char * TAG;
 
 uint32_t AliveIntervalMS;
 
+namespace {
+
+enum
+{
+    kNumLatencyBuckets = 12,        // Histogram buckets: <1ms, <2ms, <4ms, ... <1024ms, >=1024ms
+    kMaxRecordedStalls = 8,         // Number of worst stalls retained
+    kMaxActivityDepth = 4,          // Maximum nesting of event loop activities
+};
+
+const char * const ActivityNames[kEventLoopActivity_NumActivities] =
+{
+    "none",
+    "device-event",
+    "command-handling",
+    "notification-engine",
+    "service-echo",
+    "telemetry",
+};
+
+int64_t NextAliveTimeUS;
+uint32_t LatencyHistogram[kNumLatencyBuckets];
+EventLoopStall WorstStalls[kMaxRecordedStalls];
+uint8_t NumWorstStalls;
+uint32_t MaxLatenessMS;
+uint32_t LastLatenessMS;
+uint16_t LastDeviceEventType;
+
+struct ActivityRecord
+{
+    int64_t StartTimeUS;
+    EventLoopActivity Activity;
+};
+
+ActivityRecord ActivityStack[kMaxActivityDepth];
+uint8_t ActivityDepth;
+EventLoopActivity LongestActivity;
+uint32_t LongestActivityUS;
+
+// Tasks whose stack high-water marks are recorded in each telemetry sample.  These are all
+// long-lived system tasks, so their handles are looked up once and cached.
+const char * const MonitoredTaskNames[kTelemetry_NumMonitoredTasks] =
+{
+    "main",
+    WEAVE_DEVICE_CONFIG_WEAVE_TASK_NAME,
+    "tiT",
+    "wifi",
+    "eventTask",
+    "esp_timer",
+    "display",
+};
+
+TaskHandle_t MonitoredTasks[kTelemetry_NumMonitoredTasks];
+
+#if CONFIG_TELEMETRY_SAMPLE_COUNT
+
+// Ring buffer of the most recent telemetry samples.
+TelemetrySample TelemetrySamples[CONFIG_TELEMETRY_SAMPLE_COUNT];
+uint32_t TelemetrySampleCount;
+
+#endif // CONFIG_TELEMETRY_SAMPLE_COUNT
+
+void TakeTelemetrySample(TelemetrySample & sample)
+{
+    sample.TimestampMS = (uint32_t)(::esp_timer_get_time() / 1000);
+    sample.FreeHeap = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    sample.MinFreeHeap = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+    sample.LargestFreeBlock = heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT);
+
+#if WEAVE_SYSTEM_CONFIG_PROVIDE_STATISTICS && LWIP_STATS && MEMP_STATS
+    System::Stats::UpdateLwipPbufCounts();
+    sample.PacketBufsInUse = (uint16_t)System::Stats::GetResourcesInUse()[System::Stats::kSystemLayer_NumPacketBufs];
+    sample.PacketBufsHighWater = (uint16_t)System::Stats::GetHighWatermarks()[System::Stats::kSystemLayer_NumPacketBufs];
+#else
+    sample.PacketBufsInUse = 0;
+    sample.PacketBufsHighWater = 0;
+#endif
+
+    for (uint8_t i = 0; i < kTelemetry_NumMonitoredTasks; i++)
+    {
+        if (MonitoredTasks[i] == NULL)
+        {
+            MonitoredTasks[i] = xTaskGetHandle(MonitoredTaskNames[i]);
+        }
+        sample.StackHighWater[i] = (MonitoredTasks[i] != NULL) ? (uint16_t)uxTaskGetStackHighWaterMark(MonitoredTasks[i]) : 0;
+    }
+}
+
+void RecordEventLoopLatency(int64_t nowUS)
+{
+    uint32_t latenessMS = (nowUS > NextAliveTimeUS) ? (uint32_t)((nowUS - NextAliveTimeUS) / 1000) : 0;
+    uint8_t slot;
+
+    // Add the lateness to the histogram.
+    AddToLog2Histogram(LatencyHistogram, latenessMS, 1);
+
+    if (latenessMS > MaxLatenessMS)
+    {
+        MaxLatenessMS = latenessMS;
+    }
+    LastLatenessMS = latenessMS;
+
+    // If the stall is one of the worst seen so far, record it, replacing the least severe
+    // of the recorded stalls if necessary.
+    if (NumWorstStalls < kMaxRecordedStalls)
+    {
+        slot = NumWorstStalls++;
+    }
+    else
+    {
+        slot = 0;
+        for (uint8_t i = 1; i < kMaxRecordedStalls; i++)
+        {
+            if (WorstStalls[i].LatenessMS < WorstStalls[slot].LatenessMS)
+            {
+                slot = i;
+            }
+        }
+        if (WorstStalls[slot].LatenessMS >= latenessMS)
+        {
+            slot = kMaxRecordedStalls;
+        }
+    }
+    if (slot < kMaxRecordedStalls)
+    {
+        EventLoopStall & stall = WorstStalls[slot];
+        stall.TimestampMS = (uint32_t)(nowUS / 1000);
+        stall.LatenessMS = latenessMS;
+        stall.ActivityDurationMS = LongestActivityUS / 1000;
+        stall.LastDeviceEventType = LastDeviceEventType;
+        stall.Activity = (uint8_t)LongestActivity;
+    }
+
+    if (latenessMS >= CONFIG_EVENT_LOOP_STALL_THRESHOLD)
+    {
+        ESP_LOGW(TAG, "Weave event loop stalled for %" PRIu32 " ms (longest activity: %s, %" PRIu32 " ms; last device event 0x%04" PRIX16 ")",
+                 latenessMS, ActivityNames[LongestActivity], LongestActivityUS / 1000, LastDeviceEventType);
+    }
+
+    // Begin a new observation window.
+    LongestActivity = kEventLoopActivity_None;
+    LongestActivityUS = 0;
+}
+
+void HandleDeviceEvent(const WeaveDeviceEvent * event, intptr_t arg)
+{
+    LastDeviceEventType = event->Type;
+}
+
+} // unnamed namespace
+
 void HandleAliveTimer(System::Layer * /* unused */, void * /* unused */, System::Error /* unused */)
 {
     WEAVE_ERROR err;
+    TelemetrySample sample;
+    int64_t nowUS = ::esp_timer_get_time();
+
+    // Use the timer's lateness as a probe of event loop latency.
+    if (NextAliveTimeUS != 0)
+    {
+        RecordEventLoopLatency(nowUS);
+    }
+
+    {
+        EventLoopActivityScope activityScope(kEventLoopActivity_Telemetry);
+        TakeTelemetrySample(sample);
+    }
 
-    ESP_LOGI(TAG, "Alive");
+#if CONFIG_TELEMETRY_SAMPLE_COUNT
+    TelemetrySamples[TelemetrySampleCount % CONFIG_TELEMETRY_SAMPLE_COUNT] = sample;
+    TelemetrySampleCount++;
+#endif // CONFIG_TELEMETRY_SAMPLE_COUNT
 
-    // heap_caps_print_heap_info(MALLOC_CAP_DEFAULT);
+    ESP_LOGI(TAG, "Alive (free heap %" PRIu32 ", min %" PRIu32 ", largest block %" PRIu32 ", pbufs %" PRIu16 ")",
+             sample.FreeHeap, sample.MinFreeHeap, sample.LargestFreeBlock, sample.PacketBufsInUse);
 
+    NextAliveTimeUS = ::esp_timer_get_time() + AliveIntervalMS * 1000LL;
     err = SystemLayer.StartTimer(AliveIntervalMS, HandleAliveTimer, NULL);
     if (err != WEAVE_NO_ERROR)
     {
@@ -51,7 +226,154 @@ void HandleAliveTimer(System::Layer * /* unused */, void * /* unused */, System:
 
 WEAVE_ERROR StartAliveTimer(uint32_t intervalMS)
 {
+    WEAVE_ERROR err;
+
+    // Track the type of the last device event dispatched, for attributing event loop stalls.
+    err = PlatformMgr().AddEventHandler(HandleDeviceEvent, 0);
+    if (err != WEAVE_NO_ERROR)
+    {
+        ESP_LOGE(TAG, "PlatformMgr().AddEventHandler() failed: %s", ErrorStr(err));
+        return err;
+    }
+
     AliveIntervalMS = intervalMS;
     HandleAliveTimer(&SystemLayer, NULL, WEAVE_SYSTEM_CONFIG_NO_ERROR);
     return WEAVE_NO_ERROR;
 }
+
+/* Mark the start of an activity on the Weave event loop task.
+ *
+ * NOTE: This function must be called on the Weave event loop task.
+ */
+void BeginEventLoopActivity(EventLoopActivity activity)
+{
+    if (ActivityDepth < kMaxActivityDepth)
+    {
+        ActivityStack[ActivityDepth].StartTimeUS = ::esp_timer_get_time();
+        ActivityStack[ActivityDepth].Activity = activity;
+    }
+    ActivityDepth++;
+}
+
+/* Mark the end of the most recently started event loop activity.
+ *
+ * NOTE: This function must be called on the Weave event loop task.
+ */
+void EndEventLoopActivity(void)
+{
+    if (ActivityDepth == 0)
+    {
+        return;
+    }
+
+    ActivityDepth--;
+
+    if (ActivityDepth < kMaxActivityDepth)
+    {
+        const ActivityRecord & record = ActivityStack[ActivityDepth];
+        uint32_t durationUS = (uint32_t)(::esp_timer_get_time() - record.StartTimeUS);
+        if (durationUS > LongestActivityUS)
+        {
+            LongestActivityUS = durationUS;
+            LongestActivity = record.Activity;
+        }
+    }
+}
+
+/* Retrieve the most recently recorded telemetry sample.
+ *
+ * NOTE: The caller must hold the Weave stack lock.
+ */
+bool GetLatestTelemetrySample(TelemetrySample & sample)
+{
+#if CONFIG_TELEMETRY_SAMPLE_COUNT
+    if (TelemetrySampleCount != 0)
+    {
+        sample = TelemetrySamples[(TelemetrySampleCount - 1) % CONFIG_TELEMETRY_SAMPLE_COUNT];
+        return true;
+    }
+#endif // CONFIG_TELEMETRY_SAMPLE_COUNT
+    return false;
+}
+
+/* Print the contents of the telemetry ring buffer, oldest sample first.
+ *
+ * NOTE: The caller must hold the Weave stack lock.
+ */
+void DumpTelemetry(void)
+{
+#if CONFIG_TELEMETRY_SAMPLE_COUNT
+    uint32_t numSamples = (TelemetrySampleCount < CONFIG_TELEMETRY_SAMPLE_COUNT) ? TelemetrySampleCount : CONFIG_TELEMETRY_SAMPLE_COUNT;
+
+    printf("DumpTelemetry: %" PRIu32 " samples (%" PRIu32 " total)\n", numSamples, TelemetrySampleCount);
+    printf("  time-ms,free-heap,min-free-heap,largest-block,pbufs,pbufs-hwm");
+    for (uint8_t i = 0; i < kTelemetry_NumMonitoredTasks; i++)
+    {
+        printf(",stack-%s", MonitoredTaskNames[i]);
+    }
+    printf("\n");
+
+    for (uint32_t n = TelemetrySampleCount - numSamples; n < TelemetrySampleCount; n++)
+    {
+        const TelemetrySample & sample = TelemetrySamples[n % CONFIG_TELEMETRY_SAMPLE_COUNT];
+
+        printf("  %" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu16 ",%" PRIu16,
+               sample.TimestampMS, sample.FreeHeap, sample.MinFreeHeap, sample.LargestFreeBlock,
+               sample.PacketBufsInUse, sample.PacketBufsHighWater);
+        for (uint8_t i = 0; i < kTelemetry_NumMonitoredTasks; i++)
+        {
+            printf(",%" PRIu16, sample.StackHighWater[i]);
+        }
+        printf("\n");
+    }
+#else // CONFIG_TELEMETRY_SAMPLE_COUNT
+    printf("DumpTelemetry: telemetry sampling disabled\n");
+#endif // CONFIG_TELEMETRY_SAMPLE_COUNT
+}
+
+/* Return the greatest lateness of the alive timer observed since boot.
+ *
+ * NOTE: The caller must hold the Weave stack lock.
+ */
+uint32_t GetMaxEventLoopLatenessMS(void)
+{
+    return MaxLatenessMS;
+}
+
+/* Return the lateness of the most recent firing of the alive timer.
+ *
+ * NOTE: The caller must hold the Weave stack lock.
+ */
+uint32_t GetLastEventLoopLatenessMS(void)
+{
+    return LastLatenessMS;
+}
+
+/* Print the event loop latency histogram and the worst stalls recorded.
+ *
+ * NOTE: The caller must hold the Weave stack lock.
+ */
+void DumpEventLoopLatency(void)
+{
+    printf("DumpEventLoopLatency: lateness histogram\n");
+    for (uint8_t i = 0; i < kNumLatencyBuckets; i++)
+    {
+        if (i < kNumLatencyBuckets - 1)
+        {
+            printf("  <%4" PRIu32 " ms: %" PRIu32 "\n", Log2HistogramBucketLimit(1, i), LatencyHistogram[i]);
+        }
+        else
+        {
+            printf("  >=%" PRIu32 " ms: %" PRIu32 "\n", Log2HistogramBucketLimit(1, i - 1), LatencyHistogram[i]);
+        }
+    }
+
+    printf("DumpEventLoopLatency: %" PRIu8 " worst stalls\n", NumWorstStalls);
+    for (uint8_t i = 0; i < NumWorstStalls; i++)
+    {
+        const EventLoopStall & stall = WorstStalls[i];
+        printf("  at %" PRIu32 " ms: late %" PRIu32 " ms, longest activity %s (%" PRIu32 " ms), last device event 0x%04" PRIX16 "\n",
+               stall.TimestampMS, stall.LatenessMS, ActivityNames[stall.Activity], stall.ActivityDurationMS,
+               stall.LastDeviceEventType);
+    }
+}
@@ -0,0 +1,188 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <string.h>
+
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+
+#include "Display.h"
+
+#if CONFIG_HAVE_DISPLAY
+
+#include "Assets.h"
+
+extern const char *TAG;
+
+namespace {
+
+enum
+{
+    kAssetsPartitionSubType     = 0x40,
+    kAssetImageMagic            = 0x4144574F,   // 'OWDA'
+    kAssetImageVersion          = 1,
+    kAssetNameLength            = 16,
+};
+
+// Layout of the asset image header, as produced by tools/mkassets.py.
+struct AssetImageHeader
+{
+    uint32_t Magic;
+    uint16_t Version;
+    uint16_t AssetCount;
+};
+
+struct AssetImageEntry
+{
+    char Name[kAssetNameLength];
+    uint16_t Width;
+    uint16_t Height;
+    uint8_t Format;
+    uint8_t Reserved[3];
+    uint32_t Offset;
+    uint32_t Length;
+};
+
+const uint8_t * sAssetImage;
+uint32_t sAssetImageSize;
+spi_flash_mmap_handle_t sAssetImageMapHandle;
+
+} // unnamed namespace
+
+/* Map the display assets partition into the data address space.
+ *
+ * NOTE: The mapping is retained for the life of the application, so that asset data can
+ * be read directly from flash without copying it to RAM.
+ */
+esp_err_t InitDisplayAssets()
+{
+    esp_err_t err;
+    const esp_partition_t * partition;
+    const void * mapAddr;
+    const AssetImageHeader * header;
+
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)kAssetsPartitionSubType, "assets");
+    if (partition == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    err = esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &mapAddr, &sAssetImageMapHandle);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    header = (const AssetImageHeader *)mapAddr;
+    if (header->Magic != kAssetImageMagic || header->Version != kAssetImageVersion ||
+        sizeof(AssetImageHeader) + header->AssetCount * sizeof(AssetImageEntry) > partition->size)
+    {
+        ESP_LOGE(TAG, "Display assets partition does not contain a valid asset image; run 'make assets-flash'");
+        spi_flash_munmap(sAssetImageMapHandle);
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    sAssetImage = (const uint8_t *)mapAddr;
+    sAssetImageSize = partition->size;
+
+    ESP_LOGI(TAG, "Display assets mapped (%u assets)", header->AssetCount);
+
+    return ESP_OK;
+}
+
+bool GetDisplayAsset(const char * name, DisplayAsset & asset)
+{
+    if (sAssetImage == NULL)
+    {
+        return false;
+    }
+
+    const AssetImageHeader * header = (const AssetImageHeader *)sAssetImage;
+    const AssetImageEntry * entry = (const AssetImageEntry *)(header + 1);
+
+    for (uint16_t i = 0; i < header->AssetCount; i++, entry++)
+    {
+        if (strncmp(entry->Name, name, kAssetNameLength) == 0)
+        {
+            if (entry->Offset + entry->Length > sAssetImageSize)
+            {
+                break;
+            }
+            asset.Data = sAssetImage + entry->Offset;
+            asset.Width = entry->Width;
+            asset.Height = entry->Height;
+            asset.Format = entry->Format;
+            return true;
+        }
+    }
+
+    ESP_LOGE(TAG, "Display asset not found: %s", name);
+    return false;
+}
+
+/* Read a horizontal run of pixels from a row of the asset.
+ */
+void DisplayAsset::ReadRow(uint16_t row, uint16_t x, uint16_t count, color_t * dest) const
+{
+    if (Format == kFormat_Raw)
+    {
+        const uint8_t * src = Data + ((uint32_t)row * Width + x) * sizeof(color_t);
+        memcpy(dest, src, count * sizeof(color_t));
+    }
+    else
+    {
+        // Each encoded row is a sequence of packets, each of which is either a run of a single
+        // repeated pixel or a sequence of literal pixels.  Skip packets to the left of the
+        // requested pixels, and stop once past them.
+        const uint32_t * rowOffsets = (const uint32_t *)Data;
+        const uint8_t * src = Data + rowOffsets[row];
+        uint16_t end = x + count;
+        uint16_t px = 0;
+
+        while (px < end)
+        {
+            uint8_t control = *src++;
+            bool isRun = (control & 0x80) != 0;
+            uint16_t packetLen = (control & 0x7F) + 1;
+            uint16_t copyStart = (px > x) ? px : x;
+            uint16_t copyEnd = (px + packetLen < end) ? px + packetLen : end;
+
+            if (isRun)
+            {
+                for (uint16_t i = copyStart; i < copyEnd; i++)
+                {
+                    memcpy(dest + (i - x), src, sizeof(color_t));
+                }
+                src += sizeof(color_t);
+            }
+            else
+            {
+                if (copyStart < copyEnd)
+                {
+                    memcpy(dest + (copyStart - x), src + (copyStart - px) * sizeof(color_t), (copyEnd - copyStart) * sizeof(color_t));
+                }
+                src += packetLen * sizeof(color_t);
+            }
+
+            px += packetLen;
+        }
+    }
+}
+
+#endif // CONFIG_HAVE_DISPLAY
@@ -0,0 +1,110 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "BootPhases.h"
+
+extern const char * TAG;
+
+namespace {
+
+const char * const BootPhaseNames[kBootPhase_NumPhases] =
+{
+    "app-start",
+    "weave-stack-initialized",
+    "event-loop-started",
+    "ui-ready",
+    "title-animation-done",
+    "wifi-station-connected",
+    "ipv4-connectivity",
+    "service-connectivity",
+    "service-subscription",
+    "fully-connected",
+};
+
+int64_t BootPhaseTimesUS[kBootPhase_NumPhases];
+
+} // unnamed namespace
+
+/* Record the time at which a boot phase was reached.
+ *
+ * Only the first occurrence of each phase is recorded.  Returns true if the phase was
+ * reached for the first time.
+ *
+ * NOTE: This function must only be called from the app_main task.
+ */
+bool RecordBootPhase(BootPhase phase)
+{
+    if (BootPhaseTimesUS[phase] != 0)
+    {
+        return false;
+    }
+
+    BootPhaseTimesUS[phase] = ::esp_timer_get_time();
+
+    // Guard against a (theoretical) timestamp of zero being mistaken for an unrecorded phase.
+    if (BootPhaseTimesUS[phase] == 0)
+    {
+        BootPhaseTimesUS[phase] = 1;
+    }
+
+    return true;
+}
+
+/* Log the time at which each boot phase was reached, along with the time elapsed since
+ * the previous phase.
+ *
+ * NOTE: Phases are listed in the order they were reached, which for the connectivity
+ * phases may differ from the order in which they are declared.
+ */
+void LogBootPhases(void)
+{
+    bool logged[kBootPhase_NumPhases] = { };
+    int64_t prevTimeUS = 0;
+
+    ESP_LOGI(TAG, "Boot phases:");
+
+    while (true)
+    {
+        int next = -1;
+
+        for (int i = 0; i < kBootPhase_NumPhases; i++)
+        {
+            if (!logged[i] && BootPhaseTimesUS[i] != 0 &&
+                (next < 0 || BootPhaseTimesUS[i] < BootPhaseTimesUS[next]))
+            {
+                next = i;
+            }
+        }
+
+        if (next < 0)
+        {
+            break;
+        }
+
+        ESP_LOGI(TAG, "  %-24s %6u ms (+%u ms)", BootPhaseNames[next],
+                 (unsigned)(BootPhaseTimesUS[next] / 1000),
+                 (unsigned)((BootPhaseTimesUS[next] - prevTimeUS) / 1000));
+
+        logged[next] = true;
+        prevTimeUS = BootPhaseTimesUS[next];
+    }
+}
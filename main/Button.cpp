@@ -16,57 +16,388 @@
  *    limitations under the License.
  */
 
+#include <string.h>
+
 #include "esp_system.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
+#include "freertos/timers.h"
 
 #include <Weave/DeviceLayer/WeaveDeviceLayer.h>
 #include "Button.h"
 
 extern const char * TAG;
 
+SemaphoreHandle_t Button::sEventSignal = NULL;
+
 esp_err_t Button::Init(gpio_num_t gpioNum, uint16_t debouncePeriod)
 {
     esp_err_t err;
+    esp_timer_create_args_t timerArgs;
+
+    err = InitCommon(gpioNum);
+    SuccessOrExit(err);
+
+    mDebouncePeriodUS = (uint32_t)debouncePeriod * 1000;
+    mEdgeHandlerPending = false;
+
+    mEdgeQueue = xQueueCreate(kEdgeQueueLength, sizeof(Edge));
+    VerifyOrExit(mEdgeQueue != NULL, err = ESP_ERR_NO_MEM);
+
+    memset(&timerArgs, 0, sizeof(timerArgs));
+    timerArgs.arg = this;
+    timerArgs.callback = HandleDebounceTimer;
+    timerArgs.name = "button-debounce";
+    err = esp_timer_create(&timerArgs, &mDebounceTimer);
+    SuccessOrExit(err);
+
+    // Install the GPIO interrupt service, unless another component has already done so.
+    err = gpio_install_isr_service(0);
+    if (err == ESP_ERR_INVALID_STATE)
+    {
+        err = ESP_OK;
+    }
+    SuccessOrExit(err);
+
+    err = gpio_set_intr_type(gpioNum, GPIO_INTR_ANYEDGE);
+    SuccessOrExit(err);
+
+    err = gpio_isr_handler_add(gpioNum, HandleInterrupt, this);
+    SuccessOrExit(err);
+
+    err = gpio_intr_enable(gpioNum);
+    SuccessOrExit(err);
+
+exit:
+    return err;
+}
+
+/* Initialize the state common to interrupt-driven buttons and buttons scanned by a ButtonGroup.
+ */
+esp_err_t Button::InitCommon(gpio_num_t gpioNum)
+{
+    esp_err_t err;
+    esp_timer_create_args_t timerArgs;
 
+    LongPressDurationMS = 1000;
+    DoubleClickIntervalMS = 400;
     mGPIONum = gpioNum;
-    mDebouncePeriod = debouncePeriod / portTICK_PERIOD_MS;
-    mState = false;
-    mLastState = false;
+    mDebouncePeriodUS = 0;
+    mLastClickTimeUS = 0;
+    mPendingEdgeTimeUS = 0;
+    mPrevStateDurUS = 0;
+    mLock = portMUX_INITIALIZER_UNLOCKED;
 
     err = gpio_set_direction(gpioNum, GPIO_MODE_INPUT);
     SuccessOrExit(err);
 
-    Poll();
+    mDebouncedState = mState = (gpio_get_level(gpioNum) == 0);
+    mEdgeTimeUS = mStateStartTimeUS = ::esp_timer_get_time();
+
+    mEventQueue = xQueueCreate(kEventQueueLength, sizeof(ButtonEvent));
+    VerifyOrExit(mEventQueue != NULL, err = ESP_ERR_NO_MEM);
+
+    if (sEventSignal == NULL)
+    {
+        sEventSignal = xSemaphoreCreateBinary();
+        VerifyOrExit(sEventSignal != NULL, err = ESP_ERR_NO_MEM);
+    }
+
+    memset(&timerArgs, 0, sizeof(timerArgs));
+    timerArgs.arg = this;
+    timerArgs.callback = HandleLongPressTimer;
+    timerArgs.name = "button-long-press";
+    err = esp_timer_create(&timerArgs, &mLongPressTimer);
+    SuccessOrExit(err);
 
 exit:
     return err;
 }
 
+/* Consume queued events up to and including the next press or release.
+ *
+ * Returns true if a press or release was found.  Clicks, double clicks and long presses
+ * are discarded.
+ */
 bool Button::Poll()
 {
-    uint32_t now = xTaskGetTickCount();
+    ButtonEvent event;
+
+    while (GetEvent(event))
+    {
+        if (event.Type == ButtonEvent::kType_Press || event.Type == ButtonEvent::kType_Release)
+        {
+            return true;
+        }
+    }
 
-    bool newState = gpio_get_level(mGPIONum) == 0;
+    return false;
+}
 
-    if (newState != mLastState)
+/* Remove the next event from the button's event queue, without waiting.
+ */
+bool Button::GetEvent(ButtonEvent & event)
+{
+    if (xQueueReceive(mEventQueue, &event, 0) != pdTRUE)
     {
-        mLastState = newState;
-        mLastReadTime = now;
+        return false;
     }
 
-    else if (newState != mState && (now - mLastReadTime) >= mDebouncePeriod)
+    if (event.Type == ButtonEvent::kType_Press || event.Type == ButtonEvent::kType_Release)
     {
-        mState = newState;
-        mPrevStateDur = now - mStateStartTime;
-        mStateStartTime = now;
-        return true;
+        mState = (event.Type == ButtonEvent::kType_Press);
+        mPrevStateDurUS = (uint32_t)(event.TimeUS - mStateStartTimeUS);
+        mStateStartTimeUS = event.TimeUS;
     }
 
-    return false;
+    return true;
 }
 
 uint32_t Button::GetStateDuration()
 {
-    return (xTaskGetTickCount() - mStateStartTime) * portTICK_PERIOD_MS;
+    return (uint32_t)((::esp_timer_get_time() - mStateStartTimeUS) / 1000);
+}
+
+/* Block the calling task until any button generates an event, or the timeout expires.
+ */
+void Button::WaitForEvent(uint32_t timeoutMS)
+{
+    if (sEventSignal != NULL)
+    {
+        xSemaphoreTake(sEventSignal, timeoutMS / portTICK_PERIOD_MS);
+    }
+    else
+    {
+        vTaskDelay(timeoutMS / portTICK_PERIOD_MS);
+    }
+}
+
+/* Update the debounced state of the button for an edge, generating the resulting events.
+ *
+ * Returns the number of events generated, which is 0 if the button's state is unchanged.
+ *
+ * NOTE: The button's lock must be held when calling this method.
+ */
+uint8_t Button::HandleEdge(bool pressed, int64_t timeUS, ButtonEvent (&events)[kMaxEventsPerEdge])
+{
+    uint8_t count = 0;
+    uint32_t durationUS = (uint32_t)(timeUS - mEdgeTimeUS);
+
+    if (pressed == mDebouncedState)
+    {
+        return 0;
+    }
+
+    mDebouncedState = pressed;
+    mEdgeTimeUS = timeUS;
+    mPendingEdgeTimeUS = 0;
+
+    events[count].Type = (pressed) ? ButtonEvent::kType_Press : ButtonEvent::kType_Release;
+    events[count].TimeUS = timeUS;
+    events[count].DurationUS = (pressed) ? 0 : durationUS;
+    count++;
+
+    // A release before the long press duration elapses is a click, and a second click within
+    // the double click interval of the first is also a double click.
+    if (!pressed && (LongPressDurationMS == 0 || durationUS < LongPressDurationMS * 1000))
+    {
+        events[count] = events[0];
+        events[count].Type = ButtonEvent::kType_Click;
+        count++;
+
+        if (mLastClickTimeUS != 0 && timeUS - mLastClickTimeUS <= DoubleClickIntervalMS * 1000LL)
+        {
+            events[count] = events[0];
+            events[count].Type = ButtonEvent::kType_DoubleClick;
+            count++;
+            mLastClickTimeUS = 0;
+        }
+        else
+        {
+            mLastClickTimeUS = timeUS;
+        }
+    }
+
+    return count;
+}
+
+void Button::PostEvents(const ButtonEvent * events, uint8_t count)
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        xQueueSend(mEventQueue, &events[i], 0);
+    }
+
+    xSemaphoreGive(sEventSignal);
+}
+
+/* Handle an edge on the button's GPIO.
+ *
+ * NOTE: The interrupt handler only timestamps the edge and queues it, along with the level of
+ * the GPIO.  The edge is processed, and any timers started, by HandleEdges(), which is deferred
+ * to the FreeRTOS timer task, since the esp_timer API is not safe to call from an interrupt.
+ * A call to HandleEdges() is only requested if one is not already pending.  If the edge queue
+ * is full, the edge is dropped; the debounce timer reads the final level of the GPIO regardless.
+ */
+void Button::HandleInterrupt(void * arg)
+{
+    Button * self = (Button *)arg;
+    BaseType_t higherPrioTaskWoken = pdFALSE;
+    Edge edge;
+
+    edge.TimeUS = ::esp_timer_get_time();
+    edge.Pressed = (gpio_get_level(self->mGPIONum) == 0);
+
+    if (xQueueSendFromISR(self->mEdgeQueue, &edge, &higherPrioTaskWoken) == pdTRUE && !self->mEdgeHandlerPending)
+    {
+        self->mEdgeHandlerPending = true;
+        if (xTimerPendFunctionCallFromISR(HandleEdges, self, 0, &higherPrioTaskWoken) != pdPASS)
+        {
+            self->mEdgeHandlerPending = false;
+        }
+    }
+
+    if (higherPrioTaskWoken == pdTRUE)
+    {
+        portYIELD_FROM_ISR();
+    }
+}
+
+/* Process the edges queued by the interrupt handler.
+ *
+ * NOTE: This function runs on the FreeRTOS timer task.
+ */
+void Button::HandleEdges(void * arg, uint32_t /* unused */)
+{
+    Button * self = (Button *)arg;
+    Edge edge;
+
+    // Clear the pending flag before draining the queue, so that an edge queued while the queue
+    // is being drained requests another call.
+    self->mEdgeHandlerPending = false;
+
+    while (xQueueReceive(self->mEdgeQueue, &edge, 0) == pdTRUE)
+    {
+        self->ProcessInterruptEdge(edge.Pressed, edge.TimeUS);
+    }
+}
+
+/* Process an edge timestamped by the interrupt handler.
+ *
+ * NOTE: The first edge of a press or release is reported immediately.  Subsequent edges within
+ * the debounce period are treated as contact bounce, and each restarts the debounce timer, so that
+ * the final state of the button is checked once the contacts have settled.  Edges that leave the
+ * GPIO at the current debounced level (such as the brief glitches seen on GPIOs 36 and 39 when
+ * certain RTC peripherals are powered up) are ignored.
+ */
+void Button::ProcessInterruptEdge(bool pressed, int64_t timeUS)
+{
+    ButtonEvent events[kMaxEventsPerEdge];
+    bool bouncing;
+    uint8_t count = 0;
+
+    portENTER_CRITICAL(&mLock);
+    bouncing = (timeUS - mEdgeTimeUS < mDebouncePeriodUS);
+    if (!bouncing)
+    {
+        count = HandleEdge(pressed, timeUS, events);
+    }
+
+    // While bouncing, remember when the GPIO last moved away from the debounced level, so that
+    // if the contacts settle there, the edge can be reported with its true time.
+    else if (pressed != mDebouncedState)
+    {
+        mPendingEdgeTimeUS = timeUS;
+    }
+    else
+    {
+        mPendingEdgeTimeUS = 0;
+    }
+    portEXIT_CRITICAL(&mLock);
+
+    if (bouncing || count != 0)
+    {
+        esp_timer_stop(mDebounceTimer);
+        esp_timer_start_once(mDebounceTimer, mDebouncePeriodUS);
+    }
+
+    if (count != 0)
+    {
+        StartLongPressTimer(pressed, timeUS);
+        PostEvents(events, count);
+    }
+}
+
+/* Check the state of the button once its contacts have settled.
+ *
+ * If the button was released (or pressed) again while its contacts were bouncing, the edge is
+ * reported now.
+ */
+void Button::HandleDebounceTimer(void * arg)
+{
+    Button * self = (Button *)arg;
+    bool pressed = (gpio_get_level(self->mGPIONum) == 0);
+    int64_t edgeTimeUS;
+
+    portENTER_CRITICAL(&self->mLock);
+    edgeTimeUS = (self->mPendingEdgeTimeUS != 0) ? self->mPendingEdgeTimeUS : ::esp_timer_get_time();
+    portEXIT_CRITICAL(&self->mLock);
+
+    self->ProcessEdge(pressed, edgeTimeUS);
+}
+
+/* Report a debounced change in the state of the button, detected outside of the interrupt handler.
+ */
+void Button::ProcessEdge(bool pressed, int64_t timeUS)
+{
+    ButtonEvent events[kMaxEventsPerEdge];
+    uint8_t count;
+
+    portENTER_CRITICAL(&mLock);
+    count = HandleEdge(pressed, timeUS, events);
+    mPendingEdgeTimeUS = 0;
+    portEXIT_CRITICAL(&mLock);
+
+    if (count != 0)
+    {
+        StartLongPressTimer(pressed, timeUS);
+        PostEvents(events, count);
+    }
+}
+
+/* Following a change in the state of the button, start the long press timer if the button has
+ * been pressed, or stop it if the button has been released.
+ *
+ * NOTE: The timer is timed from the edge, rather than from when the edge is processed.
+ */
+void Button::StartLongPressTimer(bool pressed, int64_t edgeTimeUS)
+{
+    esp_timer_stop(mLongPressTimer);
+
+    if (pressed && LongPressDurationMS != 0)
+    {
+        int64_t remainingUS = LongPressDurationMS * 1000LL - (::esp_timer_get_time() - edgeTimeUS);
+
+        esp_timer_start_once(mLongPressTimer, (remainingUS > 0) ? (uint64_t)remainingUS : 0);
+    }
+}
+
+void Button::HandleLongPressTimer(void * arg)
+{
+    Button * self = (Button *)arg;
+    ButtonEvent event;
+    bool longPress;
+
+    portENTER_CRITICAL(&self->mLock);
+    longPress = self->mDebouncedState;
+    event.Type = ButtonEvent::kType_LongPress;
+    event.TimeUS = ::esp_timer_get_time();
+    event.DurationUS = (uint32_t)(event.TimeUS - self->mEdgeTimeUS);
+    portEXIT_CRITICAL(&self->mLock);
+
+    if (longPress)
+    {
+        self->PostEvents(&event, 1);
+    }
 }
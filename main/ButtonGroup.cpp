@@ -0,0 +1,140 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <string.h>
+
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+#include "Button.h"
+#include "ButtonGroup.h"
+
+extern const char * TAG;
+
+esp_err_t ButtonGroup::Init(uint32_t scanPeriodMS)
+{
+    esp_err_t err;
+    esp_timer_create_args_t timerArgs;
+
+    mScanPeriodUS = scanPeriodMS * 1000;
+    mButtonMask = 0;
+    mDebounced = 0;
+    mCount0 = 0;
+    mCount1 = 0;
+    memset(mButtons, 0, sizeof(mButtons));
+
+    memset(&timerArgs, 0, sizeof(timerArgs));
+    timerArgs.arg = this;
+    timerArgs.callback = HandleScanTimer;
+    timerArgs.name = "button-scan";
+    err = esp_timer_create(&timerArgs, &mScanTimer);
+    SuccessOrExit(err);
+
+exit:
+    return err;
+}
+
+esp_err_t ButtonGroup::AddButton(Button & button, gpio_num_t gpioNum)
+{
+    esp_err_t err;
+
+    VerifyOrExit(gpioNum >= 0 && gpioNum < GPIO_NUM_MAX && mButtons[gpioNum] == NULL, err = ESP_ERR_INVALID_ARG);
+
+    err = button.InitCommon(gpioNum);
+    SuccessOrExit(err);
+
+    mButtons[gpioNum] = &button;
+    mButtonMask |= (1ULL << gpioNum);
+
+exit:
+    return err;
+}
+
+esp_err_t ButtonGroup::Start(void)
+{
+    // Start from the current state of the buttons, as already read by each button's Init.
+    mDebounced = ReadPressed();
+    mCount0 = 0;
+    mCount1 = 0;
+
+    return esp_timer_start_periodic(mScanTimer, mScanPeriodUS);
+}
+
+/* Advance the vertical debounce counters for one scan.
+ *
+ * Each button's counter is formed from its bits in count0 and count1.  The counter is cleared
+ * whenever the sampled state of the button matches its debounced state, and is otherwise
+ * incremented.  When it wraps back to zero, after kDebounceScans consecutive differing samples,
+ * the debounced state is toggled.
+ *
+ * Returns a mask of the buttons whose debounced state changed.
+ */
+uint64_t ButtonGroup::DebounceScan(uint64_t sample, uint64_t & debounced, uint64_t & count0, uint64_t & count1)
+{
+    uint64_t delta = sample ^ debounced;
+    uint64_t changes;
+
+    count1 = (count1 ^ count0) & delta;
+    count0 = ~count0 & delta;
+
+    changes = delta & ~(count0 | count1);
+    debounced ^= changes;
+
+    return changes;
+}
+
+/* Read the state of all buttons in the group from the GPIO input registers.
+ *
+ * NOTE: GPIO_IN_REG holds the levels of GPIOs 0-31 and GPIO_IN1_REG those of GPIOs 32-39.
+ * Buttons are active low.
+ */
+uint64_t ButtonGroup::ReadPressed(void) const
+{
+    uint64_t levels = ((uint64_t)(REG_READ(GPIO_IN1_REG) & GPIO_IN1_DATA_NEXT) << 32) | REG_READ(GPIO_IN_REG);
+
+    return ~levels & mButtonMask;
+}
+
+void ButtonGroup::Scan(void)
+{
+    uint64_t changes = DebounceScan(ReadPressed(), mDebounced, mCount0, mCount1);
+
+    if (changes != 0)
+    {
+        // The change was first seen kDebounceScans - 1 scans ago.
+        int64_t edgeTimeUS = ::esp_timer_get_time() - (int64_t)(kDebounceScans - 1) * mScanPeriodUS;
+
+        do
+        {
+            int gpioNum = __builtin_ctzll(changes);
+            changes &= changes - 1;
+
+            mButtons[gpioNum]->ProcessEdge((mDebounced & (1ULL << gpioNum)) != 0, edgeTimeUS);
+        } while (changes != 0);
+    }
+}
+
+void ButtonGroup::HandleScanTimer(void * arg)
+{
+    static_cast<ButtonGroup *>(arg)->Scan();
+}
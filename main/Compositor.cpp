@@ -0,0 +1,591 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <string.h>
+
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "Display.h"
+
+#if CONFIG_HAVE_DISPLAY
+
+#include "Compositor.h"
+
+extern const char *TAG;
+
+Compositor DisplayCompositor;
+
+namespace {
+
+enum
+{
+    kMergeSlackPixels   = 32,       // Extra pixels that may be redrawn to avoid a separate transfer; roughly
+                                    //   the cost of setting up the transfer
+    kWindowSetupBytes   = 11,       // Bytes sent per transfer to set the display window (CASET, PASET, RAMWR)
+    kDisplayTaskStackSize = 4096,
+};
+
+// The display task runs one level above the idle task, alongside the UI (app_main) task and
+// below the Weave and network tasks, so that rendering and SPI transfers yield to them but are
+// not starved by a busy task at idle priority while holding the compositor's lock.
+const UBaseType_t kDisplayTaskPriority = tskIDLE_PRIORITY + 1;
+
+} // unnamed namespace
+
+
+// ==================== DisplayRect ====================
+
+bool DisplayRect::Intersects(const DisplayRect & other) const
+{
+    return !IsEmpty() && !other.IsEmpty() &&
+           X < other.Right() && other.X < Right() &&
+           Y < other.Bottom() && other.Y < Bottom();
+}
+
+DisplayRect DisplayRect::Intersection(const DisplayRect & other) const
+{
+    DisplayRect res = { 0, 0, 0, 0 };
+    if (Intersects(other))
+    {
+        res.X = (X > other.X) ? X : other.X;
+        res.Y = (Y > other.Y) ? Y : other.Y;
+        res.Width = (uint16_t)(((Right() < other.Right()) ? Right() : other.Right()) - res.X);
+        res.Height = (uint16_t)(((Bottom() < other.Bottom()) ? Bottom() : other.Bottom()) - res.Y);
+    }
+    return res;
+}
+
+DisplayRect DisplayRect::Union(const DisplayRect & other) const
+{
+    if (IsEmpty())
+    {
+        return other;
+    }
+    if (other.IsEmpty())
+    {
+        return *this;
+    }
+    DisplayRect res;
+    res.X = (X < other.X) ? X : other.X;
+    res.Y = (Y < other.Y) ? Y : other.Y;
+    res.Width = (uint16_t)(((Right() > other.Right()) ? Right() : other.Right()) - res.X);
+    res.Height = (uint16_t)(((Bottom() > other.Bottom()) ? Bottom() : other.Bottom()) - res.Y);
+    return res;
+}
+
+
+// ==================== Font Support ====================
+
+/* Locate a glyph in the current TFT library font.
+ *
+ * NOTE: Only proportional fonts (e.g. DEJAVU24_FONT) are supported.  The glyph layout mirrors
+ * that used by the TFT library's own print functions, so text drawn here is pixel-identical
+ * to that produced by TFT_print().
+ */
+bool GetFontGlyph(char ch, FontGlyph & glyph)
+{
+    if (cfont.font == NULL || cfont.x_size != 0)
+    {
+        return false;
+    }
+
+    const uint8_t * p = cfont.font + 4;
+
+    while (p[0] != 0xFF)
+    {
+        uint8_t charCode = p[0];
+        glyph.YOffset = p[1];
+        glyph.Width = p[2];
+        glyph.Height = p[3];
+        glyph.XOffset = (p[4] < 0x80) ? (int8_t)p[4] : (int8_t)-(0xFF - p[4]);
+        glyph.XAdvance = (glyph.Width > p[5]) ? glyph.Width : p[5];
+        glyph.Bitmap = p + 6;
+
+        if (charCode == (uint8_t)ch)
+        {
+            return true;
+        }
+
+        p += 6;
+        if (glyph.Width != 0)
+        {
+            p += ((glyph.Width * glyph.Height) - 1) / 8 + 1;
+        }
+    }
+
+    return false;
+}
+
+
+// ==================== Canvas ====================
+
+void Canvas::FillRect(int16_t x, int16_t y, uint16_t width, uint16_t height, color_t color)
+{
+    DisplayRect rect = { x, y, width, height };
+    rect = rect.Intersection(mClip);
+
+    for (int16_t row = rect.Y; row < rect.Bottom(); row++)
+    {
+        color_t * p = mBuf + (row - mClip.Y) * mClip.Width + (rect.X - mClip.X);
+        for (uint16_t i = 0; i < rect.Width; i++)
+        {
+            *p++ = color;
+        }
+    }
+}
+
+void Canvas::DrawRect(int16_t x, int16_t y, uint16_t width, uint16_t height, color_t color)
+{
+    if (width == 0 || height == 0)
+    {
+        return;
+    }
+    FillRect(x, y, width, 1, color);
+    FillRect(x, y + height - 1, width, 1, color);
+    FillRect(x, y, 1, height, color);
+    FillRect(x + width - 1, y, 1, height, color);
+}
+
+void Canvas::DrawText(const char * str, int16_t x, int16_t y, color_t color)
+{
+    FontGlyph glyph;
+
+    for (; *str != 0; str++)
+    {
+        if (!GetFontGlyph(*str, glyph))
+        {
+            continue;
+        }
+
+        DisplayRect glyphRect = { (int16_t)(x + glyph.XOffset), (int16_t)(y + glyph.YOffset), glyph.Width, glyph.Height };
+
+        if (glyphRect.Intersects(mClip))
+        {
+            for (uint16_t j = 0; j < glyph.Height; j++)
+            {
+                int16_t py = glyphRect.Y + j;
+                if (py < mClip.Y || py >= mClip.Bottom())
+                {
+                    continue;
+                }
+                for (uint16_t i = 0; i < glyph.Width; i++)
+                {
+                    int16_t px = glyphRect.X + i;
+                    uint16_t bit = i + j * glyph.Width;
+                    if (px >= mClip.X && px < mClip.Right() && (glyph.Bitmap[bit / 8] & (0x80 >> (bit % 8))) != 0)
+                    {
+                        mBuf[(py - mClip.Y) * mClip.Width + (px - mClip.X)] = color;
+                    }
+                }
+            }
+        }
+
+        x += glyph.XAdvance + 1;
+    }
+}
+
+/* Draw a 1-bit-per-pixel mask, with rows packed MSB first and without padding, using
+ * the foreground color for set bits and the background color for clear bits.
+ */
+void Canvas::DrawMask(int16_t x, int16_t y, uint16_t width, uint16_t height, const uint8_t * mask, color_t fgColor, color_t bgColor)
+{
+    DisplayRect maskRect = { x, y, width, height };
+    DisplayRect rect = maskRect.Intersection(mClip);
+
+    for (int16_t row = rect.Y; row < rect.Bottom(); row++)
+    {
+        color_t * dest = mBuf + (row - mClip.Y) * mClip.Width + (rect.X - mClip.X);
+        uint32_t bit = (uint32_t)(row - y) * width + (rect.X - x);
+        const uint8_t * maskByte = mask + bit / 8;
+        uint8_t maskBit = 0x80 >> (bit % 8);
+
+        for (uint16_t i = 0; i < rect.Width; i++)
+        {
+            *dest++ = ((*maskByte & maskBit) != 0) ? fgColor : bgColor;
+            maskBit >>= 1;
+            if (maskBit == 0)
+            {
+                maskBit = 0x80;
+                maskByte++;
+            }
+        }
+    }
+}
+
+/* Copy a horizontal run of pixels from one row of the canvas to another.
+ *
+ * NOTE: Nothing is copied if either row lies outside the clip rectangle.
+ */
+void Canvas::CopyRow(int16_t x, int16_t srcY, uint16_t width, int16_t destY)
+{
+    DisplayRect rect = { x, srcY, width, 1 };
+    rect = rect.Intersection(mClip);
+
+    if (!rect.IsEmpty() && destY >= mClip.Y && destY < mClip.Bottom())
+    {
+        color_t * rowStart = mBuf + (rect.X - mClip.X);
+        memcpy(rowStart + (destY - mClip.Y) * mClip.Width, rowStart + (srcY - mClip.Y) * mClip.Width, rect.Width * sizeof(color_t));
+    }
+}
+
+/* Draw an image from the display assets partition.
+ *
+ * NOTE: Asset pixels are already in the display's native format, so they are copied into
+ * the canvas without conversion.  Only the rows and columns that fall within the clip
+ * rectangle are read.
+ */
+void Canvas::DrawAsset(int16_t x, int16_t y, const DisplayAsset & asset)
+{
+    DisplayRect imageRect = { x, y, asset.Width, asset.Height };
+    DisplayRect rect = imageRect.Intersection(mClip);
+
+    for (int16_t row = rect.Y; row < rect.Bottom(); row++)
+    {
+        color_t * dest = mBuf + (row - mClip.Y) * mClip.Width + (rect.X - mClip.X);
+        asset.ReadRow(row - y, rect.X - x, rect.Width, dest);
+    }
+}
+
+
+// ==================== Drawable ====================
+
+/* Mark a region of the display as needing to be redrawn, if this drawable is part of the scene.
+ *
+ * NOTE: The compositor's lock must be held when calling this method.
+ */
+void Drawable::Invalidate(const DisplayRect & rect)
+{
+    if (mShown)
+    {
+        DisplayCompositor.Invalidate(rect);
+    }
+}
+
+
+// ==================== Compositor ====================
+
+esp_err_t Compositor::Init()
+{
+    mStripBuf = (color_t *)heap_caps_malloc(kStripBufPixels * sizeof(color_t), MALLOC_CAP_DMA);
+    if (mStripBuf == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate display strip buffer");
+        return ESP_ERR_NO_MEM;
+    }
+
+    mLock = xSemaphoreCreateMutex();
+    if (mLock == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    mNumDrawables = 0;
+    mNumDirtyRects = 0;
+    mRendering = false;
+    mClearPending = true;
+    mIdleWaiter = NULL;
+    mSceneStartTimeUS = 0;
+    BytesTransferred = 0;
+    Transfers = 0;
+    FlushTimeUS = 0;
+
+    if (xTaskCreate(DisplayTaskMain, "display", kDisplayTaskStackSize, this, kDisplayTaskPriority, &mTask) != pdPASS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+void Compositor::Lock()
+{
+    xSemaphoreTake(mLock, portMAX_DELAY);
+}
+
+void Compositor::Unlock()
+{
+    xSemaphoreGive(mLock);
+}
+
+/* Replace the set of objects that make up the display contents.
+ *
+ * Drawables leaving the scene are erased, and drawables entering the scene are laid out and
+ * drawn.  Drawables present in both the old and new scenes are left as they are.  The entire
+ * display is redrawn when the first scene is set, to clear whatever the display showed at
+ * power-up.
+ *
+ * NOTE: The compositor's lock must be held when calling this method.
+ */
+void Compositor::SetScene(Drawable * const * drawables, uint8_t count)
+{
+    ESP_LOGI(TAG, "Display: %u bytes in %u transfers (%u ms) since last screen change", BytesTransferred, Transfers, FlushTimeUS / 1000);
+    BytesTransferred = 0;
+    Transfers = 0;
+    FlushTimeUS = 0;
+    mSceneStartTimeUS = ::esp_timer_get_time();
+
+    if (count > kMaxDrawables)
+    {
+        count = kMaxDrawables;
+    }
+
+    // Erase the drawables that are leaving the scene.
+    for (uint8_t i = 0; i < mNumDrawables; i++)
+    {
+        bool remains = false;
+        for (uint8_t j = 0; j < count && !remains; j++)
+        {
+            remains = (drawables[j] == mDrawables[i]);
+        }
+        if (!remains)
+        {
+            Invalidate(mDrawables[i]->GetBounds());
+            mDrawables[i]->mShown = false;
+        }
+    }
+
+    // Lay out and draw the drawables that are entering the scene.
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (!drawables[i]->mShown)
+        {
+            drawables[i]->Layout();
+            drawables[i]->mShown = true;
+            Invalidate(drawables[i]->GetBounds());
+        }
+    }
+
+    mNumDrawables = count;
+    if (mNumDrawables > 0)
+    {
+        memcpy(mDrawables, drawables, mNumDrawables * sizeof(Drawable *));
+    }
+
+    if (mClearPending)
+    {
+        DisplayRect fullRect = { 0, 0, DisplayWidth, DisplayHeight };
+        Invalidate(fullRect);
+        mClearPending = false;
+    }
+}
+
+/* Mark a region of the display as needing to be redrawn on the next flush.
+ *
+ * NOTE: The compositor's lock must be held when calling this method.
+ */
+void Compositor::Invalidate(const DisplayRect & rect)
+{
+    DisplayRect fullRect = { 0, 0, DisplayWidth, DisplayHeight };
+    DisplayRect newRect = rect.Intersection(fullRect);
+
+    if (newRect.IsEmpty())
+    {
+        return;
+    }
+
+    // Merge the new rectangle with any existing dirty rectangle that overlaps it, or that lies close enough
+    // that redrawing the area between the two is cheaper than a separate transfer.  Repeat until no further
+    // merges are possible, since each merge grows the new rectangle.
+    uint8_t i = 0;
+    while (i < mNumDirtyRects)
+    {
+        DisplayRect merged = mDirtyRects[i].Union(newRect);
+
+        if (mDirtyRects[i].Intersects(newRect) ||
+            merged.Area() <= mDirtyRects[i].Area() + newRect.Area() + kMergeSlackPixels)
+        {
+            newRect = merged;
+            RemoveDirtyRect(i);
+            i = 0;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    // If the dirty rectangle list is full, merge the new rectangle with the existing rectangle that results
+    // in the smallest increase in redrawn area.
+    if (mNumDirtyRects == kMaxDirtyRects)
+    {
+        uint8_t bestIndex = 0;
+        uint32_t bestCost = UINT32_MAX;
+
+        for (i = 0; i < mNumDirtyRects; i++)
+        {
+            uint32_t cost = mDirtyRects[i].Union(newRect).Area() - mDirtyRects[i].Area();
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestIndex = i;
+            }
+        }
+
+        newRect = mDirtyRects[bestIndex].Union(newRect);
+        RemoveDirtyRect(bestIndex);
+    }
+
+    mDirtyRects[mNumDirtyRects++] = newRect;
+}
+
+/* Signal the display task to redraw all dirty regions of the display.
+ */
+void Compositor::Flush()
+{
+    xTaskNotifyGive(mTask);
+}
+
+/* Block the calling task until the display task has finished redrawing all dirty regions.
+ *
+ * Any dirty regions that have not yet been flushed are flushed, so that the wait always ends,
+ * whether or not the caller has called Flush().  Returns immediately if there are no dirty regions
+ * and the display task is not rendering.
+ *
+ * NOTE: The compositor's lock must NOT be held when calling this method.  Only one task may
+ * wait at a time.
+ */
+void Compositor::WaitForIdle()
+{
+    bool idle;
+
+    Lock();
+    idle = (mNumDirtyRects == 0 && !mRendering);
+    if (!idle)
+    {
+        mIdleWaiter = xTaskGetCurrentTaskHandle();
+    }
+    Unlock();
+
+    if (!idle)
+    {
+        Flush();
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+void Compositor::RemoveDirtyRect(uint8_t index)
+{
+    mNumDirtyRects--;
+    mDirtyRects[index] = mDirtyRects[mNumDirtyRects];
+}
+
+/* Redraw dirty regions until none remain.
+ *
+ * NOTE: This method runs on the display task.
+ */
+void Compositor::RenderDirtyRects()
+{
+    int64_t startTimeUS = ::esp_timer_get_time();
+
+    Lock();
+
+    mRendering = true;
+
+    while (mNumDirtyRects > 0)
+    {
+        DisplayRect rect = mDirtyRects[--mNumDirtyRects];
+        RenderRect(rect);
+    }
+
+    FlushTimeUS += (uint32_t)(::esp_timer_get_time() - startTimeUS);
+
+    // Log the time taken to fully draw a new screen, measured from when the scene was changed.
+    if (mSceneStartTimeUS != 0)
+    {
+        ESP_LOGI(TAG, "Display: screen drawn in %u ms", (uint32_t)((::esp_timer_get_time() - mSceneStartTimeUS) / 1000));
+        mSceneStartTimeUS = 0;
+    }
+
+    mRendering = false;
+
+    // Wake any task waiting for the display to become idle.
+    if (mIdleWaiter != NULL)
+    {
+        xTaskNotifyGive(mIdleWaiter);
+        mIdleWaiter = NULL;
+    }
+
+    Unlock();
+}
+
+/* Render a region of the display in horizontal strips, sending each strip to the display
+ * in a single windowed transfer.
+ *
+ * NOTE: This method is called with the compositor's lock held, but releases it while
+ * sending each strip to the display.  Regions invalidated in the meantime are added to
+ * the dirty list and redrawn by a later pass.
+ */
+void Compositor::RenderRect(const DisplayRect & rect)
+{
+    Canvas canvas;
+    uint16_t stripLines = kStripBufPixels / rect.Width;
+
+    canvas.mBuf = mStripBuf;
+
+    for (int16_t y = rect.Y; y < rect.Bottom(); y += stripLines)
+    {
+        uint16_t lines = (rect.Bottom() - y < stripLines) ? (uint16_t)(rect.Bottom() - y) : stripLines;
+        uint32_t pixelCount = (uint32_t)rect.Width * lines;
+
+        canvas.mClip.X = rect.X;
+        canvas.mClip.Y = y;
+        canvas.mClip.Width = rect.Width;
+        canvas.mClip.Height = lines;
+
+        // Clear the strip to the background color and render each drawable that overlaps it.
+        memset(mStripBuf, 0, pixelCount * sizeof(color_t));
+        for (uint8_t i = 0; i < mNumDrawables; i++)
+        {
+            if (mDrawables[i]->GetBounds().Intersects(canvas.mClip))
+            {
+                mDrawables[i]->Render(canvas);
+            }
+        }
+
+        Unlock();
+
+        // Send the strip to the display.
+        disp_select();
+        send_data(rect.X, y, rect.Right() - 1, y + lines - 1, pixelCount, mStripBuf);
+        disp_deselect();
+
+        Lock();
+
+        BytesTransferred += pixelCount * sizeof(color_t) + kWindowSetupBytes;
+        Transfers++;
+    }
+}
+
+void Compositor::DisplayTaskMain(void * arg)
+{
+    Compositor * self = (Compositor *)arg;
+
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->RenderDirtyRects();
+    }
+}
+
+#endif // CONFIG_HAVE_DISPLAY
@@ -0,0 +1,336 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+#include <Weave/Support/ErrorStr.h>
+
+#include "ConnectivityTimeline.h"
+#include "Histogram.h"
+
+#if CONFIG_CONNECTIVITY_TIMELINE_COUNT
+
+using namespace ::nl;
+using namespace ::nl::Weave;
+using namespace ::nl::Weave::DeviceLayer;
+
+extern const char * TAG;
+
+namespace {
+
+enum
+{
+    kAllMilestones = (1 << kConnectivityMilestone_NumMilestones) - 1,
+    kNumSteps = kConnectivityMilestone_NumMilestones + 1,  // Time to regain each milestone, plus the whole outage
+    kStep_Outage = kConnectivityMilestone_NumMilestones,
+    kNumDurationBuckets = 12,                               // Histogram buckets: <64ms, <128ms, ... <65536ms, >=65536ms
+    kFirstBucketLimitMS = 64,
+};
+
+const uint32_t kNotReached = UINT32_MAX;
+
+const char * const MilestoneNames[kConnectivityMilestone_NumMilestones] =
+{
+    "wifi",
+    "ipv4",
+    "tunnel",
+    "subscription",
+};
+
+const char * const StepNames[kNumSteps] =
+{
+    "to-wifi",
+    "wifi-to-ipv4",
+    "ipv4-to-tunnel",
+    "tunnel-to-sub",
+    "outage",
+};
+
+uint8_t CurrentMask;
+bool InOutage;
+ConnectivityTimeline CurTimeline;
+
+// Ring buffer of the most recent completed timelines.
+ConnectivityTimeline Timelines[CONFIG_CONNECTIVITY_TIMELINE_COUNT];
+uint32_t TimelineCount;
+
+uint32_t StepHistograms[kNumSteps][kNumDurationBuckets];
+
+uint8_t SampleMilestones(void)
+{
+    uint8_t mask = 0;
+
+    if (ConnectivityMgr().IsWiFiStationConnected())
+    {
+        mask |= (1 << kConnectivityMilestone_WiFiStation);
+    }
+    if (ConnectivityMgr().HaveIPv4InternetConnectivity())
+    {
+        mask |= (1 << kConnectivityMilestone_IPv4);
+    }
+    if (ConnectivityMgr().HaveServiceConnectivity())
+    {
+        mask |= (1 << kConnectivityMilestone_ServiceTunnel);
+    }
+    if (TraitMgr().IsServiceSubscriptionEstablished())
+    {
+        mask |= (1 << kConnectivityMilestone_Subscription);
+    }
+
+    return mask;
+}
+
+void BeginTimeline(uint32_t startTimeMS, uint8_t upMask, bool isReconnect)
+{
+    CurTimeline.StartTimeMS = startTimeMS;
+    for (uint8_t i = 0; i < kConnectivityMilestone_NumMilestones; i++)
+    {
+        // Milestones that remain up through the outage are considered to have been reached at its start.
+        CurTimeline.MilestoneTimeMS[i] = (upMask & (1 << i)) ? 0 : kNotReached;
+    }
+    CurTimeline.Setbacks = 0;
+    CurTimeline.LostMask = 0;
+    CurTimeline.IsReconnect = isReconnect;
+    InOutage = true;
+}
+
+/* Compute the time taken to pass through each step of a completed timeline.
+ *
+ * The time to regain a milestone is measured from the time the previous milestone was regained
+ * (or from the start of the outage if the previous milestone remained up).  Steps for milestones
+ * that remained up through the outage are reported as kNotReached.
+ */
+void ComputeStepDurations(const ConnectivityTimeline & timeline, uint32_t (&durationsMS)[kNumSteps])
+{
+    uint32_t prevTimeMS = 0;
+
+    durationsMS[kStep_Outage] = 0;
+
+    for (uint8_t i = 0; i < kConnectivityMilestone_NumMilestones; i++)
+    {
+        uint32_t timeMS = timeline.MilestoneTimeMS[i];
+
+        if (timeline.LostMask & (1 << i))
+        {
+            // Milestones may occasionally be regained out of order (e.g. if the IPv4 Internet
+            // connectivity check completes after the tunnel is established).
+            durationsMS[i] = (timeMS > prevTimeMS) ? timeMS - prevTimeMS : 0;
+        }
+        else
+        {
+            durationsMS[i] = kNotReached;
+        }
+
+        if (timeMS > durationsMS[kStep_Outage])
+        {
+            durationsMS[kStep_Outage] = timeMS;
+        }
+
+        prevTimeMS = timeMS;
+    }
+}
+
+void CompleteTimeline(void)
+{
+    uint32_t durationsMS[kNumSteps];
+    char stepsBuf[96];
+    int len = 0;
+
+    ComputeStepDurations(CurTimeline, durationsMS);
+
+    for (uint8_t i = 0; i < kNumSteps; i++)
+    {
+        if (durationsMS[i] != kNotReached)
+        {
+            AddToLog2Histogram(StepHistograms[i], durationsMS[i], kFirstBucketLimitMS);
+
+            if (i != kStep_Outage && len >= 0 && len < (int)sizeof(stepsBuf))
+            {
+                len += snprintf(stepsBuf + len, sizeof(stepsBuf) - len, "%s%s %" PRIu32 " ms",
+                                (len != 0) ? ", " : "", StepNames[i], durationsMS[i]);
+            }
+        }
+    }
+    if (len == 0)
+    {
+        stepsBuf[0] = 0;
+    }
+
+    Timelines[TimelineCount % CONFIG_CONNECTIVITY_TIMELINE_COUNT] = CurTimeline;
+    TimelineCount++;
+    InOutage = false;
+
+    ESP_LOGI(TAG, "Fully %s after %" PRIu32 " ms (%s; %" PRIu16 " setbacks)",
+             (CurTimeline.IsReconnect) ? "reconnected" : "connected", durationsMS[kStep_Outage],
+             stepsBuf, CurTimeline.Setbacks);
+}
+
+/* Timestamp transitions in the device's connectivity milestones.
+ *
+ * The milestones are sampled after every device event, so that transitions are timestamped
+ * as soon as the Weave stack acts upon the underlying event, rather than when the UI next
+ * polls the connectivity state.
+ */
+void HandleDeviceEvent(const WeaveDeviceEvent * event, intptr_t arg)
+{
+    uint8_t mask = SampleMilestones();
+    uint8_t lostMask = CurrentMask & ~mask;
+    uint8_t gainedMask = mask & ~CurrentMask;
+    uint32_t nowMS;
+
+    if (mask == CurrentMask)
+    {
+        return;
+    }
+
+    nowMS = (uint32_t)(::esp_timer_get_time() / 1000);
+
+    // If any milestone has been lost while fully connected, begin a new outage.
+    if (!InOutage)
+    {
+        BeginTimeline(nowMS, mask, true);
+    }
+
+    for (uint8_t i = 0; i < kConnectivityMilestone_NumMilestones; i++)
+    {
+        uint8_t bit = (1 << i);
+
+        if (lostMask & bit)
+        {
+            // Losing a milestone that was already regained during this outage is a setback.
+            if (CurTimeline.LostMask & bit)
+            {
+                CurTimeline.Setbacks++;
+            }
+            CurTimeline.LostMask |= bit;
+            CurTimeline.MilestoneTimeMS[i] = kNotReached;
+        }
+        else if (gainedMask & bit)
+        {
+            CurTimeline.LostMask |= bit;
+            CurTimeline.MilestoneTimeMS[i] = nowMS - CurTimeline.StartTimeMS;
+        }
+
+        if ((lostMask | gainedMask) & bit)
+        {
+            ESP_LOGI(TAG, "Connectivity: %s %s at %" PRIu32 " ms (+%" PRIu32 " ms into %s)",
+                     MilestoneNames[i], (gainedMask & bit) ? "up" : "down", nowMS,
+                     nowMS - CurTimeline.StartTimeMS, (CurTimeline.IsReconnect) ? "outage" : "boot");
+        }
+    }
+
+    CurrentMask = mask;
+
+    if (mask == kAllMilestones)
+    {
+        CompleteTimeline();
+    }
+}
+
+void PrintTimeline(const ConnectivityTimeline & timeline)
+{
+    printf("  %" PRIu32 ",%s,0x%" PRIX8, timeline.StartTimeMS, (timeline.IsReconnect) ? "reconnect" : "initial",
+           timeline.LostMask);
+    for (uint8_t i = 0; i < kConnectivityMilestone_NumMilestones; i++)
+    {
+        if (timeline.MilestoneTimeMS[i] != kNotReached)
+        {
+            printf(",%" PRIu32, timeline.MilestoneTimeMS[i]);
+        }
+        else
+        {
+            printf(",-");
+        }
+    }
+    printf(",%" PRIu16 "\n", timeline.Setbacks);
+}
+
+} // unnamed namespace
+
+WEAVE_ERROR StartConnectivityTimeline(void)
+{
+    WEAVE_ERROR err;
+
+    // The initial timeline runs from boot until the device is first fully connected.
+    CurrentMask = 0;
+    BeginTimeline(0, 0, false);
+
+    err = PlatformMgr().AddEventHandler(HandleDeviceEvent, 0);
+    if (err != WEAVE_NO_ERROR)
+    {
+        ESP_LOGE(TAG, "PlatformMgr().AddEventHandler() failed: %s", ErrorStr(err));
+    }
+
+    return err;
+}
+
+/* Print the step duration histograms and the most recent connectivity timelines, oldest first.
+ *
+ * NOTE: The caller must hold the Weave stack lock.
+ */
+void DumpConnectivityTimeline(void)
+{
+    uint32_t numTimelines = (TimelineCount < CONFIG_CONNECTIVITY_TIMELINE_COUNT) ? TimelineCount : CONFIG_CONNECTIVITY_TIMELINE_COUNT;
+
+    printf("DumpConnectivityTimeline: step duration histograms\n");
+    printf("  bucket");
+    for (uint8_t s = 0; s < kNumSteps; s++)
+    {
+        printf(",%s", StepNames[s]);
+    }
+    printf("\n");
+    for (uint8_t i = 0; i < kNumDurationBuckets; i++)
+    {
+        if (i < kNumDurationBuckets - 1)
+        {
+            printf("  <%" PRIu32 " ms", Log2HistogramBucketLimit(kFirstBucketLimitMS, i));
+        }
+        else
+        {
+            printf("  >=%" PRIu32 " ms", Log2HistogramBucketLimit(kFirstBucketLimitMS, i - 1));
+        }
+        for (uint8_t s = 0; s < kNumSteps; s++)
+        {
+            printf(",%" PRIu32, StepHistograms[s][i]);
+        }
+        printf("\n");
+    }
+
+    printf("DumpConnectivityTimeline: %" PRIu32 " timelines (%" PRIu32 " total)\n", numTimelines, TimelineCount);
+    printf("  start-ms,type,lost-mask");
+    for (uint8_t i = 0; i < kConnectivityMilestone_NumMilestones; i++)
+    {
+        printf(",%s-ms", MilestoneNames[i]);
+    }
+    printf(",setbacks\n");
+    for (uint32_t n = TimelineCount - numTimelines; n < TimelineCount; n++)
+    {
+        PrintTimeline(Timelines[n % CONFIG_CONNECTIVITY_TIMELINE_COUNT]);
+    }
+
+    if (InOutage)
+    {
+        printf("DumpConnectivityTimeline: outage in progress\n");
+        PrintTimeline(CurTimeline);
+    }
+}
+
+#endif // CONFIG_CONNECTIVITY_TIMELINE_COUNT
@@ -45,15 +45,18 @@ void CountdownWidget::Init(uint8_t numIndicators, uint32_t intervalMS)
 
     for (uint8_t i = 0; i < mNumIndicators; i++)
     {
-        Char[i] = '0' + (mNumIndicators - i);
-        State[i] = false;
+        SetChar(i, '0' + (mNumIndicators - i));
     }
 }
 
 void CountdownWidget::Start(uint32_t elapsedTime)
 {
     mStartTimeUS = ::esp_timer_get_time() - elapsedTime;
-    Display();
+    for (uint8_t i = 0; i < mNumIndicators; i++)
+    {
+        SetState(i, false);
+    }
+    Update();
 }
 
 void CountdownWidget::Update()
@@ -65,9 +68,8 @@ void CountdownWidget::Update()
         {
             for (uint8_t i = 0; i < mNumIndicators; i++)
             {
-                State[i] = (i < elapsedCount);
+                SetState(i, (i < elapsedCount));
             }
-            StatusIndicatorWidget::Update();
         }
     }
 }
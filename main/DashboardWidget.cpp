@@ -0,0 +1,340 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_system.h"
+#include "esp_log.h"
+
+#include "Display.h"
+
+#if CONFIG_HAVE_DISPLAY
+
+#include "DashboardWidget.h"
+
+extern const char *TAG;
+
+namespace {
+
+struct MetricInfo
+{
+    const char * Label;
+    const char * ValueFormat;
+    uint16_t RangeStep;         // Granularity with which a graph's range is expanded
+    bool ZeroBased;             // Whether the graph's range always starts at zero
+};
+
+const MetricInfo sMetricInfo[DashboardWidget::kNumMetrics] =
+{
+    { "RTT",  "%u ms",  50, true  },
+    { "Heap", "%u KB",  8,  false },
+    { "Loop", "%u ms",  10, true  },
+    { "Cmds", "%u/min", 10, true  },
+};
+
+} // unnamed namespace
+
+void DashboardWidget::Init()
+{
+    LabelColor = { 141, 151, 155 }; // PANTONE 443 C
+    ValueColor = { 4, 173, 201 }; // PANTONE 3125 C
+    GraphColor = { 4, 173, 201 }; // PANTONE 3125 C
+    AxisColor = { 60, 64, 66 };
+
+    mHistoryLen = DisplayWidth - (DisplayWidth * kLabelWidth) / 100 - kMarginPix;
+    if (mHistoryLen > kMaxHistory)
+    {
+        mHistoryLen = kMaxHistory;
+    }
+    mCursor = 0;
+    mNumSamples = 0;
+
+    memset(mGraphs, 0, sizeof(mGraphs));
+    for (uint8_t i = 0; i < kNumMetrics; i++)
+    {
+        strcpy(mGraphs[i].ValueText, "--");
+    }
+}
+
+/* Add a sample of each metric, drawing it at the cursor and advancing the cursor.
+ *
+ * NOTE: The compositor's lock must be held when calling this method.
+ */
+void DashboardWidget::AddSample(const uint16_t (&values)[kNumMetrics])
+{
+    uint16_t column = mCursor;
+
+    mCursor = (mCursor + 1) % mHistoryLen;
+    if (mNumSamples < mHistoryLen)
+    {
+        mNumSamples++;
+    }
+
+    for (uint8_t i = 0; i < kNumMetrics; i++)
+    {
+        mGraphs[i].Samples[column] = values[i];
+        UpdateValueText(i, values[i]);
+        UpdateRange(i, values[i]);
+    }
+
+    // Redraw the new sample, the blank column that now follows it, and the column after that,
+    // which is no longer connected to its predecessor.
+    for (uint16_t i = 0; i < 3; i++)
+    {
+        InvalidateColumn((column + i) % mHistoryLen);
+    }
+}
+
+DisplayRect DashboardWidget::GetBounds() const
+{
+    DisplayRect rect = { 0, 0, DisplayWidth, DisplayHeight };
+    return rect;
+}
+
+void DashboardWidget::Render(Canvas & canvas)
+{
+    for (uint8_t i = 0; i < kNumMetrics; i++)
+    {
+        const Graph & graph = mGraphs[i];
+
+        if (graph.LabelRect.Intersects(canvas.ClipRect()))
+        {
+            canvas.DrawText(sMetricInfo[i].Label, graph.LabelRect.X, graph.LabelRect.Y, LabelColor);
+        }
+        if (graph.ValueRect.Intersects(canvas.ClipRect()))
+        {
+            canvas.DrawText(graph.ValueText, graph.ValueRect.X, graph.ValueRect.Y, ValueColor);
+        }
+        if (graph.PlotRect.Intersects(canvas.ClipRect()))
+        {
+            RenderPlot(canvas, graph);
+        }
+    }
+}
+
+void DashboardWidget::Layout()
+{
+    uint16_t rowHeight = DisplayHeight / kNumMetrics;
+    uint16_t fontHeight;
+
+    TFT_setFont(DEJAVU24_FONT, NULL);
+    fontHeight = (uint16_t)TFT_getfontheight();
+
+    for (uint8_t i = 0; i < kNumMetrics; i++)
+    {
+        Graph & graph = mGraphs[i];
+        int16_t rowY = (int16_t)(i * rowHeight);
+
+        // Stack the label and the current value in the label column, centered vertically in the row.
+        graph.LabelRect.X = kMarginPix;
+        graph.LabelRect.Y = rowY + (int16_t)((rowHeight - 2 * fontHeight) / 2);
+        graph.LabelRect.Width = (uint16_t)TFT_getStringWidth((char *)sMetricInfo[i].Label);
+        graph.LabelRect.Height = fontHeight;
+
+        graph.ValueRect.X = kMarginPix;
+        graph.ValueRect.Y = graph.LabelRect.Bottom();
+        graph.ValueRect.Width = (uint16_t)TFT_getStringWidth(graph.ValueText);
+        graph.ValueRect.Height = fontHeight;
+
+        graph.PlotRect.X = (int16_t)(DisplayWidth - kMarginPix - mHistoryLen);
+        graph.PlotRect.Y = rowY + kMarginPix;
+        graph.PlotRect.Width = mHistoryLen;
+        graph.PlotRect.Height = rowHeight - 2 * kMarginPix;
+    }
+}
+
+/* Compute the range, rounded out to the metric's range step, needed to show a single value.
+ */
+void DashboardWidget::GetValueRange(uint8_t metric, uint16_t value, uint16_t & rangeMin, uint16_t & rangeMax)
+{
+    const MetricInfo & info = sMetricInfo[metric];
+    uint32_t max = ((uint32_t)value / info.RangeStep + 1) * info.RangeStep;
+
+    rangeMin = (info.ZeroBased) ? 0 : (value / info.RangeStep) * info.RangeStep;
+    rangeMax = (max < UINT16_MAX) ? (uint16_t)max : UINT16_MAX;
+}
+
+/* Update the range of a graph following the addition of a new sample.
+ *
+ * The range is expanded immediately to include the new sample.  It is only reduced when a
+ * sample that determined the minimum or maximum of the range scrolls out of the graph (i.e.
+ * reaches the blank column at the cursor), at which point it is recomputed from the samples
+ * still shown, so that a single spike does not flatten the graph for the rest of its history.
+ *
+ * NOTE: Must be called after the new sample has been stored and the cursor advanced.
+ */
+void DashboardWidget::UpdateRange(uint8_t metric, uint16_t value)
+{
+    Graph & graph = mGraphs[metric];
+    uint16_t rangeMin, rangeMax;
+    bool recompute = false;
+
+    // Determine whether the sample that has just scrolled out of the graph set its range.
+    if (mCursor < mNumSamples && graph.RangeMax != 0)
+    {
+        uint16_t oldMin, oldMax;
+
+        GetValueRange(metric, graph.Samples[mCursor], oldMin, oldMax);
+        recompute = (oldMax == graph.RangeMax || (!sMetricInfo[metric].ZeroBased && oldMin == graph.RangeMin));
+    }
+
+    if (recompute)
+    {
+        rangeMin = UINT16_MAX;
+        rangeMax = 0;
+
+        for (uint16_t column = 0; column < mNumSamples; column++)
+        {
+            uint16_t sampleMin, sampleMax;
+
+            if (column == mCursor)
+            {
+                continue;
+            }
+
+            GetValueRange(metric, graph.Samples[column], sampleMin, sampleMax);
+            if (sampleMin < rangeMin)
+            {
+                rangeMin = sampleMin;
+            }
+            if (sampleMax > rangeMax)
+            {
+                rangeMax = sampleMax;
+            }
+        }
+    }
+    else
+    {
+        GetValueRange(metric, value, rangeMin, rangeMax);
+
+        // The range of an empty graph is set by its first sample.
+        if (graph.RangeMax != 0)
+        {
+            if (graph.RangeMin < rangeMin)
+            {
+                rangeMin = graph.RangeMin;
+            }
+            if (graph.RangeMax > rangeMax)
+            {
+                rangeMax = graph.RangeMax;
+            }
+        }
+    }
+
+    if (rangeMin != graph.RangeMin || rangeMax != graph.RangeMax)
+    {
+        graph.RangeMin = rangeMin;
+        graph.RangeMax = rangeMax;
+
+        // All of the samples move when the range changes.
+        Invalidate(graph.PlotRect);
+    }
+}
+
+void DashboardWidget::UpdateValueText(uint8_t metric, uint16_t value)
+{
+    Graph & graph = mGraphs[metric];
+    char valueText[kMaxValueTextLength];
+
+    snprintf(valueText, sizeof(valueText), sMetricInfo[metric].ValueFormat, value);
+
+    if (strcmp(valueText, graph.ValueText) != 0)
+    {
+        Invalidate(graph.ValueRect);
+
+        strcpy(graph.ValueText, valueText);
+        TFT_setFont(DEJAVU24_FONT, NULL);
+        graph.ValueRect.Width = (uint16_t)TFT_getStringWidth(graph.ValueText);
+
+        Invalidate(graph.ValueRect);
+    }
+}
+
+/* Invalidate a single column of every graph.
+ */
+void DashboardWidget::InvalidateColumn(uint16_t column)
+{
+    const DisplayRect & firstPlot = mGraphs[0].PlotRect;
+    const DisplayRect & lastPlot = mGraphs[kNumMetrics - 1].PlotRect;
+
+    DisplayRect rect = { (int16_t)(firstPlot.X + column), firstPlot.Y, 1, (uint16_t)(lastPlot.Bottom() - firstPlot.Y) };
+    Invalidate(rect);
+}
+
+int16_t DashboardWidget::ValueToY(const Graph & graph, uint16_t value) const
+{
+    if (value < graph.RangeMin)
+    {
+        value = graph.RangeMin;
+    }
+    if (value > graph.RangeMax)
+    {
+        value = graph.RangeMax;
+    }
+
+    return (int16_t)(graph.PlotRect.Bottom() - 1 -
+                     ((uint32_t)(value - graph.RangeMin) * (graph.PlotRect.Height - 1)) / (graph.RangeMax - graph.RangeMin));
+}
+
+/* Draw the columns of a graph that lie within the canvas's clip rectangle.
+ *
+ * NOTE: Each sample is drawn as a vertical span joining it to the previous sample, unless the
+ * previous column is the blank column at the cursor, or the sample is in the first column.
+ */
+void DashboardWidget::RenderPlot(Canvas & canvas, const Graph & graph)
+{
+    DisplayRect drawRect = graph.PlotRect.Intersection(canvas.ClipRect());
+
+    for (int16_t x = drawRect.X; x < drawRect.Right(); x++)
+    {
+        uint16_t column = (uint16_t)(x - graph.PlotRect.X);
+
+        if (column == mCursor)
+        {
+            continue;
+        }
+
+        canvas.FillRect(x, graph.PlotRect.Bottom() - 1, 1, 1, AxisColor);
+
+        if (column >= mNumSamples || graph.RangeMax == 0)
+        {
+            continue;
+        }
+
+        int16_t y = ValueToY(graph, graph.Samples[column]);
+        int16_t spanTop = y, spanBottom = y;
+
+        if (column > 0 && column - 1 != mCursor)
+        {
+            int16_t prevY = ValueToY(graph, graph.Samples[column - 1]);
+            if (prevY < spanTop)
+            {
+                spanTop = prevY;
+            }
+            if (prevY > spanBottom)
+            {
+                spanBottom = prevY;
+            }
+        }
+
+        canvas.FillRect(x, spanTop, 1, (uint16_t)(spanBottom - spanTop + 1), GraphColor);
+    }
+}
+
+#endif // CONFIG_HAVE_DISPLAY
@@ -0,0 +1,473 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_ota_ops.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "mbedtls/md.h"
+#include "mbedtls/sha256.h"
+#include "rom/miniz.h"
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+#include <Weave/Support/ErrorStr.h>
+#include "DeltaOTA.h"
+
+using namespace ::nl;
+
+extern const char * TAG;
+
+namespace {
+
+enum
+{
+    kMinWindowBits = 9,
+    kMaxWindowBits = 15,
+    kReadBlockSize = 1024,
+    kServerTaskStackSize = 4096,
+    kServerTaskPriority = 1,
+    kServerRecvTimeoutSec = 10,
+    kServerKeyLen = 32,
+};
+
+DeltaOTAUpdater sServerUpdater;
+uint16_t sServerPort;
+uint8_t sServerKey[kServerKeyLen];
+uint8_t sServerRecvBuf[1024];
+
+} // unnamed namespace
+
+DeltaOTAUpdater::DeltaOTAUpdater(void)
+{
+    mInflator = NULL;
+    mWindow = NULL;
+    mActive = false;
+    mOTAStarted = false;
+}
+
+/* Prepare to receive a delta OTA image, authenticated with the given key.
+ *
+ * NOTE: The key is not copied, and must remain valid until the update ends.
+ */
+esp_err_t DeltaOTAUpdater::Begin(const uint8_t * key, size_t keyLen)
+{
+    esp_err_t err = ESP_OK;
+
+    Abort();
+
+    VerifyOrExit(key != NULL && keyLen != 0, err = ESP_ERR_INVALID_ARG);
+    mKey = key;
+    mKeyLen = keyLen;
+
+    mOldPartition = esp_ota_get_running_partition();
+    mNewPartition = esp_ota_get_next_update_partition(NULL);
+    VerifyOrExit(mOldPartition != NULL && mNewPartition != NULL, err = ESP_ERR_NOT_FOUND);
+
+    mHeaderLen = 0;
+    mWindowPos = 0;
+    mFlashErr = ESP_OK;
+    mInflateDone = false;
+    mActive = true;
+
+exit:
+    return err;
+}
+
+/* Process the next piece of the delta OTA image.
+ *
+ * NOTE: On failure, the update is aborted.
+ */
+esp_err_t DeltaOTAUpdater::Write(const uint8_t * data, size_t len)
+{
+    esp_err_t err = ESP_OK;
+    tinfl_status inflateStatus = TINFL_STATUS_NEEDS_MORE_INPUT;
+    int status;
+
+    VerifyOrExit(mActive, err = ESP_ERR_INVALID_STATE);
+
+    // Accumulate the header, and once it is complete, check it and prepare to apply the patch.
+    if (mHeaderLen < sizeof(mHeader))
+    {
+        size_t n = sizeof(mHeader) - mHeaderLen;
+        if (n > len)
+        {
+            n = len;
+        }
+        memcpy((uint8_t *)&mHeader + mHeaderLen, data, n);
+        mHeaderLen += n;
+        data += n;
+        len -= n;
+
+        if (mHeaderLen == sizeof(mHeader))
+        {
+            err = StartPatch();
+            SuccessOrExit(err);
+        }
+    }
+
+    // Decompress the patch records into the window, applying each piece as it is produced.  The
+    // decompressor may hold more output than fits in the window, even once all input is consumed.
+    while (!mInflateDone && (len > 0 || inflateStatus == TINFL_STATUS_HAS_MORE_OUTPUT))
+    {
+        size_t inBytes = len;
+        size_t outBytes = ((size_t)1 << mHeader.WindowBits) - mWindowPos;
+
+        inflateStatus = tinfl_decompress(mInflator, data, &inBytes, mWindow, mWindow + mWindowPos, &outBytes, TINFL_FLAG_HAS_MORE_INPUT);
+        VerifyOrExit(inflateStatus >= TINFL_STATUS_DONE, err = ESP_ERR_INVALID_ARG);
+
+        data += inBytes;
+        len -= inBytes;
+
+        if (outBytes != 0)
+        {
+            status = mPatcher.Apply(mWindow + mWindowPos, outBytes);
+            VerifyOrExit(status != DeltaPatcher::kStatus_ReadError && status != DeltaPatcher::kStatus_WriteError,
+                         err = (mFlashErr != ESP_OK) ? mFlashErr : ESP_FAIL);
+            VerifyOrExit(status == DeltaPatcher::kStatus_OK, err = ESP_ERR_INVALID_ARG);
+            mWindowPos = (mWindowPos + outBytes) & (((size_t)1 << mHeader.WindowBits) - 1);
+        }
+
+        mInflateDone = (inflateStatus == TINFL_STATUS_DONE);
+    }
+
+    // Data following the end of the deflate stream is invalid.
+    VerifyOrExit(len == 0, err = ESP_ERR_INVALID_ARG);
+
+exit:
+    if (err != ESP_OK)
+    {
+        Abort();
+    }
+    return err;
+}
+
+/* Complete the update, verifying the new application and making it the boot partition.
+ */
+esp_err_t DeltaOTAUpdater::End(void)
+{
+    esp_err_t err = ESP_OK;
+    uint8_t digest[32];
+
+    VerifyOrExit(mActive && mOTAStarted && mInflateDone, err = ESP_ERR_INVALID_STATE);
+
+    VerifyOrExit(mPatcher.Finish() == DeltaPatcher::kStatus_OK, err = (mFlashErr != ESP_OK) ? mFlashErr : ESP_ERR_INVALID_ARG);
+
+    mbedtls_sha256_finish(&mNewSHA256, digest);
+    VerifyOrExit(memcmp(digest, mHeader.NewSHA256, sizeof(digest)) == 0, err = ESP_ERR_OTA_VALIDATE_FAILED);
+
+    mOTAStarted = false;
+    err = esp_ota_end(mOTAHandle);
+    SuccessOrExit(err);
+
+    err = esp_ota_set_boot_partition(mNewPartition);
+    SuccessOrExit(err);
+
+    ESP_LOGI(TAG, "Delta OTA update complete: %u byte application written to partition %s",
+             mHeader.NewSize, mNewPartition->label);
+
+exit:
+    Abort();
+    return err;
+}
+
+/* Abandon the update in progress, if any, releasing its resources.
+ */
+void DeltaOTAUpdater::Abort(void)
+{
+    if (mOTAStarted)
+    {
+        // Ending the OTA releases its handle; the incomplete image fails validation and is not used.
+        esp_ota_end(mOTAHandle);
+        mOTAStarted = false;
+    }
+    if (mActive && mHeaderLen == sizeof(mHeader))
+    {
+        mbedtls_sha256_free(&mNewSHA256);
+    }
+    free(mInflator);
+    mInflator = NULL;
+    free(mWindow);
+    mWindow = NULL;
+    mActive = false;
+}
+
+/* Check the header of the delta OTA image, and prepare to apply its patch records.
+ */
+esp_err_t DeltaOTAUpdater::StartPatch(void)
+{
+    esp_err_t err;
+
+    mbedtls_sha256_init(&mNewSHA256);
+    mbedtls_sha256_starts(&mNewSHA256, 0);
+
+    VerifyOrExit(mHeader.Magic == DeltaPatchHeader::kMagic, err = ESP_ERR_INVALID_ARG);
+    VerifyOrExit(mHeader.Version == DeltaPatchHeader::kVersion, err = ESP_ERR_NOT_SUPPORTED);
+
+    // Authenticate the header before acting on anything else in it.
+    err = CheckHeaderMAC();
+    SuccessOrExit(err);
+
+    VerifyOrExit(mHeader.WindowBits >= kMinWindowBits && mHeader.WindowBits <= kMaxWindowBits, err = ESP_ERR_NOT_SUPPORTED);
+    VerifyOrExit(mHeader.OldSize <= mOldPartition->size && mHeader.NewSize <= mNewPartition->size, err = ESP_ERR_INVALID_SIZE);
+
+    err = CheckOldImage();
+    SuccessOrExit(err);
+
+    mInflator = (tinfl_decompressor *)malloc(sizeof(tinfl_decompressor));
+    mWindow = (uint8_t *)malloc((size_t)1 << mHeader.WindowBits);
+    VerifyOrExit(mInflator != NULL && mWindow != NULL, err = ESP_ERR_NO_MEM);
+    tinfl_init(mInflator);
+
+    ESP_LOGI(TAG, "Delta OTA update: patching %u byte application in partition %s to %u bytes in partition %s",
+             mHeader.OldSize, mOldPartition->label, mHeader.NewSize, mNewPartition->label);
+
+    err = esp_ota_begin(mNewPartition, mHeader.NewSize, &mOTAHandle);
+    SuccessOrExit(err);
+    mOTAStarted = true;
+
+    mPatcher.Init(mHeader.OldSize, mHeader.NewSize, ReadOld, WriteNew, this);
+
+exit:
+    return err;
+}
+
+/* Verify the HMAC of the header of the delta OTA image.
+ *
+ * NOTE: The HMAC is compared in constant time, so that the time taken to reject a forged header
+ * reveals nothing about the expected HMAC.
+ */
+esp_err_t DeltaOTAUpdater::CheckHeaderMAC(void)
+{
+    esp_err_t err = ESP_OK;
+    uint8_t mac[sizeof(mHeader.HMAC)];
+    uint8_t diff = 0;
+
+    VerifyOrExit(mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), mKey, mKeyLen,
+                                 (const uint8_t *)&mHeader, offsetof(DeltaPatchHeader, HMAC), mac) == 0,
+                 err = ESP_FAIL);
+
+    for (size_t i = 0; i < sizeof(mac); i++)
+    {
+        diff |= mac[i] ^ mHeader.HMAC[i];
+    }
+
+    if (diff != 0)
+    {
+        ESP_LOGE(TAG, "Delta OTA update rejected: header not authenticated with this device's key");
+        err = ESP_ERR_INVALID_ARG;
+    }
+
+exit:
+    return err;
+}
+
+/* Verify that the delta applies to the running application, by comparing the SHA-256 of the
+ * running application with that recorded in the header.
+ */
+esp_err_t DeltaOTAUpdater::CheckOldImage(void)
+{
+    esp_err_t err = ESP_OK;
+    mbedtls_sha256_context sha256;
+    uint8_t digest[32];
+    uint8_t * buf;
+
+    buf = (uint8_t *)malloc(kReadBlockSize);
+    VerifyOrExit(buf != NULL, err = ESP_ERR_NO_MEM);
+
+    mbedtls_sha256_init(&sha256);
+    mbedtls_sha256_starts(&sha256, 0);
+    for (uint32_t offset = 0; offset < mHeader.OldSize && err == ESP_OK; offset += kReadBlockSize)
+    {
+        uint32_t n = mHeader.OldSize - offset;
+        if (n > kReadBlockSize)
+        {
+            n = kReadBlockSize;
+        }
+        err = esp_partition_read(mOldPartition, offset, buf, n);
+        mbedtls_sha256_update(&sha256, buf, n);
+    }
+    mbedtls_sha256_finish(&sha256, digest);
+    mbedtls_sha256_free(&sha256);
+    free(buf);
+    SuccessOrExit(err);
+
+    if (memcmp(digest, mHeader.OldSHA256, sizeof(digest)) != 0)
+    {
+        ESP_LOGE(TAG, "Delta OTA update does not apply to the running application");
+        err = ESP_ERR_INVALID_STATE;
+    }
+
+exit:
+    return err;
+}
+
+bool DeltaOTAUpdater::ReadOld(void * context, uint32_t offset, uint8_t * buf, uint32_t len)
+{
+    DeltaOTAUpdater * self = (DeltaOTAUpdater *)context;
+    self->mFlashErr = esp_partition_read(self->mOldPartition, offset, buf, len);
+    return self->mFlashErr == ESP_OK;
+}
+
+bool DeltaOTAUpdater::WriteNew(void * context, const uint8_t * buf, uint32_t len)
+{
+    DeltaOTAUpdater * self = (DeltaOTAUpdater *)context;
+    mbedtls_sha256_update(&self->mNewSHA256, buf, len);
+    self->mFlashErr = esp_ota_write(self->mOTAHandle, buf, len);
+    return self->mFlashErr == ESP_OK;
+}
+
+// ==================== Delta OTA Server ====================
+
+namespace {
+
+/* Receive a single delta OTA image over a connection, replying with "OK" or the reason for failure.
+ *
+ * Returns true if the update succeeded.
+ */
+bool HandleConnection(int sock)
+{
+    esp_err_t err;
+    char resp[64];
+    int len;
+
+    err = sServerUpdater.Begin(sServerKey, sizeof(sServerKey));
+    SuccessOrExit(err);
+
+    while ((len = recv(sock, sServerRecvBuf, sizeof(sServerRecvBuf), 0)) > 0)
+    {
+        err = sServerUpdater.Write(sServerRecvBuf, (size_t)len);
+        SuccessOrExit(err);
+    }
+    VerifyOrExit(len == 0, err = ESP_ERR_TIMEOUT);
+
+    err = sServerUpdater.End();
+    SuccessOrExit(err);
+
+exit:
+    if (err != ESP_OK)
+    {
+        sServerUpdater.Abort();
+        ESP_LOGE(TAG, "Delta OTA update failed: %s", ErrorStr(err));
+        snprintf(resp, sizeof(resp), "ERROR %s\n", ErrorStr(err));
+    }
+    else
+    {
+        snprintf(resp, sizeof(resp), "OK\n");
+    }
+    send(sock, resp, strlen(resp), 0);
+    return err == ESP_OK;
+}
+
+void DeltaOTAServerTask(void * arg)
+{
+    struct sockaddr_in addr;
+    struct timeval timeout;
+    int listenSock;
+
+    listenSock = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenSock < 0)
+    {
+        ESP_LOGE(TAG, "Delta OTA server: socket() failed");
+        vTaskDelete(NULL);
+        return;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(sServerPort);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(listenSock, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listenSock, 1) != 0)
+    {
+        ESP_LOGE(TAG, "Delta OTA server: failed to listen on port %u", sServerPort);
+        close(listenSock);
+        vTaskDelete(NULL);
+        return;
+    }
+
+    ESP_LOGI(TAG, "Delta OTA server listening on port %u", sServerPort);
+
+    while (true)
+    {
+        int sock = accept(listenSock, NULL, NULL);
+        if (sock < 0)
+        {
+            continue;
+        }
+
+        timeout.tv_sec = kServerRecvTimeoutSec;
+        timeout.tv_usec = 0;
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        bool updated = HandleConnection(sock);
+        close(sock);
+
+        if (updated)
+        {
+            ESP_LOGI(TAG, "Restarting to run the updated application");
+            vTaskDelay(1000 / portTICK_PERIOD_MS);
+            esp_restart();
+        }
+    }
+}
+
+} // unnamed namespace
+
+/* Start a task that accepts delta OTA images on the given TCP port, authenticated with the given
+ * key (32 bytes, as 64 hex digits).
+ *
+ * Each connection carries a single delta image, which is applied as it is received.  When the
+ * sender closes its side of the connection, the update is completed, a one line response is
+ * sent, and, if the update succeeded, the device restarts into the new application.  Images
+ * whose header is not authenticated with the key are rejected before the running application
+ * is read or the inactive partition written.
+ *
+ * NOTE: The key is held in the application image, so it should be unique to the devices it
+ * updates.
+ */
+esp_err_t StartDeltaOTAServer(uint16_t port, const char * keyHex)
+{
+    size_t keyHexLen = (keyHex != NULL) ? strlen(keyHex) : 0;
+
+    if (keyHexLen != 2 * kServerKeyLen || strspn(keyHex, "0123456789abcdefABCDEF") != keyHexLen)
+    {
+        ESP_LOGE(TAG, "Delta OTA server: key must be %u hex digits", 2 * kServerKeyLen);
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < kServerKeyLen; i++)
+    {
+        char byteHex[3] = { keyHex[2 * i], keyHex[2 * i + 1], 0 };
+        sServerKey[i] = (uint8_t)strtoul(byteHex, NULL, 16);
+    }
+
+    sServerPort = port;
+
+    if (xTaskCreate(DeltaOTAServerTask, "delta-ota", kServerTaskStackSize, NULL, kServerTaskPriority, NULL) != pdPASS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
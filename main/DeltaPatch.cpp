@@ -0,0 +1,199 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <string.h>
+
+#include "DeltaPatch.h"
+
+namespace {
+
+uint32_t GetLE32(const uint8_t * p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+} // unnamed namespace
+
+void DeltaPatcher::Init(uint32_t oldSize, uint32_t newSize, ReadOldFunct readOld, WriteNewFunct writeNew, void * context)
+{
+    mReadOld = readOld;
+    mWriteNew = writeNew;
+    mContext = context;
+    mOldPos = 0;
+    mOldSize = oldSize;
+    mNewSize = newSize;
+    mNewPos = 0;
+    mDiffRemaining = 0;
+    mExtraRemaining = 0;
+    mSeek = 0;
+    mControlLen = 0;
+    mBlockLen = 0;
+}
+
+/* Apply the next piece of the patch records.
+ */
+int DeltaPatcher::Apply(const uint8_t * data, uint32_t len)
+{
+    int status = kStatus_OK;
+
+    while (len > 0)
+    {
+        // Accumulate the control block of the next record.
+        if (mDiffRemaining == 0 && mExtraRemaining == 0)
+        {
+            uint32_t n = kControlSize - mControlLen;
+            if (n > len)
+            {
+                n = len;
+            }
+
+            // Data beyond the end of the new image is invalid.
+            if (mNewPos == mNewSize)
+            {
+                return kStatus_InvalidPatch;
+            }
+
+            memcpy(mControl + mControlLen, data, n);
+            mControlLen += n;
+            data += n;
+            len -= n;
+
+            if (mControlLen < kControlSize)
+            {
+                break;
+            }
+            mControlLen = 0;
+
+            mDiffRemaining = GetLE32(mControl);
+            mExtraRemaining = GetLE32(mControl + 4);
+            mSeek = (int32_t)GetLE32(mControl + 8);
+
+            if (mDiffRemaining > mNewSize - mNewPos || mExtraRemaining > mNewSize - mNewPos - mDiffRemaining ||
+                (mDiffRemaining != 0 && (mOldPos < 0 || mOldPos + mDiffRemaining > mOldSize)))
+            {
+                return kStatus_InvalidPatch;
+            }
+
+            if (mDiffRemaining == 0 && mExtraRemaining == 0)
+            {
+                mOldPos += mSeek;
+            }
+
+            continue;
+        }
+
+        // Add the diff bytes to the corresponding bytes of the old image.
+        if (mDiffRemaining != 0)
+        {
+            uint32_t n = kBlockSize - mBlockLen;
+            uint8_t * out = mBlock + mBlockLen;
+
+            if (n > len)
+            {
+                n = len;
+            }
+            if (n > mDiffRemaining)
+            {
+                n = mDiffRemaining;
+            }
+
+            if (!mReadOld(mContext, (uint32_t)mOldPos, out, n))
+            {
+                return kStatus_ReadError;
+            }
+            for (uint32_t i = 0; i < n; i++)
+            {
+                out[i] += data[i];
+            }
+
+            mOldPos += n;
+            mDiffRemaining -= n;
+            mBlockLen += n;
+            mNewPos += n;
+            data += n;
+            len -= n;
+        }
+
+        // Copy the extra bytes.
+        else
+        {
+            uint32_t n = kBlockSize - mBlockLen;
+
+            if (n > len)
+            {
+                n = len;
+            }
+            if (n > mExtraRemaining)
+            {
+                n = mExtraRemaining;
+            }
+
+            memcpy(mBlock + mBlockLen, data, n);
+
+            mExtraRemaining -= n;
+            mBlockLen += n;
+            mNewPos += n;
+            data += n;
+            len -= n;
+        }
+
+        if (mDiffRemaining == 0 && mExtraRemaining == 0)
+        {
+            mOldPos += mSeek;
+        }
+
+        if (mBlockLen == kBlockSize)
+        {
+            status = FlushBlock();
+            if (status != kStatus_OK)
+            {
+                return status;
+            }
+        }
+    }
+
+    return status;
+}
+
+/* Write any buffered data, and check that the new image is complete.
+ */
+int DeltaPatcher::Finish(void)
+{
+    int status = FlushBlock();
+
+    if (status == kStatus_OK && (mNewPos != mNewSize || mControlLen != 0 || mDiffRemaining != 0 || mExtraRemaining != 0))
+    {
+        status = kStatus_InvalidPatch;
+    }
+
+    return status;
+}
+
+int DeltaPatcher::FlushBlock(void)
+{
+    if (mBlockLen != 0)
+    {
+        if (!mWriteNew(mContext, mBlock, mBlockLen))
+        {
+            return kStatus_WriteError;
+        }
+        mBlockLen = 0;
+    }
+
+    return kStatus_OK;
+}
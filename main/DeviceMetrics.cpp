@@ -0,0 +1,176 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <string.h>
+
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+#include <Weave/Support/ErrorStr.h>
+
+#include "DeviceMetrics.h"
+#include "AliveTimer.h"
+#include "ServiceEcho.h"
+#include "NotificationStats.h"
+#include "AppProfiles.h"
+
+using namespace ::nl;
+using namespace ::nl::Weave;
+using namespace ::nl::Weave::DeviceLayer;
+using namespace ::nl::Weave::Profiles::DataManagement_Current;
+using namespace ::nl::Weave::TLV;
+using namespace ::Schema::Nest::Trait::Performance;
+
+extern const char * TAG;
+
+static_assert((uint32_t)DeviceMetricsTrait::kWeaveProfileId == (uint32_t)kAppProfile_DeviceMetricsTrait,
+              "DeviceMetricsTrait profile id in traits.json does not match AppProfiles.h");
+
+DeviceMetricsPublisher DeviceMetrics;
+
+namespace {
+
+/* The leaves of the DeviceMetricsTrait, and the members of its typed data that hold them.
+ */
+const struct
+{
+    PropertyPathHandle Handle;
+    uint32_t DeviceMetricsTrait::Data::*Field;
+} MetricLeaves[] =
+{
+    { DeviceMetricsTrait::kPropertyHandle_UptimeSec,              &DeviceMetricsTrait::Data::UptimeSec },
+    { DeviceMetricsTrait::kPropertyHandle_CommandsReceived,       &DeviceMetricsTrait::Data::CommandsReceived },
+    { DeviceMetricsTrait::kPropertyHandle_CommandsSent,           &DeviceMetricsTrait::Data::CommandsSent },
+    { DeviceMetricsTrait::kPropertyHandle_EchoRttMs,              &DeviceMetricsTrait::Data::EchoRttMs },
+    { DeviceMetricsTrait::kPropertyHandle_FreeHeap,               &DeviceMetricsTrait::Data::FreeHeap },
+    { DeviceMetricsTrait::kPropertyHandle_MinFreeHeap,            &DeviceMetricsTrait::Data::MinFreeHeap },
+    { DeviceMetricsTrait::kPropertyHandle_LargestFreeBlock,       &DeviceMetricsTrait::Data::LargestFreeBlock },
+    { DeviceMetricsTrait::kPropertyHandle_MaxEventLoopLatenessMs, &DeviceMetricsTrait::Data::MaxEventLoopLatenessMs },
+};
+
+static_assert(sizeof(MetricLeaves) / sizeof(MetricLeaves[0]) == DeviceMetricsTrait::Serializer::kNumLeaves,
+              "MetricLeaves does not list every leaf of the DeviceMetricsTrait");
+
+} // unnamed namespace
+
+DeviceMetricsPublisher::DeviceMetricsPublisher(void)
+    : mDataSource(*this)
+{
+    mPublishIntervalMS = 0;
+    mCommandsReceived = 0;
+    mCommandsSent = 0;
+    memset(&mPublishedData, 0, sizeof(mPublishedData));
+}
+
+WEAVE_ERROR DeviceMetricsPublisher::Init(uint32_t publishIntervalMS)
+{
+    WEAVE_ERROR err;
+
+    VerifyOrExit(publishIntervalMS != 0, err = WEAVE_ERROR_INVALID_ARGUMENT);
+
+    mPublishIntervalMS = publishIntervalMS;
+
+    // Publish the DeviceMetricsTrait.
+    err = TraitMgr().PublishTrait(0, &mDataSource);
+    SuccessOrExit(err);
+
+    err = SystemLayer.StartTimer(mPublishIntervalMS, HandlePublishTimer, this);
+    SuccessOrExit(err);
+
+exit:
+    if (err != WEAVE_NO_ERROR)
+    {
+        ESP_LOGE(TAG, "DeviceMetricsPublisher::Init() failed: %s", ErrorStr(err));
+    }
+    return err;
+}
+
+void DeviceMetricsPublisher::Publish(void)
+{
+    DeviceMetricsTrait::Data data;
+    TelemetrySample sample;
+    bool changed = false;
+
+    memset(&sample, 0, sizeof(sample));
+    GetLatestTelemetrySample(sample);
+
+    data.UptimeSec = (uint32_t)(::esp_timer_get_time() / 1000000);
+    data.CommandsReceived = mCommandsReceived;
+    data.CommandsSent = mCommandsSent;
+    data.EchoRttMs = ServiceEcho.LastRTTUS / 1000;
+    data.FreeHeap = sample.FreeHeap;
+    data.MinFreeHeap = sample.MinFreeHeap;
+    data.LargestFreeBlock = sample.LargestFreeBlock;
+    data.MaxEventLoopLatenessMs = GetMaxEventLoopLatenessMS();
+
+    // Mark dirty only those leaves whose values have changed since the last publication.
+    mDataSource.Lock();
+    for (size_t i = 0; i < sizeof(MetricLeaves) / sizeof(MetricLeaves[0]); i++)
+    {
+        uint32_t DeviceMetricsTrait::Data::*field = MetricLeaves[i].Field;
+
+        if (data.*field != mPublishedData.*field)
+        {
+            mPublishedData.*field = data.*field;
+            mDataSource.SetDirty(MetricLeaves[i].Handle);
+            changed = true;
+        }
+    }
+    mDataSource.Unlock();
+
+    if (changed)
+    {
+        RunNotificationEngine();
+    }
+}
+
+void DeviceMetricsPublisher::HandlePublishTimer(System::Layer * /* unused */, void * appState, System::Error /* unused */)
+{
+    DeviceMetricsPublisher * self = (DeviceMetricsPublisher *)appState;
+    WEAVE_ERROR err;
+
+    self->Publish();
+
+    err = SystemLayer.StartTimer(self->mPublishIntervalMS, HandlePublishTimer, self);
+    if (err != WEAVE_NO_ERROR)
+    {
+        ESP_LOGE(TAG, "SystemLayer.StartTimer() failed: %s", ErrorStr(err));
+    }
+}
+
+DeviceMetricsPublisher::DeviceMetricsTraitDataSource::DeviceMetricsTraitDataSource(DeviceMetricsPublisher & publisher)
+    : TraitDataSource(&DeviceMetricsTrait::TraitSchema),
+      mPublisher(publisher)
+{
+}
+
+WEAVE_ERROR DeviceMetricsPublisher::DeviceMetricsTraitDataSource::GetLeafData(PropertyPathHandle aLeafHandle, uint64_t aTagToWrite, TLVWriter & aWriter)
+{
+    uint32_t startLen = aWriter.GetLengthWritten();
+    WEAVE_ERROR err;
+
+    err = DeviceMetricsTrait::Serializer::WriteLeaf(mPublisher.mPublishedData, aLeafHandle, aTagToWrite, aWriter);
+    if (err == WEAVE_NO_ERROR)
+    {
+        CountEncodedLeaf(aWriter.GetLengthWritten() - startLen);
+    }
+
+    return err;
+}
@@ -17,11 +17,14 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
 
 #include "esp_system.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "nvs.h"
 
 #include "Display.h"
 
@@ -32,6 +35,249 @@ extern const char *TAG;
 uint16_t DisplayHeight = 0;
 uint16_t DisplayWidth = 0;
 
+#if CONFIG_DISPLAY_SPI_CALIBRATION
+
+namespace {
+
+const char * const kCalibrationNamespace = "display";
+const char * const kReadClockKey = "rd-clock";
+const char * const kWriteClockKey = "wr-clock";
+
+enum
+{
+    kCalibrationLinePixels = 64,
+    kCalibrationLineBytes = kCalibrationLinePixels * sizeof(color_t),
+    kCalibrationPatterns = 3,
+    kCalibrationRounds = 4,
+};
+
+// Candidate write clocks, fastest first.  Each is an integer division of the 80 MHz APB clock.
+const uint32_t kCandidateWriteClocks[] = { 40000000, 26666667, 20000000, 16000000, 13333333, 10000000 };
+
+/* Fill a line with one of the calibration test patterns.
+ *
+ * NOTE: The display stores 6 bits per color channel, so only the upper 6 bits of each
+ * byte are significant.
+ */
+void FillCalibrationPattern(uint8_t pattern, uint8_t seed, uint8_t * line)
+{
+    uint8_t lfsr = seed | 1;
+
+    for (size_t i = 0; i < kCalibrationLineBytes; i++)
+    {
+        switch (pattern)
+        {
+        case 0:
+            // Alternate all-ones and all-zeros, maximizing the transitions on the data line.
+            line[i] = ((i + seed) & 1) ? 0x00 : 0xFC;
+            break;
+        case 1:
+            // Walk a single set bit through each significant bit position.
+            line[i] = (uint8_t)(0x80 >> ((i + seed) % 6));
+            break;
+        default:
+            // Pseudo-random data from an 8-bit LFSR.
+            lfsr = (uint8_t)((lfsr >> 1) ^ ((lfsr & 1) ? 0xB8 : 0));
+            line[i] = lfsr;
+            break;
+        }
+    }
+}
+
+/* Determine whether pixel data written at the given SPI clock reliably reaches the display,
+ * by writing a series of test patterns and reading them back at the (slower) read clock.
+ */
+bool TestWriteClock(uint32_t clock, uint8_t * line, uint8_t * readBuf)
+{
+    int y = _height / 2;
+
+    if (spi_lobo_set_speed(disp_spi, clock) == 0)
+    {
+        return false;
+    }
+
+    for (uint8_t round = 0; round < kCalibrationRounds; round++)
+    {
+        for (uint8_t pattern = 0; pattern < kCalibrationPatterns; pattern++)
+        {
+            FillCalibrationPattern(pattern, (uint8_t)(round * 37), line);
+            memset(readBuf, 0, kCalibrationLineBytes + 1);
+
+            if (disp_select() != ESP_OK)
+            {
+                return false;
+            }
+            send_data(0, y, kCalibrationLinePixels - 1, y, kCalibrationLinePixels, (color_t *)line);
+            if (disp_deselect() != ESP_OK)
+            {
+                return false;
+            }
+
+            // Read back at the read clock.  The first byte returned is a dummy byte.
+            if (read_data(0, y, kCalibrationLinePixels - 1, y, kCalibrationLineBytes, readBuf, 1) != ESP_OK)
+            {
+                return false;
+            }
+
+            for (size_t i = 0; i < kCalibrationLineBytes; i++)
+            {
+                if ((line[i] & 0xFC) != (readBuf[i + 1] & 0xFC))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/* Find the SPI clock at which pixel data is to be written to the display.
+ *
+ * The candidate clocks are tested from fastest to slowest, and the clock chosen is the one below
+ * the fastest that passes, so that a clock which only just passes (e.g. at the current
+ * temperature) is not used.  The chosen clock is tested again before being returned.
+ *
+ * NOTE: Must be called after the maximum read clock has been determined.
+ */
+uint32_t FindWriteClock()
+{
+    const size_t numCandidates = sizeof(kCandidateWriteClocks) / sizeof(kCandidateWriteClocks[0]);
+    uint32_t writeClock = 0;
+    uint8_t * line = (uint8_t *)malloc(kCalibrationLineBytes);
+    uint8_t * readBuf = (uint8_t *)malloc(kCalibrationLineBytes + 1);
+
+    if (line != NULL && readBuf != NULL)
+    {
+        size_t i;
+
+        for (i = 0; i < numCandidates; i++)
+        {
+            if (TestWriteClock(kCandidateWriteClocks[i], line, readBuf))
+            {
+                break;
+            }
+        }
+
+        if (i < numCandidates)
+        {
+            if (i + 1 < numCandidates)
+            {
+                i++;
+            }
+            if (TestWriteClock(kCandidateWriteClocks[i], line, readBuf))
+            {
+                writeClock = spi_lobo_get_speed(disp_spi);
+            }
+        }
+    }
+
+    free(line);
+    free(readBuf);
+
+    if (writeClock == 0)
+    {
+        ESP_LOGE(TAG, "Display write clock calibration failed; using default clock");
+        writeClock = DEFAULT_SPI_CLOCK;
+    }
+
+    return writeClock;
+}
+
+/* Confirm that pixel data can still be reliably written at a previously calibrated clock.
+ */
+bool VerifyWriteClock(uint32_t writeClock)
+{
+    bool verified = false;
+    uint8_t * line = (uint8_t *)malloc(kCalibrationLineBytes);
+    uint8_t * readBuf = (uint8_t *)malloc(kCalibrationLineBytes + 1);
+
+    if (line != NULL && readBuf != NULL)
+    {
+        verified = TestWriteClock(writeClock, line, readBuf);
+    }
+
+    free(line);
+    free(readBuf);
+
+    return verified;
+}
+
+/* Determine the maximum read and write SPI clocks for the display.
+ *
+ * The clocks are probed on the first boot and stored in NVS, so that later boots can skip
+ * the probes.  On each later boot the stored write clock is re-tested with the calibration
+ * patterns; if it no longer passes, the stored clocks are discarded and the probes are run again.
+ */
+uint32_t CalibrateDisplayClocks()
+{
+    esp_err_t err;
+    nvs_handle handle;
+    bool storageOpen;
+    uint32_t readClock = 0, writeClock = 0;
+    int64_t startTimeUS = ::esp_timer_get_time();
+
+    err = nvs_open(kCalibrationNamespace, NVS_READWRITE, &handle);
+    storageOpen = (err == ESP_OK);
+    if (!storageOpen)
+    {
+        ESP_LOGE(TAG, "Unable to open display calibration storage (err %d)", err);
+    }
+
+    if (storageOpen &&
+        nvs_get_u32(handle, kReadClockKey, &readClock) == ESP_OK &&
+        nvs_get_u32(handle, kWriteClockKey, &writeClock) == ESP_OK)
+    {
+        max_rdclock = readClock;
+        if (VerifyWriteClock(writeClock))
+        {
+            ESP_LOGI(TAG, "Display SPI clocks loaded from NVS (read %u Hz, write %u Hz)", readClock, writeClock);
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Stored display write clock (%u Hz) failed verification; recalibrating", writeClock);
+            writeClock = 0;
+        }
+    }
+
+    if (writeClock == 0)
+    {
+        max_rdclock = find_rd_speed();
+        writeClock = FindWriteClock();
+
+        ESP_LOGI(TAG, "Display SPI clocks calibrated in %u ms (read %u Hz, write %u Hz)",
+                 (uint32_t)((::esp_timer_get_time() - startTimeUS) / 1000), max_rdclock, writeClock);
+
+        if (storageOpen)
+        {
+            err = nvs_set_u32(handle, kReadClockKey, max_rdclock);
+            if (err == ESP_OK)
+            {
+                err = nvs_set_u32(handle, kWriteClockKey, writeClock);
+            }
+            if (err == ESP_OK)
+            {
+                err = nvs_commit(handle);
+            }
+            if (err != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Unable to store display calibration (err %d)", err);
+            }
+        }
+    }
+
+    if (storageOpen)
+    {
+        nvs_close(handle);
+    }
+
+    return writeClock;
+}
+
+} // unnamed namespace
+
+#endif // CONFIG_DISPLAY_SPI_CALIBRATION
+
 esp_err_t InitDisplay()
 {
     esp_err_t err;
@@ -44,7 +290,7 @@ esp_err_t InitDisplay()
     buscfg.sclk_io_num=PIN_NUM_CLK;               // set SPI CLK pin
     buscfg.quadwp_io_num=-1;
     buscfg.quadhd_io_num=-1;
-    buscfg.max_transfer_sz = 6*1024;
+    buscfg.max_transfer_sz = kDisplayMaxTransferSize;
 
     spi_lobo_device_interface_config_t devcfg;
     memset((void *)&devcfg, 0, sizeof(devcfg));
@@ -78,12 +324,21 @@ esp_err_t InitDisplay()
     // Initialize the display driver.
     TFT_display_init();
 
+#if CONFIG_DISPLAY_SPI_CALIBRATION
+
+    // Determine the maximum read and write clocks and switch to the write clock.
+    spi_lobo_set_speed(spi, CalibrateDisplayClocks());
+
+#else // CONFIG_DISPLAY_SPI_CALIBRATION
+
     // ---- Detect maximum read speed ----
     max_rdclock = find_rd_speed();
 
     // Set the SPI clock speed.
     spi_lobo_set_speed(spi, DEFAULT_SPI_CLOCK);
 
+#endif // CONFIG_DISPLAY_SPI_CALIBRATION
+
     TFT_setGammaCurve(0);
     TFT_setRotation(LANDSCAPE);
     TFT_setFont(DEJAVU24_FONT, NULL);
@@ -97,17 +352,4 @@ esp_err_t InitDisplay()
     return err;
 }
 
-void ClearDisplay()
-{
-    TFT_fillRect(0, 0, (int)DisplayWidth, (int)DisplayHeight, TFT_BLACK);
-}
-
-void DisplayMessageCentered(const char *msg, uint16_t vpos)
-{
-    uint16_t msgWidth = (uint16_t)TFT_getStringWidth((char *)msg);
-    uint16_t msgX = (DisplayWidth - msgWidth) / 2;
-    uint16_t msgY = (DisplayHeight * vpos) / 100;
-    TFT_print((char *)msg, msgX, msgY);
-}
-
 #endif // CONFIG_HAVE_DISPLAY
@@ -0,0 +1,224 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <string.h>
+
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "Display.h"
+
+#if CONFIG_HAVE_DISPLAY
+
+#include "DisplayBenchmark.h"
+#include "Compositor.h"
+#include "Assets.h"
+
+extern const char * TAG;
+
+namespace {
+
+enum
+{
+    kFillIterations = 20,
+    kBlitIterations = 100,
+    kTextIterations = 100,
+};
+
+class BenchmarkTest : public Drawable
+{
+public:
+    const char * Name;
+    uint32_t Iterations;
+
+    /* Change the test's contents and invalidate the affected regions of the display.
+     *
+     * NOTE: The compositor's lock must be held when calling this method.
+     */
+    void Step(uint32_t iteration)
+    {
+        Invalidate(GetBounds());
+        mIteration = iteration;
+        Invalidate(GetBounds());
+    }
+
+protected:
+    uint32_t mIteration;
+};
+
+/* Fills the entire display with a solid color, alternating between two colors.
+ */
+class FillTest : public BenchmarkTest
+{
+public:
+    virtual DisplayRect GetBounds() const
+    {
+        DisplayRect rect = { 0, 0, DisplayWidth, DisplayHeight };
+        return rect;
+    }
+
+    virtual void Render(Canvas & canvas)
+    {
+        canvas.FillRect(0, 0, DisplayWidth, DisplayHeight, (mIteration & 1) ? TFT_BLUE : TFT_DARKGREY);
+    }
+};
+
+/* Draws the logo image at a series of positions across the display.
+ */
+class BlitTest : public BenchmarkTest
+{
+public:
+    DisplayAsset Image;
+
+    virtual DisplayRect GetBounds() const
+    {
+        DisplayRect rect;
+        rect.Width = Image.Width;
+        rect.Height = Image.Height;
+        rect.X = (int16_t)((mIteration * 7) % (DisplayWidth - Image.Width + 1));
+        rect.Y = (int16_t)((mIteration * 5) % (DisplayHeight - Image.Height + 1));
+        return rect;
+    }
+
+    virtual void Render(Canvas & canvas)
+    {
+        DisplayRect rect = GetBounds();
+        canvas.DrawAsset(rect.X, rect.Y, Image);
+    }
+};
+
+/* Draws a line of text at a series of positions down the display.
+ */
+class TextTest : public BenchmarkTest
+{
+public:
+    const char * Text;
+
+    virtual DisplayRect GetBounds() const
+    {
+        TFT_setFont(DEJAVU24_FONT, NULL);
+
+        DisplayRect rect;
+        rect.Width = (uint16_t)TFT_getStringWidth((char *)Text);
+        rect.Height = (uint16_t)TFT_getfontheight();
+        rect.X = (int16_t)((DisplayWidth - rect.Width) / 2);
+        rect.Y = (int16_t)((mIteration * 11) % (DisplayHeight - rect.Height + 1));
+        return rect;
+    }
+
+    virtual void Render(Canvas & canvas)
+    {
+        DisplayRect rect = GetBounds();
+        canvas.DrawText(Text, rect.X, rect.Y, TFT_WHITE);
+    }
+};
+
+void RunTest(BenchmarkTest & test)
+{
+    Drawable * scene[] = { &test };
+    int64_t startTimeUS;
+    uint32_t elapsedUS, opsPerSec10, bytes;
+
+    // Draw the initial screen, which is not included in the measurement.
+    DisplayCompositor.Lock();
+    test.Step(0);
+    DisplayCompositor.SetScene(scene, 1);
+    DisplayCompositor.Unlock();
+    DisplayCompositor.Flush();
+    DisplayCompositor.WaitForIdle();
+
+    DisplayCompositor.Lock();
+    DisplayCompositor.BytesTransferred = 0;
+    DisplayCompositor.Transfers = 0;
+    DisplayCompositor.Unlock();
+
+    startTimeUS = ::esp_timer_get_time();
+
+    for (uint32_t i = 1; i <= test.Iterations; i++)
+    {
+        DisplayCompositor.Lock();
+        test.Step(i);
+        DisplayCompositor.Unlock();
+        DisplayCompositor.Flush();
+        DisplayCompositor.WaitForIdle();
+    }
+
+    elapsedUS = (uint32_t)(::esp_timer_get_time() - startTimeUS);
+    if (elapsedUS == 0)
+    {
+        elapsedUS = 1;
+    }
+
+    DisplayCompositor.Lock();
+    bytes = DisplayCompositor.BytesTransferred;
+    DisplayCompositor.Unlock();
+
+    opsPerSec10 = (uint32_t)(((uint64_t)test.Iterations * 10000000) / elapsedUS);
+
+    ESP_LOGI(TAG, "Display benchmark: %-5s %4u ops in %5u ms = %4u.%u ops/s, %4u KB/s", test.Name, test.Iterations,
+             elapsedUS / 1000, opsPerSec10 / 10, opsPerSec10 % 10, (uint32_t)(((uint64_t)bytes * 1000000 / elapsedUS) / 1024));
+}
+
+} // unnamed namespace
+
+/* Measure and log the rate of full-screen fills, image blits and text draws.
+ *
+ * Each test repeatedly changes a single Drawable and waits for the display task to send the
+ * affected regions to the display, so the results include rendering, SPI transfer and
+ * compositor overhead.
+ *
+ * NOTE: Must be called after the compositor has been initialized, and before any other task
+ * uses the display.
+ */
+void RunDisplayBenchmark()
+{
+    FillTest fillTest;
+    BlitTest blitTest;
+    TextTest textTest;
+
+    ESP_LOGI(TAG, "Display benchmark: starting (SPI clock %u Hz)", spi_lobo_get_speed(disp_spi));
+
+    fillTest.Name = "fill";
+    fillTest.Iterations = kFillIterations;
+    RunTest(fillTest);
+
+    blitTest.Name = "blit";
+    blitTest.Iterations = kBlitIterations;
+    if (GetDisplayAsset("OpenWeaveLogo", blitTest.Image) && blitTest.Image.Width <= DisplayWidth && blitTest.Image.Height <= DisplayHeight)
+    {
+        RunTest(blitTest);
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Display benchmark: blit test skipped (logo asset not available)");
+    }
+
+    textTest.Name = "text";
+    textTest.Iterations = kTextIterations;
+    textTest.Text = "Blue Sky 0123456789";
+    RunTest(textTest);
+
+    DisplayCompositor.Lock();
+    DisplayCompositor.SetScene(NULL, 0);
+    DisplayCompositor.Unlock();
+    DisplayCompositor.Flush();
+    DisplayCompositor.WaitForIdle();
+}
+
+#endif // CONFIG_HAVE_DISPLAY
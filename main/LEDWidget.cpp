@@ -16,33 +16,100 @@
  *    limitations under the License.
  */
 
+#include <string.h>
+
 #include "esp_system.h"
 #include "esp_log.h"
 #include "driver/gpio.h"
+#include "driver/ledc.h"
 #include "esp_timer.h"
 
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
 #include "LEDWidget.h"
 
 extern const char * TAG;
 
-void LEDWidget::Init(gpio_num_t gpioNum)
+// LEDC timer 0 and channel 0 are used by the LightController.
+#define LED_SPEED_MODE LEDC_HIGH_SPEED_MODE
+#define LED_TIMER_NUM LEDC_TIMER_1
+#define LED_FIRST_CHANNEL_NUM LEDC_CHANNEL_1
+#define LED_FREQ 5000
+#define LED_RESOLUTION LEDC_TIMER_8_BIT
+
+static ledc_channel_t sNextChannel = LED_FIRST_CHANNEL_NUM;
+static bool sLEDCInitialized = false;
+
+esp_err_t LEDWidget::Init(gpio_num_t gpioNum)
 {
-    mLastChangeTimeUS = 0;
-    mBlinkOnTimeMS = 0;
-    mBlinkOffTimeMS = 0;
+    esp_err_t err = ESP_OK;
+    ledc_timer_config_t timerConfig;
+    ledc_channel_config_t chanConfig;
+    esp_timer_create_args_t timerArgs;
+
+    mLock = portMUX_INITIALIZER_UNLOCKED;
+    mPattern[0].Brightness = 0;
+    mPattern[0].Fade = false;
+    mPattern[0].DurationMS = 0;
+    mNumSteps = 1;
+    mPatternChanged = false;
+    mStepTimer = NULL;
+    mStepStartTimeUS = 0;
+    mStepIndex = 0;
     mGPIONum = gpioNum;
-    mState = false;
+    mChannel = LEDC_CHANNEL_MAX;
 
-    if (gpioNum < GPIO_NUM_MAX)
+    VerifyOrExit(gpioNum < GPIO_NUM_MAX, err = ESP_OK);
+    VerifyOrExit(sNextChannel < LEDC_CHANNEL_MAX, err = ESP_ERR_NO_MEM);
+
+    // Configure the LEDC timer and fade service shared by all LEDs.
+    if (!sLEDCInitialized)
     {
-        gpio_set_direction(gpioNum, GPIO_MODE_OUTPUT);
+        memset(&timerConfig, 0, sizeof(timerConfig));
+        timerConfig.duty_resolution = LED_RESOLUTION;
+        timerConfig.freq_hz = LED_FREQ;
+        timerConfig.speed_mode = LED_SPEED_MODE;
+        timerConfig.timer_num = LED_TIMER_NUM;
+        err = ledc_timer_config(&timerConfig);
+        SuccessOrExit(err);
+
+        err = ledc_fade_func_install(0);
+        SuccessOrExit(err);
+
+        sLEDCInitialized = true;
     }
+
+    memset(&chanConfig, 0, sizeof(chanConfig));
+    chanConfig.channel = sNextChannel;
+    chanConfig.duty = 0;
+    chanConfig.gpio_num = gpioNum;
+    chanConfig.speed_mode = LED_SPEED_MODE;
+    chanConfig.timer_sel = LED_TIMER_NUM;
+    err = ledc_channel_config(&chanConfig);
+    SuccessOrExit(err);
+
+    mChannel = sNextChannel;
+    sNextChannel = (ledc_channel_t)(sNextChannel + 1);
+
+    memset(&timerArgs, 0, sizeof(timerArgs));
+    timerArgs.arg = this;
+    timerArgs.callback = HandleStepTimer;
+    timerArgs.name = "led-step";
+    err = esp_timer_create(&timerArgs, &mStepTimer);
+    SuccessOrExit(err);
+
+exit:
+    return err;
 }
 
 void LEDWidget::Set(bool state)
 {
-    mBlinkOnTimeMS = mBlinkOffTimeMS = 0;
-    DoSet(state);
+    SetBrightness((state) ? 255 : 0);
+}
+
+void LEDWidget::SetBrightness(uint8_t brightness)
+{
+    LEDPatternStep step = { brightness, false, 0 };
+    Play(&step, 1);
 }
 
 void LEDWidget::Blink(uint32_t changeRateMS)
@@ -52,33 +119,132 @@ void LEDWidget::Blink(uint32_t changeRateMS)
 
 void LEDWidget::Blink(uint32_t onTimeMS, uint32_t offTimeMS)
 {
-    mBlinkOnTimeMS = onTimeMS;
-    mBlinkOffTimeMS = offTimeMS;
-    Animate();
+    LEDPatternStep steps[2] =
+    {
+        { 255, false, (uint16_t)onTimeMS },
+        { 0, false, (uint16_t)offTimeMS },
+    };
+    Play(steps, 2);
 }
 
-void LEDWidget::Animate()
+void LEDWidget::Breathe(uint32_t periodMS)
 {
-    if (mBlinkOnTimeMS != 0 && mBlinkOffTimeMS != 0)
+    LEDPatternStep steps[2] =
+    {
+        { 255, true, (uint16_t)(periodMS / 2) },
+        { 0, true, (uint16_t)(periodMS - periodMS / 2) },
+    };
+    Play(steps, 2);
+}
+
+void LEDWidget::DoubleFlash(uint32_t periodMS)
+{
+    uint16_t flashMS = (uint16_t)(periodMS / 8);
+    LEDPatternStep steps[4] =
+    {
+        { 255, false, flashMS },
+        { 0, false, flashMS },
+        { 255, false, flashMS },
+        { 0, false, (uint16_t)(periodMS - 3 * flashMS) },
+    };
+    Play(steps, 4);
+}
+
+/* Play a pattern on the LED, starting with its first step.
+ *
+ * NOTE: The steps are copied, and the pattern is started by the step timer, so that the LEDC
+ * hardware is only ever accessed from the timer task.
+ */
+void LEDWidget::Play(const LEDPatternStep * steps, uint8_t numSteps)
+{
+    bool changed;
+
+    if (numSteps > kMaxPatternSteps)
     {
-        int64_t nowUS = ::esp_timer_get_time();
-        int64_t stateDurUS = ((mState) ? mBlinkOnTimeMS : mBlinkOffTimeMS) * 1000LL;
-        int64_t nextChangeTimeUS = mLastChangeTimeUS + stateDurUS;
+        numSteps = kMaxPatternSteps;
+    }
+    if (numSteps == 0)
+    {
+        return;
+    }
 
-        if (nowUS > nextChangeTimeUS)
+    portENTER_CRITICAL(&mLock);
+    changed = (numSteps != mNumSteps || memcmp(steps, mPattern, numSteps * sizeof(LEDPatternStep)) != 0);
+    if (changed)
+    {
+        memcpy(mPattern, steps, numSteps * sizeof(LEDPatternStep));
+        mNumSteps = numSteps;
+        mPatternChanged = true;
+    }
+    portEXIT_CRITICAL(&mLock);
+
+    if (changed && mStepTimer != NULL)
+    {
+        // If the timer re-armed itself between the stop and the start, stop it again.
+        esp_timer_stop(mStepTimer);
+        if (esp_timer_start_once(mStepTimer, 0) != ESP_OK)
         {
-            DoSet(!mState);
-            mLastChangeTimeUS = nowUS;
+            esp_timer_stop(mStepTimer);
+            esp_timer_start_once(mStepTimer, 0);
         }
     }
 }
 
-void LEDWidget::DoSet(bool state)
+void LEDWidget::ApplyStep(const LEDPatternStep & step)
 {
-    mState = state;
-    if (mGPIONum < GPIO_NUM_MAX)
+    if (step.Fade && step.DurationMS != 0)
     {
-        gpio_set_level(mGPIONum, (state) ? 1 : 0);
+        ledc_set_fade_with_time(LED_SPEED_MODE, mChannel, step.Brightness, step.DurationMS);
+        ledc_fade_start(LED_SPEED_MODE, mChannel, LEDC_FADE_NO_WAIT);
+    }
+    else
+    {
+        ledc_set_duty(LED_SPEED_MODE, mChannel, step.Brightness);
+        ledc_update_duty(LED_SPEED_MODE, mChannel);
     }
 }
 
+/* Advance to the next step of the current pattern, or to the first step of a new pattern.
+ *
+ * NOTE: Each step is scheduled relative to the start time of the previous one, rather than to
+ * the time the timer actually fired, so that latency in the timer task does not accumulate over
+ * the course of a pattern.
+ */
+void LEDWidget::HandleStepTimer(void * arg)
+{
+    LEDWidget * self = (LEDWidget *)arg;
+    int64_t nowUS = ::esp_timer_get_time();
+    int64_t delayUS;
+    LEDPatternStep step;
+
+    portENTER_CRITICAL(&self->mLock);
+    if (self->mPatternChanged)
+    {
+        self->mPatternChanged = false;
+        self->mStepIndex = 0;
+        self->mStepStartTimeUS = nowUS;
+    }
+    else
+    {
+        self->mStepIndex = (self->mStepIndex + 1) % self->mNumSteps;
+    }
+    step = self->mPattern[self->mStepIndex];
+    portEXIT_CRITICAL(&self->mLock);
+
+    self->ApplyStep(step);
+
+    if (step.DurationMS != 0)
+    {
+        self->mStepStartTimeUS += step.DurationMS * 1000LL;
+        delayUS = self->mStepStartTimeUS - nowUS;
+
+        // If the timer has fallen behind by more than a step, resynchronize with the current time.
+        if (delayUS < 0)
+        {
+            self->mStepStartTimeUS = nowUS;
+            delayUS = 0;
+        }
+
+        esp_timer_start_once(self->mStepTimer, delayUS);
+    }
+}
@@ -21,9 +21,15 @@
 #include "driver/ledc.h"
 
 #include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+#include <Weave/Support/ErrorStr.h>
 #include <LightController.h>
+#include <AliveTimer.h>
+#include <DeviceMetrics.h>
+#include <NotificationStats.h>
+#include <LightEventLog.h>
 #include <nest/trait/lighting/LogicalCircuitControlTrait.h>
 
+using namespace ::nl::Weave;
 using namespace ::nl::Weave::DeviceLayer;
 using namespace ::nl::Weave::Profiles::DataManagement_Current;
 using namespace ::nl::Weave::TLV;
@@ -41,9 +47,12 @@ extern const char * TAG;
 LightController::LightController(void)
     : mStateDS(*this), mControlDS(*this)
 {
-    mState = OFF;
-    mLevel = 100;
+    mStateData.State = OFF;
+    mStateData.Brightness = 100;
+    mStateData.BrightnessIsNull = false;
     mGPIONum = GPIO_NUM_MAX;
+    mDimSweepIntervalMS = 0;
+    mDimSweepStep = kDimSweepStep;
 }
 
 WEAVE_ERROR LightController::Init(gpio_num_t gpioNum)
@@ -62,8 +71,9 @@ WEAVE_ERROR LightController::Init(gpio_num_t gpioNum)
     err = TraitMgr().PublishTrait(0, &mControlDS);
     SuccessOrExit(err);
 
-    mState = OFF;
-    mLevel = 100;
+    mStateData.State = OFF;
+    mStateData.Brightness = 100;
+    mStateData.BrightnessIsNull = false;
     mGPIONum = gpioNum;
 
     if (gpioNum < GPIO_NUM_MAX)
@@ -90,12 +100,25 @@ exit:
     return err;
 }
 
-void LightController::Set(int8_t state, uint8_t level)
+/* Change the state and level of the light.  sourceNodeId identifies the node on whose behalf the
+ * change is made, and is recorded in the light event log.
+ */
+void LightController::Set(int8_t state, uint8_t level, uint64_t sourceNodeId)
 {
     uint32_t dimmerDutyCycle = 0;
+    bool stateChanged = (state != mStateData.State);
+    bool levelChanged = (level != mStateData.Brightness || mStateData.BrightnessIsNull);
+
+#if CONFIG_LIGHT_EVENT_LOG_SIZE
+    if (stateChanged || levelChanged)
+    {
+        LightEventLog.Record(mStateData.State, state, mStateData.Brightness, level, sourceNodeId);
+    }
+#endif // CONFIG_LIGHT_EVENT_LOG_SIZE
 
-    mState = state;
-    mLevel = level;
+    mStateData.State = state;
+    mStateData.Brightness = level;
+    mStateData.BrightnessIsNull = false;
     if (mGPIONum < GPIO_NUM_MAX)
     {
         dimmerDutyCycle = (state == ON) ? (DIMMER_DUTY_CYCLE_MAX_VALUE * level * 2 + 1) / 200 : 0;
@@ -103,16 +126,91 @@ void LightController::Set(int8_t state, uint8_t level)
         ledc_update_duty(DIMMER_SPEED_MODE, DIMMER_CHANNEL_NUM);
     }
     ESP_LOGI(TAG, "Light state changed to %s, level %" PRIu8 " (pwm %" PRIu32 "/%" PRIu32 ")",
-             (mState == ON) ? "ON" : "OFF", mLevel, dimmerDutyCycle, DIMMER_DUTY_CYCLE_MAX_VALUE);
+             (state == ON) ? "ON" : "OFF", level, dimmerDutyCycle, DIMMER_DUTY_CYCLE_MAX_VALUE);
+
+    // Mark only the leaves that have changed as dirty, so that notifications to subscribers carry
+    // just the change (e.g. only the brightness while dimming).  If both have changed, mark the
+    // root instead, which encodes more compactly than the two leaves separately.  If nothing has
+    // changed, there is nothing to notify.
+    if (!stateChanged && !levelChanged)
+    {
+        return;
+    }
     mStateDS.Lock();
-    mStateDS.SetDirty(LogicalCircuitStateTrait::kPropertyHandle_Root);
+    if (stateChanged && levelChanged)
+    {
+        mStateDS.SetDirty(LogicalCircuitStateTrait::kPropertyHandle_Root);
+    }
+    else if (stateChanged)
+    {
+        mStateDS.SetDirty(LogicalCircuitStateTrait::kPropertyHandle_State);
+    }
+    else
+    {
+        mStateDS.SetDirty(LogicalCircuitStateTrait::kPropertyHandle_Brightness);
+    }
     mStateDS.Unlock();
-    nl::Weave::Profiles::DataManagement::SubscriptionEngine::GetInstance()->GetNotificationEngine()->Run();
+
+    RunNotificationEngine();
 }
 
 void LightController::Toggle(void)
 {
-    Set((mState == ON) ? OFF : ON, mLevel);
+    Set((mStateData.State == ON) ? OFF : ON, mStateData.Brightness, FabricState.LocalNodeId);
+}
+
+/* Repeatedly sweep the light's level between 0 and 100, changing it by kDimSweepStep at the
+ * given interval, to measure the cost of fanning out changes to subscribers.
+ *
+ * At the end of each sweep the notification statistics gathered during the sweep are logged,
+ * and then reset.
+ */
+WEAVE_ERROR LightController::StartDimSweep(uint32_t stepIntervalMS)
+{
+    WEAVE_ERROR err;
+
+    mDimSweepIntervalMS = stepIntervalMS;
+    mDimSweepStep = kDimSweepStep;
+    ResetNotificationStats();
+
+    err = SystemLayer.StartTimer(mDimSweepIntervalMS, HandleDimSweepTimer, this);
+    if (err != WEAVE_NO_ERROR)
+    {
+        ESP_LOGE(TAG, "SystemLayer.StartTimer() failed: %s", nl::ErrorStr(err));
+    }
+
+    return err;
+}
+
+void LightController::HandleDimSweepTimer(System::Layer * /* unused */, void * appState, System::Error /* unused */)
+{
+    LightController * self = (LightController *)appState;
+    int level = (int)self->mStateData.Brightness + self->mDimSweepStep;
+    WEAVE_ERROR err;
+
+    if (level >= 100 || level <= 0)
+    {
+        NotificationStats stats;
+
+        level = (level >= 100) ? 100 : 0;
+        self->mDimSweepStep = -self->mDimSweepStep;
+
+        GetNotificationStats(stats);
+        ESP_LOGI(TAG, "Dim sweep: %" PRIu32 " notification runs, avg %" PRIu32 " us, max %" PRIu32 " us, max %" PRIu16 " subscriptions, max %" PRIu16 " pbufs in use after a run (high-water mark %" PRIu16 ")",
+                 stats.Runs, (stats.Runs != 0) ? (uint32_t)(stats.TotalRunTimeUS / stats.Runs) : 0, stats.MaxRunTimeUS,
+                 stats.MaxSubscriptions, stats.MaxPacketBufsInUse, stats.PacketBufsHighWater);
+        ESP_LOGI(TAG, "Dim sweep: %" PRIu32 " leaves encoded, %" PRIu32 " bytes, avg %" PRIu32 " bytes per run",
+                 stats.EncodedLeaves, stats.EncodedLeafBytes, (stats.Runs != 0) ? stats.EncodedLeafBytes / stats.Runs : 0);
+        ResetNotificationStats();
+    }
+
+    self->Set(ON, (uint8_t)level, FabricState.LocalNodeId);
+
+    err = SystemLayer.StartTimer(self->mDimSweepIntervalMS, HandleDimSweepTimer, self);
+    if (err != WEAVE_NO_ERROR)
+    {
+        ESP_LOGE(TAG, "SystemLayer.StartTimer() failed: %s", nl::ErrorStr(err));
+    }
 }
 
 LightController::LogicalCircuitStateTraitDataSource::LogicalCircuitStateTraitDataSource(LightController & lightController)
@@ -123,25 +221,15 @@ LightController::LogicalCircuitStateTraitDataSource::LogicalCircuitStateTraitDat
 
 WEAVE_ERROR LightController::LogicalCircuitStateTraitDataSource::GetLeafData(PropertyPathHandle aLeafHandle, uint64_t aTagToWrite, TLVWriter & aWriter)
 {
-    WEAVE_ERROR err = WEAVE_NO_ERROR;
+    uint32_t startLen = aWriter.GetLengthWritten();
+    WEAVE_ERROR err;
 
-    switch (aLeafHandle)
+    err = LogicalCircuitStateTrait::Serializer::WriteLeaf(mLightController.mStateData, aLeafHandle, aTagToWrite, aWriter);
+    if (err == WEAVE_NO_ERROR)
     {
-    case LogicalCircuitStateTrait::kPropertyHandle_State:
-        err = aWriter.Put(aTagToWrite, mLightController.mState);
-        SuccessOrExit(err);
-        break;
-
-    case LogicalCircuitStateTrait::kPropertyHandle_Brightness:
-        err = aWriter.Put(aTagToWrite, mLightController.mLevel);
-        SuccessOrExit(err);
-        break;
-
-    default:
-        break;
+        CountEncodedLeaf(aWriter.GetLengthWritten() - startLen);
     }
 
-exit:
     return err;
 }
 
@@ -168,6 +256,9 @@ void LightController::LogicalCircuitControlTraitDataSource::OnCustomCommand(::nl
     uint32_t statusProfileId = ::nl::Weave::Profiles::kWeaveProfile_Common;
     uint32_t statusCode = ::nl::Weave::Profiles::Common::kStatus_InternalError;
     bool respSent = false;
+    EventLoopActivityScope activityScope(kEventLoopActivity_CommandHandling);
+
+    DeviceMetrics.CountCommandReceived();
 
     // Verify that the requested command is supported (only SetLogicalCircuitState in this case).
     if (aCommandType != LogicalCircuitControlTrait::kSetLogicalCircuitStateRequestId)
@@ -206,53 +297,13 @@ void LightController::LogicalCircuitControlTraitDataSource::OnCustomCommand(::nl
     // TODO: support action time
 
     // Parse and verify the command arguments.
-    {
-        TLVType container;
-        err = aArgumentReader.EnterContainer(container);
-        SuccessOrExit(err);
-
-        err = aArgumentReader.Next();
-        SuccessOrExit(err);
-        VerifyOrExit(aArgumentReader.GetTag() == ContextTag(LogicalCircuitControlTrait::kSetLogicalCircuitStateRequestParameter_State),
-                     (err = WEAVE_ERROR_UNEXPECTED_TLV_ELEMENT, statusCode = ::nl::Weave::Profiles::Common::kStatus_BadRequest));
-        if (aArgumentReader.GetType() == kTLVType_SignedInteger)
-        {
-            err = aArgumentReader.Get(newState);
-            SuccessOrExit(err);
-            VerifyOrExit(newState == PhysicalCircuitStateTrait::CIRCUIT_STATE_ON || newState == PhysicalCircuitStateTrait::CIRCUIT_STATE_OFF,
-                         (err = WEAVE_ERROR_INVALID_ARGUMENT, statusCode = ::nl::Weave::Profiles::Common::kStatus_BadRequest));
-        }
-        else
-        {
-            VerifyOrExit(aArgumentReader.GetType() == kTLVType_Null,
-                         (err = WEAVE_ERROR_WRONG_TLV_TYPE, statusCode = ::nl::Weave::Profiles::Common::kStatus_BadRequest));
-            newState = mLightController.mState;
-        }
-
-        err = aArgumentReader.Next();
-        SuccessOrExit(err);
-        VerifyOrExit(aArgumentReader.GetTag() == ContextTag(LogicalCircuitControlTrait::kSetLogicalCircuitStateRequestParameter_Level),
-                     (err = WEAVE_ERROR_UNEXPECTED_TLV_ELEMENT, statusCode = ::nl::Weave::Profiles::Common::kStatus_BadRequest));
-        if (aArgumentReader.GetType() == kTLVType_UnsignedInteger)
-        {
-            err = aArgumentReader.Get(newLevel);
-            SuccessOrExit(err);
-            VerifyOrExit(newLevel <= 100,
-                         (err = WEAVE_ERROR_INVALID_ARGUMENT, statusCode = ::nl::Weave::Profiles::Common::kStatus_BadRequest));
-        }
-        else
-        {
-            VerifyOrExit(aArgumentReader.GetType() == kTLVType_Null,
-                         (err = WEAVE_ERROR_WRONG_TLV_TYPE, statusCode = ::nl::Weave::Profiles::Common::kStatus_BadRequest));
-            newLevel = mLightController.mLevel;
-        }
-
-        err = aArgumentReader.ExitContainer(container);
-        SuccessOrExit(err);
-    }
+    newState = (uint8_t)mLightController.mStateData.State;
+    newLevel = mLightController.mStateData.Brightness;
+    err = DecodeSetLogicalCircuitStateArguments(aArgumentReader, newState, newLevel, statusCode);
+    SuccessOrExit(err);
 
     // Update the state of the light.
-    mLightController.Set(newState, newLevel);
+    mLightController.Set(newState, newLevel, aMsgInfo->SourceNodeId);
 
     // Send the response.
     err = aCommand->SendResponse(GetVersion(), NULL);
@@ -270,3 +321,59 @@ exit:
 
     PacketBuffer::Free(aPayload);
 }
+
+/* Parse and verify the arguments of a SetLogicalCircuitState command.
+ *
+ * On entry, aState and aLevel hold the current state and level of the light, which are retained
+ * for any argument given as null.  On failure, aStatusCode is set to the status to be returned
+ * to the requester.
+ */
+WEAVE_ERROR LightController::DecodeSetLogicalCircuitStateArguments(TLVReader & aArgumentReader,
+        uint8_t & aState, uint8_t & aLevel, uint32_t & aStatusCode)
+{
+    WEAVE_ERROR err;
+    TLVType container;
+
+    err = aArgumentReader.EnterContainer(container);
+    SuccessOrExit(err);
+
+    err = aArgumentReader.Next();
+    SuccessOrExit(err);
+    VerifyOrExit(aArgumentReader.GetTag() == ContextTag(LogicalCircuitControlTrait::kSetLogicalCircuitStateRequestParameter_State),
+                 (err = WEAVE_ERROR_UNEXPECTED_TLV_ELEMENT, aStatusCode = ::nl::Weave::Profiles::Common::kStatus_BadRequest));
+    if (aArgumentReader.GetType() == kTLVType_SignedInteger)
+    {
+        err = aArgumentReader.Get(aState);
+        SuccessOrExit(err);
+        VerifyOrExit(aState == PhysicalCircuitStateTrait::CIRCUIT_STATE_ON || aState == PhysicalCircuitStateTrait::CIRCUIT_STATE_OFF,
+                     (err = WEAVE_ERROR_INVALID_ARGUMENT, aStatusCode = ::nl::Weave::Profiles::Common::kStatus_BadRequest));
+    }
+    else
+    {
+        VerifyOrExit(aArgumentReader.GetType() == kTLVType_Null,
+                     (err = WEAVE_ERROR_WRONG_TLV_TYPE, aStatusCode = ::nl::Weave::Profiles::Common::kStatus_BadRequest));
+    }
+
+    err = aArgumentReader.Next();
+    SuccessOrExit(err);
+    VerifyOrExit(aArgumentReader.GetTag() == ContextTag(LogicalCircuitControlTrait::kSetLogicalCircuitStateRequestParameter_Level),
+                 (err = WEAVE_ERROR_UNEXPECTED_TLV_ELEMENT, aStatusCode = ::nl::Weave::Profiles::Common::kStatus_BadRequest));
+    if (aArgumentReader.GetType() == kTLVType_UnsignedInteger)
+    {
+        err = aArgumentReader.Get(aLevel);
+        SuccessOrExit(err);
+        VerifyOrExit(aLevel <= 100,
+                     (err = WEAVE_ERROR_INVALID_ARGUMENT, aStatusCode = ::nl::Weave::Profiles::Common::kStatus_BadRequest));
+    }
+    else
+    {
+        VerifyOrExit(aArgumentReader.GetType() == kTLVType_Null,
+                     (err = WEAVE_ERROR_WRONG_TLV_TYPE, aStatusCode = ::nl::Weave::Profiles::Common::kStatus_BadRequest));
+    }
+
+    err = aArgumentReader.ExitContainer(container);
+    SuccessOrExit(err);
+
+exit:
+    return err;
+}
@@ -0,0 +1,248 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+#include <Weave/Profiles/data-management/DataManagement.h>
+#include <Weave/Support/ErrorStr.h>
+
+#include "LightEventLog.h"
+#include "NotificationStats.h"
+#include "AppProfiles.h"
+
+#if CONFIG_LIGHT_EVENT_LOG_SIZE
+
+using namespace ::nl::Weave;
+using namespace ::nl::Weave::DeviceLayer;
+using namespace ::nl::Weave::Profiles::DataManagement_Current;
+using namespace ::nl::Weave::TLV;
+
+extern const char * TAG;
+
+LightEventLogger LightEventLog;
+
+namespace {
+
+const EventSchema LightStateChangeEventSchema =
+{
+    kAppProfile_LightEvents,
+    LightEventLogger::kEventStructureType,
+    Production,
+    1,      // Data schema version
+    1,      // Minimum compatible data schema version
+};
+
+} // unnamed namespace
+
+LightEventLogger::LightEventLogger(void)
+{
+    memset(mRing, 0, sizeof(mRing));
+    mHead = 0;
+    mCount = 0;
+    mEarlyUploadPending = false;
+    mUploadIntervalMS = 0;
+    mEventsLogged = 0;
+    mEventsDropped = 0;
+    mEventsDroppedReported = 0;
+    mEventsFailed = 0;
+    mEventsFailedReported = 0;
+}
+
+WEAVE_ERROR LightEventLogger::Init(uint32_t uploadIntervalMS)
+{
+    WEAVE_ERROR err;
+
+    VerifyOrExit(uploadIntervalMS != 0, err = WEAVE_ERROR_INVALID_ARGUMENT);
+
+    mUploadIntervalMS = uploadIntervalMS;
+
+    err = SystemLayer.StartTimer(mUploadIntervalMS, HandleUploadTimer, this);
+    SuccessOrExit(err);
+
+exit:
+    if (err != WEAVE_NO_ERROR)
+    {
+        ESP_LOGE(TAG, "LightEventLogger::Init() failed: %s", nl::ErrorStr(err));
+    }
+    return err;
+}
+
+/* Append a change in the state of the light to the ring.
+ *
+ * NOTE: This is called on the path that changes the light, and so does no more than copy the
+ * change into the ring.  If the ring is full the change is counted and dropped, rather than
+ * waiting for, or forcing, an upload.
+ *
+ * NOTE: The caller must hold the Weave stack lock.
+ */
+void LightEventLogger::Record(int8_t oldState, int8_t newState, uint8_t oldLevel, uint8_t newLevel, uint64_t sourceNodeId)
+{
+    LightStateChange * change;
+
+    if (mCount == kRingSize)
+    {
+        mEventsDropped++;
+        return;
+    }
+
+    change = &mRing[(mHead + mCount) % kRingSize];
+    change->SourceNodeId = sourceNodeId;
+    change->TimeMS = (uint32_t)(::esp_timer_get_time() / 1000);
+    change->OldState = oldState;
+    change->NewState = newState;
+    change->OldLevel = oldLevel;
+    change->NewLevel = newLevel;
+    mCount++;
+
+    // If the ring is filling up faster than it is being uploaded, bring the next upload forward.
+    // The upload runs from the Weave event loop once the caller has returned.
+    if (mCount >= kEarlyUploadThreshold && !mEarlyUploadPending && mUploadIntervalMS != 0)
+    {
+        mEarlyUploadPending = true;
+        SystemLayer.CancelTimer(HandleUploadTimer, this);
+        SystemLayer.StartTimer(0, HandleUploadTimer, this);
+    }
+}
+
+/* Drain the ring into the Weave event log, then run the notification engine once so that the
+ * resulting events are sent to the service together.
+ *
+ * NOTE: A change that the event log fails to accept (e.g. because it is out of space) is counted
+ * and discarded, rather than being retried, so that it cannot hold up the changes behind it.
+ */
+void LightEventLogger::Upload(void)
+{
+    uint16_t logged = 0;
+
+    mEarlyUploadPending = false;
+
+    while (mCount > 0)
+    {
+        // LogEvent() returns an event id of 0 if the event could not be logged.
+        if (LogEvent(LightStateChangeEventSchema, WriteEvent, &mRing[mHead]) != 0)
+        {
+            logged++;
+        }
+        else
+        {
+            mEventsFailed++;
+        }
+
+        mHead = (mHead + 1) % kRingSize;
+        mCount--;
+    }
+
+    if (logged != 0)
+    {
+        mEventsLogged += logged;
+        RunNotificationEngine();
+    }
+
+    if (mEventsDropped != mEventsDroppedReported)
+    {
+        ESP_LOGW(TAG, "Light event log full: %" PRIu32 " light state change(s) dropped", mEventsDropped - mEventsDroppedReported);
+        mEventsDroppedReported = mEventsDropped;
+    }
+
+    if (mEventsFailed != mEventsFailedReported)
+    {
+        ESP_LOGE(TAG, "LogEvent() failed: %" PRIu32 " light state change(s) not logged", mEventsFailed - mEventsFailedReported);
+        mEventsFailedReported = mEventsFailed;
+    }
+}
+
+/* Write the payload of a light state change event.
+ *
+ * NOTE: Weave stamps each event with the time it is logged, rather than the time of the change,
+ * so the payload carries the age of the change at that point, from which the time of the change
+ * itself can be recovered.
+ */
+WEAVE_ERROR LightEventLogger::WriteEvent(TLVWriter & writer, uint8_t dataTag, void * appData)
+{
+    WEAVE_ERROR err;
+    const LightStateChange * change = (const LightStateChange *)appData;
+    uint32_t ageMS = (uint32_t)(::esp_timer_get_time() / 1000) - change->TimeMS;
+    TLVType container;
+
+    err = writer.StartContainer(ContextTag(dataTag), kTLVType_Structure, container);
+    SuccessOrExit(err);
+
+    err = writer.Put(ContextTag(kTag_OldState), change->OldState);
+    SuccessOrExit(err);
+
+    err = writer.Put(ContextTag(kTag_NewState), change->NewState);
+    SuccessOrExit(err);
+
+    err = writer.Put(ContextTag(kTag_OldLevel), change->OldLevel);
+    SuccessOrExit(err);
+
+    err = writer.Put(ContextTag(kTag_NewLevel), change->NewLevel);
+    SuccessOrExit(err);
+
+    err = writer.Put(ContextTag(kTag_SourceNodeId), change->SourceNodeId);
+    SuccessOrExit(err);
+
+    err = writer.Put(ContextTag(kTag_AgeMS), ageMS);
+    SuccessOrExit(err);
+
+    err = writer.EndContainer(container);
+    SuccessOrExit(err);
+
+exit:
+    return err;
+}
+
+void LightEventLogger::HandleUploadTimer(System::Layer * /* unused */, void * appState, System::Error /* unused */)
+{
+    LightEventLogger * self = (LightEventLogger *)appState;
+    WEAVE_ERROR err;
+
+    self->Upload();
+
+    err = SystemLayer.StartTimer(self->mUploadIntervalMS, HandleUploadTimer, self);
+    if (err != WEAVE_NO_ERROR)
+    {
+        ESP_LOGE(TAG, "SystemLayer.StartTimer() failed: %s", nl::ErrorStr(err));
+    }
+}
+
+/* Print the state of the light event log.
+ *
+ * NOTE: The caller must hold the Weave stack lock.
+ */
+void LightEventLogger::Dump(void)
+{
+    printf("Light event log: %u/%u pending, %" PRIu32 " logged, %" PRIu32 " dropped (ring full), %" PRIu32 " failed to log\n",
+           (unsigned)mCount, (unsigned)kRingSize, mEventsLogged, mEventsDropped, mEventsFailed);
+
+    for (uint16_t i = 0; i < mCount; i++)
+    {
+        const LightStateChange & change = mRing[(mHead + i) % kRingSize];
+
+        printf("  %10" PRIu32 " ms  %016" PRIX64 "  state %d -> %d  level %u -> %u\n",
+               change.TimeMS, change.SourceNodeId, change.OldState, change.NewState,
+               (unsigned)change.OldLevel, (unsigned)change.NewLevel);
+    }
+}
+
+#endif // CONFIG_LIGHT_EVENT_LOG_SIZE
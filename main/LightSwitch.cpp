@@ -22,6 +22,7 @@
 #include <Weave/DeviceLayer/WeaveDeviceLayer.h>
 #include <nest/trait/lighting/LogicalCircuitControlTrait.h>
 #include <LightSwitch.h>
+#include <DeviceMetrics.h>
 
 using namespace ::nl::Weave;
 using namespace ::nl::Weave::DeviceLayer;
@@ -98,7 +99,7 @@ void LightSwitch::SendCommand(void)
     buf = PacketBuffer::New();
     VerifyOrExit(buf != NULL, err = WEAVE_ERROR_NO_MEMORY);
 
-    err = EncodeCommandRequest(buf);
+    err = EncodeCommandRequest(mState, mLevel, buf);
     SuccessOrExit(err);
 
     ESP_LOGI(TAG, "Sending LogicalCircuitControlTrait::SetLogicalCircuitState command to %016" PRIx64 " (state %s, level %" PRIu8 ")",
@@ -108,6 +109,8 @@ void LightSwitch::SendCommand(void)
     buf = NULL;
     SuccessOrExit(err);
 
+    DeviceMetrics.CountCommandSent();
+
 exit:
     if (err != WEAVE_NO_ERROR)
     {
@@ -120,7 +123,9 @@ exit:
     PacketBuffer::Free(buf);
 }
 
-WEAVE_ERROR LightSwitch::EncodeCommandRequest(PacketBuffer * buf)
+/* Encode a SetLogicalCircuitState command requesting the given state and level.
+ */
+WEAVE_ERROR LightSwitch::EncodeCommandRequest(int8_t state, uint8_t level, PacketBuffer * buf)
 {
     WEAVE_ERROR err = WEAVE_NO_ERROR;
     TLVWriter tlvWriter;
@@ -161,10 +166,10 @@ WEAVE_ERROR LightSwitch::EncodeCommandRequest(PacketBuffer * buf)
             err = tlvWriter.StartContainer(ContextTag(CustomCommand::kCsTag_Argument), kTLVType_Structure, container);
             SuccessOrExit(err);
 
-            err = tlvWriter.Put(ContextTag(LogicalCircuitControlTrait::kSetLogicalCircuitStateRequestParameter_State), mState);
+            err = tlvWriter.Put(ContextTag(LogicalCircuitControlTrait::kSetLogicalCircuitStateRequestParameter_State), state);
             SuccessOrExit(err);
 
-            err = tlvWriter.Put(ContextTag(LogicalCircuitControlTrait::kSetLogicalCircuitStateRequestParameter_Level), mLevel);
+            err = tlvWriter.Put(ContextTag(LogicalCircuitControlTrait::kSetLogicalCircuitStateRequestParameter_Level), level);
             SuccessOrExit(err);
 
             err = tlvWriter.EndContainer(kTLVType_Structure);
@@ -0,0 +1,70 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <string.h>
+
+#include "esp_system.h"
+#include "esp_log.h"
+
+#include "Display.h"
+
+#if CONFIG_HAVE_DISPLAY
+
+#include "MessageWidget.h"
+
+void MessageWidget::Init(const char * msg)
+{
+    mMessage = msg;
+    VPos = 25;
+    Color = { 141, 151 , 155 }; // PANTONE 443 C
+    memset(&mRect, 0, sizeof(mRect));
+}
+
+/* Change the displayed message.
+ *
+ * NOTE: The compositor's lock must be held when calling this method.
+ */
+void MessageWidget::SetMessage(const char * msg)
+{
+    Invalidate(mRect);
+    mMessage = msg;
+    Layout();
+    Invalidate(mRect);
+}
+
+DisplayRect MessageWidget::GetBounds() const
+{
+    return mRect;
+}
+
+void MessageWidget::Render(Canvas & canvas)
+{
+    canvas.DrawText(mMessage, mRect.X, mRect.Y, Color);
+}
+
+void MessageWidget::Layout()
+{
+    TFT_setFont(DEJAVU24_FONT, NULL);
+
+    mRect.Width = (uint16_t)TFT_getStringWidth((char *)mMessage);
+    mRect.Height = (uint16_t)TFT_getfontheight();
+    mRect.X = (int16_t)((DisplayWidth - mRect.Width) / 2);
+    mRect.Y = (int16_t)((DisplayHeight * VPos) / 100);
+}
+
+#endif // CONFIG_HAVE_DISPLAY
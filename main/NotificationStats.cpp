@@ -0,0 +1,175 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <string.h>
+
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+#include <Weave/Profiles/data-management/DataManagement.h>
+#include <SystemLayer/SystemStats.h>
+
+#include "NotificationStats.h"
+#include "AliveTimer.h"
+#include "Histogram.h"
+
+using namespace ::nl;
+using namespace ::nl::Weave;
+using namespace ::nl::Weave::Profiles::DataManagement_Current;
+
+extern const char * TAG;
+
+namespace {
+
+enum
+{
+    kFirstBucketLimitUS = 64,
+};
+
+NotificationStats Stats;
+
+uint16_t GetSubscriptionsInUse(void)
+{
+    SubscriptionEngine * engine = SubscriptionEngine::GetInstance();
+
+    return (uint16_t)(SubscriptionEngine::kMaxNumSubscriptionHandlers - engine->GetNumUnusedHandlers());
+}
+
+void GetPacketBufCounts(uint16_t & inUse, uint16_t & highWater)
+{
+#if WEAVE_SYSTEM_CONFIG_PROVIDE_STATISTICS && LWIP_STATS && MEMP_STATS
+    System::Stats::UpdateLwipPbufCounts();
+    inUse = (uint16_t)System::Stats::GetResourcesInUse()[System::Stats::kSystemLayer_NumPacketBufs];
+    highWater = (uint16_t)System::Stats::GetHighWatermarks()[System::Stats::kSystemLayer_NumPacketBufs];
+#else
+    inUse = 0;
+    highWater = 0;
+#endif
+}
+
+} // unnamed namespace
+
+/* Run the WDM notification engine, sending any dirty trait data to subscribers, and record the
+ * time taken and the resources in use.
+ *
+ * The time taken by a run is the Weave task CPU time spent fanning a change out to subscribers:
+ * the notification engine encodes and sends a notification to each subscriber in turn, until it
+ * reaches its limit of notifications in flight or runs out of PacketBuffers.  It is not the
+ * latency seen by any one subscriber, which also includes the time on the network and, for
+ * subscribers beyond the in-flight limit, the wait for earlier notifications to be acknowledged
+ * before a later run reaches them.
+ *
+ * The PacketBuffers in use are sampled when the run returns, after the notifications it sent
+ * have been handed to the network stack, and so may be below the peak reached during the run.
+ * The peak is reflected in the PacketBuffer high-water mark, which is recorded alongside, but
+ * covers all activity since boot rather than notification runs alone.
+ *
+ * NOTE: This function must be called on the Weave event loop task.
+ */
+void RunNotificationEngine(void)
+{
+    uint16_t subscriptions = GetSubscriptionsInUse();
+    uint16_t packetBufs, packetBufsHighWater;
+    uint32_t runTimeUS;
+    int64_t startTimeUS;
+
+    BeginEventLoopActivity(kEventLoopActivity_NotificationEngine);
+    startTimeUS = ::esp_timer_get_time();
+    SubscriptionEngine::GetInstance()->GetNotificationEngine()->Run();
+    runTimeUS = (uint32_t)(::esp_timer_get_time() - startTimeUS);
+    EndEventLoopActivity();
+
+    GetPacketBufCounts(packetBufs, packetBufsHighWater);
+
+    AddToLog2Histogram(Stats.RunTimeHistogram, runTimeUS, kFirstBucketLimitUS);
+
+    Stats.Runs++;
+    Stats.TotalRunTimeUS += runTimeUS;
+    if (runTimeUS > Stats.MaxRunTimeUS)
+    {
+        Stats.MaxRunTimeUS = runTimeUS;
+    }
+    if (subscriptions > Stats.MaxSubscriptions)
+    {
+        Stats.MaxSubscriptions = subscriptions;
+    }
+    if (packetBufs > Stats.MaxPacketBufsInUse)
+    {
+        Stats.MaxPacketBufsInUse = packetBufs;
+    }
+    Stats.PacketBufsHighWater = packetBufsHighWater;
+}
+
+/* Count a trait leaf encoded by one of the application's data sources, and the number of bytes
+ * it occupies in the notification.
+ *
+ * NOTE: Leaves are encoded once for each subscriber notified, so with N subscribers a change to a
+ * leaf is counted N times.  This function must be called on the Weave event loop task.
+ */
+void CountEncodedLeaf(uint32_t encodedBytes)
+{
+    Stats.EncodedLeaves++;
+    Stats.EncodedLeafBytes += encodedBytes;
+}
+
+/* Retrieve the notification statistics gathered since boot, or since they were last reset.
+ *
+ * NOTE: The caller must hold the Weave stack lock.
+ */
+void GetNotificationStats(NotificationStats & stats)
+{
+    stats = Stats;
+}
+
+/* Reset the notification statistics.
+ *
+ * NOTE: The caller must hold the Weave stack lock.
+ */
+void ResetNotificationStats(void)
+{
+    memset(&Stats, 0, sizeof(Stats));
+}
+
+/* Print the notification statistics.
+ *
+ * NOTE: The caller must hold the Weave stack lock.
+ */
+void DumpNotificationStats(void)
+{
+    printf("DumpNotificationStats: %" PRIu32 " runs, avg %" PRIu32 " us, max %" PRIu32 " us\n",
+           Stats.Runs, (Stats.Runs != 0) ? (uint32_t)(Stats.TotalRunTimeUS / Stats.Runs) : 0, Stats.MaxRunTimeUS);
+    printf("  subscriptions: max %" PRIu16 " of %u\n", Stats.MaxSubscriptions,
+           (unsigned)SubscriptionEngine::kMaxNumSubscriptionHandlers);
+    printf("  pbufs in use after run: max %" PRIu16 ", high-water mark since boot %" PRIu16 "\n",
+           Stats.MaxPacketBufsInUse, Stats.PacketBufsHighWater);
+    printf("  leaves encoded: %" PRIu32 ", %" PRIu32 " bytes\n", Stats.EncodedLeaves, Stats.EncodedLeafBytes);
+    printf("  run time histogram\n");
+    for (uint8_t i = 0; i < kNotificationStats_NumRunTimeBuckets; i++)
+    {
+        if (i < kNotificationStats_NumRunTimeBuckets - 1)
+        {
+            printf("  <%6" PRIu32 " us: %" PRIu32 "\n", Log2HistogramBucketLimit(kFirstBucketLimitUS, i), Stats.RunTimeHistogram[i]);
+        }
+        else
+        {
+            printf("  >=%" PRIu32 " us: %" PRIu32 "\n", Log2HistogramBucketLimit(kFirstBucketLimitUS, i - 1), Stats.RunTimeHistogram[i]);
+        }
+    }
+}
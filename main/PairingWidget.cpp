@@ -16,8 +16,12 @@
  *    limitations under the License.
  */
 
+#include <string.h>
+#include <stdlib.h>
+
 #include "esp_system.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -39,84 +43,232 @@ using namespace ::nl::Weave::Profiles::DeviceDescription;
 
 enum
 {
-    kQRCodeVersion = 4,
     kQRCodeECC = ECC_LOW,
-    kQRCodeModuleSizePix = 4,
-    kQRCodeQuietZone = 2
+    kQRCodeMaxModuleSizePix = 4,
+    kQRCodeQuietZone = 2,
+    kQRCodeMaxHeight = 70,          // Maximum height of the QR code, as a percentage of the display height
 };
 
+namespace {
+
+/* Select the smallest QR code version that can hold a given string at the ECC_LOW level.
+ *
+ * NOTE: The QRCode library chooses the most compact encoding mode for the string, but does
+ * not check that the string fits in the requested version.  So the same mode selection is
+ * performed here and checked against the character capacity of each version.
+ */
+uint8_t SelectQRCodeVersion(const char * str, uint8_t maxVersion)
+{
+    // Character capacities for QR code versions 1-10 at the ECC_LOW level, for the numeric,
+    // alphanumeric and byte encoding modes.
+    static const uint16_t sCapacity[3][10] =
+    {
+        { 41, 77, 127, 187, 255, 322, 370, 461, 552, 652 },
+        { 25, 47, 77, 114, 154, 195, 224, 279, 335, 395 },
+        { 17, 32, 53, 78, 106, 134, 154, 192, 230, 271 },
+    };
+
+    size_t len = strlen(str);
+    bool isNumeric = true, isAlphanumeric = true;
+    uint8_t mode;
+
+    for (const char * p = str; *p != 0; p++)
+    {
+        if (*p < '0' || *p > '9')
+        {
+            isNumeric = false;
+            if (strchr("ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:", *p) == NULL)
+            {
+                isAlphanumeric = false;
+            }
+        }
+    }
+
+    mode = (isNumeric) ? 0 : (isAlphanumeric) ? 1 : 2;
+
+    for (uint8_t version = 1; version <= maxVersion && version <= 10; version++)
+    {
+        if (len <= sCapacity[mode][version - 1])
+        {
+            return version;
+        }
+    }
+
+    return 0;
+}
+
+} // unnamed namespace
+
 void PairingWidget::Init()
 {
     PairingCodeColor = { 4, 173, 201 }; // PANTONE 3125 C
     QRCodeColor = { 141, 151, 155 }; // PANTONE 443 C
     VMargin = 7;
+    mQRCodeValid = false;
+    mPairingCode[0] = 0;
+    memset(&mQRCodeRect, 0, sizeof(mQRCodeRect));
+    memset(&mPairingCodeRect, 0, sizeof(mPairingCodeRect));
+
+    // Generate the QR code now, so that the pairing screen can be shown immediately.
+    UpdateQRCode();
 }
 
+/* Regenerate the QR code if the pairing code has changed since it was generated.
+ *
+ * NOTE: The compositor's lock must be held when calling this method.
+ */
 void PairingWidget::Display()
+{
+    if (!mQRCodeValid || strncmp(mPairingCode, FabricState.PairingCode, kMaxPairingCodeLength) != 0)
+    {
+        Invalidate(GetBounds());
+        UpdateQRCode();
+        Invalidate(GetBounds());
+    }
+}
+
+DisplayRect PairingWidget::GetBounds() const
+{
+    return mQRCodeRect.Union(mPairingCodeRect);
+}
+
+void PairingWidget::Layout()
+{
+    memset(&mQRCodeRect, 0, sizeof(mQRCodeRect));
+    memset(&mPairingCodeRect, 0, sizeof(mPairingCodeRect));
+
+    if (!mQRCodeValid)
+    {
+        return;
+    }
+
+    mQRCodeRect.Width = mQRCodeRect.Height = (mQRCode.size + kQRCodeQuietZone * 2) * mQRCodeModuleSizePix;
+    mQRCodeRect.X = (int16_t)((DisplayWidth - mQRCodeRect.Width) / 2);
+    mQRCodeRect.Y = (int16_t)((DisplayHeight * VMargin) / 100);
+
+    // Center the pairing code in the space below the QR code.
+    TFT_setFont(DEJAVU24_FONT, NULL);
+    mPairingCodeRect.Width = (uint16_t)TFT_getStringWidth(mPairingCode);
+    mPairingCodeRect.Height = (uint16_t)TFT_getfontheight();
+    mPairingCodeRect.X = (int16_t)((DisplayWidth - mPairingCodeRect.Width) / 2);
+    mPairingCodeRect.Y = (int16_t)(mQRCodeRect.Bottom() + (DisplayHeight - mQRCodeRect.Bottom() - mPairingCodeRect.Height) / 2);
+}
+
+void PairingWidget::Render(Canvas & canvas)
+{
+    const DisplayRect & qrCodeRect = mQRCodeRect;
+
+    if (!mQRCodeValid)
+    {
+        return;
+    }
+
+    // Draw the QR code image.  Each row of modules is expanded into a row of pixels, which is then
+    // repeated for the height of a module.
+    DisplayRect drawRect = qrCodeRect.Intersection(canvas.ClipRect());
+    if (!drawRect.IsEmpty())
+    {
+        uint16_t quietZonePix = kQRCodeQuietZone * mQRCodeModuleSizePix;
+        int16_t prevModuleY = -1;
+
+        canvas.FillRect(qrCodeRect.X, qrCodeRect.Y, qrCodeRect.Width, qrCodeRect.Height, QRCodeColor);
+
+        for (int16_t y = drawRect.Y; y < drawRect.Bottom(); y++)
+        {
+            int16_t moduleY = (y - qrCodeRect.Y - quietZonePix) / mQRCodeModuleSizePix;
+
+            if (y - qrCodeRect.Y < quietZonePix || moduleY >= mQRCode.size)
+            {
+                continue;
+            }
+
+            if (moduleY == prevModuleY)
+            {
+                canvas.CopyRow(qrCodeRect.X + quietZonePix, y - 1, mQRCode.size * mQRCodeModuleSizePix, y);
+                continue;
+            }
+
+            // Fill each horizontal run of dark modules with a single operation.
+            uint8_t moduleX = 0;
+            while (moduleX < mQRCode.size)
+            {
+                uint8_t runStart = moduleX;
+                while (moduleX < mQRCode.size && qrcode_getModule(&mQRCode, moduleX, (uint8_t)moduleY))
+                {
+                    moduleX++;
+                }
+                if (moduleX > runStart)
+                {
+                    canvas.FillRect(qrCodeRect.X + quietZonePix + runStart * mQRCodeModuleSizePix, y,
+                                    (moduleX - runStart) * mQRCodeModuleSizePix, 1, TFT_BLACK);
+                }
+                else
+                {
+                    moduleX++;
+                }
+            }
+
+            prevModuleY = moduleY;
+        }
+    }
+
+    // Draw the pairing code.
+    canvas.DrawText(mPairingCode, mPairingCodeRect.X, mPairingCodeRect.Y, PairingCodeColor);
+}
+
+/* Generate the QR code for the device's current pairing information.
+ */
+WEAVE_ERROR PairingWidget::UpdateQRCode()
 {
     WEAVE_ERROR err;
-    QRCode qrCode;
-    enum { kMaxQRCodeStrLength = 120 };
     char * qrCodeStr = NULL;
-    uint8_t * qrCodeDataBuf = NULL;
-    uint16_t qrCodeSize, qrCodeX, qrCodeY, qrCodeXOffset, qrCodeYOffset;
-    uint16_t pairingCodeHeight, pairingCodeWidth, pairingCodeX, pairingCodeY;
+    uint8_t version;
+    int64_t startTimeUS = ::esp_timer_get_time();
+
+    mQRCodeValid = false;
+
+    strncpy(mPairingCode, FabricState.PairingCode, kMaxPairingCodeLength);
+    mPairingCode[kMaxPairingCodeLength] = 0;
 
     // Construct the string to be encoded in the QR code.
     err = GetQRCodeString(qrCodeStr);
     SuccessOrExit(err);
 
+    // Select the smallest QR code version that will hold the string.
+    version = SelectQRCodeVersion(qrCodeStr, kMaxQRCodeVersion);
+    VerifyOrExit(version != 0, err = WEAVE_ERROR_BUFFER_TOO_SMALL);
+
     // Generate the QR code.
-    qrCodeDataBuf = (uint8_t *)malloc(qrcode_getBufferSize(kQRCodeVersion));
-    VerifyOrExit(qrCodeDataBuf != NULL, err = WEAVE_ERROR_NO_MEMORY);
-    if (qrcode_initText(&qrCode, qrCodeDataBuf, kQRCodeVersion, kQRCodeECC, qrCodeStr) != 0)
+    if (qrcode_initText(&mQRCode, mQRCodeData, version, kQRCodeECC, qrCodeStr) != 0)
     {
         ESP_LOGE(TAG, "qrcode_initText() failed");
         ExitNow(err = WEAVE_ERROR_INCORRECT_STATE);
     }
 
-    // Draw the QR code image on the screen.
-    qrCodeSize = (qrCode.size + kQRCodeQuietZone * 2) * kQRCodeModuleSizePix;
-    qrCodeX = (DisplayWidth - qrCodeSize) / 2;
-    qrCodeY = (DisplayHeight * VMargin) / 100;
-    qrCodeXOffset = qrCodeX + (kQRCodeQuietZone * kQRCodeModuleSizePix);
-    qrCodeYOffset = qrCodeY + (kQRCodeQuietZone * kQRCodeModuleSizePix);
-    TFT_fillRect(qrCodeX, qrCodeY, (int)qrCodeSize, (int)qrCodeSize, QRCodeColor);
-    for (uint8_t y = 0; y < qrCode.size; y++)
+    // Choose the largest module size that keeps the QR code within its allotted height.
+    mQRCodeModuleSizePix = ((DisplayHeight * kQRCodeMaxHeight) / 100) / (mQRCode.size + kQRCodeQuietZone * 2);
+    if (mQRCodeModuleSizePix > kQRCodeMaxModuleSizePix)
     {
-        for (uint8_t x = 0; x < qrCode.size; x++)
-        {
-            if (qrcode_getModule(&qrCode, x, y))
-            {
-                TFT_fillRect(x * kQRCodeModuleSizePix + qrCodeXOffset, y * kQRCodeModuleSizePix + qrCodeYOffset,
-                             (int)kQRCodeModuleSizePix, (int)kQRCodeModuleSizePix, TFT_BLACK);
-            }
-        }
+        mQRCodeModuleSizePix = kQRCodeMaxModuleSizePix;
     }
+    VerifyOrExit(mQRCodeModuleSizePix > 0, err = WEAVE_ERROR_BUFFER_TOO_SMALL);
 
-    // Display the pairing code
-    TFT_setFont(DEJAVU24_FONT, NULL);
-    pairingCodeHeight = TFT_getfontheight();
-    pairingCodeWidth = TFT_getStringWidth((char *)FabricState.PairingCode);
-    pairingCodeX = (DisplayWidth - pairingCodeWidth) / 2;
-    pairingCodeY = qrCodeY + qrCodeSize + (DisplayHeight - (qrCodeY + qrCodeSize) - pairingCodeHeight) / 2;
-    _fg = PairingCodeColor;
-    _bg = TFT_BLACK;
-    TFT_print((char *)FabricState.PairingCode, (int)pairingCodeX, (int)pairingCodeY);
+    mQRCodeValid = true;
+
+    ESP_LOGI(TAG, "Pairing QR code generated (version %u, %u chars) in %u ms", version, (unsigned)strlen(qrCodeStr),
+             (uint32_t)((::esp_timer_get_time() - startTimeUS) / 1000));
 
 exit:
+    Layout();
     if (qrCodeStr != NULL)
     {
         free(qrCodeStr);
     }
-    if (qrCodeDataBuf != NULL)
-    {
-        free(qrCodeDataBuf);
-    }
     if (err != WEAVE_NO_ERROR)
     {
-        ESP_LOGE(TAG, "PairingWidget::Display() failed: %s", ErrorStr(err));
+        ESP_LOGE(TAG, "PairingWidget::UpdateQRCode() failed: %s", ErrorStr(err));
     }
+    return err;
 }
 
 WEAVE_ERROR PairingWidget::GetQRCodeString(char *& qrCodeStr)
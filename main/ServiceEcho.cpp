@@ -16,11 +16,15 @@
  *    limitations under the License.
  */
 
+#include <string.h>
+
 #include "esp_system.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include <Weave/DeviceLayer/WeaveDeviceLayer.h>
 #include "ServiceEcho.h"
+#include "AliveTimer.h"
 
 using namespace ::nl;
 using namespace ::nl::Inet;
@@ -33,6 +37,20 @@ extern const char * TAG;
 
 ServiceEchoClient ServiceEcho;
 
+namespace {
+
+// Payload sizes exercised by the payload size sweep.  Sizes larger than the capacity of the
+// payload buffer are skipped.
+const uint16_t SweepPayloadSizes[ServiceEchoClient::kMaxSweepSizes] = { 0, 64, 128, 256, 384, 512, 768, 1024, 1152, 1280 };
+
+enum
+{
+    kSweepEchoIntervalMS = 100,     // Delay between consecutive echos during a payload size sweep (in ms)
+    kMessageTrailerReserve = 32,    // Space left at the end of the payload buffer for the message integrity check
+};
+
+} // unnamed namespace
+
 static void EchoBindingEventHandler(void * apAppState, Binding::EventType aEvent, const Binding::InEventParam & aInParam, Binding::OutEventParam & aOutParam)
 {
     Binding *binding = aInParam.Source;
@@ -56,60 +74,66 @@ static void EchoBindingEventHandler(void * apAppState, Binding::EventType aEvent
     }
 }
 
-static void EchoClientEventHandler(void * appState, WeaveEchoClient::EventType eventType, const WeaveEchoClient::InEventParam & inParam, WeaveEchoClient::OutEventParam & outParam)
+void ServiceEchoClient::HandleEchoClientEvent(void * appState, WeaveEchoClient::EventType eventType, const WeaveEchoClient::InEventParam & inParam, WeaveEchoClient::OutEventParam & outParam)
 {
+    EventLoopActivityScope activityScope(kEventLoopActivity_ServiceEcho);
+
     switch (eventType)
     {
     case WeaveEchoClient::kEvent_PreparePayload:
-        outParam.PreparePayload.Payload = PacketBuffer::New();
+        outParam.PreparePayload.Payload = ServiceEcho.PreparePayload();
         outParam.PreparePayload.PrepareError = (outParam.PreparePayload.Payload != NULL) ? WEAVE_NO_ERROR : WEAVE_ERROR_NO_MEMORY;
         break;
     case WeaveEchoClient::kEvent_ResponseReceived:
-        ESP_LOGI(TAG, "Echo response received from service");
-        PacketBuffer::Free(inParam.ResponseReceived.Payload);
-        ServiceEcho.ServiceAlive = true;
+        ServiceEcho.HandleEchoComplete(inParam.ResponseReceived.Payload);
         break;
     case WeaveEchoClient::kEvent_ResponseTimeout:
         ESP_LOGI(TAG, "Timeout waiting for echo response from service");
-        ServiceEcho.ServiceAlive = false;
+        ServiceEcho.HandleEchoComplete(NULL);
         break;
     case WeaveEchoClient::kEvent_CommunicationError:
         ESP_LOGE(TAG, "Communication error sending echo request to service: %s", ErrorStr(inParam.CommunicationError.Reason));
-        ServiceEcho.ServiceAlive = false;
+        ServiceEcho.HandleEchoComplete(NULL);
         break;
     default:
         ServiceEcho.DefaultEventHandler(appState, eventType, inParam, outParam);
     }
 }
 
-void ServiceEchoClient::PlatformEventHandler(const WeaveDeviceEvent * event, intptr_t arg)
+void ServiceEchoClient::HandleEchoTimer(System::Layer * /* unused */, void * /* unused */, System::Error /* unused */)
 {
-    WEAVE_ERROR err = WEAVE_NO_ERROR;
+    WEAVE_ERROR err;
 
+    err = ServiceEcho.SendEchoRequest();
+    if (err != WEAVE_NO_ERROR)
+    {
+        ESP_LOGE(TAG, "ServiceEcho.SendEchoRequest() failed: %s", ErrorStr(err));
+        ServiceEcho.ScheduleNextEcho(false);
+    }
+}
+
+void ServiceEchoClient::PlatformEventHandler(const WeaveDeviceEvent * event, intptr_t arg)
+{
     if (event->Type == DeviceEventType::kServiceTunnelStateChange)
     {
         if (event->ServiceTunnelStateChange.Result == kConnectivity_Established)
         {
             ESP_LOGI(TAG, "Starting periodic echos to service");
-            err = ServiceEcho.SendRepeating(ServiceEcho.mIntervalMS);
-            SuccessOrExit(err);
+#if CONFIG_SERVICE_ECHO_PAYLOAD_SWEEP_SAMPLES
+            ServiceEcho.StartPayloadSweep(CONFIG_SERVICE_ECHO_PAYLOAD_SWEEP_SAMPLES);
+#endif
+            ServiceEcho.StartEchos();
         }
         else if (event->ServiceTunnelStateChange.Result == kConnectivity_Lost)
         {
             ESP_LOGI(TAG, "Stopping periodic echos to service");
-            ServiceEcho.Stop();
+            ServiceEcho.StopEchos();
             ServiceEcho.ServiceAlive = false;
         }
     }
-
-exit:
-    if (err != WEAVE_NO_ERROR)
-    {
-        ESP_LOGE(TAG, "ServiceEchoClient::PlatformEventHandler() failed: %s", ErrorStr(err));
-    }
 }
 
-WEAVE_ERROR ServiceEchoClient::Init(uint32_t intervalMS)
+WEAVE_ERROR ServiceEchoClient::Init(uint32_t minIntervalMS, uint32_t maxIntervalMS)
 {
     WEAVE_ERROR err;
     Binding * binding;
@@ -117,14 +141,30 @@ WEAVE_ERROR ServiceEchoClient::Init(uint32_t intervalMS)
     binding = ::nl::Weave::DeviceLayer::ExchangeMgr.NewBinding(EchoBindingEventHandler, NULL);
     VerifyOrExit(binding != NULL, err = WEAVE_ERROR_NO_MEMORY);
 
-    err = WeaveEchoClient::Init(binding, EchoClientEventHandler, NULL);
+    err = WeaveEchoClient::Init(binding, HandleEchoClientEvent, NULL);
     SuccessOrExit(err);
 
     err = PlatformMgr().AddEventHandler(PlatformEventHandler);
     SuccessOrExit(err);
 
+    // Allocate the buffer that will carry the payload of every echo request.
+    mPayloadBuf = PacketBuffer::New();
+    VerifyOrExit(mPayloadBuf != NULL, err = WEAVE_ERROR_NO_MEMORY);
+    mPayloadStart = mPayloadBuf->Start();
+    mMaxPayloadLen = (mPayloadBuf->AvailableDataLength() > kMessageTrailerReserve)
+            ? mPayloadBuf->AvailableDataLength() - kMessageTrailerReserve
+            : 0;
+    mPayloadBufInFlight = false;
+    mSentPayloadLen = 0;
+    mSendTimeUS = 0;
+    mSweepActive = false;
+    mNumSweepSizes = 0;
+
     ServiceAlive = false;
-    mIntervalMS = intervalMS;
+    LastRTTUS = 0;
+    mMinIntervalMS = minIntervalMS;
+    mMaxIntervalMS = (maxIntervalMS > minIntervalMS) ? maxIntervalMS : minIntervalMS;
+    mCurIntervalMS = minIntervalMS;
 
 exit:
     if (err != WEAVE_NO_ERROR)
@@ -133,3 +173,293 @@ exit:
     }
     return err;
 }
+
+WEAVE_ERROR ServiceEchoClient::StartPayloadSweep(uint8_t samplesPerSize)
+{
+    WEAVE_ERROR err = WEAVE_NO_ERROR;
+
+    VerifyOrExit(mMaxPayloadLen != 0 && samplesPerSize != 0, err = WEAVE_ERROR_INCORRECT_STATE);
+
+    // Determine the sizes that will fit in the payload buffer.
+    mNumSweepSizes = 0;
+    for (uint8_t i = 0; i < kMaxSweepSizes; i++)
+    {
+        if (SweepPayloadSizes[i] <= mMaxPayloadLen)
+        {
+            memset(&mSweepStats[mNumSweepSizes], 0, sizeof(mSweepStats[0]));
+            mSweepStats[mNumSweepSizes].PayloadLen = SweepPayloadSizes[i];
+            mSweepStats[mNumSweepSizes].MinRTTUS = UINT32_MAX;
+            mNumSweepSizes++;
+        }
+    }
+
+    ESP_LOGI(TAG, "Starting echo payload sweep (%" PRIu8 " sizes, %" PRIu8 " echos per size, max payload %" PRIu16 " bytes)",
+             mNumSweepSizes, samplesPerSize, mMaxPayloadLen);
+
+    mSweepSamplesPerSize = samplesPerSize;
+    mSweepSizeIndex = 0;
+    mSweepActive = true;
+
+    // If echos are currently running, the sweep begins with the next scheduled echo.  Otherwise
+    // it begins when the service tunnel is established.
+
+exit:
+    return err;
+}
+
+void ServiceEchoClient::StartEchos(void)
+{
+    mCurIntervalMS = mMinIntervalMS;
+    SystemLayer.CancelTimer(HandleEchoTimer, NULL);
+    HandleEchoTimer(&SystemLayer, NULL, WEAVE_SYSTEM_CONFIG_NO_ERROR);
+}
+
+void ServiceEchoClient::StopEchos(void)
+{
+    SystemLayer.CancelTimer(HandleEchoTimer, NULL);
+    Stop();
+
+    // Stopping the client abandons any outstanding request without a response.
+    ReleasePayloadBuf(false);
+
+    if (mSweepActive)
+    {
+        ESP_LOGI(TAG, "Echo payload sweep aborted");
+        mSweepActive = false;
+    }
+}
+
+void ServiceEchoClient::HandleEchoComplete(PacketBuffer * response)
+{
+    uint32_t rttUS = (uint32_t)(::esp_timer_get_time() - mSendTimeUS);
+
+    // Only count the echo as successful if the service returned the entire payload.
+    bool responded = (response != NULL && response->DataLength() == mSentPayloadLen);
+
+    if (response != NULL)
+    {
+        if (!responded)
+        {
+            ESP_LOGE(TAG, "Echo response from service has wrong length (expected %" PRIu16 ", got %" PRIu16 ")",
+                     mSentPayloadLen, response->DataLength());
+        }
+        PacketBuffer::Free(response);
+    }
+
+    ServiceAlive = (response != NULL);
+
+    ReleasePayloadBuf(response != NULL);
+
+    if (responded)
+    {
+        LastRTTUS = rttUS;
+    }
+
+    if (mSweepActive)
+    {
+        RecordSweepSample(responded, rttUS);
+    }
+
+    ScheduleNextEcho(responded);
+
+    if (responded && !mSweepActive)
+    {
+        ESP_LOGI(TAG, "Echo response received from service (rtt %" PRIu32 " ms, next echo in %" PRIu32 " ms)",
+                 rttUS / 1000, mCurIntervalMS);
+    }
+}
+
+void ServiceEchoClient::ScheduleNextEcho(bool serviceResponded)
+{
+    WEAVE_ERROR err;
+    uint32_t delayMS;
+
+    // While sweeping payload sizes, send echos back-to-back at a fixed, short interval.
+    if (mSweepActive)
+    {
+        delayMS = kSweepEchoIntervalMS;
+    }
+
+    // Otherwise, back off while the service is responding; tighten back to the minimum
+    // interval as soon as an echo fails.
+    else
+    {
+        if (serviceResponded)
+        {
+            mCurIntervalMS = (mCurIntervalMS <= mMaxIntervalMS / 2) ? mCurIntervalMS * 2 : mMaxIntervalMS;
+        }
+        else
+        {
+            mCurIntervalMS = mMinIntervalMS;
+        }
+        delayMS = mCurIntervalMS;
+    }
+
+    err = SystemLayer.StartTimer(delayMS, HandleEchoTimer, NULL);
+    if (err != WEAVE_NO_ERROR)
+    {
+        ESP_LOGE(TAG, "SystemLayer.StartTimer() failed: %s", ErrorStr(err));
+    }
+}
+
+/* Give up the reusable payload buffer's role in the request that has just completed.
+ *
+ * A response can only arrive once the request has been sent and, under WRM, acknowledged, at which
+ * point the stack has released its reference to the request buffer, and the buffer can safely be
+ * rewritten for the next echo.  A request that timed out or failed, on the other hand, may still
+ * be queued for transmission (e.g. behind a stalled service tunnel), and PacketBuffer offers no way
+ * to tell when that is no longer so.  In that case our reference is dropped, leaving the buffer to
+ * be freed by whoever holds it last, and a new reusable buffer is allocated for the next echo.
+ */
+void ServiceEchoClient::ReleasePayloadBuf(bool responded)
+{
+    if (mPayloadBufInFlight)
+    {
+        mPayloadBufInFlight = false;
+        if (!responded)
+        {
+            PacketBuffer::Free(mPayloadBuf);
+            mPayloadBuf = NULL;
+        }
+    }
+}
+
+PacketBuffer * ServiceEchoClient::PreparePayload(void)
+{
+    PacketBuffer * payload = NULL;
+    uint16_t payloadLen = (mSweepActive) ? mSweepStats[mSweepSizeIndex].PayloadLen : 0;
+
+    // If an earlier echo is still outstanding, its request holds the reusable buffer, so give it
+    // up (see ReleasePayloadBuf()).
+    ReleasePayloadBuf(false);
+
+    // Replace a reusable buffer that has been given up.
+    if (mPayloadBuf == NULL)
+    {
+        mPayloadBuf = PacketBuffer::New();
+        VerifyOrExit(mPayloadBuf != NULL, /* */);
+        mPayloadStart = mPayloadBuf->Start();
+    }
+
+    // Reset the buffer to its initial, empty state.  Sending the request moves the start of
+    // the buffer to make room for the message header, so this must be done on every use.
+    mPayloadBuf->SetStart(mPayloadStart);
+    mPayloadBuf->SetDataLength(0);
+
+    // Hand the echo client its own reference to the buffer, which it releases once the
+    // request has been sent.  Our reference keeps the buffer out of the pool.
+    mPayloadBuf->AddRef();
+    mPayloadBufInFlight = true;
+
+    payload = mPayloadBuf;
+
+    // Fill the payload with a simple counting pattern.
+    if (payloadLen > mMaxPayloadLen)
+    {
+        payloadLen = mMaxPayloadLen;
+    }
+    for (uint16_t i = 0; i < payloadLen; i++)
+    {
+        payload->Start()[i] = (uint8_t)i;
+    }
+    payload->SetDataLength(payloadLen);
+
+    if (mSweepActive)
+    {
+        mSweepStats[mSweepSizeIndex].Sent++;
+    }
+
+    mSentPayloadLen = payloadLen;
+    mSendTimeUS = ::esp_timer_get_time();
+
+exit:
+    return payload;
+}
+
+void ServiceEchoClient::RecordSweepSample(bool responded, uint32_t rttUS)
+{
+    PayloadSizeStats & stats = mSweepStats[mSweepSizeIndex];
+
+    if (responded)
+    {
+        stats.Received++;
+        stats.TotalRTTUS += rttUS;
+        if (rttUS < stats.MinRTTUS)
+        {
+            stats.MinRTTUS = rttUS;
+        }
+        if (rttUS > stats.MaxRTTUS)
+        {
+            stats.MaxRTTUS = rttUS;
+        }
+    }
+
+    // Move to the next size once the current size has been sampled the requested number of times.
+    if (stats.Sent >= mSweepSamplesPerSize)
+    {
+        mSweepSizeIndex++;
+        if (mSweepSizeIndex >= mNumSweepSizes)
+        {
+            mSweepActive = false;
+            mCurIntervalMS = mMinIntervalMS;
+            LogSweepResults();
+        }
+    }
+}
+
+/* Find the first size in the payload size sweep at which loss rises by 20 percentage points, or
+ * the average round-trip time grows by more than 50%, relative to the next smaller size.
+ */
+bool ServiceEchoClient::FindPayloadSweepKnee(uint8_t & index) const
+{
+    for (uint8_t i = 1; i < mNumSweepSizes; i++)
+    {
+        const PayloadSizeStats & prevStats = mSweepStats[i - 1];
+        const PayloadSizeStats & stats = mSweepStats[i];
+
+        if (prevStats.Received != 0 && prevStats.Sent != 0)
+        {
+            uint32_t prevLossPct = ((prevStats.Sent - prevStats.Received) * 100u) / prevStats.Sent;
+            uint32_t prevAvgRTTUS = prevStats.TotalRTTUS / prevStats.Received;
+            uint32_t lossPct = (stats.Sent != 0) ? ((stats.Sent - stats.Received) * 100u) / stats.Sent : 0;
+            uint32_t avgRTTUS = (stats.Received != 0) ? stats.TotalRTTUS / stats.Received : 0;
+
+            if (lossPct >= prevLossPct + 20 || stats.Received == 0 || avgRTTUS * 2 > prevAvgRTTUS * 3)
+            {
+                index = i;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void ServiceEchoClient::LogSweepResults(void) const
+{
+    uint8_t kneeIndex;
+    bool kneeFound = FindPayloadSweepKnee(kneeIndex);
+
+    ESP_LOGI(TAG, "Echo payload sweep results:");
+    ESP_LOGI(TAG, "  size   sent  rcvd  loss%%  min-rtt  avg-rtt  max-rtt  goodput");
+
+    for (uint8_t i = 0; i < mNumSweepSizes; i++)
+    {
+        const PayloadSizeStats & stats = mSweepStats[i];
+        uint32_t lossPct = (stats.Sent != 0) ? ((stats.Sent - stats.Received) * 100u) / stats.Sent : 0;
+        uint32_t avgRTTUS = (stats.Received != 0) ? stats.TotalRTTUS / stats.Received : 0;
+
+        // Goodput counts the payload carried in both directions over the average round-trip time.
+        uint32_t goodputBPS = (avgRTTUS != 0) ? (uint32_t)((2ull * stats.PayloadLen * 1000000ull) / avgRTTUS) : 0;
+
+        ESP_LOGI(TAG, "  %4" PRIu16 "  %4" PRIu8 "  %4" PRIu8 "  %4" PRIu32 "  %5" PRIu32 "ms  %5" PRIu32 "ms  %5" PRIu32 "ms  %6" PRIu32 " B/s",
+                 stats.PayloadLen, stats.Sent, stats.Received, lossPct,
+                 (stats.Received != 0) ? stats.MinRTTUS / 1000 : 0, avgRTTUS / 1000, stats.MaxRTTUS / 1000, goodputBPS);
+
+        if (kneeFound && i == kneeIndex)
+        {
+            ESP_LOGI(TAG, "  Loss/latency jump between %" PRIu16 " and %" PRIu16 " bytes (possible fragmentation)",
+                     mSweepStats[i - 1].PayloadLen, stats.PayloadLen);
+        }
+    }
+}
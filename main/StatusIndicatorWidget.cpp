@@ -17,6 +17,7 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
 
 #include "esp_system.h"
 #include "esp_log.h"
@@ -38,75 +39,216 @@ void StatusIndicatorWidget::Init(uint8_t numIndicators)
     Size = 15;
     VPos = 75;
     HMargin = 10;
-    memset(Char, 0, sizeof(Char));
-    memset(State, 0, sizeof(State));
     mNumIndicators = (numIndicators <= kMaxIndicators) ? numIndicators : (uint16_t)kMaxIndicators;
-    memset(mLastChar, 0, sizeof(mLastChar));
-    memset(mLastState, 0, sizeof(mLastState));
+    memset(mChar, 0, sizeof(mChar));
+    memset(mState, 0, sizeof(mState));
+    memset(mIndicatorRects, 0, sizeof(mIndicatorRects));
+
+    // Allocate the glyph cache now, for indicators of the initial size, so that drawing the
+    // indicators never allocates memory.
+    mGlyphCacheSizePix = (DisplayHeight * Size) / 100;
+    mGlyphCacheSlotSize = (mGlyphCacheSizePix * mGlyphCacheSizePix + 7) / 8;
+    mGlyphCache = (uint8_t *)malloc(kMaxCachedGlyphs * mGlyphCacheSlotSize);
+    if (mGlyphCache == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate status indicator glyph cache");
+    }
+    memset(mGlyphCacheChar, 0, sizeof(mGlyphCacheChar));
+    mGlyphCacheNext = 0;
 }
 
-void StatusIndicatorWidget::Display()
+/* Set the character displayed by an indicator, redrawing the indicator if it changes.
+ *
+ * NOTE: The compositor's lock must be held when calling this method.
+ */
+void StatusIndicatorWidget::SetChar(uint8_t indicatorPos, char indicatorChar)
 {
-    for (uint8_t i = 0; i < mNumIndicators; i++)
+    if (indicatorPos < mNumIndicators && mChar[indicatorPos] != indicatorChar)
+    {
+        mChar[indicatorPos] = indicatorChar;
+        Invalidate(mIndicatorRects[indicatorPos]);
+    }
+}
+
+/* Set the state of an indicator, redrawing the indicator if it changes.
+ *
+ * NOTE: The compositor's lock must be held when calling this method.
+ */
+void StatusIndicatorWidget::SetState(uint8_t indicatorPos, bool state)
+{
+    if (indicatorPos < mNumIndicators && mState[indicatorPos] != state)
     {
-        DrawIndicator(Char[i], State[i], i);
-        mLastChar[i] = Char[i];
-        mLastState[i] = State[i];
+        mState[indicatorPos] = state;
+        Invalidate(mIndicatorRects[indicatorPos]);
     }
 }
 
-void StatusIndicatorWidget::Update()
+DisplayRect StatusIndicatorWidget::GetBounds() const
+{
+    if (mNumIndicators == 0)
+    {
+        DisplayRect emptyRect = { 0, 0, 0, 0 };
+        return emptyRect;
+    }
+
+    return mIndicatorRects[0].Union(mIndicatorRects[mNumIndicators - 1]);
+}
+
+void StatusIndicatorWidget::Render(Canvas & canvas)
 {
     for (uint8_t i = 0; i < mNumIndicators; i++)
     {
-        if (Char[i] != mLastChar[i] || State[i] != mLastState[i])
+        if (mIndicatorRects[i].Intersects(canvas.ClipRect()))
         {
-            DrawIndicator(Char[i], State[i], i);
-            mLastChar[i] = Char[i];
-            mLastState[i] = State[i];
+            DrawIndicator(canvas, mChar[i], mState[i], i);
         }
     }
 }
 
-void StatusIndicatorWidget::DrawIndicator(char indicatorChar, bool state, uint8_t indicatorPos) const
+void StatusIndicatorWidget::Layout()
 {
     uint16_t sizePix = (DisplayHeight * Size) / 100;
     uint16_t marginPix = (DisplayWidth * HMargin) / 100;
 
-    uint16_t indicatorY = (DisplayHeight * VPos) / 100;
-    uint16_t indicatorX = marginPix + ((DisplayWidth - (2 * marginPix) - sizePix) * indicatorPos) / (mNumIndicators - 1);
+    for (uint8_t i = 0; i < mNumIndicators; i++)
+    {
+        DisplayRect & rect = mIndicatorRects[i];
+        rect.X = (int16_t)(marginPix + ((DisplayWidth - (2 * marginPix) - sizePix) * i) / (mNumIndicators - 1));
+        rect.Y = (int16_t)((DisplayHeight * VPos) / 100);
+        rect.Width = sizePix;
+        rect.Height = sizePix;
+    }
+
+    // Discard the cached glyphs if the size of the indicators has changed.
+    if (sizePix != mGlyphCacheSizePix)
+    {
+        memset(mGlyphCacheChar, 0, sizeof(mGlyphCacheChar));
+        mGlyphCacheSizePix = sizePix;
+        mGlyphCacheNext = 0;
+    }
+}
+
+void StatusIndicatorWidget::DrawIndicator(Canvas & canvas, char indicatorChar, bool state, uint8_t indicatorPos)
+{
+    const DisplayRect & rect = mIndicatorRects[indicatorPos];
+    const uint8_t * glyphMask = NULL;
+    color_t charColor, backgroundColor;
 
-    if (indicatorChar != 0 && !state)
+    if (indicatorChar == 0)
     {
-        TFT_fillRect((int)indicatorX, (int)indicatorY, (int)sizePix, (int)sizePix, TFT_BLACK);
-        TFT_drawRect((int)indicatorX, (int)indicatorY, (int)sizePix, (int)sizePix, Color);
-        _fg = Color;
-        _bg = TFT_BLACK;
+        canvas.FillRect(rect.X, rect.Y, rect.Width, rect.Height, TFT_BLACK);
+        return;
+    }
+
+    if (!state)
+    {
+        charColor = Color;
+        backgroundColor = TFT_BLACK;
     }
     else
     {
-        TFT_fillRect((int)indicatorX, (int)indicatorY, (int)sizePix, (int)sizePix, (indicatorChar != 0) ? Color : TFT_BLACK);
-        _fg = TFT_BLACK;
-        _bg = Color;
+        charColor = TFT_BLACK;
+        backgroundColor = Color;
+    }
+
+    glyphMask = GetGlyphMask(indicatorChar, rect.Width);
+
+    if (glyphMask != NULL)
+    {
+        canvas.DrawMask(rect.X, rect.Y, rect.Width, rect.Height, glyphMask, charColor, backgroundColor);
     }
 
-    if (indicatorChar != 0)
+    // If the glyph cannot be cached, draw the character directly from the font.
+    else
     {
         char indicatorStr[2] = { indicatorChar, 0 };
-        int fontWidth, fontHeight;
 
         TFT_setFont(DEJAVU24_FONT, NULL);
 
-        TFT_getfontsize(&fontWidth, &fontHeight);
-        fontHeight = TFT_getfontheight();
-        fontWidth = TFT_getStringWidth(indicatorStr);
+        int16_t charX = rect.X + (rect.Width / 2) - (TFT_getStringWidth(indicatorStr) / 2);
+        int16_t charY = rect.Y + (rect.Height / 2) - (TFT_getfontheight() / 2) + 2;
 
-        uint16_t charX = indicatorX + (sizePix / 2) - (fontWidth / 2);
-        uint16_t charY = indicatorY + (sizePix / 2) - (fontHeight / 2) + 2;
+        canvas.FillRect(rect.X, rect.Y, rect.Width, rect.Height, backgroundColor);
+        canvas.DrawText(indicatorStr, charX, charY, charColor);
+    }
 
-        TFT_print(indicatorStr, (int)charX, (int)charY);
+    if (!state)
+    {
+        canvas.DrawRect(rect.X, rect.Y, rect.Width, rect.Height, Color);
     }
 }
 
-#endif // CONFIG_HAVE_DISPLAY
+/* Get the mask for an indicator character, rasterizing it into the glyph cache if necessary.
+ * Returns NULL if the mask does not fit in the cache.
+ *
+ * NOTE: Indicator characters may change at any time (e.g. the 'A'/'B' connectivity indicator),
+ * so characters are rasterized on first use rather than at Init().  The cache slots are sized
+ * for the indicators at Init(), so the cache is not used if the indicators are later made larger.
+ */
+const uint8_t * StatusIndicatorWidget::GetGlyphMask(char indicatorChar, uint16_t sizePix)
+{
+    uint16_t maskSize = (sizePix * sizePix + 7) / 8;
+    uint8_t * mask;
+    uint8_t slot;
+
+    if (mGlyphCache == NULL || sizePix != mGlyphCacheSizePix || maskSize > mGlyphCacheSlotSize)
+    {
+        return NULL;
+    }
+
+    for (slot = 0; slot < kMaxCachedGlyphs; slot++)
+    {
+        if (mGlyphCacheChar[slot] == indicatorChar)
+        {
+            return mGlyphCache + slot * mGlyphCacheSlotSize;
+        }
+    }
+
+    // Rasterize the character into the next slot, replacing the oldest entry if the cache is full.
+    slot = mGlyphCacheNext;
+    mGlyphCacheNext = (mGlyphCacheNext + 1) % kMaxCachedGlyphs;
+    mask = mGlyphCache + slot * mGlyphCacheSlotSize;
+    RasterizeGlyph(indicatorChar, sizePix, mask);
+    mGlyphCacheChar[slot] = indicatorChar;
+
+    return mask;
+}
 
+/* Rasterize a character, centered within an indicator, into a 1-bit-per-pixel mask.
+ *
+ * NOTE: The character is positioned exactly as it would be by Canvas::DrawText().
+ */
+void StatusIndicatorWidget::RasterizeGlyph(char indicatorChar, uint16_t sizePix, uint8_t * mask)
+{
+    char indicatorStr[2] = { indicatorChar, 0 };
+    FontGlyph glyph;
+
+    memset(mask, 0, (sizePix * sizePix + 7) / 8);
+
+    TFT_setFont(DEJAVU24_FONT, NULL);
+
+    if (!GetFontGlyph(indicatorChar, glyph))
+    {
+        return;
+    }
+
+    int16_t charX = (sizePix / 2) - (TFT_getStringWidth(indicatorStr) / 2) + glyph.XOffset;
+    int16_t charY = (sizePix / 2) - (TFT_getfontheight() / 2) + 2 + glyph.YOffset;
+
+    for (uint16_t j = 0; j < glyph.Height; j++)
+    {
+        int16_t y = charY + j;
+        for (uint16_t i = 0; i < glyph.Width; i++)
+        {
+            int16_t x = charX + i;
+            uint16_t srcBit = i + j * glyph.Width;
+            if (x >= 0 && x < sizePix && y >= 0 && y < sizePix && (glyph.Bitmap[srcBit / 8] & (0x80 >> (srcBit % 8))) != 0)
+            {
+                uint16_t destBit = x + y * sizePix;
+                mask[destBit / 8] |= (0x80 >> (destBit % 8));
+            }
+        }
+    }
+}
+
+#endif // CONFIG_HAVE_DISPLAY
@@ -17,6 +17,7 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
 
 #include "esp_system.h"
 #include "esp_log.h"
@@ -32,18 +33,6 @@
 
 extern const char *TAG;
 
-namespace {
-
-const uint8_t OpenWeaveLogo[] =
-{
-#include "OpenWeaveLogo.dat"
-};
-
-const uint16_t OpenWeaveLogo_Width = 280;
-const uint16_t OpenWeaveLogo_Height = 28;
-
-} // unnamed namespace
-
 void TitleWidget::Init(const char * title)
 {
     Title = title;
@@ -54,14 +43,23 @@ void TitleWidget::Init(const char * title)
     TitleDelayMS = 300;
     LingerDelayMS = 500;
     mStartTimeUS = 0;
-    mLogoX = (DisplayWidth - OpenWeaveLogo_Width) / 2;
+    if (!GetDisplayAsset("OpenWeaveLogo", mLogo))
+    {
+        memset(&mLogo, 0, sizeof(mLogo));
+    }
+    mLogoRowBuf = (mLogo.Width != 0) ? (color_t *)malloc(2 * mLogo.Width * sizeof(color_t)) : NULL;
+    mLogoX = 0;
+    mLogoEndY = 0;
     mLogoY = UINT16_MAX;
+    memset(&mTitleRect, 0, sizeof(mTitleRect));
     mTitleDisplayed = false;
     Done = true;
 }
 
 void TitleWidget::Start()
 {
+    Invalidate(GetBounds());
+
     mStartTimeUS = ::esp_timer_get_time();
     mLogoY = UINT16_MAX;
     mTitleDisplayed = false;
@@ -77,19 +75,17 @@ void TitleWidget::Animate()
 
     uint32_t relativeTimeMS = (uint32_t)((::esp_timer_get_time() - mStartTimeUS) / 1000);
 
-    uint16_t logoEndY = (DisplayHeight * LogoVPos) / 100;
-
-    if (mLogoY == UINT16_MAX || mLogoY < logoEndY)
+    if (mLogoY == UINT16_MAX || mLogoY < mLogoEndY)
     {
         uint16_t newLogoY;
 
         if (AnimationTimeMS != 0 && relativeTimeMS < AnimationTimeMS)
         {
-            newLogoY = (uint16_t)((logoEndY * relativeTimeMS) / AnimationTimeMS);
+            newLogoY = (uint16_t)((mLogoEndY * relativeTimeMS) / AnimationTimeMS);
         }
         else
         {
-            newLogoY = logoEndY;
+            newLogoY = mLogoEndY;
         }
 
         if (mLogoY != UINT16_MAX)
@@ -98,32 +94,28 @@ void TitleWidget::Animate()
 
             uint16_t stepY = newLogoY - mLogoY;
 
-            if (newLogoY < logoEndY && stepY < kMinLogoStep)
+            if (newLogoY < mLogoEndY && stepY < kMinLogoStep)
             {
                 return;
             }
 
-            TFT_fillRect((int)mLogoX, (int)mLogoY, (int)OpenWeaveLogo_Width, (stepY < OpenWeaveLogo_Height) ? (int)stepY : (int)OpenWeaveLogo_Height, TFT_BLACK);
-        }
+            InvalidateLogoMove(mLogoY, newLogoY);
 
-        mLogoY = newLogoY;
+            mLogoY = newLogoY;
+        }
+        else
+        {
+            mLogoY = newLogoY;
 
-        TFT_bmp_image((int)mLogoX, (int)mLogoY, 0, NULL, (uint8_t *)OpenWeaveLogo, sizeof(OpenWeaveLogo));
+            Invalidate(LogoRect());
+        }
     }
 
     if (!mTitleDisplayed && relativeTimeMS >= (AnimationTimeMS + TitleDelayMS))
     {
-        TFT_setFont(DEJAVU24_FONT, NULL);
-
-        uint16_t titleWidth = (uint16_t)TFT_getStringWidth((char *)Title);
-        uint16_t titleX = (DisplayWidth - titleWidth) / 2;
-        uint16_t titleY = (DisplayHeight * TitleVPos) / 100;
-
-        _fg = TitleColor;
-        _bg = TFT_BLACK;
-        TFT_print((char *)Title, titleX, titleY);
-
         mTitleDisplayed = true;
+
+        Invalidate(mTitleRect);
     }
 
     if (relativeTimeMS >= (AnimationTimeMS + TitleDelayMS + LingerDelayMS))
@@ -134,4 +126,109 @@ void TitleWidget::Animate()
     }
 }
 
+DisplayRect TitleWidget::GetBounds() const
+{
+    DisplayRect logoTravelRect = { (int16_t)mLogoX, 0, mLogo.Width, (uint16_t)(mLogoEndY + mLogo.Height) };
+    return logoTravelRect.Union(mTitleRect);
+}
+
+void TitleWidget::Render(Canvas & canvas)
+{
+    if (mLogoY != UINT16_MAX && mLogo.Data != NULL)
+    {
+        canvas.DrawAsset((int16_t)mLogoX, (int16_t)mLogoY, mLogo);
+    }
+
+    if (mTitleDisplayed)
+    {
+        canvas.DrawText(Title, mTitleRect.X, mTitleRect.Y, TitleColor);
+    }
+}
+
+void TitleWidget::Layout()
+{
+    mLogoX = (DisplayWidth - mLogo.Width) / 2;
+    mLogoEndY = (DisplayHeight * LogoVPos) / 100;
+
+    TFT_setFont(DEJAVU24_FONT, NULL);
+    mTitleRect.Width = (uint16_t)TFT_getStringWidth((char *)Title);
+    mTitleRect.Height = (uint16_t)TFT_getfontheight();
+    mTitleRect.X = (int16_t)((DisplayWidth - mTitleRect.Width) / 2);
+    mTitleRect.Y = (int16_t)((DisplayHeight * TitleVPos) / 100);
+}
+
+/* Invalidate the parts of the display that change when the logo moves down from oldY to newY.
+ *
+ * NOTE: The ILI9341's hardware scrolling cannot be used to move the logo, since the panel's scroll
+ * axis is horizontal when the display is in landscape orientation.  Instead, the logo rows that
+ * appear on each display row before and after the move are compared, and only the changed spans
+ * are redrawn.  Since the logo is mostly background, this is typically a third of the pixels in
+ * the logo.
+ */
+void TitleWidget::InvalidateLogoMove(uint16_t oldY, uint16_t newY)
+{
+    // Changed spans separated by fewer than this many unchanged pixels are redrawn together,
+    // since sending the unchanged pixels is cheaper than starting another transfer.
+    enum { kMinSpanGap = 8 };
+
+    if (mLogoRowBuf == NULL)
+    {
+        DisplayRect moveRect = { (int16_t)mLogoX, (int16_t)oldY, mLogo.Width, (uint16_t)(newY - oldY + mLogo.Height) };
+        Invalidate(moveRect);
+        return;
+    }
+
+    color_t * oldRow = mLogoRowBuf;
+    color_t * newRow = mLogoRowBuf + mLogo.Width;
+
+    for (uint16_t y = oldY; y < newY + mLogo.Height; y++)
+    {
+        ReadLogoRow(y - oldY, oldRow);
+        ReadLogoRow(y - newY, newRow);
+
+        int16_t spanStart = -1, spanEnd = -1;
+
+        for (uint16_t x = 0; x <= mLogo.Width; x++)
+        {
+            bool changed = (x < mLogo.Width && memcmp(&oldRow[x], &newRow[x], sizeof(color_t)) != 0);
+
+            if (spanStart >= 0 && (x == mLogo.Width || (changed && x - spanEnd >= kMinSpanGap)))
+            {
+                DisplayRect spanRect = { (int16_t)(mLogoX + spanStart), (int16_t)y, (uint16_t)(spanEnd - spanStart), 1 };
+                Invalidate(spanRect);
+                spanStart = -1;
+            }
+
+            if (changed)
+            {
+                if (spanStart < 0)
+                {
+                    spanStart = x;
+                }
+                spanEnd = x + 1;
+            }
+        }
+    }
+}
+
+/* Read a row of the logo image, treating rows outside the image as background.
+ */
+void TitleWidget::ReadLogoRow(int32_t row, color_t * buf) const
+{
+    if (row >= 0 && row < mLogo.Height)
+    {
+        mLogo.ReadRow((uint16_t)row, 0, mLogo.Width, buf);
+    }
+    else
+    {
+        memset(buf, 0, mLogo.Width * sizeof(color_t));
+    }
+}
+
+DisplayRect TitleWidget::LogoRect() const
+{
+    DisplayRect rect = { (int16_t)mLogoX, (int16_t)mLogoY, mLogo.Width, mLogo.Height };
+    return rect;
+}
+
 #endif // CONFIG_HAVE_DISPLAY
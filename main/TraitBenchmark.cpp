@@ -0,0 +1,263 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+#include <Weave/Support/ErrorStr.h>
+#include <TraitBenchmark.h>
+
+#if CONFIG_TRAIT_BENCHMARK_ITERATIONS
+
+#if CONFIG_HEAP_TRACING
+#include "esp_heap_trace.h"
+#endif
+
+#include <LightController.h>
+#include <LightSwitch.h>
+#include <nest/trait/lighting/LogicalCircuitControlTrait.h>
+
+using namespace ::nl;
+using namespace ::nl::Weave;
+using namespace ::nl::Weave::Profiles::DataManagement_Current;
+using namespace ::nl::Weave::TLV;
+using namespace ::Schema::Nest::Trait::Lighting;
+
+extern const char * TAG;
+
+namespace {
+
+enum
+{
+    kTracedIterations = 16,
+    kTraceRecords = 64,
+};
+
+LightController sLightController;
+PacketBuffer * sCommandBuf;
+uint8_t sCommandArgs[16];
+uint32_t sCommandArgsLen;
+
+#if CONFIG_HEAP_TRACING
+heap_trace_record_t sTraceRecords[kTraceRecords];
+#endif
+
+} // unnamed namespace
+
+/* Run each benchmark for the given number of iterations, printing one line of JSON per benchmark.
+ *
+ * NOTE: Must be called after the Weave stack has been initialized, but before the Weave event
+ * loop is started, so that the allocations counted are those of the benchmark alone.
+ */
+void TraitBenchmark::Run(uint32_t iterations)
+{
+    WEAVE_ERROR err;
+    TLVWriter writer;
+    TLVType container;
+
+    ESP_LOGI(TAG, "Trait benchmark: starting (%u iterations)", iterations);
+
+    sCommandBuf = PacketBuffer::New();
+    VerifyOrExit(sCommandBuf != NULL, err = WEAVE_ERROR_NO_MEMORY);
+
+    // Encode the arguments of a SetLogicalCircuitState command, as received by the light controller.
+    writer.Init(sCommandArgs, sizeof(sCommandArgs));
+    err = writer.StartContainer(AnonymousTag, kTLVType_Structure, container);
+    SuccessOrExit(err);
+    err = writer.Put(ContextTag(LogicalCircuitControlTrait::kSetLogicalCircuitStateRequestParameter_State), (int8_t)LightController::ON);
+    SuccessOrExit(err);
+    err = writer.Put(ContextTag(LogicalCircuitControlTrait::kSetLogicalCircuitStateRequestParameter_Level), (uint8_t)50);
+    SuccessOrExit(err);
+    err = writer.EndContainer(container);
+    SuccessOrExit(err);
+    err = writer.Finalize();
+    SuccessOrExit(err);
+    sCommandArgsLen = writer.GetLengthWritten();
+
+#if CONFIG_HEAP_TRACING
+    err = heap_trace_init_standalone(sTraceRecords, kTraceRecords);
+    SuccessOrExit(err);
+#endif
+
+    RunTest("LightSwitch::EncodeCommandRequest", EncodeCommandRequest, iterations);
+    RunTest("LogicalCircuitControlTrait::DecodeCommandArguments", DecodeCommandArguments, iterations);
+    RunTest("LogicalCircuitStateTrait::EncodeNotification", EncodeStateNotification, iterations);
+    RunTest("LogicalCircuitStateTrait::EncodeTypedNotification", EncodeTypedStateNotification, iterations);
+    RunTest("LogicalCircuitStateTrait::SchemaLookup", LookupStateSchema, iterations);
+
+exit:
+    if (err != WEAVE_NO_ERROR)
+    {
+        ESP_LOGE(TAG, "Trait benchmark failed: %s", ErrorStr(err));
+    }
+    if (sCommandBuf != NULL)
+    {
+        PacketBuffer::Free(sCommandBuf);
+        sCommandBuf = NULL;
+    }
+}
+
+/* Time the given operation, and count the heap allocations it makes, printing the results as JSON.
+ *
+ * NOTE: Allocations are counted over a separate, shorter run, as heap tracing records every
+ * allocation and slows the operation down.
+ */
+void TraitBenchmark::RunTest(const char * name, OperationFunct op, uint32_t iterations)
+{
+    WEAVE_ERROR err;
+    int64_t startTimeUS;
+    uint32_t nsPerOp;
+    char allocsPerOp[16] = "null";
+
+    // Run the operation once, outside of the measurement, to check that it succeeds.
+    err = op();
+    SuccessOrExit(err);
+
+    startTimeUS = ::esp_timer_get_time();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        op();
+    }
+    nsPerOp = (uint32_t)(((uint64_t)(::esp_timer_get_time() - startTimeUS) * 1000) / iterations);
+
+#if CONFIG_HEAP_TRACING
+    {
+        size_t count;
+
+        heap_trace_start(HEAP_TRACE_ALL);
+        for (uint32_t i = 0; i < kTracedIterations; i++)
+        {
+            op();
+        }
+        heap_trace_stop();
+
+        // If the record buffer filled, the count is only a lower bound, and is not reported.
+        count = heap_trace_get_count();
+        if (count < kTraceRecords)
+        {
+            snprintf(allocsPerOp, sizeof(allocsPerOp), "%u.%02u", (unsigned)(count / kTracedIterations),
+                     (unsigned)(((count % kTracedIterations) * 100) / kTracedIterations));
+        }
+    }
+#endif // CONFIG_HEAP_TRACING
+
+    printf("{\"benchmark\":\"%s\",\"iterations\":%u,\"ns_per_op\":%u,\"allocs_per_op\":%s}\n", name, iterations, nsPerOp, allocsPerOp);
+
+exit:
+    if (err != WEAVE_NO_ERROR)
+    {
+        ESP_LOGE(TAG, "Trait benchmark: %s failed: %s", name, ErrorStr(err));
+    }
+}
+
+WEAVE_ERROR TraitBenchmark::EncodeCommandRequest(void)
+{
+    sCommandBuf->SetDataLength(0);
+    return LightSwitch::EncodeCommandRequest(LightSwitch::ON, 75, sCommandBuf);
+}
+
+WEAVE_ERROR TraitBenchmark::DecodeCommandArguments(void)
+{
+    WEAVE_ERROR err;
+    TLVReader reader;
+    uint8_t state = LightController::OFF;
+    uint8_t level = 100;
+    uint32_t statusCode = 0;
+
+    reader.Init(sCommandArgs, sCommandArgsLen);
+    err = reader.Next();
+    SuccessOrExit(err);
+
+    err = LightController::DecodeSetLogicalCircuitStateArguments(reader, state, level, statusCode);
+    SuccessOrExit(err);
+
+exit:
+    return err;
+}
+
+WEAVE_ERROR TraitBenchmark::EncodeStateNotification(void)
+{
+    WEAVE_ERROR err;
+    TLVWriter writer;
+    uint8_t buf[32];
+
+    writer.Init(buf, sizeof(buf));
+    err = sLightController.GetStateDataSource().ReadData(LogicalCircuitStateTrait::kPropertyHandle_Root, AnonymousTag, writer);
+    SuccessOrExit(err);
+
+    err = writer.Finalize();
+    SuccessOrExit(err);
+
+exit:
+    return err;
+}
+
+/* Encode the same data as EncodeStateNotification(), using the generated typed serializer rather
+ * than the schema engine and the data source's GetLeafData().
+ */
+WEAVE_ERROR TraitBenchmark::EncodeTypedStateNotification(void)
+{
+    WEAVE_ERROR err;
+    TLVWriter writer;
+    TLVType container;
+    uint8_t buf[32];
+
+    writer.Init(buf, sizeof(buf));
+    err = writer.StartContainer(AnonymousTag, kTLVType_Structure, container);
+    SuccessOrExit(err);
+
+    err = LogicalCircuitStateTrait::Serializer::WriteLeaves(sLightController.GetStateData(), LogicalCircuitStateTrait::Serializer::kAllLeaves, writer);
+    SuccessOrExit(err);
+
+    err = writer.EndContainer(container);
+    SuccessOrExit(err);
+
+    err = writer.Finalize();
+    SuccessOrExit(err);
+
+exit:
+    return err;
+}
+
+/* Map each property of the LogicalCircuitStateTrait to its tag and parent, and back to its handle,
+ * as the notification and update paths do.
+ */
+WEAVE_ERROR TraitBenchmark::LookupStateSchema(void)
+{
+    WEAVE_ERROR err = WEAVE_NO_ERROR;
+    const TraitSchemaEngine & schema = LogicalCircuitStateTrait::TraitSchema;
+
+    for (PropertyPathHandle handle = LogicalCircuitStateTrait::kPropertyHandle_Root + 1;
+         handle <= LogicalCircuitStateTrait::kLastSchemaHandle; handle++)
+    {
+        PropertyPathHandle parent = schema.GetParent(handle);
+        uint64_t tag = schema.GetTag(handle);
+
+        VerifyOrExit(schema.GetChildHandle(parent, (uint8_t)TagNumFromTag(tag)) == handle && schema.IsLeaf(handle),
+                     err = WEAVE_ERROR_INCORRECT_STATE);
+    }
+
+exit:
+    return err;
+}
+
+#endif // CONFIG_TRAIT_BENCHMARK_ITERATIONS
@@ -19,4 +19,4 @@
 #
 
 COMPONENT_DEPENDS			:= openweave tft spidriver
-COMPONENT_SRCDIRS           := . trait-support/nest/trait/lighting
+COMPONENT_SRCDIRS           := . trait-support/nest/trait/lighting trait-support/nest/trait/performance
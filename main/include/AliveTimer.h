@@ -21,6 +21,72 @@
 
 #include <Weave/DeviceLayer/WeaveDeviceLayer.h>
 
+enum
+{
+    kTelemetry_NumMonitoredTasks = 7
+};
+
+/**
+ * A snapshot of system resource usage, recorded each time the alive timer fires.
+ */
+struct TelemetrySample
+{
+    uint32_t TimestampMS;                                   // Time since boot
+    uint32_t FreeHeap;                                      // Current free heap (bytes)
+    uint32_t MinFreeHeap;                                   // Minimum free heap since boot (bytes)
+    uint32_t LargestFreeBlock;                              // Largest allocatable heap block (bytes)
+    uint16_t PacketBufsInUse;                               // Weave PacketBuffers currently allocated
+    uint16_t PacketBufsHighWater;                           // Maximum PacketBuffers allocated since boot
+    uint16_t StackHighWater[kTelemetry_NumMonitoredTasks];  // Minimum free stack for each monitored task (bytes)
+};
+
+/**
+ * Units of work performed on the Weave event loop task that are tracked by the event loop
+ * stall detector.  When the alive timer fires late, the longest activity observed since the
+ * previous firing is recorded alongside the stall.
+ */
+enum EventLoopActivity
+{
+    kEventLoopActivity_None = 0,
+    kEventLoopActivity_DeviceEvent,
+    kEventLoopActivity_CommandHandling,
+    kEventLoopActivity_NotificationEngine,
+    kEventLoopActivity_ServiceEcho,
+    kEventLoopActivity_Telemetry,
+
+    kEventLoopActivity_NumActivities
+};
+
+/**
+ * A record of an occasion on which the alive timer fired late.
+ */
+struct EventLoopStall
+{
+    uint32_t TimestampMS;           // Time since boot at which the timer fired
+    uint32_t LatenessMS;            // Amount by which the timer fired late
+    uint32_t ActivityDurationMS;    // Duration of the longest activity since the previous firing
+    uint16_t LastDeviceEventType;   // Type of the last Weave device event dispatched
+    uint8_t Activity;               // Longest activity since the previous firing (EventLoopActivity)
+};
+
 extern WEAVE_ERROR StartAliveTimer(uint32_t intervalMS);
+extern bool GetLatestTelemetrySample(TelemetrySample & sample);
+extern void DumpTelemetry(void);
+extern void DumpEventLoopLatency(void);
+extern uint32_t GetMaxEventLoopLatenessMS(void);
+extern uint32_t GetLastEventLoopLatenessMS(void);
+
+extern void BeginEventLoopActivity(EventLoopActivity activity);
+extern void EndEventLoopActivity(void);
+
+/**
+ * Marks the enclosing block as an activity performed on the Weave event loop task.
+ */
+class EventLoopActivityScope
+{
+public:
+    EventLoopActivityScope(EventLoopActivity activity) { BeginEventLoopActivity(activity); }
+    ~EventLoopActivityScope() { EndEventLoopActivity(); }
+};
 
 #endif // ALIVE_TIMER_H
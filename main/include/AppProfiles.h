@@ -0,0 +1,40 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef APP_PROFILES_H
+#define APP_PROFILES_H
+
+/* Weave profile ids for the schemas defined by the demo application itself.
+ *
+ * These are allocated under a vendor id belonging to the application, rather than under Nest's
+ * vendor id (0x235A), so that they can never collide with a schema published by Nest.  The demo
+ * application has no assigned Weave vendor id; 0xFFF1 is used as a private, development-only
+ * vendor id, and must be replaced by the vendor's own assigned id in any product derived from
+ * the demo.
+ *
+ * NOTE: The DeviceMetricsTrait profile id is also given in main/trait-support/traits.json, from
+ * which the trait's schema files are generated, and the two must agree.
+ */
+enum
+{
+    kAppVendorId = 0xFFF1U,
+
+    kAppProfile_DeviceMetricsTrait      = (kAppVendorId << 16) | 0x0001U,     // DeviceMetricsTrait
+    kAppProfile_LightEvents             = (kAppVendorId << 16) | 0x0002U,     // Light state change events
+};
+
+#endif // APP_PROFILES_H
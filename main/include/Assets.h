@@ -0,0 +1,53 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include "Display.h"
+
+#if CONFIG_HAVE_DISPLAY
+
+/**
+ * An image stored in the display assets partition.
+ *
+ * Pixels are stored in the native format of the display (color_t), either raw, or
+ * run-length encoded with a table of per-row offsets.  See tools/mkassets.py.
+ */
+struct DisplayAsset
+{
+    enum
+    {
+        kFormat_Raw = 0,
+        kFormat_RLE = 1,
+    };
+
+    const uint8_t * Data;       // Memory-mapped asset data
+    uint16_t Width;
+    uint16_t Height;
+    uint8_t Format;
+
+    void ReadRow(uint16_t row, uint16_t x, uint16_t count, color_t * dest) const;
+};
+
+extern esp_err_t InitDisplayAssets();
+extern bool GetDisplayAsset(const char * name, DisplayAsset & asset);
+
+#endif // CONFIG_HAVE_DISPLAY
+
+#endif // ASSETS_H
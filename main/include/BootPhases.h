@@ -0,0 +1,47 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef BOOT_PHASES_H
+#define BOOT_PHASES_H
+
+#include <stdint.h>
+
+/**
+ * Milestones in the boot sequence, from entry into app_main() through to the device being
+ * fully connected to the service.
+ */
+enum BootPhase
+{
+    kBootPhase_AppStart = 0,
+    kBootPhase_WeaveStackInitialized,
+    kBootPhase_EventLoopStarted,
+    kBootPhase_UIReady,
+    kBootPhase_TitleAnimationDone,
+    kBootPhase_WiFiStationConnected,
+    kBootPhase_IPv4Connectivity,
+    kBootPhase_ServiceConnectivity,
+    kBootPhase_ServiceSubscription,
+    kBootPhase_FullyConnected,
+
+    kBootPhase_NumPhases
+};
+
+extern bool RecordBootPhase(BootPhase phase);
+extern void LogBootPhases(void);
+
+#endif // BOOT_PHASES_H
@@ -21,26 +21,119 @@
 
 #include "esp_system.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 
+/**
+ * An event generated by a Button.
+ */
+struct ButtonEvent
+{
+    enum
+    {
+        kType_Press = 0,
+        kType_Release,
+        kType_Click,                // Released before the long press duration elapsed
+        kType_DoubleClick,          // Clicked within the double click interval of the previous click
+        kType_LongPress,            // Held for the long press duration
+    };
+
+    uint8_t Type;
+    int64_t TimeUS;                 // Time of the event; for presses and releases, the time of the initial edge
+    uint32_t DurationUS;            // For releases and clicks, the time for which the button was held
+};
+
+/**
+ *  @class Button
+ *
+ *  @brief
+ *    An interrupt-driven, debounced push button.
+ *
+ *    Each edge on the button's GPIO is timestamped by an interrupt handler and queued, to be
+ *    processed by a handler deferred to the FreeRTOS timer task.  The first edge of a press or
+ *    release is reported immediately, after which further edges are ignored until the contacts
+ *    have settled for the debounce period, at which point a one-shot timer checks the final state
+ *    of the button.  Presses and releases, along with the clicks, double clicks and
+ *    long presses derived from them, are placed in a queue from which they can be read with
+ *    GetEvent().
+ *
+ *    Alternatively, a button may be added to a ButtonGroup, which debounces all of its buttons
+ *    from a periodic scan of the GPIO input registers and reports their changes through the
+ *    same queue.
+ *
+ *    Poll() provides the original polled interface: each call consumes queued events up to and
+ *    including the next press or release, returning true if one was found.  IsPressed() and the
+ *    duration methods reflect the press or release most recently consumed, with durations
+ *    measured from the time of the initial edge.  A given button should be read with either
+ *    Poll() or GetEvent(), but not both.
+ */
 class Button
 {
 public:
+    uint32_t LongPressDurationMS;
+    uint32_t DoubleClickIntervalMS;
+
     esp_err_t Init(gpio_num_t gpioNum, uint16_t debouncePeriod);
     bool Poll();
+    bool GetEvent(ButtonEvent & event);
     bool IsPressed();
     uint32_t GetStateStartTime();
     uint32_t GetStateDuration();
     uint32_t GetPrevStateDuration();
 
+    static void WaitForEvent(uint32_t timeoutMS);
+
 private:
-    uint32_t mLastReadTime;     // in ticks
-    uint32_t mStateStartTime;   // in ticks
-    uint32_t mPrevStateDur;     // in ticks
+    enum
+    {
+        kEventQueueLength = 16,
+        kEdgeQueueLength = 8,
+        kMaxEventsPerEdge = 3,
+    };
+
+    struct Edge
+    {
+        int64_t TimeUS;
+        bool Pressed;
+    };
+
+    // State maintained by the interrupt handler, the deferred edge handler and timers.
+    QueueHandle_t mEventQueue;
+    QueueHandle_t mEdgeQueue;       // Edges timestamped by the interrupt handler, awaiting processing
+    esp_timer_handle_t mDebounceTimer;
+    esp_timer_handle_t mLongPressTimer;
+    portMUX_TYPE mLock;
+    int64_t mEdgeTimeUS;            // Time of the last reported edge
+    int64_t mLastClickTimeUS;       // Time of the last click, or 0 if the next click cannot be a double click
+    int64_t mPendingEdgeTimeUS;     // Time the GPIO last left the debounced level while bouncing, or 0
+    uint32_t mDebouncePeriodUS;
     gpio_num_t mGPIONum;
-    uint16_t mDebouncePeriod;   // in ticks
+    bool mDebouncedState;
+    volatile bool mEdgeHandlerPending;
+
+    // State as of the last press or release consumed by Poll() or GetEvent().
+    int64_t mStateStartTimeUS;
+    uint32_t mPrevStateDurUS;
     bool mState;
-    bool mLastState;
+
+    static SemaphoreHandle_t sEventSignal;
+
+    friend class ButtonGroup;
+
+    esp_err_t InitCommon(gpio_num_t gpioNum);
+    void ProcessEdge(bool pressed, int64_t timeUS);
+    void ProcessInterruptEdge(bool pressed, int64_t timeUS);
+    uint8_t HandleEdge(bool pressed, int64_t timeUS, ButtonEvent (&events)[kMaxEventsPerEdge]);
+    void StartLongPressTimer(bool pressed, int64_t edgeTimeUS);
+    void PostEvents(const ButtonEvent * events, uint8_t count);
+
+    static void HandleInterrupt(void * arg);
+    static void HandleEdges(void * arg, uint32_t unused);
+    static void HandleDebounceTimer(void * arg);
+    static void HandleLongPressTimer(void * arg);
 };
 
 inline bool Button::IsPressed()
@@ -50,12 +143,12 @@ inline bool Button::IsPressed()
 
 inline uint32_t Button::GetStateStartTime()
 {
-    return mStateStartTime * portTICK_PERIOD_MS;
+    return (uint32_t)(mStateStartTimeUS / 1000);
 }
 
 inline uint32_t Button::GetPrevStateDuration()
 {
-    return mPrevStateDur * portTICK_PERIOD_MS;
+    return mPrevStateDurUS / 1000;
 }
 
 #endif // BUTTON_H
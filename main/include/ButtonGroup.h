@@ -0,0 +1,82 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef BUTTON_GROUP_H
+#define BUTTON_GROUP_H
+
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+
+class Button;
+
+/**
+ *  @class ButtonGroup
+ *
+ *  @brief
+ *    Scans and debounces a set of push buttons together.
+ *
+ *    On each scan, the GPIO input registers are read once, giving the level of every GPIO as a
+ *    single bit mask.  All buttons in the group are then debounced in parallel using a pair of
+ *    vertical counters, which count the consecutive scans for which each button has differed
+ *    from its debounced state, and which produce a mask of the buttons whose state changed.
+ *    Only the changed buttons are visited, so the cost of a scan does not grow with the number of
+ *    buttons in the group.
+ *
+ *    A button's state changes after it has read the same for kDebounceScans consecutive scans.
+ *    Changes are reported to the button with the time of the first of those scans, and from there
+ *    are turned into events exactly as for an interrupt-driven button.
+ *
+ *    Buttons must be added between calls to Init() and Start().
+ */
+class ButtonGroup
+{
+public:
+    enum
+    {
+        kDebounceScans = 4,
+    };
+
+    esp_err_t Init(uint32_t scanPeriodMS);
+    esp_err_t AddButton(Button & button, gpio_num_t gpioNum);
+    esp_err_t Start(void);
+    uint64_t GetPressedMask(void) const;
+
+    static uint64_t DebounceScan(uint64_t sample, uint64_t & debounced, uint64_t & count0, uint64_t & count1);
+
+private:
+    esp_timer_handle_t mScanTimer;
+    uint32_t mScanPeriodUS;
+    uint64_t mButtonMask;           // GPIOs of the buttons in the group
+    uint64_t mDebounced;            // Debounced state of each button (1 = pressed)
+    uint64_t mCount0;               // Low bit of each button's vertical counter
+    uint64_t mCount1;               // High bit of each button's vertical counter
+    Button * mButtons[GPIO_NUM_MAX];
+
+    uint64_t ReadPressed(void) const;
+    void Scan(void);
+
+    static void HandleScanTimer(void * arg);
+};
+
+inline uint64_t ButtonGroup::GetPressedMask(void) const
+{
+    return mDebounced;
+}
+
+#endif // BUTTON_GROUP_H
@@ -0,0 +1,185 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include "Display.h"
+#include "Assets.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#if CONFIG_HAVE_DISPLAY
+
+/**
+ * A rectangular region of the display, in pixels.
+ */
+struct DisplayRect
+{
+    int16_t X;
+    int16_t Y;
+    uint16_t Width;
+    uint16_t Height;
+
+    int16_t Right() const { return X + (int16_t)Width; }       // Exclusive
+    int16_t Bottom() const { return Y + (int16_t)Height; }     // Exclusive
+    uint32_t Area() const { return (uint32_t)Width * Height; }
+    bool IsEmpty() const { return Width == 0 || Height == 0; }
+    bool Intersects(const DisplayRect & other) const;
+    DisplayRect Intersection(const DisplayRect & other) const;
+    DisplayRect Union(const DisplayRect & other) const;
+};
+
+/**
+ * Information describing a single glyph in the current TFT library font.
+ */
+struct FontGlyph
+{
+    const uint8_t * Bitmap;     // Glyph bitmap; 1 bit per pixel, MSB first, rows packed without padding
+    uint8_t Width;
+    uint8_t Height;
+    int8_t XOffset;
+    uint8_t YOffset;
+    uint8_t XAdvance;
+};
+
+extern bool GetFontGlyph(char ch, FontGlyph & glyph);
+
+/**
+ * A target for drawing operations that renders into a region of the compositor's strip buffer.
+ *
+ * All drawing operations are clipped to the canvas's clip rectangle.
+ */
+class Canvas
+{
+public:
+    const DisplayRect & ClipRect() const { return mClip; }
+
+    void FillRect(int16_t x, int16_t y, uint16_t width, uint16_t height, color_t color);
+    void DrawRect(int16_t x, int16_t y, uint16_t width, uint16_t height, color_t color);
+    void DrawText(const char * str, int16_t x, int16_t y, color_t color);
+    void DrawMask(int16_t x, int16_t y, uint16_t width, uint16_t height, const uint8_t * mask, color_t fgColor, color_t bgColor);
+    void DrawAsset(int16_t x, int16_t y, const DisplayAsset & asset);
+    void CopyRow(int16_t x, int16_t srcY, uint16_t width, int16_t destY);
+
+private:
+    friend class Compositor;
+
+    color_t * mBuf;
+    DisplayRect mClip;
+};
+
+/**
+ * An object that can render itself onto a Canvas.
+ *
+ * A Drawable computes the positions of its contents in Layout(), which the compositor calls each
+ * time the Drawable is added to the scene, and caches them for use by GetBounds() and Render().
+ * Methods that change what a Drawable displays should invalidate the affected regions using
+ * Invalidate(), which does nothing while the Drawable is not part of the scene.
+ */
+class Drawable
+{
+public:
+    Drawable() : mShown(false) { }
+
+    virtual DisplayRect GetBounds() const = 0;
+    virtual void Render(Canvas & canvas) = 0;
+    virtual void Layout() { }
+
+    bool IsShown() const { return mShown; }
+
+protected:
+    void Invalidate(const DisplayRect & rect);
+
+private:
+    friend class Compositor;
+
+    bool mShown;
+};
+
+/**
+ *  @class Compositor
+ *
+ *  @brief
+ *    Composes the contents of the display from a set of Drawable objects, redrawing only those
+ *    regions that have been invalidated.
+ *
+ *    Invalidated rectangles are accumulated, and merged where doing so is cheaper than drawing
+ *    them separately.  When the compositor is flushed, a dedicated display task renders each dirty
+ *    region in horizontal strips into a DMA-capable buffer, and sends each strip to the display in
+ *    a single windowed SPI transfer.
+ *
+ *    When the scene is changed, only the regions covered by Drawables entering or leaving the
+ *    scene are redrawn.  Drawables that remain in the scene keep their layout and are not redrawn
+ *    unless they invalidate themselves.
+ *
+ *    The compositor's lock must be held while changing the scene, invalidating regions, or changing
+ *    any state used by a Drawable's Render() method.  The display task holds the lock only while
+ *    rendering a strip, never during an SPI transfer, so other tasks are not delayed by display
+ *    updates.  Invalidations made while the display task is busy are merged into the pending dirty
+ *    regions, so intermediate frames are skipped rather than queued.
+ */
+class Compositor
+{
+public:
+    enum
+    {
+        kMaxDrawables = 8,
+        kMaxDirtyRects = 32,
+        kStripBufPixels = kDisplayMaxTransferSize / sizeof(color_t),
+    };
+
+    esp_err_t Init();
+    void Lock();
+    void Unlock();
+    void SetScene(Drawable * const * drawables, uint8_t count);
+    void Invalidate(const DisplayRect & rect);
+    void Flush();
+    void WaitForIdle();
+
+    uint32_t BytesTransferred;      // Bytes sent to the display since the scene was last changed
+    uint32_t Transfers;             // Windowed transfers since the scene was last changed
+    uint32_t FlushTimeUS;           // Time spent rendering and sending since the scene was last changed
+
+private:
+    TaskHandle_t mTask;
+    TaskHandle_t mIdleWaiter;
+    SemaphoreHandle_t mLock;
+    int64_t mSceneStartTimeUS;
+    color_t * mStripBuf;
+    Drawable * mDrawables[kMaxDrawables];
+    DisplayRect mDirtyRects[kMaxDirtyRects];
+    uint8_t mNumDrawables;
+    uint8_t mNumDirtyRects;
+    bool mRendering;
+    bool mClearPending;
+
+    void RemoveDirtyRect(uint8_t index);
+    void RenderDirtyRects();
+    void RenderRect(const DisplayRect & rect);
+
+    static void DisplayTaskMain(void * arg);
+};
+
+extern Compositor DisplayCompositor;
+
+#endif // CONFIG_HAVE_DISPLAY
+
+#endif // COMPOSITOR_H
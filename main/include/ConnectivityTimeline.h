@@ -0,0 +1,53 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef CONNECTIVITY_TIMELINE_H
+#define CONNECTIVITY_TIMELINE_H
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+
+/**
+ * The milestones passed through, in order, as the device establishes connectivity to the service.
+ */
+enum ConnectivityMilestone
+{
+    kConnectivityMilestone_WiFiStation = 0,     // WiFi station connected to an AP
+    kConnectivityMilestone_IPv4,                // IPv4 Internet connectivity
+    kConnectivityMilestone_ServiceTunnel,       // Service tunnel established
+    kConnectivityMilestone_Subscription,        // Service subscription established
+
+    kConnectivityMilestone_NumMilestones
+};
+
+/**
+ * The timeline of a single outage: from the loss of connectivity (or boot) until the device is
+ * once again fully connected.
+ */
+struct ConnectivityTimeline
+{
+    uint32_t StartTimeMS;                                               // Time since boot at which the outage began
+    uint32_t MilestoneTimeMS[kConnectivityMilestone_NumMilestones];     // Time since the start at which each milestone was (re)gained
+    uint16_t Setbacks;                                                  // Number of times a regained milestone was lost again
+    uint8_t LostMask;                                                   // Milestones that were down during the outage (bit per milestone)
+    bool IsReconnect;                                                   // False for the initial connection after boot
+};
+
+extern WEAVE_ERROR StartConnectivityTimeline(void);
+extern void DumpConnectivityTimeline(void);
+
+#endif // CONNECTIVITY_TIMELINE_H
@@ -42,6 +42,7 @@ public:
     void Update();
     bool IsDone();
     uint32_t TotalDurationMS();
+    Drawable * AsDrawable() { return this; }
 
 private:
     int64_t mStartTimeUS;
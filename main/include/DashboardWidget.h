@@ -0,0 +1,103 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef DASHBOARD_WIDGET_H
+#define DASHBOARD_WIDGET_H
+
+#include "Display.h"
+#include "Compositor.h"
+
+#if CONFIG_HAVE_DISPLAY
+
+/**
+ *  @class DashboardWidget
+ *
+ *  @brief
+ *    Displays a live sparkline and current value for each of a set of device performance metrics.
+ *
+ *    Samples are retained in a ring buffer per metric, one sample per graph column.  Rather than
+ *    scrolling the graphs, which would require redrawing every column on each update, new samples
+ *    are drawn at a cursor that sweeps across the graphs and wraps around, with a blank column
+ *    marking the boundary between the newest and oldest samples.  Adding a sample therefore
+ *    invalidates only the columns around the cursor, unless a sample falls outside a graph's
+ *    current range, in which case the range is expanded and the graph redrawn.  When the sample
+ *    that set the minimum or maximum of a graph's range scrolls out of the graph, the range is
+ *    recomputed from the samples that remain.
+ */
+class DashboardWidget : public Drawable
+{
+public:
+    enum Metric
+    {
+        kMetric_ServiceRTT = 0,         // Service echo round-trip time (ms)
+        kMetric_FreeHeap,               // Free heap (KB)
+        kMetric_EventLoopLatency,       // Weave event loop lateness (ms)
+        kMetric_CommandRate,            // Lighting commands sent and received (per minute)
+
+        kNumMetrics
+    };
+
+    // Layout properties, which take effect when the widget is next laid out.
+    color_t LabelColor;
+    color_t ValueColor;
+    color_t GraphColor;
+    color_t AxisColor;
+
+    void Init();
+    void AddSample(const uint16_t (&values)[kNumMetrics]);
+
+    virtual DisplayRect GetBounds() const;
+    virtual void Render(Canvas & canvas);
+    virtual void Layout();
+
+private:
+    enum
+    {
+        kMaxHistory = 320,
+        kMaxValueTextLength = 12,
+        kLabelWidth = 30,           // Width of the label column, as a percentage of the display width
+        kMarginPix = 4,
+    };
+
+    struct Graph
+    {
+        uint16_t Samples[kMaxHistory];
+        uint16_t RangeMin;
+        uint16_t RangeMax;
+        DisplayRect LabelRect;
+        DisplayRect ValueRect;
+        DisplayRect PlotRect;
+        char ValueText[kMaxValueTextLength];
+    };
+
+    Graph mGraphs[kNumMetrics];
+    uint16_t mHistoryLen;           // Number of samples retained per metric (the width of each plot)
+    uint16_t mCursor;               // Column at which the next sample will be drawn
+    uint16_t mNumSamples;           // Number of columns holding samples
+
+    void UpdateRange(uint8_t metric, uint16_t value);
+    static void GetValueRange(uint8_t metric, uint16_t value, uint16_t & rangeMin, uint16_t & rangeMax);
+    void UpdateValueText(uint8_t metric, uint16_t value);
+    void InvalidateColumn(uint16_t column);
+    int16_t ValueToY(const Graph & graph, uint16_t value) const;
+    void RenderPlot(Canvas & canvas, const Graph & graph);
+};
+
+#endif // CONFIG_HAVE_DISPLAY
+
+#endif // DASHBOARD_WIDGET_H
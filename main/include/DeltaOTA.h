@@ -0,0 +1,82 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef DELTA_OTA_H
+#define DELTA_OTA_H
+
+#include "esp_system.h"
+#include "esp_partition.h"
+#include "esp_ota_ops.h"
+#include "mbedtls/sha256.h"
+#include "rom/miniz.h"
+
+#include "DeltaPatch.h"
+
+/**
+ *  @class DeltaOTAUpdater
+ *
+ *  @brief
+ *    Applies a delta OTA image, as generated by tools/mkdelta.py, to the running application,
+ *    writing the resulting application into the inactive OTA partition.
+ *
+ *    The delta image is supplied in pieces of any size via Write().  Its header is authenticated
+ *    with the key given to Begin() and checked against the running application, after which the deflate stream that follows is
+ *    decompressed and applied as it arrives.  Memory use is bounded by the deflate window
+ *    chosen when the delta was generated (4KB by default) plus the decompressor state.  Once
+ *    the new application has been written and its SHA-256 verified, End() makes it the boot
+ *    partition.
+ */
+class DeltaOTAUpdater
+{
+public:
+    DeltaOTAUpdater(void);
+
+    esp_err_t Begin(const uint8_t * key, size_t keyLen);
+    esp_err_t Write(const uint8_t * data, size_t len);
+    esp_err_t End(void);
+    void Abort(void);
+
+private:
+    DeltaPatchHeader mHeader;
+    size_t mHeaderLen;
+    const uint8_t * mKey;
+    size_t mKeyLen;
+    const esp_partition_t * mOldPartition;
+    const esp_partition_t * mNewPartition;
+    esp_ota_handle_t mOTAHandle;
+    tinfl_decompressor * mInflator;
+    uint8_t * mWindow;
+    size_t mWindowPos;
+    esp_err_t mFlashErr;
+    bool mActive;
+    bool mOTAStarted;
+    bool mInflateDone;
+    mbedtls_sha256_context mNewSHA256;
+    DeltaPatcher mPatcher;
+
+    esp_err_t StartPatch(void);
+    esp_err_t CheckHeaderMAC(void);
+    esp_err_t CheckOldImage(void);
+
+    static bool ReadOld(void * context, uint32_t offset, uint8_t * buf, uint32_t len);
+    static bool WriteNew(void * context, const uint8_t * buf, uint32_t len);
+};
+
+extern esp_err_t StartDeltaOTAServer(uint16_t port, const char * keyHex);
+
+#endif // DELTA_OTA_H
@@ -0,0 +1,122 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <stdint.h>
+
+/**
+ * The header at the start of a delta OTA image, as generated by tools/mkdelta.py.
+ *
+ * The header is followed by a raw deflate stream containing the records applied by DeltaPatcher.
+ * The header is authenticated by an HMAC-SHA256 over its other fields, keyed with a key shared
+ * with the devices to be updated.  Since the header carries the SHA-256 of the new image, which
+ * is checked before the new image is used, this authenticates the image as a whole.
+ */
+struct DeltaPatchHeader
+{
+    enum
+    {
+        kMagic      = 0x5044574f,   // 'OWDP'
+        kVersion    = 2,
+    };
+
+    uint32_t Magic;
+    uint8_t Version;
+    uint8_t WindowBits;             // Size of the deflate window (log2)
+    uint16_t Reserved;
+    uint32_t OldSize;               // Size of the image to which the delta applies
+    uint32_t NewSize;               // Size of the image produced
+    uint8_t OldSHA256[32];
+    uint8_t NewSHA256[32];
+    uint8_t HMAC[32];               // HMAC-SHA256 of the preceding fields
+} __attribute__((packed));
+
+/**
+ *  @class DeltaPatcher
+ *
+ *  @brief
+ *    Applies the records of a delta OTA image to an old image, producing a new image.
+ *
+ *    Each record consists of a control block, giving a diff length, an extra length and an old
+ *    image seek adjustment; diff length bytes, each of which is added to the byte at the current
+ *    position in the old image to produce the next byte of the new image; and extra length bytes,
+ *    which are copied to the new image unchanged.  After each record, the old image position is
+ *    advanced by the diff length plus the seek adjustment.
+ *
+ *    The records may be supplied in pieces of any size.  The old image is read, and the new image
+ *    written, through callbacks in blocks of at most kBlockSize bytes, so the memory used does not
+ *    depend on the size of the images.
+ *
+ *    This class has no platform dependencies, so that it can be built and tested on a host.
+ */
+class DeltaPatcher
+{
+public:
+    enum
+    {
+        kBlockSize = 1024,
+    };
+
+    enum
+    {
+        kStatus_OK = 0,
+        kStatus_InvalidPatch,
+        kStatus_ReadError,
+        kStatus_WriteError,
+    };
+
+    typedef bool (*ReadOldFunct)(void * context, uint32_t offset, uint8_t * buf, uint32_t len);
+    typedef bool (*WriteNewFunct)(void * context, const uint8_t * buf, uint32_t len);
+
+    void Init(uint32_t oldSize, uint32_t newSize, ReadOldFunct readOld, WriteNewFunct writeNew, void * context);
+    int Apply(const uint8_t * data, uint32_t len);
+    int Finish(void);
+    uint32_t GetNewImageOffset(void) const;
+
+private:
+    enum
+    {
+        kControlSize = 12,
+    };
+
+    ReadOldFunct mReadOld;
+    WriteNewFunct mWriteNew;
+    void * mContext;
+    int64_t mOldPos;                // May be outside the old image between records
+    uint32_t mOldSize;
+    uint32_t mNewSize;
+    uint32_t mNewPos;               // Position in the new image, including buffered data
+    uint32_t mDiffRemaining;
+    uint32_t mExtraRemaining;
+    int32_t mSeek;
+    uint8_t mControl[kControlSize];
+    uint8_t mControlLen;
+    uint16_t mBlockLen;
+    uint8_t mBlock[kBlockSize];     // New image data not yet written
+
+    int FlushBlock(void);
+};
+
+inline uint32_t DeltaPatcher::GetNewImageOffset(void) const
+{
+    return mNewPos;
+}
+
+#endif // DELTA_PATCH_H
@@ -0,0 +1,96 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef DEVICE_METRICS_H
+#define DEVICE_METRICS_H
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+#include <Weave/Profiles/data-management/TraitData.h>
+#include <nest/trait/performance/DeviceMetricsTrait.h>
+
+/**
+ *  @class DeviceMetricsPublisher
+ *
+ *  @brief
+ *    Publishes the device's runtime performance counters via the DeviceMetricsTrait, making them
+ *    available to any subscriber, including the service.
+ *
+ *    Counters are updated in place as events occur.  At a fixed interval the current values are
+ *    compared against those last published and only the leaves that have changed are marked
+ *    dirty, bounding the rate of notifications regardless of how often the counters change.
+ */
+class DeviceMetricsPublisher
+{
+public:
+    DeviceMetricsPublisher(void);
+
+    WEAVE_ERROR Init(uint32_t publishIntervalMS);
+
+    void CountCommandReceived(void);
+    void CountCommandSent(void);
+    uint32_t GetCommandsReceived(void) const;
+    uint32_t GetCommandsSent(void) const;
+
+private:
+
+    class DeviceMetricsTraitDataSource : public ::nl::Weave::Profiles::DataManagement_Current::TraitDataSource
+    {
+    public:
+        DeviceMetricsTraitDataSource(DeviceMetricsPublisher & publisher);
+
+    private:
+        DeviceMetricsPublisher & mPublisher;
+
+        WEAVE_ERROR GetLeafData(::nl::Weave::Profiles::DataManagement_Current::PropertyPathHandle aLeafHandle, uint64_t aTagToWrite,
+                        ::nl::Weave::TLV::TLVWriter & aWriter) __OVERRIDE;
+    };
+
+    DeviceMetricsTraitDataSource mDataSource;
+    uint32_t mPublishIntervalMS;
+    uint32_t mCommandsReceived;
+    uint32_t mCommandsSent;
+    ::Schema::Nest::Trait::Performance::DeviceMetricsTrait::Data mPublishedData;
+
+    void Publish(void);
+
+    static void HandlePublishTimer(::nl::Weave::System::Layer * layer, void * appState, ::nl::Weave::System::Error err);
+};
+
+inline void DeviceMetricsPublisher::CountCommandReceived(void)
+{
+    mCommandsReceived++;
+}
+
+inline void DeviceMetricsPublisher::CountCommandSent(void)
+{
+    mCommandsSent++;
+}
+
+inline uint32_t DeviceMetricsPublisher::GetCommandsReceived(void) const
+{
+    return mCommandsReceived;
+}
+
+inline uint32_t DeviceMetricsPublisher::GetCommandsSent(void) const
+{
+    return mCommandsSent;
+}
+
+extern DeviceMetricsPublisher DeviceMetrics;
+
+#endif // DEVICE_METRICS_H
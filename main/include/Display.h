@@ -39,12 +39,15 @@ extern "C" {
 #include "tft.h"
 } // extern "C"
 
+enum
+{
+    kDisplayMaxTransferSize = 6 * 1024,     // Maximum size of a single SPI transfer to the display (in bytes)
+};
+
 extern uint16_t DisplayHeight;
 extern uint16_t DisplayWidth;
 
 extern esp_err_t InitDisplay();
-extern void ClearDisplay();
-extern void DisplayMessageCentered(const char *msg, uint16_t vpos);
 
 #endif // #if CONFIG_HAVE_DISPLAY
 
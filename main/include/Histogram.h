@@ -0,0 +1,51 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Return the upper limit (exclusive) of a bucket of a log2 histogram whose first bucket
+ * counts values below firstBucketLimit, and each subsequent bucket twice the range of the
+ * one before.  The last bucket of a histogram has no upper limit; its lower limit is the
+ * upper limit of the bucket before it.
+ */
+inline uint32_t Log2HistogramBucketLimit(uint32_t firstBucketLimit, uint8_t bucket)
+{
+    return firstBucketLimit << bucket;
+}
+
+/**
+ * Count a value in a log2 histogram whose first bucket counts values below firstBucketLimit.
+ * Values beyond the range of the second-to-last bucket are counted in the last bucket.
+ */
+template <size_t NumBuckets>
+inline void AddToLog2Histogram(uint32_t (&histogram)[NumBuckets], uint32_t value, uint32_t firstBucketLimit)
+{
+    uint8_t bucket = 0;
+    while (bucket < NumBuckets - 1 && value >= Log2HistogramBucketLimit(firstBucketLimit, bucket))
+    {
+        bucket++;
+    }
+    histogram[bucket]++;
+}
+
+#endif // HISTOGRAM_H
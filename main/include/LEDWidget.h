@@ -19,25 +19,71 @@
 #ifndef LED_WIDGET_H
 #define LED_WIDGET_H
 
+#include "esp_system.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "freertos/FreeRTOS.h"
 
+/**
+ * A single step in an LED pattern.
+ */
+struct LEDPatternStep
+{
+    uint8_t Brightness;             // 0 (off) to 255 (full)
+    bool Fade;                      // Ramp from the previous brightness over the step's duration
+    uint16_t DurationMS;            // 0 = hold the step indefinitely
+};
+
+/**
+ *  @class LEDWidget
+ *
+ *  @brief
+ *    Plays patterns on an LED.
+ *
+ *    A pattern is a sequence of steps, each of which sets the LED to a given brightness (or
+ *    fades to it) for a given time, and which repeats until the pattern is changed.  The LED is
+ *    driven by an LEDC PWM channel, with fades performed by the LEDC hardware, and the pattern is
+ *    stepped by a one-shot esp_timer, so that its timing is independent of the caller.
+ *
+ *    Setting the pattern that is already playing has no effect, so callers may set the desired
+ *    pattern as often as convenient.
+ */
 class LEDWidget
 {
 public:
-    void Init(gpio_num_t gpioNum);
+    enum
+    {
+        kMaxPatternSteps = 8,
+    };
+
+    esp_err_t Init(gpio_num_t gpioNum);
     void Set(bool state);
+    void SetBrightness(uint8_t brightness);
     void Blink(uint32_t changeRateMS);
     void Blink(uint32_t onTimeMS, uint32_t offTimeMS);
-    void Animate();
+    void Breathe(uint32_t periodMS);
+    void DoubleFlash(uint32_t periodMS);
+    void Play(const LEDPatternStep * steps, uint8_t numSteps);
 
 private:
-    int64_t mLastChangeTimeUS;
-    uint32_t mBlinkOnTimeMS;
-    uint32_t mBlinkOffTimeMS;
+    // State shared with the step timer.
+    portMUX_TYPE mLock;
+    LEDPatternStep mPattern[kMaxPatternSteps];
+    uint8_t mNumSteps;
+    bool mPatternChanged;
+
+    // State owned by the step timer.
+    esp_timer_handle_t mStepTimer;
+    int64_t mStepStartTimeUS;
+    uint8_t mStepIndex;
+
     gpio_num_t mGPIONum;
-    bool mState;
+    ledc_channel_t mChannel;
+
+    void ApplyStep(const LEDPatternStep & step);
 
-    void DoSet(bool state);
+    static void HandleStepTimer(void * arg);
 };
 
-#endif // TITLE_WIDGET_H
+#endif // LED_WIDGET_H
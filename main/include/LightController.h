@@ -19,6 +19,8 @@
 #ifndef LIGHT_CONTROLLER_H
 #define LIGHT_CONTROLLER_H
 
+#include "driver/gpio.h"
+
 #include <Weave/Profiles/data-management/TraitData.h>
 #include <nest/trait/lighting/LogicalCircuitStateTrait.h>
 
@@ -46,11 +48,24 @@ public:
     int8_t GetState(void);
     uint8_t GetLevel(void);
 
-    void Set(int8_t state, uint8_t level);
+    void Set(int8_t state, uint8_t level, uint64_t sourceNodeId);
     void Toggle(void);
 
+    WEAVE_ERROR StartDimSweep(uint32_t stepIntervalMS);
+
+    const ::Schema::Nest::Trait::Lighting::LogicalCircuitStateTrait::Data & GetStateData(void) const;
+    ::nl::Weave::Profiles::DataManagement_Current::TraitDataSource & GetStateDataSource(void);
+
+    static WEAVE_ERROR DecodeSetLogicalCircuitStateArguments(::nl::Weave::TLV::TLVReader & aArgumentReader,
+            uint8_t & aState, uint8_t & aLevel, uint32_t & aStatusCode);
+
 private:
 
+    enum
+    {
+        kDimSweepStep = 5,
+    };
+
     class LogicalCircuitStateTraitDataSource : public ::nl::Weave::Profiles::DataManagement_Current::TraitDataSource
     {
     public:
@@ -84,18 +99,31 @@ private:
     LogicalCircuitStateTraitDataSource mStateDS;
     LogicalCircuitControlTraitDataSource mControlDS;
     gpio_num_t mGPIONum;
-    int8_t mState;
-    uint8_t mLevel;
+    ::Schema::Nest::Trait::Lighting::LogicalCircuitStateTrait::Data mStateData;
+    uint32_t mDimSweepIntervalMS;
+    int8_t mDimSweepStep;
+
+    static void HandleDimSweepTimer(::nl::Weave::System::Layer * layer, void * appState, ::nl::Weave::System::Error err);
 };
 
 inline int8_t LightController::GetState(void)
 {
-    return mState;
+    return mStateData.State;
 }
 
 inline uint8_t LightController::GetLevel(void)
 {
-    return mLevel;
+    return mStateData.Brightness;
+}
+
+inline const ::Schema::Nest::Trait::Lighting::LogicalCircuitStateTrait::Data & LightController::GetStateData(void) const
+{
+    return mStateData;
+}
+
+inline ::nl::Weave::Profiles::DataManagement_Current::TraitDataSource & LightController::GetStateDataSource(void)
+{
+    return mStateDS;
 }
 
 #endif // LIGHT_CONTROLLER_H
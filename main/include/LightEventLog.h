@@ -0,0 +1,119 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+#ifndef LIGHT_EVENT_LOG_H
+#define LIGHT_EVENT_LOG_H
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+
+#if CONFIG_LIGHT_EVENT_LOG_SIZE
+
+/**
+ *  @class LightEventLogger
+ *
+ *  @brief
+ *    Records changes to the state of the light as WDM events, which reach the service over its
+ *    subscription to the device.
+ *
+ *    Each change is appended as a compact record to a fixed-size ring in RAM, at little cost to
+ *    the caller.  At a fixed interval, or sooner if the ring is filling up, the accumulated records
+ *    are drained into the Weave event log in a single pass, and the notification engine is run once,
+ *    so that a burst of changes is carried to the service in a handful of messages.  If the ring is
+ *    full, further changes are counted and dropped until it is drained.
+ */
+class LightEventLogger
+{
+public:
+    LightEventLogger(void);
+
+    WEAVE_ERROR Init(uint32_t uploadIntervalMS);
+
+    void Record(int8_t oldState, int8_t newState, uint8_t oldLevel, uint8_t newLevel, uint64_t sourceNodeId);
+
+    uint32_t GetEventsLogged(void) const;
+    uint32_t GetEventsDropped(void) const;
+    uint32_t GetEventsFailed(void) const;
+
+    void Dump(void);
+
+    enum
+    {
+        kEventStructureType = 0x0001,   // Light state change event, within the kAppProfile_LightEvents profile
+
+        kTag_OldState = 1,
+        kTag_NewState = 2,
+        kTag_OldLevel = 3,
+        kTag_NewLevel = 4,
+        kTag_SourceNodeId = 5,
+        kTag_AgeMS = 6,                 // Time between the change and the logging of its event
+    };
+
+private:
+
+    enum
+    {
+        kRingSize = CONFIG_LIGHT_EVENT_LOG_SIZE,
+        kEarlyUploadThreshold = (kRingSize * 3) / 4,    // Drain early once the ring is this full
+    };
+
+    struct LightStateChange
+    {
+        uint64_t SourceNodeId;
+        uint32_t TimeMS;                // Time of the change, in ms since boot
+        int8_t OldState;
+        int8_t NewState;
+        uint8_t OldLevel;
+        uint8_t NewLevel;
+    };
+
+    LightStateChange mRing[kRingSize];
+    uint16_t mHead;                     // Index of the oldest record
+    uint16_t mCount;
+    bool mEarlyUploadPending;
+    uint32_t mUploadIntervalMS;
+    uint32_t mEventsLogged;
+    uint32_t mEventsDropped;            // Changes dropped because the ring was full
+    uint32_t mEventsDroppedReported;
+    uint32_t mEventsFailed;             // Changes that the Weave event log failed to accept
+    uint32_t mEventsFailedReported;
+
+    void Upload(void);
+
+    static WEAVE_ERROR WriteEvent(::nl::Weave::TLV::TLVWriter & writer, uint8_t dataTag, void * appData);
+    static void HandleUploadTimer(::nl::Weave::System::Layer * layer, void * appState, ::nl::Weave::System::Error err);
+};
+
+inline uint32_t LightEventLogger::GetEventsLogged(void) const
+{
+    return mEventsLogged;
+}
+
+inline uint32_t LightEventLogger::GetEventsDropped(void) const
+{
+    return mEventsDropped;
+}
+
+inline uint32_t LightEventLogger::GetEventsFailed(void) const
+{
+    return mEventsFailed;
+}
+
+extern LightEventLogger LightEventLog;
+
+#endif // CONFIG_LIGHT_EVENT_LOG_SIZE
+
+#endif // LIGHT_EVENT_LOG_H
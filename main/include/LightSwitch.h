@@ -39,6 +39,8 @@ public:
     void Set(uint8_t state, uint8_t level);
     void Toggle(void);
 
+    static WEAVE_ERROR EncodeCommandRequest(int8_t state, uint8_t level, ::nl::Weave::PacketBuffer * buf);
+
 private:
     uint64_t mControllerNodeId;
     ::nl::Weave::Binding * mControllerBinding;
@@ -48,7 +50,6 @@ private:
     bool mChangePending;
 
     void SendCommand(void);
-    WEAVE_ERROR EncodeCommandRequest(::nl::Weave::PacketBuffer * buf);
 
     static void HandleBindingEvent(void *apAppState, ::nl::Weave::Binding::EventType aEvent,
             const ::nl::Weave::Binding::InEventParam & aInParam, ::nl::Weave::Binding::OutEventParam & aOutParam);
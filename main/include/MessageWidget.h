@@ -0,0 +1,48 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef MESSAGE_WIDGET_H
+#define MESSAGE_WIDGET_H
+
+#include "Display.h"
+#include "Compositor.h"
+
+#if CONFIG_HAVE_DISPLAY
+
+class MessageWidget : public Drawable
+{
+public:
+    // Layout properties, which take effect when the widget is next laid out.
+    uint16_t VPos;
+    color_t Color;
+
+    void Init(const char * msg);
+    void SetMessage(const char * msg);
+
+    virtual DisplayRect GetBounds() const;
+    virtual void Render(Canvas & canvas);
+    virtual void Layout();
+
+private:
+    const char * mMessage;
+    DisplayRect mRect;
+};
+
+#endif // CONFIG_HAVE_DISPLAY
+
+#endif // MESSAGE_WIDGET_H
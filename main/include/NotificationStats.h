@@ -0,0 +1,52 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef NOTIFICATION_STATS_H
+#define NOTIFICATION_STATS_H
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+
+enum
+{
+    kNotificationStats_NumRunTimeBuckets = 12,     // Histogram buckets: <64us, <128us, ... <65536us, >=65536us
+};
+
+/**
+ * Statistics describing the cost of fanning out trait changes to subscribers, gathered each time
+ * the application runs the WDM notification engine.
+ */
+struct NotificationStats
+{
+    uint32_t Runs;                                                  // Number of notification engine runs
+    uint32_t MaxRunTimeUS;                                          // Longest run
+    uint64_t TotalRunTimeUS;                                        // Total time spent in runs
+    uint16_t MaxSubscriptions;                                      // Most subscription handlers in use at the start of a run
+    uint16_t MaxPacketBufsInUse;                                    // Most PacketBuffers in use at the end of a run
+    uint16_t PacketBufsHighWater;                                   // Most PacketBuffers ever in use, since boot
+    uint32_t EncodedLeaves;                                         // Number of trait leaves encoded into notifications
+    uint32_t EncodedLeafBytes;                                      // Total TLV bytes of those leaves
+    uint32_t RunTimeHistogram[kNotificationStats_NumRunTimeBuckets];
+};
+
+extern void RunNotificationEngine(void);
+extern void CountEncodedLeaf(uint32_t encodedBytes);
+extern void GetNotificationStats(NotificationStats & stats);
+extern void ResetNotificationStats(void);
+extern void DumpNotificationStats(void);
+
+#endif // NOTIFICATION_STATS_H
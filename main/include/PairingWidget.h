@@ -20,10 +20,12 @@
 #define PAIRING_WIDGET_H
 
 #include "Display.h"
+#include "Compositor.h"
+#include "qrcode.h"
 
 #if CONFIG_HAVE_DISPLAY
 
-class PairingWidget
+class PairingWidget : public Drawable
 {
 public:
     color_t QRCodeColor;
@@ -33,7 +35,28 @@ public:
     void Init();
     void Display();
 
+    virtual DisplayRect GetBounds() const;
+    virtual void Render(Canvas & canvas);
+    virtual void Layout();
+
 private:
+    enum
+    {
+        kMaxQRCodeVersion = 10,
+        kMaxQRCodeSize = kMaxQRCodeVersion * 4 + 17,
+        kQRCodeDataBufSize = (kMaxQRCodeSize * kMaxQRCodeSize + 7) / 8,
+        kMaxPairingCodeLength = 16,
+    };
+
+    QRCode mQRCode;
+    uint8_t mQRCodeData[kQRCodeDataBufSize];    // QR code modules, packed 1 bit per module
+    bool mQRCodeValid;
+    uint8_t mQRCodeModuleSizePix;
+    char mPairingCode[kMaxPairingCodeLength + 1];
+    DisplayRect mQRCodeRect;
+    DisplayRect mPairingCodeRect;
+
+    WEAVE_ERROR UpdateQRCode();
     WEAVE_ERROR GetQRCodeString(char *& qrCodeStr);
 };
 
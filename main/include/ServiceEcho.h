@@ -22,19 +22,96 @@
 #include <Weave/DeviceLayer/WeaveDeviceLayer.h>
 #include <Weave/Profiles/echo/Next/WeaveEchoClient.h>
 
+/**
+ *  @class ServiceEchoClient
+ *
+ *  @brief
+ *    Periodically sends Weave Echo requests to the service while the service tunnel is up.
+ *
+ *    The interval between echos adapts to the health of the service: each successful response
+ *    doubles the interval, up to a configured maximum, while a timeout or communication error
+ *    immediately returns it to the minimum so that a dead tunnel is detected quickly.  The
+ *    request payload is carried in a single, pre-allocated buffer that is reused for each echo
+ *    once a response shows that the stack has released the previous request.
+ *
+ *    The client can also run a payload size sweep, sending a series of echos with increasing
+ *    payload sizes and reporting the round-trip time, loss and effective goodput for each size.
+ *    The sweep flags the first size at which loss or latency jumps, which typically indicates
+ *    that messages have started to fragment somewhere along the path to the service.
+ */
 class ServiceEchoClient : public ::nl::Weave::Profiles::Echo_Next::WeaveEchoClient
 {
 public:
-    WEAVE_ERROR Init(uint32_t intervalMS);
+    enum
+    {
+        kMaxSweepSizes = 10,
+    };
+
+    struct PayloadSizeStats
+    {
+        uint16_t PayloadLen;
+        uint8_t Sent;
+        uint8_t Received;
+        uint32_t MinRTTUS;
+        uint32_t MaxRTTUS;
+        uint32_t TotalRTTUS;
+    };
+
+    WEAVE_ERROR Init(uint32_t minIntervalMS, uint32_t maxIntervalMS);
+    WEAVE_ERROR StartPayloadSweep(uint8_t samplesPerSize);
+    bool IsPayloadSweepActive(void) const;
+    uint8_t GetNumPayloadSweepSizes(void) const;
+    const PayloadSizeStats & GetPayloadSweepStats(uint8_t index) const;
+    bool FindPayloadSweepKnee(uint8_t & index) const;
 
     bool ServiceAlive;
+    uint32_t LastRTTUS;
 
 private:
-    uint32_t mIntervalMS;
+    ::nl::Weave::PacketBuffer * mPayloadBuf;
+    uint8_t * mPayloadStart;
+    int64_t mSendTimeUS;
+    uint32_t mMinIntervalMS;
+    uint32_t mMaxIntervalMS;
+    uint32_t mCurIntervalMS;
+    uint16_t mMaxPayloadLen;
+    uint16_t mSentPayloadLen;
+    bool mPayloadBufInFlight;
+    bool mSweepActive;
+    uint8_t mSweepSamplesPerSize;
+    uint8_t mSweepSizeIndex;
+    uint8_t mNumSweepSizes;
+    PayloadSizeStats mSweepStats[kMaxSweepSizes];
+
+    void StartEchos(void);
+    void StopEchos(void);
+    void HandleEchoComplete(::nl::Weave::PacketBuffer * response);
+    void ScheduleNextEcho(bool serviceResponded);
+    ::nl::Weave::PacketBuffer * PreparePayload(void);
+    void ReleasePayloadBuf(bool responded);
+    void RecordSweepSample(bool responded, uint32_t rttUS);
+    void LogSweepResults(void) const;
 
+    static void HandleEchoClientEvent(void * appState, EventType eventType, const InEventParam & inParam, OutEventParam & outParam);
+    static void HandleEchoTimer(::nl::Weave::System::Layer * layer, void * appState, ::nl::Weave::System::Error err);
     static void PlatformEventHandler(const ::nl::Weave::DeviceLayer::WeaveDeviceEvent * event, intptr_t arg);
 };
 
+inline bool ServiceEchoClient::IsPayloadSweepActive(void) const
+{
+    return mSweepActive;
+}
+
+inline uint8_t ServiceEchoClient::GetNumPayloadSweepSizes(void) const
+{
+    return mNumSweepSizes;
+}
+
+inline const ServiceEchoClient::PayloadSizeStats & ServiceEchoClient::GetPayloadSweepStats(uint8_t index) const
+{
+    return mSweepStats[index];
+}
+
 extern ServiceEchoClient ServiceEcho;
 
 #endif // SERVICE_ECHO_H
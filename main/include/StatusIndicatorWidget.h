@@ -20,10 +20,11 @@
 #define STATUS_INDICATOR_WIDGET_H
 
 #include "Display.h"
+#include "Compositor.h"
 
 #if CONFIG_HAVE_DISPLAY
 
-class StatusIndicatorWidget
+class StatusIndicatorWidget : public Drawable
 {
 public:
     enum
@@ -31,25 +32,44 @@ public:
         kMaxIndicators = 5
     };
 
+    // Layout properties, which take effect when the widget is next laid out.
     color_t Color;
     uint16_t Size;
     uint16_t VPos;
     uint16_t HMargin;
-    char Char[kMaxIndicators];
-    bool State[kMaxIndicators];
 
     void Init(uint8_t numIndicators);
-    void Display();
-    void Update();
+    void SetChar(uint8_t indicatorPos, char indicatorChar);
+    void SetState(uint8_t indicatorPos, bool state);
+
+    virtual DisplayRect GetBounds() const;
+    virtual void Render(Canvas & canvas);
+    virtual void Layout();
 
 protected:
     uint8_t mNumIndicators;
 
 private:
-    char mLastChar[kMaxIndicators];
-    bool mLastState[kMaxIndicators];
+    enum
+    {
+        kMaxCachedGlyphs = 8
+    };
+
+    char mChar[kMaxIndicators];
+    bool mState[kMaxIndicators];
+    DisplayRect mIndicatorRects[kMaxIndicators];
+
+    // Cache of pre-rasterized indicator characters, each stored as a 1-bit-per-pixel mask
+    // the size of an indicator.
+    uint8_t * mGlyphCache;
+    char mGlyphCacheChar[kMaxCachedGlyphs];
+    uint16_t mGlyphCacheSizePix;
+    uint16_t mGlyphCacheSlotSize;
+    uint8_t mGlyphCacheNext;
 
-    void DrawIndicator(char indicatorChar, bool state, uint8_t indicatorPos) const;
+    void DrawIndicator(Canvas & canvas, char indicatorChar, bool state, uint8_t indicatorPos);
+    const uint8_t * GetGlyphMask(char indicatorChar, uint16_t sizePix);
+    static void RasterizeGlyph(char indicatorChar, uint16_t sizePix, uint8_t * mask);
 };
 
 #endif // CONFIG_HAVE_DISPLAY
@@ -20,16 +20,21 @@
 #define TITLE_WIDGET_H
 
 #include "Display.h"
+#include "Compositor.h"
 
 #if CONFIG_HAVE_DISPLAY
 
-class TitleWidget
+class TitleWidget : public Drawable
 {
 public:
     void Init(const char * title);
     void Start();
     void Animate();
 
+    virtual DisplayRect GetBounds() const;
+    virtual void Render(Canvas & canvas);
+    virtual void Layout();
+
     const char * Title;
     uint16_t LogoVPos;
     uint16_t TitleVPos;
@@ -41,9 +46,17 @@ public:
 
 private:
     int64_t mStartTimeUS;
+    DisplayAsset mLogo;
+    color_t * mLogoRowBuf;
     uint16_t mLogoX;
     uint16_t mLogoY;
+    uint16_t mLogoEndY;
+    DisplayRect mTitleRect;
     bool mTitleDisplayed;
+
+    DisplayRect LogoRect() const;
+    void InvalidateLogoMove(uint16_t oldY, uint16_t newY);
+    void ReadLogoRow(int32_t row, color_t * buf) const;
 };
 
 #endif // CONFIG_HAVE_DISPLAY
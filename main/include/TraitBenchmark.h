@@ -0,0 +1,51 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef TRAIT_BENCHMARK_H
+#define TRAIT_BENCHMARK_H
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+
+#if CONFIG_TRAIT_BENCHMARK_ITERATIONS
+
+/**
+ *  @class TraitBenchmark
+ *
+ *  @brief
+ *    Measures the lighting command and trait data hot paths, printing the results as JSON.
+ */
+class TraitBenchmark
+{
+public:
+    static void Run(uint32_t iterations);
+
+private:
+    typedef WEAVE_ERROR (*OperationFunct)(void);
+
+    static void RunTest(const char * name, OperationFunct op, uint32_t iterations);
+
+    static WEAVE_ERROR EncodeCommandRequest(void);
+    static WEAVE_ERROR DecodeCommandArguments(void);
+    static WEAVE_ERROR EncodeStateNotification(void);
+    static WEAVE_ERROR EncodeTypedStateNotification(void);
+    static WEAVE_ERROR LookupStateSchema(void);
+};
+
+#endif // CONFIG_TRAIT_BENCHMARK_ITERATIONS
+
+#endif // TRAIT_BENCHMARK_H
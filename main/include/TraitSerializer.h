@@ -0,0 +1,174 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef TRAIT_SERIALIZER_H
+#define TRAIT_SERIALIZER_H
+
+#include <Weave/Profiles/data-management/DataManagement.h>
+
+/**
+ *  @class TraitSerializer
+ *
+ *  @brief
+ *    Writes the leaves of a typed trait data struct, as generated by tools/mktraits.py, to a
+ *    TLVWriter.
+ *
+ *    The serializer for a trait is a typedef listing one TraitLeaf (or NullableTraitLeaf) per
+ *    leaf of the trait, in property handle order.  Each leaf is written by a function that is
+ *    instantiated for that leaf's struct member, so writing a leaf involves neither a virtual
+ *    call nor a switch on the property handle.  WriteLeaf() looks up the leaf's write function
+ *    in a constant table indexed by handle, and WriteLeaves() writes a set of leaves in a single
+ *    pass that the compiler unrolls into straight-line code.
+ *
+ *    A trait data source uses WriteLeaf() from its GetLeafData().  OpenWeave still reaches
+ *    GetLeafData() through a virtual call for each leaf it notifies, giving the tag the leaf is
+ *    to be written with, so the serializer removes only the switch from that path.
+ *    WriteLeaves() is for callers that encode the leaves of a trait themselves; it writes the
+ *    same bytes as WriteLeaf() with each leaf's context tag (see
+ *    tools/host-tests/TraitSerializerTest.cpp).
+ *
+ *    Only flat traits, whose leaves all sit directly beneath the root (with context tags 1, 2,
+ *    ...), are supported.
+ */
+template <typename DataT, ::nl::Weave::Profiles::DataManagement_Current::PropertyPathHandle FirstLeafHandle, typename... Leaves>
+class TraitSerializer
+{
+public:
+    enum
+    {
+        kNumLeaves = sizeof...(Leaves),
+        kAllLeaves = (1u << kNumLeaves) - 1,
+    };
+
+    static uint32_t LeafBit(::nl::Weave::Profiles::DataManagement_Current::PropertyPathHandle leafHandle);
+    static WEAVE_ERROR WriteLeaf(const DataT & data, ::nl::Weave::Profiles::DataManagement_Current::PropertyPathHandle leafHandle,
+            uint64_t tag, ::nl::Weave::TLV::TLVWriter & writer);
+    static WEAVE_ERROR WriteLeaves(const DataT & data, uint32_t leafMask, ::nl::Weave::TLV::TLVWriter & writer);
+};
+
+/**
+ * Writes a single leaf of a typed trait data struct.
+ */
+template <typename DataT, typename FieldT, FieldT DataT::*Field>
+struct TraitLeaf
+{
+    static WEAVE_ERROR Write(const DataT & data, uint64_t tag, ::nl::Weave::TLV::TLVWriter & writer);
+};
+
+/**
+ * Writes a single nullable leaf of a typed trait data struct, along with the member flagging
+ * whether the leaf is null.
+ */
+template <typename DataT, typename FieldT, FieldT DataT::*Field, bool DataT::*IsNull>
+struct NullableTraitLeaf
+{
+    static WEAVE_ERROR Write(const DataT & data, uint64_t tag, ::nl::Weave::TLV::TLVWriter & writer);
+};
+
+namespace TraitSerializerInternal {
+
+template <typename T>
+inline WEAVE_ERROR PutLeafValue(::nl::Weave::TLV::TLVWriter & writer, uint64_t tag, T value)
+{
+    return writer.Put(tag, value);
+}
+
+inline WEAVE_ERROR PutLeafValue(::nl::Weave::TLV::TLVWriter & writer, uint64_t tag, bool value)
+{
+    return writer.PutBoolean(tag, value);
+}
+
+template <typename DataT, typename... Leaves>
+struct LeafSequence;
+
+template <typename DataT>
+struct LeafSequence<DataT>
+{
+    static WEAVE_ERROR WriteMasked(const DataT & data, uint32_t leafMask, uint8_t contextTag, ::nl::Weave::TLV::TLVWriter & writer)
+    {
+        return WEAVE_NO_ERROR;
+    }
+};
+
+template <typename DataT, typename FirstLeaf, typename... OtherLeaves>
+struct LeafSequence<DataT, FirstLeaf, OtherLeaves...>
+{
+    static WEAVE_ERROR WriteMasked(const DataT & data, uint32_t leafMask, uint8_t contextTag, ::nl::Weave::TLV::TLVWriter & writer)
+    {
+        if (leafMask & 1)
+        {
+            WEAVE_ERROR err = FirstLeaf::Write(data, ::nl::Weave::TLV::ContextTag(contextTag), writer);
+            if (err != WEAVE_NO_ERROR)
+            {
+                return err;
+            }
+        }
+        return LeafSequence<DataT, OtherLeaves...>::WriteMasked(data, leafMask >> 1, contextTag + 1, writer);
+    }
+};
+
+} // namespace TraitSerializerInternal
+
+template <typename DataT, typename FieldT, FieldT DataT::*Field>
+inline WEAVE_ERROR TraitLeaf<DataT, FieldT, Field>::Write(const DataT & data, uint64_t tag, ::nl::Weave::TLV::TLVWriter & writer)
+{
+    return TraitSerializerInternal::PutLeafValue(writer, tag, data.*Field);
+}
+
+template <typename DataT, typename FieldT, FieldT DataT::*Field, bool DataT::*IsNull>
+inline WEAVE_ERROR NullableTraitLeaf<DataT, FieldT, Field, IsNull>::Write(const DataT & data, uint64_t tag, ::nl::Weave::TLV::TLVWriter & writer)
+{
+    return (data.*IsNull) ? writer.PutNull(tag) : TraitSerializerInternal::PutLeafValue(writer, tag, data.*Field);
+}
+
+/* Return the bit representing a leaf in the leaf masks accepted by WriteLeaves().
+ */
+template <typename DataT, ::nl::Weave::Profiles::DataManagement_Current::PropertyPathHandle FirstLeafHandle, typename... Leaves>
+inline uint32_t TraitSerializer<DataT, FirstLeafHandle, Leaves...>::LeafBit(::nl::Weave::Profiles::DataManagement_Current::PropertyPathHandle leafHandle)
+{
+    return 1u << (leafHandle - FirstLeafHandle);
+}
+
+/* Write a single leaf, identified by its property handle, with the given tag.
+ *
+ * NOTE: As for TraitDataSource::GetLeafData(), nothing is written for handles that don't
+ * identify a leaf of the trait.
+ */
+template <typename DataT, ::nl::Weave::Profiles::DataManagement_Current::PropertyPathHandle FirstLeafHandle, typename... Leaves>
+WEAVE_ERROR TraitSerializer<DataT, FirstLeafHandle, Leaves...>::WriteLeaf(const DataT & data,
+        ::nl::Weave::Profiles::DataManagement_Current::PropertyPathHandle leafHandle, uint64_t tag, ::nl::Weave::TLV::TLVWriter & writer)
+{
+    typedef WEAVE_ERROR (*WriteFunct)(const DataT & data, uint64_t tag, ::nl::Weave::TLV::TLVWriter & writer);
+    static const WriteFunct sWriteFuncts[kNumLeaves] = { &Leaves::Write... };
+
+    uint32_t index = leafHandle - FirstLeafHandle;
+
+    return (index < kNumLeaves) ? sWriteFuncts[index](data, tag, writer) : WEAVE_NO_ERROR;
+}
+
+/* Write the leaves selected by leafMask (see LeafBit()), in handle order, each with its
+ * context tag.
+ */
+template <typename DataT, ::nl::Weave::Profiles::DataManagement_Current::PropertyPathHandle FirstLeafHandle, typename... Leaves>
+inline WEAVE_ERROR TraitSerializer<DataT, FirstLeafHandle, Leaves...>::WriteLeaves(const DataT & data, uint32_t leafMask,
+        ::nl::Weave::TLV::TLVWriter & writer)
+{
+    return TraitSerializerInternal::LeafSequence<DataT, Leaves...>::WriteMasked(data, leafMask, 1, writer);
+}
+
+#endif // TRAIT_SERIALIZER_H
@@ -3,7 +3,7 @@
  *    Copyright (c) 2018 Nest Labs, Inc.
  *    All rights reserved.
  *
- *    THIS FILE IS GENERATED. DO NOT MODIFY.
+ *    THIS FILE IS GENERATED BY tools/mktraits.py. DO NOT MODIFY.
  *
  *    SOURCE TEMPLATE: trait.cpp.h
  *    SOURCE PROTO: nest/trait/lighting/logical_circuit_control_trait.proto
@@ -3,7 +3,7 @@
  *    Copyright (c) 2018 Nest Labs, Inc.
  *    All rights reserved.
  *
- *    THIS FILE IS GENERATED. DO NOT MODIFY.
+ *    THIS FILE IS GENERATED BY tools/mktraits.py. DO NOT MODIFY.
  *
  *    SOURCE TEMPLATE: trait.cpp.h
  *    SOURCE PROTO: nest/trait/lighting/physical_circuit_state_trait.proto
@@ -14,6 +14,7 @@
 
 #include <Weave/Profiles/data-management/DataManagement.h>
 #include <Weave/Support/SerializationUtils.h>
+#include <TraitSerializer.h>
 
 
 
@@ -65,6 +66,19 @@ enum CircuitState {
     CIRCUIT_STATE_OFF = 2,
 };
 
+//
+// Typed Data
+//
+
+struct Data {
+    int8_t State;
+    uint8_t Level;
+};
+
+typedef TraitSerializer<Data, kPropertyHandle_State,
+        TraitLeaf<Data, int8_t, &Data::State>,
+        TraitLeaf<Data, uint8_t, &Data::Level> > Serializer;
+
 } // namespace PhysicalCircuitStateTrait
 } // namespace Lighting
 } // namespace Trait
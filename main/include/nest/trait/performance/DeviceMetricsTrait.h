@@ -0,0 +1,120 @@
+/**
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    THIS FILE IS GENERATED BY tools/mktraits.py. DO NOT MODIFY.
+ *
+ *    Schema definitions for the DeviceMetricsTrait, an application-specific trait used by the
+ *    OpenWeave ESP32 demo application to publish runtime performance counters.  The trait is
+ *    defined under the application's own vendor id, as given in main/include/AppProfiles.h.
+ *
+ */
+#ifndef _NEST_TRAIT_PERFORMANCE__DEVICE_METRICS_TRAIT_H_
+#define _NEST_TRAIT_PERFORMANCE__DEVICE_METRICS_TRAIT_H_
+
+#include <Weave/Profiles/data-management/DataManagement.h>
+#include <Weave/Support/SerializationUtils.h>
+#include <TraitSerializer.h>
+
+
+
+namespace Schema {
+namespace Nest {
+namespace Trait {
+namespace Performance {
+namespace DeviceMetricsTrait {
+
+extern const nl::Weave::Profiles::DataManagement::TraitSchemaEngine TraitSchema;
+
+enum {
+      kWeaveProfileId = (0xfff1U << 16) | 0x1U
+};
+
+//
+// Properties
+//
+
+enum {
+    kPropertyHandle_Root = 1,
+
+    //---------------------------------------------------------------------------------------------------------------------------//
+    //  Name                                IDL Type                            TLV Type           Optional?       Nullable?     //
+    //---------------------------------------------------------------------------------------------------------------------------//
+
+    //
+    //  uptime_sec                          uint32                               uint32            NO              NO
+    //
+    kPropertyHandle_UptimeSec = 2,
+
+    //
+    //  commands_received                   uint32                               uint32            NO              NO
+    //
+    kPropertyHandle_CommandsReceived = 3,
+
+    //
+    //  commands_sent                       uint32                               uint32            NO              NO
+    //
+    kPropertyHandle_CommandsSent = 4,
+
+    //
+    //  echo_rtt_ms                         uint32                               uint32            NO              NO
+    //
+    kPropertyHandle_EchoRttMs = 5,
+
+    //
+    //  free_heap                           uint32                               uint32            NO              NO
+    //
+    kPropertyHandle_FreeHeap = 6,
+
+    //
+    //  min_free_heap                       uint32                               uint32            NO              NO
+    //
+    kPropertyHandle_MinFreeHeap = 7,
+
+    //
+    //  largest_free_block                  uint32                               uint32            NO              NO
+    //
+    kPropertyHandle_LargestFreeBlock = 8,
+
+    //
+    //  max_event_loop_lateness_ms          uint32                               uint32            NO              NO
+    //
+    kPropertyHandle_MaxEventLoopLatenessMs = 9,
+
+    //
+    // Enum for last handle
+    //
+    kLastSchemaHandle = 9,
+};
+
+//
+// Typed Data
+//
+
+struct Data {
+    uint32_t UptimeSec;
+    uint32_t CommandsReceived;
+    uint32_t CommandsSent;
+    uint32_t EchoRttMs;
+    uint32_t FreeHeap;
+    uint32_t MinFreeHeap;
+    uint32_t LargestFreeBlock;
+    uint32_t MaxEventLoopLatenessMs;
+};
+
+typedef TraitSerializer<Data, kPropertyHandle_UptimeSec,
+        TraitLeaf<Data, uint32_t, &Data::UptimeSec>,
+        TraitLeaf<Data, uint32_t, &Data::CommandsReceived>,
+        TraitLeaf<Data, uint32_t, &Data::CommandsSent>,
+        TraitLeaf<Data, uint32_t, &Data::EchoRttMs>,
+        TraitLeaf<Data, uint32_t, &Data::FreeHeap>,
+        TraitLeaf<Data, uint32_t, &Data::MinFreeHeap>,
+        TraitLeaf<Data, uint32_t, &Data::LargestFreeBlock>,
+        TraitLeaf<Data, uint32_t, &Data::MaxEventLoopLatenessMs> > Serializer;
+
+} // namespace DeviceMetricsTrait
+} // namespace Performance
+} // namespace Trait
+} // namespace Nest
+} // namespace Schema
+#endif // _NEST_TRAIT_PERFORMANCE__DEVICE_METRICS_TRAIT_H_
@@ -27,21 +27,36 @@
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "esp_heap_caps_init.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include <new>
 
 #include <Weave/DeviceLayer/WeaveDeviceLayer.h>
 #include <Weave/Support/ErrorStr.h>
 
 #include "AliveTimer.h"
+#include "BootPhases.h"
+#include "ConnectivityTimeline.h"
 #include "ServiceEcho.h"
+#include "DeviceMetrics.h"
+#include "NotificationStats.h"
+#include "DeltaOTA.h"
 #include "Display.h"
 #include "TitleWidget.h"
 #include "StatusIndicatorWidget.h"
 #include "PairingWidget.h"
 #include "CountdownWidget.h"
+#include "MessageWidget.h"
+#include "DashboardWidget.h"
+#include "Compositor.h"
+#include "DisplayBenchmark.h"
+#include "TraitBenchmark.h"
+#include "Assets.h"
 #include "LEDWidget.h"
 #include "Button.h"
+#include "ButtonGroup.h"
 #include "LightController.h"
+#include "LightEventLog.h"
 #include "LightSwitch.h"
 
 using namespace ::nl;
@@ -100,9 +115,11 @@ void CriticalSectionExit(void)
 enum DisplayMode
 {
     kDisplayMode_Uninitialized,
+    kDisplayMode_TitleScreen,
     kDisplayMode_StatusScreen,
     kDisplayMode_PairingScreen,
     kDisplayMode_ResetCountdown,
+    kDisplayMode_Dashboard,
 };
 
 static DisplayMode displayMode = kDisplayMode_Uninitialized;
@@ -110,9 +127,31 @@ static TitleWidget titleWidget;
 static StatusIndicatorWidget statusIndicator;
 static PairingWidget pairingWidget;
 static CountdownWidget resetCountdownWidget;
+static MessageWidget resetMessage;
+#if CONFIG_DEFER_EVENT_LOOP_START
+static bool eventLoopStarted = false;
+#endif // CONFIG_DEFER_EVENT_LOOP_START
+
+static Drawable * const titleScreen[] = { &titleWidget };
+static Drawable * const statusScreen[] = { &titleWidget, &statusIndicator };
+static Drawable * const pairingScreen[] = { &pairingWidget };
+static Drawable * const resetScreen[] = { &resetMessage, resetCountdownWidget.AsDrawable() };
 
 static const char *resetMsg = "Reset to defaults in";
 
+#if CONFIG_DASHBOARD_SAMPLE_INTERVAL
+
+static DashboardWidget dashboardWidget;
+static Drawable * const dashboardScreen[] = { &dashboardWidget };
+static int64_t nextDashboardSampleTimeUS = 0;
+static int64_t lastDashboardSampleTimeUS = 0;
+static uint32_t lastDashboardCommandCount = 0;
+static uint32_t serviceEchoRTTMS = 0;
+static uint32_t eventLoopLatenessMS = 0;
+static uint32_t commandCount = 0;
+
+#endif // CONFIG_DASHBOARD_SAMPLE_INTERVAL
+
 #endif // CONFIG_HAVE_DISPLAY
 
 static Button attentionButton;
@@ -131,6 +170,7 @@ static volatile bool commissionerDetected = false;
 
 #if CONFIG_ENABLE_LIGHTING_DEMO_FEATURE
 
+static ButtonGroup lightSwitchButtons;
 static Button lightSwitchOnButton;
 static Button lightSwitchOffButton;
 static LightController lightController;
@@ -149,6 +189,8 @@ static uint8_t dimStartLevel = 0;
 #endif // CONFIG_ENABLE_LIGHTING_DEMO_FEATURE
 
 static void DeviceEventHandler(const WeaveDeviceEvent * event, intptr_t arg);
+static WEAVE_ERROR StartWeaveEventLoop(void);
+static void DumpDiagnostics(void);
 
 extern "C" void app_main()
 {
@@ -159,6 +201,8 @@ extern "C" void app_main()
                         // ambiguity.  For convenience, ESP_OK and WEAVE_NO_ERROR are mapped
                         // to the same value.
 
+    RecordBootPhase(kBootPhase_AppStart);
+
     // Initialize the ESP NVS layer.
     err = nvs_flash_init();
     if (err != WEAVE_NO_ERROR)
@@ -204,6 +248,13 @@ extern "C" void app_main()
         return;
     }
 
+    RecordBootPhase(kBootPhase_WeaveStackInitialized);
+
+#if CONFIG_TRAIT_BENCHMARK_ITERATIONS
+    // Benchmark the lighting command and trait data paths before the Weave event loop is started.
+    TraitBenchmark::Run(CONFIG_TRAIT_BENCHMARK_ITERATIONS);
+#endif // CONFIG_TRAIT_BENCHMARK_ITERATIONS
+
     // Configure the Weave Connectivity Manager to automatically enable the WiFi AP interface
     // whenever the WiFi station interface has not be configured.
     ConnectivityMgr().SetWiFiAPMode(ConnectivityManager::kWiFiAPMode_OnDemand_NoStationProvision);
@@ -225,13 +276,55 @@ extern "C" void app_main()
 #if CONFIG_SERVICE_ECHO_INTERVAL
     // Start a Weave echo client that will periodically send Weave Echo requests to the Nest service
     // whenever the service tunnel is established.
-    err = ServiceEcho.Init(CONFIG_SERVICE_ECHO_INTERVAL);
+    err = ServiceEcho.Init(CONFIG_SERVICE_ECHO_INTERVAL, CONFIG_SERVICE_ECHO_MAX_INTERVAL);
     if (err != WEAVE_NO_ERROR)
     {
         return;
     }
 #endif // CONFIG_SERVICE_ECHO_INTERVAL
 
+#if CONFIG_DELTA_OTA_PORT
+    // Accept authenticated delta OTA updates from test fixtures.
+    err = StartDeltaOTAServer(CONFIG_DELTA_OTA_PORT, CONFIG_DELTA_OTA_KEY);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "StartDeltaOTAServer() failed: %s", ErrorStr(err));
+        return;
+    }
+#endif // CONFIG_DELTA_OTA_PORT
+
+#if CONFIG_DEVICE_METRICS_PUBLISH_INTERVAL
+    // Publish the device's runtime performance counters via the DeviceMetricsTrait, so that
+    // subscribers (including the service) can collect them.
+    err = DeviceMetrics.Init(CONFIG_DEVICE_METRICS_PUBLISH_INTERVAL);
+    if (err != WEAVE_NO_ERROR)
+    {
+        return;
+    }
+#endif // CONFIG_DEVICE_METRICS_PUBLISH_INTERVAL
+
+#if CONFIG_CONNECTIVITY_TIMELINE_COUNT
+    // Record a timeline of the device's connectivity to the service, from boot and after every
+    // loss of connectivity.
+    err = StartConnectivityTimeline();
+    if (err != WEAVE_NO_ERROR)
+    {
+        return;
+    }
+#endif // CONFIG_CONNECTIVITY_TIMELINE_COUNT
+
+#if !CONFIG_DEFER_EVENT_LOOP_START
+    // Start a task to run the Weave Device event loop.  This is done as early as possible so
+    // that WiFi and service connectivity are established while the rest of the device (buttons,
+    // LEDs, display) is initialized, and while the title animation runs.  From here on, the
+    // Weave stack must be locked before it is accessed from this task.
+    err = StartWeaveEventLoop();
+    if (err != WEAVE_NO_ERROR)
+    {
+        return;
+    }
+#endif // !CONFIG_DEFER_EVENT_LOOP_START
+
     // Initialize the attention button.
     err = attentionButton.Init(ATTENTION_BUTTON_GPIO_NUM, 50);
     if (err != WEAVE_NO_ERROR)
@@ -241,17 +334,29 @@ extern "C" void app_main()
     }
 
     // Initialize the status LED.
-    statusLED.Init(STATUS_LED_GPIO_NUM);
+    err = statusLED.Init(STATUS_LED_GPIO_NUM);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "LEDWidget.Init() failed: %s", ErrorStr(err));
+        return;
+    }
 
 #if CONFIG_ENABLE_LIGHTING_DEMO_FEATURE
 
+    PlatformMgr().LockWeaveStack();
+
     // Determine if we're acting as a lighting controller or switch
     isLightingController = (::nl::Weave::DeviceLayer::FabricState.LocalNodeId == CONFIG_LIGHTING_CONTROLLER_DEVICE_ID);
 
+    // Initialize the light controller or remote light switch object.
+    err = (isLightingController)
+        ? lightController.Init(LIGHT_CONTROLLER_OUTPUT_GPIO_NUM)
+        : lightSwitch.Init(CONFIG_LIGHTING_CONTROLLER_DEVICE_ID);
+
+    PlatformMgr().UnlockWeaveStack();
+
     if (isLightingController)
     {
-        // Initialize the light controller object.
-        err = lightController.Init(LIGHT_CONTROLLER_OUTPUT_GPIO_NUM);
         if (err != WEAVE_NO_ERROR)
         {
             ESP_LOGE(TAG, "LightContoller.Init() failed: %s", nl::ErrorStr(err));
@@ -259,31 +364,55 @@ extern "C" void app_main()
         }
 
         ESP_LOGI(TAG, "Lighting demo feature enabled: Serving as Light Controller");
-    }
 
-    else
-    {
-        // Initialize the remote light switch object.
-        err = lightSwitch.Init(CONFIG_LIGHTING_CONTROLLER_DEVICE_ID);
+#if CONFIG_LIGHTING_DIM_SWEEP_INTERVAL
+        // Continuously sweep the light's level to measure the cost of notifying subscribers.
+        PlatformMgr().LockWeaveStack();
+        err = lightController.StartDimSweep(CONFIG_LIGHTING_DIM_SWEEP_INTERVAL);
+        PlatformMgr().UnlockWeaveStack();
         if (err != WEAVE_NO_ERROR)
         {
-            ESP_LOGE(TAG, "LightSwitch.Init() failed: %s", nl::ErrorStr(err));
             return;
         }
+#endif // CONFIG_LIGHTING_DIM_SWEEP_INTERVAL
 
-        // Initialize the light switch ON button.
-        err = lightSwitchOnButton.Init(LIGHT_SWITCH_ON_BUTTON_GPIO_NUM, 50);
+#if CONFIG_LIGHT_EVENT_LOG_SIZE
+        // Record changes to the state of the light as WDM events, uploaded to the service in batches.
+        PlatformMgr().LockWeaveStack();
+        err = LightEventLog.Init(CONFIG_LIGHT_EVENT_UPLOAD_INTERVAL);
+        PlatformMgr().UnlockWeaveStack();
         if (err != WEAVE_NO_ERROR)
         {
-            ESP_LOGE(TAG, "Button.Init() failed: %s", ErrorStr(err));
             return;
         }
+#endif // CONFIG_LIGHT_EVENT_LOG_SIZE
+    }
 
-        // Initialize the light switch OFF button.
-        err = lightSwitchOffButton.Init(LIGHT_SWITCH_OFF_BUTTON_GPIO_NUM, 50);
+    else
+    {
         if (err != WEAVE_NO_ERROR)
         {
-            ESP_LOGE(TAG, "Button.Init() failed: %s", ErrorStr(err));
+            ESP_LOGE(TAG, "LightSwitch.Init() failed: %s", nl::ErrorStr(err));
+            return;
+        }
+
+        // Initialize the light switch ON and OFF buttons, which are scanned together every 5ms.
+        err = lightSwitchButtons.Init(5);
+        if (err == ESP_OK)
+        {
+            err = lightSwitchButtons.AddButton(lightSwitchOnButton, LIGHT_SWITCH_ON_BUTTON_GPIO_NUM);
+        }
+        if (err == ESP_OK)
+        {
+            err = lightSwitchButtons.AddButton(lightSwitchOffButton, LIGHT_SWITCH_OFF_BUTTON_GPIO_NUM);
+        }
+        if (err == ESP_OK)
+        {
+            err = lightSwitchButtons.Start();
+        }
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "ButtonGroup init failed: %s", ErrorStr(err));
             return;
         }
 
@@ -302,49 +431,63 @@ extern "C" void app_main()
         ESP_LOGE(TAG, "InitDisplay() failed: %s", ErrorStr(err));
         return;
     }
+    err = InitDisplayAssets();
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "InitDisplayAssets() failed: %s", ErrorStr(err));
+    }
+    err = DisplayCompositor.Init();
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "DisplayCompositor.Init() failed: %s", ErrorStr(err));
+        return;
+    }
 
     // Initialize the UI widgets.
     titleWidget.Init("Blue Sky");
     pairingWidget.Init();
     statusIndicator.Init(5);
-    statusIndicator.Char[0] = 'W';
-    statusIndicator.Char[1] = 'I';
-    statusIndicator.Char[2] = 'T';
-    statusIndicator.Char[3] = 'S';
-    statusIndicator.Char[4] = 'A';
+    statusIndicator.SetChar(0, 'W');
+    statusIndicator.SetChar(1, 'I');
+    statusIndicator.SetChar(2, 'T');
+    statusIndicator.SetChar(3, 'S');
+    statusIndicator.SetChar(4, 'A');
     resetCountdownWidget.Init(3);
+    resetMessage.Init(resetMsg);
+    resetMessage.Color = titleWidget.TitleColor;
+#if CONFIG_DASHBOARD_SAMPLE_INTERVAL
+    dashboardWidget.Init();
+#endif // CONFIG_DASHBOARD_SAMPLE_INTERVAL
 
-#endif // CONFIG_HAVE_DISPLAY
+#if CONFIG_DISPLAY_BENCHMARK
+    RunDisplayBenchmark();
+#endif // CONFIG_DISPLAY_BENCHMARK
 
-    ESP_LOGI(TAG, "Ready");
+#endif // CONFIG_HAVE_DISPLAY
 
 #if CONFIG_HAVE_DISPLAY
 
-    // If the device has a display, run the title animation before starting the Weave stack.
+    // If the device has a display, start the title animation.  The animation is driven by
+    // the UI loop below, concurrently with connectivity being established.
+    DisplayCompositor.Lock();
+    DisplayCompositor.SetScene(titleScreen, sizeof(titleScreen) / sizeof(titleScreen[0]));
     titleWidget.Start();
-    while (true)
-    {
-        titleWidget.Animate();
-        if (titleWidget.Done)
-        {
-            break;
-        }
-        vTaskDelay(50 / portTICK_RATE_MS);
-    }
-
-    // Display the status indicators.
-    statusIndicator.Display();
-    displayMode = kDisplayMode_StatusScreen;
+    DisplayCompositor.Unlock();
+    displayMode = kDisplayMode_TitleScreen;
 
 #endif // CONFIG_HAVE_DISPLAY
 
-    // Start a task to run the Weave Device event loop.
-    err = PlatformMgr().StartEventLoopTask();
+    RecordBootPhase(kBootPhase_UIReady);
+
+#if CONFIG_DEFER_EVENT_LOOP_START && !CONFIG_HAVE_DISPLAY
+    err = StartWeaveEventLoop();
     if (err != WEAVE_NO_ERROR)
     {
-        ESP_LOGE(TAG, "PlatformMgr().StartEventLoopTask() failed: %s", ErrorStr(err));
         return;
     }
+#endif // CONFIG_DEFER_EVENT_LOOP_START && !CONFIG_HAVE_DISPLAY
+
+    ESP_LOGI(TAG, "Ready");
 
     // Repeatedly loop to drive the UI...
     while (true)
@@ -366,6 +509,11 @@ extern "C" void app_main()
             isPairedToAccount = ConfigurationMgr().IsPairedToAccount();
             haveServiceConnectivity = ConnectivityMgr().HaveServiceConnectivity();
             isServiceSubscriptionEstablished = TraitMgr().IsServiceSubscriptionEstablished();
+#if CONFIG_HAVE_DISPLAY && CONFIG_DASHBOARD_SAMPLE_INTERVAL
+            serviceEchoRTTMS = (ServiceEcho.ServiceAlive) ? ServiceEcho.LastRTTUS / 1000 : 0;
+            eventLoopLatenessMS = GetLastEventLoopLatenessMS();
+            commandCount = DeviceMetrics.GetCommandsReceived() + DeviceMetrics.GetCommandsSent();
+#endif // CONFIG_HAVE_DISPLAY && CONFIG_DASHBOARD_SAMPLE_INTERVAL
 
             PlatformMgr().UnlockWeaveStack();
         }
@@ -374,6 +522,29 @@ extern "C" void app_main()
         // connectivity and it is able to interact with the service on a regular basis.
         bool isFullyConnected = (haveIPv4Connectivity && haveServiceConnectivity && isServiceSubscriptionEstablished);
 
+        // Record the time at which each connectivity milestone is first reached, and log the
+        // complete boot timeline once the system is fully connected.
+        if (isWiFiStationConnected)
+        {
+            RecordBootPhase(kBootPhase_WiFiStationConnected);
+        }
+        if (haveIPv4Connectivity)
+        {
+            RecordBootPhase(kBootPhase_IPv4Connectivity);
+        }
+        if (haveServiceConnectivity)
+        {
+            RecordBootPhase(kBootPhase_ServiceConnectivity);
+        }
+        if (isServiceSubscriptionEstablished)
+        {
+            RecordBootPhase(kBootPhase_ServiceSubscription);
+        }
+        if (isFullyConnected && RecordBootPhase(kBootPhase_FullyConnected))
+        {
+            LogBootPhases();
+        }
+
         // Update the status LED...
         //
         // If the WiFi station interface is provisioned and enabled, but the system doesn't have
@@ -415,25 +586,42 @@ extern "C" void app_main()
                 statusLED.Set(true);
             }
         }
-        statusLED.Animate();
 
-        // Poll the attention button.  Whenever we detect a *release* of the button
-        // demand start the WiFi AP interface and place the device in "user selected"
-        // mode.
+        // Process events from the attention button.  Whenever we detect a *click* of the
+        // button (a press and release shorter than the long press duration) demand start the
+        // WiFi AP interface and place the device in "user selected" mode.
         //
         // While the device is in user selected mode, it will respond to Device
         // Identify Requests that have the UserSelectedMode flag set.  This makes it
         // easy for other mobile applications or devices to find it.
         //
+        // A long press of the button is reserved for diagnostics, and does not start the AP.
+        // It prints the diagnostic state recorded by the application to the console, and on
+        // devices with a display also toggles the performance dashboard.
+        //
         bool attentionButtonPressDetected = false;
+        bool attentionButtonLongPressDetected = false;
         (void)attentionButtonPressDetected;
-        if (attentionButton.Poll() && !attentionButton.IsPressed())
+        ButtonEvent attentionButtonEvent;
+        while (attentionButton.GetEvent(attentionButtonEvent))
         {
-            PlatformMgr().LockWeaveStack();
-            ConnectivityMgr().DemandStartWiFiAP();
-            ConnectivityMgr().SetUserSelectedMode(true);
-            PlatformMgr().UnlockWeaveStack();
-            attentionButtonPressDetected = true;
+            if (attentionButtonEvent.Type == ButtonEvent::kType_Click)
+            {
+                PlatformMgr().LockWeaveStack();
+                ConnectivityMgr().DemandStartWiFiAP();
+                ConnectivityMgr().SetUserSelectedMode(true);
+                PlatformMgr().UnlockWeaveStack();
+                attentionButtonPressDetected = true;
+            }
+            else if (attentionButtonEvent.Type == ButtonEvent::kType_LongPress)
+            {
+                attentionButtonLongPressDetected = true;
+            }
+        }
+
+        if (attentionButtonLongPressDetected)
+        {
+            DumpDiagnostics();
         }
 
         // If the attention button has been pressed for more that the factory reset
@@ -442,7 +630,13 @@ extern "C" void app_main()
             attentionButton.GetStateDuration() > CONFIG_FACTORY_RESET_BUTTON_DURATION)
         {
 #if CONFIG_HAVE_DISPLAY
-            ClearDisplay();
+            // Clear the display, and wait for the display task to finish doing so before the
+            // device reboots.
+            DisplayCompositor.Lock();
+            DisplayCompositor.SetScene(NULL, 0);
+            DisplayCompositor.Unlock();
+            DisplayCompositor.Flush();
+            DisplayCompositor.WaitForIdle();
 #endif
             PlatformMgr().LockWeaveStack();
             ConfigurationMgr().InitiateFactoryReset();
@@ -537,13 +731,17 @@ extern "C" void app_main()
 
 #if CONFIG_HAVE_DISPLAY
 
+        // Lock the compositor while the display widgets are updated, so that the display task
+        // does not render them mid-change.
+        DisplayCompositor.Lock();
+
         // Update the status indicators.
-        statusIndicator.State[0] = isWiFiStationConnected;
-        statusIndicator.State[1] = haveIPv4Connectivity;
-        statusIndicator.State[2] = haveServiceConnectivity;
-        statusIndicator.State[3] = isServiceSubscriptionEstablished;
-        statusIndicator.State[4] = (haveBLEConnections || isWiFiAPActive);
-        statusIndicator.Char[4] = (haveBLEConnections) ? 'B' : 'A';
+        statusIndicator.SetState(0, isWiFiStationConnected);
+        statusIndicator.SetState(1, haveIPv4Connectivity);
+        statusIndicator.SetState(2, haveServiceConnectivity);
+        statusIndicator.SetState(3, isServiceSubscriptionEstablished);
+        statusIndicator.SetState(4, (haveBLEConnections || isWiFiAPActive));
+        statusIndicator.SetChar(4, (haveBLEConnections) ? 'B' : 'A');
 
         // If NOT currently showing the reset countdown screen, and the attention button
         // has been pressed long enough that the reset time is less than the total
@@ -553,28 +751,46 @@ extern "C" void app_main()
             if (attentionButton.IsPressed() &&
                 attentionButton.GetStateDuration() + resetCountdownWidget.TotalDurationMS() >= CONFIG_FACTORY_RESET_BUTTON_DURATION)
             {
-                ClearDisplay();
-                TFT_setFont(DEJAVU24_FONT, NULL);
-                _fg = titleWidget.TitleColor;
-                _bg = TFT_BLACK;
-                DisplayMessageCentered(resetMsg, 25);
+                DisplayCompositor.SetScene(resetScreen, sizeof(resetScreen) / sizeof(resetScreen[0]));
                 resetCountdownWidget.Start();
                 displayMode = kDisplayMode_ResetCountdown;
             }
         }
 
+        // If currently displaying the title screen and the title animation has
+        // finished, display the status indicators.  Since the title remains on
+        // screen, only the indicators are drawn.
+        if (displayMode == kDisplayMode_TitleScreen)
+        {
+            if (titleWidget.Done)
+            {
+                DisplayCompositor.SetScene(statusScreen, sizeof(statusScreen) / sizeof(statusScreen[0]));
+                displayMode = kDisplayMode_StatusScreen;
+                RecordBootPhase(kBootPhase_TitleAnimationDone);
+            }
+        }
+
         // If currently displaying the status screen and the attention button
         // is pressed while the device is not paired to an account, switch to
         // the pairing screen.
-        if (displayMode == kDisplayMode_StatusScreen)
+        else if (displayMode == kDisplayMode_StatusScreen)
         {
             if (!isPairedToAccount && attentionButtonPressDetected)
             {
-                ClearDisplay();
+                DisplayCompositor.SetScene(pairingScreen, sizeof(pairingScreen) / sizeof(pairingScreen[0]));
                 pairingWidget.Display();
                 commissionerDetected = false;
                 displayMode = kDisplayMode_PairingScreen;
             }
+#if CONFIG_DASHBOARD_SAMPLE_INTERVAL
+            // If the device is paired, a long press of the attention button switches to the
+            // performance dashboard.
+            else if (isPairedToAccount && attentionButtonLongPressDetected)
+            {
+                DisplayCompositor.SetScene(dashboardScreen, sizeof(dashboardScreen) / sizeof(dashboardScreen[0]));
+                displayMode = kDisplayMode_Dashboard;
+            }
+#endif // CONFIG_DASHBOARD_SAMPLE_INTERVAL
         }
 
         // If currently displaying the pairing screen and...
@@ -588,9 +804,8 @@ extern "C" void app_main()
             if (!isWiFiAPActive || isPairedToAccount ||
                 commissionerDetected || attentionButtonPressDetected)
             {
-                ClearDisplay();
+                DisplayCompositor.SetScene(statusScreen, sizeof(statusScreen) / sizeof(statusScreen[0]));
                 titleWidget.Start();
-                statusIndicator.Display();
                 displayMode = kDisplayMode_StatusScreen;
             }
         }
@@ -601,19 +816,52 @@ extern "C" void app_main()
         {
             if (!attentionButton.IsPressed())
             {
-                ClearDisplay();
+                DisplayCompositor.SetScene(statusScreen, sizeof(statusScreen) / sizeof(statusScreen[0]));
                 titleWidget.Start();
-                statusIndicator.Display();
                 displayMode = kDisplayMode_StatusScreen;
             }
         }
 
-        // If displaying the status screen, run the title animation and update
-        // the status indicators.
-        if (displayMode == kDisplayMode_StatusScreen)
+#if CONFIG_DASHBOARD_SAMPLE_INTERVAL
+
+        // If currently displaying the performance dashboard and the attention button
+        // is long pressed again, switch back to the status screen.
+        else if (displayMode == kDisplayMode_Dashboard)
+        {
+            if (attentionButtonLongPressDetected)
+            {
+                DisplayCompositor.SetScene(statusScreen, sizeof(statusScreen) / sizeof(statusScreen[0]));
+                titleWidget.Start();
+                displayMode = kDisplayMode_StatusScreen;
+            }
+        }
+
+        // Periodically record a sample of each dashboard metric, whether or not the dashboard
+        // is displayed, so that its history is available as soon as it is shown.
+        int64_t nowUS = ::esp_timer_get_time();
+        if (nowUS >= nextDashboardSampleTimeUS)
+        {
+            uint16_t values[DashboardWidget::kNumMetrics];
+            uint32_t elapsedMS = (lastDashboardSampleTimeUS != 0) ? (uint32_t)((nowUS - lastDashboardSampleTimeUS) / 1000) : 0;
+            uint32_t commandRate = (elapsedMS != 0) ? ((commandCount - lastDashboardCommandCount) * 60000) / elapsedMS : 0;
+
+            values[DashboardWidget::kMetric_ServiceRTT] = (uint16_t)((serviceEchoRTTMS < UINT16_MAX) ? serviceEchoRTTMS : UINT16_MAX);
+            values[DashboardWidget::kMetric_FreeHeap] = (uint16_t)(heap_caps_get_free_size(MALLOC_CAP_DEFAULT) / 1024);
+            values[DashboardWidget::kMetric_EventLoopLatency] = (uint16_t)((eventLoopLatenessMS < UINT16_MAX) ? eventLoopLatenessMS : UINT16_MAX);
+            values[DashboardWidget::kMetric_CommandRate] = (uint16_t)((commandRate < UINT16_MAX) ? commandRate : UINT16_MAX);
+            dashboardWidget.AddSample(values);
+
+            lastDashboardSampleTimeUS = nowUS;
+            lastDashboardCommandCount = commandCount;
+            nextDashboardSampleTimeUS = nowUS + CONFIG_DASHBOARD_SAMPLE_INTERVAL * 1000LL;
+        }
+
+#endif // CONFIG_DASHBOARD_SAMPLE_INTERVAL
+
+        // If displaying the title or status screen, run the title animation.
+        if (displayMode == kDisplayMode_TitleScreen || displayMode == kDisplayMode_StatusScreen)
         {
             titleWidget.Animate();
-            statusIndicator.Update();
         }
 
         // If displaying the reset countdown screen, update the countdown indicators.
@@ -622,9 +870,33 @@ extern "C" void app_main()
             resetCountdownWidget.Update();
         }
 
+#if CONFIG_DEFER_EVENT_LOOP_START
+        // Start the Weave event loop once the title animation has finished, or once the title
+        // screen has been left for any other reason (e.g. for the reset countdown).
+        bool startEventLoop = (!eventLoopStarted && (titleWidget.Done || displayMode != kDisplayMode_TitleScreen));
+#endif // CONFIG_DEFER_EVENT_LOOP_START
+
+        DisplayCompositor.Unlock();
+
+        // Signal the display task to send any changes to the display.
+        DisplayCompositor.Flush();
+
+#if CONFIG_DEFER_EVENT_LOOP_START
+        if (startEventLoop)
+        {
+            eventLoopStarted = true;
+            err = StartWeaveEventLoop();
+            if (err != WEAVE_NO_ERROR)
+            {
+                return;
+            }
+        }
+#endif // CONFIG_DEFER_EVENT_LOOP_START
+
 #endif // CONFIG_HAVE_DISPLAY
 
-        vTaskDelay(50 / portTICK_RATE_MS);
+        // Wait for the next UI update, waking early if a button is pressed or released.
+        Button::WaitForEvent(50);
     }
 }
 
@@ -634,9 +906,52 @@ extern "C" void app_main()
  */
 void DeviceEventHandler(const WeaveDeviceEvent * event, intptr_t arg)
 {
+    EventLoopActivityScope activityScope(kEventLoopActivity_DeviceEvent);
+
     if (event->Type == DeviceEventType::kSessionEstablished &&
         event->SessionEstablished.IsCommissioner)
     {
         commissionerDetected = true;
     }
 }
+
+/* Start the task that runs the Weave Device event loop.
+ */
+WEAVE_ERROR StartWeaveEventLoop(void)
+{
+    WEAVE_ERROR err;
+
+    err = PlatformMgr().StartEventLoopTask();
+    if (err != WEAVE_NO_ERROR)
+    {
+        ESP_LOGE(TAG, "PlatformMgr().StartEventLoopTask() failed: %s", ErrorStr(err));
+        return err;
+    }
+
+    RecordBootPhase(kBootPhase_EventLoopStarted);
+
+    return WEAVE_NO_ERROR;
+}
+
+/* Print the diagnostic state recorded by the application to the console.
+ */
+void DumpDiagnostics(void)
+{
+    PlatformMgr().LockWeaveStack();
+
+    LogBootPhases();
+    DumpTelemetry();
+    DumpEventLoopLatency();
+#if CONFIG_CONNECTIVITY_TIMELINE_COUNT
+    DumpConnectivityTimeline();
+#endif // CONFIG_CONNECTIVITY_TIMELINE_COUNT
+    DumpNotificationStats();
+#if CONFIG_ENABLE_LIGHTING_DEMO_FEATURE && CONFIG_LIGHT_EVENT_LOG_SIZE
+    if (isLightingController)
+    {
+        LightEventLog.Dump();
+    }
+#endif // CONFIG_ENABLE_LIGHTING_DEMO_FEATURE && CONFIG_LIGHT_EVENT_LOG_SIZE
+
+    PlatformMgr().UnlockWeaveStack();
+}
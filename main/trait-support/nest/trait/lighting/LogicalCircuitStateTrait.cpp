@@ -3,7 +3,7 @@
  *    Copyright (c) 2018 Nest Labs, Inc.
  *    All rights reserved.
  *
- *    THIS FILE IS GENERATED. DO NOT MODIFY.
+ *    THIS FILE IS GENERATED BY tools/mktraits.py. DO NOT MODIFY.
  *
  *    SOURCE TEMPLATE: trait.cpp
  *    SOURCE PROTO: nest/trait/lighting/logical_circuit_state_trait.proto
@@ -24,7 +24,7 @@ using namespace ::nl::Weave::Profiles::DataManagement;
 // Property Table
 //
 
-const TraitSchemaEngine::PropertyInfo PropertyMap[] = {
+constexpr TraitSchemaEngine::PropertyInfo PropertyMap[] = {
     { kPropertyHandle_Root, 1 }, // state
     { kPropertyHandle_Root, 2 }, // brightness
 };
@@ -0,0 +1,69 @@
+/**
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    THIS FILE IS GENERATED BY tools/mktraits.py. DO NOT MODIFY.
+ *
+ *    Schema definitions for the DeviceMetricsTrait, an application-specific trait used by the
+ *    OpenWeave ESP32 demo application to publish runtime performance counters.  The trait is
+ *    defined under the application's own vendor id, as given in main/include/AppProfiles.h.
+ *
+ */
+
+#include <nest/trait/performance/DeviceMetricsTrait.h>
+
+namespace Schema {
+namespace Nest {
+namespace Trait {
+namespace Performance {
+namespace DeviceMetricsTrait {
+
+using namespace ::nl::Weave::Profiles::DataManagement;
+
+//
+// Property Table
+//
+
+constexpr TraitSchemaEngine::PropertyInfo PropertyMap[] = {
+    { kPropertyHandle_Root, 1 }, // uptime_sec
+    { kPropertyHandle_Root, 2 }, // commands_received
+    { kPropertyHandle_Root, 3 }, // commands_sent
+    { kPropertyHandle_Root, 4 }, // echo_rtt_ms
+    { kPropertyHandle_Root, 5 }, // free_heap
+    { kPropertyHandle_Root, 6 }, // min_free_heap
+    { kPropertyHandle_Root, 7 }, // largest_free_block
+    { kPropertyHandle_Root, 8 }, // max_event_loop_lateness_ms
+};
+
+//
+// Schema
+//
+
+const TraitSchemaEngine TraitSchema = {
+    {
+        kWeaveProfileId,
+        PropertyMap,
+        sizeof(PropertyMap) / sizeof(PropertyMap[0]),
+        1,
+#if (TDM_EXTENSION_SUPPORT) || (TDM_VERSIONING_SUPPORT)
+        2,
+#endif
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+#if (TDM_EXTENSION_SUPPORT)
+        NULL,
+#endif
+#if (TDM_VERSIONING_SUPPORT)
+        NULL,
+#endif
+    }
+};
+
+} // namespace DeviceMetricsTrait
+} // namespace Performance
+} // namespace Trait
+} // namespace Nest
+} // namespace Schema
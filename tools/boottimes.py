@@ -0,0 +1,123 @@
+#!/usr/bin/env python
+#
+#    Copyright (c) 2018 Nest Labs, Inc.
+#    All rights reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License");
+#    you may not use this file except in compliance with the License.
+#    You may obtain a copy of the License at
+#
+#        http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS,
+#    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#    See the License for the specific language governing permissions and
+#    limitations under the License.
+#
+#    Description:
+#      Summarizes the boot timelines logged by the OpenWeave ESP32 demo
+#      application over a number of boots, and compares two sets of boots,
+#      such as those of builds with and without the Defer Weave Event Loop
+#      Start config setting.
+#
+#      Each log is a capture of the device's console (e.g. from 'make monitor')
+#      over one or more boots.  The "Boot phases:" timeline logged when the
+#      device first becomes fully connected is read from each boot; repeats of
+#      a timeline, as printed by a long press of the attention button, are
+#      ignored.
+#
+
+from __future__ import print_function
+
+import argparse
+import re
+import sys
+
+PHASE_RE = re.compile(r'^\s*([a-z0-9-]+)\s+(\d+) ms \(\+\d+ ms\)\s*$')
+HEADER_RE = re.compile(r'Boot phases:\s*$')
+LOG_PREFIX_RE = re.compile(r'^(?:\x1b\[[0-9;]*m)?[EWIDV] \(\d+\) [^:]*:')
+RESET_RE = re.compile(r'^ets |^rst:0x')
+
+FULLY_CONNECTED = 'fully-connected'
+
+
+def read_timelines(path):
+    '''Read the boot timelines from a console log, returning a list of dicts mapping phase
+    names to times (ms since boot).'''
+    timelines = []
+    boot = 0
+    current = None
+    with open(path) as f:
+        for line in f:
+            line = line.rstrip('\r\n')
+            if RESET_RE.match(line):
+                boot += 1
+            if HEADER_RE.search(line):
+                current = {}
+                timelines.append((boot, current))
+                continue
+            m = PHASE_RE.match(LOG_PREFIX_RE.sub('', line).replace('\x1b[0m', ''))
+            if current is not None and m:
+                current[m.group(1)] = int(m.group(2))
+            else:
+                current = None
+
+    # Keep only complete timelines, and only the first of each boot.
+    result = {}
+    for boot, timeline in timelines:
+        if FULLY_CONNECTED in timeline and boot not in result:
+            result[boot] = timeline
+    return [result[boot] for boot in sorted(result)]
+
+
+def median(values):
+    values = sorted(values)
+    n = len(values)
+    return values[n // 2] if n % 2 else (values[n // 2 - 1] + values[n // 2]) / 2.0
+
+
+def summarize(timelines):
+    '''Return a list of (phase, count, median, min, max) tuples, in order of median time.'''
+    phases = {}
+    for timeline in timelines:
+        for phase, t in timeline.items():
+            phases.setdefault(phase, []).append(t)
+    summary = [(phase, len(times), median(times), min(times), max(times)) for phase, times in phases.items()]
+    return sorted(summary, key=lambda s: s[2])
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Summarize and compare the boot timelines of the demo application.')
+    parser.add_argument('logs', nargs='+', metavar='LOG', help='Console log covering one or more boots (give two to compare)')
+    args = parser.parse_args()
+
+    if len(args.logs) > 2:
+        parser.error('at most two logs may be compared')
+
+    summaries = []
+    for path in args.logs:
+        timelines = read_timelines(path)
+        if not timelines:
+            print('%s: no complete boot timelines found' % path, file=sys.stderr)
+            return 1
+        summary = summarize(timelines)
+        summaries.append(dict((s[0], s) for s in summary))
+
+        print('%s: %d boots' % (path, len(timelines)))
+        print('  %-24s %8s %8s %8s' % ('phase', 'median', 'min', 'max'))
+        for phase, count, med, lo, hi in summary:
+            print('  %-24s %8.0f %8d %8d%s' % (phase, med, lo, hi, '' if count == len(timelines) else '  (%d boots)' % count))
+        print()
+
+    if len(summaries) == 2:
+        before, after = summaries
+        print('Change in median time (ms), %s -> %s:' % tuple(args.logs))
+        for phase in sorted(set(before) & set(after), key=lambda p: after[p][2]):
+            print('  %-24s %8.0f -> %8.0f  (%+.0f)' % (phase, before[phase][2], after[phase][2], after[phase][2] - before[phase][2]))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
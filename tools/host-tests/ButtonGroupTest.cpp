@@ -0,0 +1,216 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host tests for ButtonGroup: the vertical counter debounce, and the scanning
+ *      of a group of buttons from the GPIO input registers.
+ */
+
+#include <stdlib.h>
+
+#include "HostSim.h"
+#include "HostTest.h"
+#include "Button.h"
+#include "ButtonGroup.h"
+
+namespace {
+
+const uint32_t kScanPeriodMS = 5;
+const int64_t kScanPeriodUS = kScanPeriodMS * 1000;
+
+/* A button's state changes on the kDebounceScans'th consecutive scan that differs from it.
+ */
+void TestDebounceSingleButton(void)
+{
+    uint64_t debounced = 0, count0 = 0, count1 = 0;
+
+    for (int i = 1; i < ButtonGroup::kDebounceScans; i++)
+    {
+        EXPECT_EQ(ButtonGroup::DebounceScan(1, debounced, count0, count1), 0);
+        EXPECT_EQ(debounced, 0);
+    }
+    EXPECT_EQ(ButtonGroup::DebounceScan(1, debounced, count0, count1), 1);
+    EXPECT_EQ(debounced, 1);
+    EXPECT_EQ(count0 | count1, 0);
+
+    // Once changed, the button stays changed while the samples agree with it.
+    EXPECT_EQ(ButtonGroup::DebounceScan(1, debounced, count0, count1), 0);
+    EXPECT_EQ(debounced, 1);
+}
+
+/* A single sample that agrees with the debounced state restarts the count.
+ */
+void TestDebounceBounceRestartsCount(void)
+{
+    uint64_t debounced = 0, count0 = 0, count1 = 0;
+
+    for (int i = 1; i < ButtonGroup::kDebounceScans; i++)
+    {
+        EXPECT_EQ(ButtonGroup::DebounceScan(1, debounced, count0, count1), 0);
+    }
+    EXPECT_EQ(ButtonGroup::DebounceScan(0, debounced, count0, count1), 0);
+    EXPECT_EQ(count0 | count1, 0);
+
+    for (int i = 1; i < ButtonGroup::kDebounceScans; i++)
+    {
+        EXPECT_EQ(ButtonGroup::DebounceScan(1, debounced, count0, count1), 0);
+    }
+    EXPECT_EQ(ButtonGroup::DebounceScan(1, debounced, count0, count1), 1);
+}
+
+/* All 64 lanes are debounced independently, matching a per-button counter.
+ */
+void TestDebounceMatchesScalarModel(void)
+{
+    uint64_t debounced = 0, count0 = 0, count1 = 0;
+    bool modelState[64] = { false };
+    int modelCount[64] = { 0 };
+
+    srand(1);
+
+    for (int scan = 0; scan < 20000; scan++)
+    {
+        uint64_t sample = 0;
+        uint64_t expectedChanges = 0;
+        uint64_t changes;
+
+        // Give each lane a different tendency to bounce, so that all counter values are seen.
+        for (int i = 0; i < 64; i++)
+        {
+            bool level = ((rand() % 64) < i) ? !modelState[i] : modelState[i];
+            sample |= (uint64_t)level << i;
+
+            if (level == modelState[i])
+            {
+                modelCount[i] = 0;
+            }
+            else if (++modelCount[i] == ButtonGroup::kDebounceScans)
+            {
+                modelState[i] = level;
+                modelCount[i] = 0;
+                expectedChanges |= 1ULL << i;
+            }
+        }
+
+        changes = ButtonGroup::DebounceScan(sample, debounced, count0, count1);
+        if (!EXPECT_EQ(changes, expectedChanges))
+        {
+            break;
+        }
+    }
+}
+
+/* A press reported by a scanned group carries the time of the first of the scans that
+ * debounced it, and bounces seen by a scan delay the press.
+ */
+void TestGroupReportsFirstStableScan(void)
+{
+    ButtonGroup group;
+    Button button;
+    ButtonEvent event;
+    int64_t startUS;
+
+    HostSim::Reset();
+    startUS = HostSim::Now();
+
+    EXPECT_EQ(group.Init(kScanPeriodMS), ESP_OK);
+    EXPECT_EQ(group.AddButton(button, GPIO_NUM_39), ESP_OK);
+    EXPECT_EQ(group.Start(), ESP_OK);
+
+    // Press between the second and third scans, bouncing back up across the fourth scan.
+    HostSim::RunUntil(startUS + 12000);
+    HostSim::SetLevel(GPIO_NUM_39, 0);
+    HostSim::RunUntil(startUS + 13000);
+    HostSim::SetLevel(GPIO_NUM_39, 1);
+    HostSim::RunUntil(startUS + 14000);
+    HostSim::SetLevel(GPIO_NUM_39, 0);
+    HostSim::RunUntil(startUS + 19000);
+    HostSim::SetLevel(GPIO_NUM_39, 1);
+    HostSim::RunUntil(startUS + 21000);
+    HostSim::SetLevel(GPIO_NUM_39, 0);
+
+    // The scans at 25, 30, 35 and 40 ms all see the button pressed.
+    HostSim::RunUntil(startUS + 40000 - 1);
+    EXPECT(!button.GetEvent(event));
+    EXPECT_EQ(group.GetPressedMask(), 0);
+
+    HostSim::RunUntil(startUS + 40000);
+    EXPECT(button.GetEvent(event));
+    EXPECT_EQ(event.Type, ButtonEvent::kType_Press);
+    EXPECT_EQ(event.TimeUS, startUS + 25000);
+    EXPECT_EQ(group.GetPressedMask(), 1ULL << GPIO_NUM_39);
+    EXPECT(!button.GetEvent(event));
+
+    // Release cleanly 100 ms after the first stable scan of the press.
+    HostSim::RunUntil(startUS + 122000);
+    HostSim::SetLevel(GPIO_NUM_39, 1);
+    HostSim::RunUntil(startUS + 200000);
+
+    EXPECT(button.GetEvent(event));
+    EXPECT_EQ(event.Type, ButtonEvent::kType_Release);
+    EXPECT_EQ(event.TimeUS, startUS + 125000);
+    EXPECT_EQ(event.DurationUS, 100000);
+    EXPECT(button.GetEvent(event));
+    EXPECT_EQ(event.Type, ButtonEvent::kType_Click);
+    EXPECT(!button.GetEvent(event));
+}
+
+/* Buttons in the low and high GPIO input registers change in the same scan, each reported to
+ * its own button.
+ */
+void TestGroupScansBothRegisters(void)
+{
+    ButtonGroup group;
+    Button lowButton, highButton, idleButton;
+    ButtonEvent event;
+    int64_t startUS;
+
+    HostSim::Reset();
+    startUS = HostSim::Now();
+
+    EXPECT_EQ(group.Init(kScanPeriodMS), ESP_OK);
+    EXPECT_EQ(group.AddButton(lowButton, GPIO_NUM_0), ESP_OK);
+    EXPECT_EQ(group.AddButton(highButton, GPIO_NUM_38), ESP_OK);
+    EXPECT_EQ(group.AddButton(idleButton, GPIO_NUM_37), ESP_OK);
+    EXPECT_EQ(group.AddButton(idleButton, GPIO_NUM_37), ESP_ERR_INVALID_ARG);
+    EXPECT_EQ(group.Start(), ESP_OK);
+
+    HostSim::RunUntil(startUS + 2000);
+    HostSim::SetLevel(GPIO_NUM_0, 0);
+    HostSim::SetLevel(GPIO_NUM_38, 0);
+    HostSim::RunUntil(startUS + 2000 + ButtonGroup::kDebounceScans * kScanPeriodUS);
+
+    EXPECT_EQ(group.GetPressedMask(), (1ULL << GPIO_NUM_0) | (1ULL << GPIO_NUM_38));
+    EXPECT(lowButton.GetEvent(event) && event.Type == ButtonEvent::kType_Press);
+    EXPECT(highButton.GetEvent(event) && event.Type == ButtonEvent::kType_Press);
+    EXPECT(!idleButton.GetEvent(event));
+}
+
+} // unnamed namespace
+
+int main(void)
+{
+    RUN_TEST(TestDebounceSingleButton);
+    RUN_TEST(TestDebounceBounceRestartsCount);
+    RUN_TEST(TestDebounceMatchesScalarModel);
+    RUN_TEST(TestGroupReportsFirstStableScan);
+    RUN_TEST(TestGroupScansBothRegisters);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,310 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host tests for the interrupt-driven Button: debouncing of the edges queued by
+ *      the interrupt handler, and the events derived from them.
+ */
+
+#include "HostSim.h"
+#include "HostTest.h"
+#include "Button.h"
+
+namespace {
+
+const gpio_num_t kButtonGPIO = GPIO_NUM_39;
+const uint16_t kDebouncePeriodMS = 50;
+const int64_t kMS = 1000;
+
+int64_t sStartUS;
+
+/* Initialize the button, and start the test a second later, since edges within the debounce
+ * period of initialization are treated as bounces.
+ */
+void InitButton(Button & button)
+{
+    HostSim::Reset();
+    EXPECT_EQ(button.Init(kButtonGPIO, kDebouncePeriodMS), ESP_OK);
+    sStartUS = HostSim::Now() + 1000 * kMS;
+    HostSim::RunUntil(sStartUS);
+}
+
+/* Set the button's level at the given time after the start of the test.
+ */
+void SetLevelAt(int64_t timeUS, int level)
+{
+    HostSim::RunUntil(sStartUS + timeUS);
+    HostSim::SetLevel(kButtonGPIO, level);
+}
+
+void Press(int64_t timeUS)
+{
+    SetLevelAt(timeUS, 0);
+}
+
+void Release(int64_t timeUS)
+{
+    SetLevelAt(timeUS, 1);
+}
+
+/* Check that the next queued event is of the given type, at the given time after the start of
+ * the test.
+ */
+bool ExpectEvent(Button & button, uint8_t type, int64_t timeUS, uint32_t durationUS = 0)
+{
+    ButtonEvent event;
+
+    return EXPECT(button.GetEvent(event)) &&
+           EXPECT_EQ(event.Type, type) &&
+           EXPECT_EQ(event.TimeUS - sStartUS, timeUS) &&
+           EXPECT_EQ(event.DurationUS, durationUS);
+}
+
+bool ExpectNoEvent(Button & button)
+{
+    ButtonEvent event;
+
+    return EXPECT(!button.GetEvent(event));
+}
+
+void TestClick(void)
+{
+    Button button;
+
+    InitButton(button);
+    Press(10 * kMS);
+    Release(210 * kMS);
+    HostSim::RunUntil(sStartUS + 500 * kMS);
+
+    ExpectEvent(button, ButtonEvent::kType_Press, 10 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Release, 210 * kMS, 200 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Click, 210 * kMS, 200 * kMS);
+    ExpectNoEvent(button);
+}
+
+/* The first edge of a press or release is reported at once; bounces that settle back at the
+ * reported level are ignored.
+ */
+void TestBouncesIgnored(void)
+{
+    Button button;
+
+    InitButton(button);
+    Press(10 * kMS);
+    HostSim::RunUntil(sStartUS + 10 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Press, 10 * kMS);
+
+    Release(11 * kMS);
+    Press(12 * kMS);
+    Release(14 * kMS);
+    Press(15 * kMS);
+    HostSim::RunUntil(sStartUS + 300 * kMS);
+    ExpectNoEvent(button);
+    EXPECT(button.Poll() == false);
+
+    Release(300 * kMS);
+    Press(301 * kMS);
+    Release(303 * kMS);
+    HostSim::RunUntil(sStartUS + 600 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Release, 300 * kMS, 290 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Click, 300 * kMS, 290 * kMS);
+    ExpectNoEvent(button);
+}
+
+/* If the contacts settle at the other level while bouncing, the debounce timer reports the change
+ * with the time the GPIO last moved to that level.
+ */
+void TestSettleAfterBounce(void)
+{
+    Button button;
+
+    InitButton(button);
+    Press(10 * kMS);
+    Release(20 * kMS);
+    Press(25 * kMS);
+    Release(30 * kMS);
+
+    HostSim::RunUntil(sStartUS + 30 * kMS + kDebouncePeriodMS * kMS - 1);
+    ExpectEvent(button, ButtonEvent::kType_Press, 10 * kMS);
+    ExpectNoEvent(button);
+
+    HostSim::RunUntil(sStartUS + 30 * kMS + kDebouncePeriodMS * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Release, 30 * kMS, 20 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Click, 30 * kMS, 20 * kMS);
+    ExpectNoEvent(button);
+}
+
+/* An interrupt that leaves the GPIO at its debounced level generates no events.
+ */
+void TestGlitchIgnored(void)
+{
+    Button button;
+
+    InitButton(button);
+    HostSim::RunUntil(sStartUS + 10 * kMS);
+    HostSim::RaiseInterrupt(kButtonGPIO);
+    HostSim::RunUntil(sStartUS + 500 * kMS);
+    ExpectNoEvent(button);
+    EXPECT(!button.IsPressed());
+}
+
+/* A second click within the double click interval is also a double click; a third is not.
+ */
+void TestDoubleClick(void)
+{
+    Button button;
+
+    InitButton(button);
+    Press(0);
+    Release(100 * kMS);
+    Press(250 * kMS);
+    Release(350 * kMS);
+    Press(500 * kMS);
+    Release(600 * kMS);
+    HostSim::RunUntil(sStartUS + 1000 * kMS);
+
+    ExpectEvent(button, ButtonEvent::kType_Press, 0);
+    ExpectEvent(button, ButtonEvent::kType_Release, 100 * kMS, 100 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Click, 100 * kMS, 100 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Press, 250 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Release, 350 * kMS, 100 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Click, 350 * kMS, 100 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_DoubleClick, 350 * kMS, 100 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Press, 500 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Release, 600 * kMS, 100 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Click, 600 * kMS, 100 * kMS);
+    ExpectNoEvent(button);
+}
+
+/* Clicks further apart than the double click interval are single clicks.
+ */
+void TestSlowClicks(void)
+{
+    Button button;
+
+    InitButton(button);
+    Press(0);
+    Release(100 * kMS);
+    Press(450 * kMS);
+    Release(550 * kMS);
+    HostSim::RunUntil(sStartUS + 1000 * kMS);
+
+    ExpectEvent(button, ButtonEvent::kType_Press, 0);
+    ExpectEvent(button, ButtonEvent::kType_Release, 100 * kMS, 100 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Click, 100 * kMS, 100 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Press, 450 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Release, 550 * kMS, 100 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Click, 550 * kMS, 100 * kMS);
+    ExpectNoEvent(button);
+}
+
+/* A long press is reported the long press duration after the press edge, even when the edge
+ * is processed late, and the release that ends it is not a click.
+ */
+void TestLongPress(void)
+{
+    const int64_t kLatencyUS = 20 * kMS;
+    Button button;
+
+    InitButton(button);
+    HostSim::SetLatency(kLatencyUS);
+    Press(10 * kMS);
+    Release(1510 * kMS);
+    HostSim::RunUntil(sStartUS + 2000 * kMS);
+
+    ExpectEvent(button, ButtonEvent::kType_Press, 10 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_LongPress, 1010 * kMS + kLatencyUS, 1000 * kMS + kLatencyUS);
+    ExpectEvent(button, ButtonEvent::kType_Release, 1510 * kMS, 1500 * kMS);
+    ExpectNoEvent(button);
+}
+
+/* Releasing before the long press duration cancels the long press.
+ */
+void TestLongPressCancelled(void)
+{
+    Button button;
+
+    InitButton(button);
+    Press(10 * kMS);
+    Release(900 * kMS);
+    HostSim::RunUntil(sStartUS + 3000 * kMS);
+
+    ExpectEvent(button, ButtonEvent::kType_Press, 10 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Release, 900 * kMS, 890 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Click, 900 * kMS, 890 * kMS);
+    ExpectNoEvent(button);
+}
+
+/* Edges queued while a call to the edge handler is pending are processed by that call, in order.
+ */
+void TestEdgesQueuedWhilePending(void)
+{
+    Button button;
+
+    InitButton(button);
+    HostSim::SetLatency(5 * kMS);
+    Press(10 * kMS);
+    Release(11 * kMS);
+    Press(12 * kMS);
+    HostSim::RunUntil(sStartUS + 14 * kMS);
+    ExpectNoEvent(button);
+
+    HostSim::RunUntil(sStartUS + 15 * kMS);
+    ExpectEvent(button, ButtonEvent::kType_Press, 10 * kMS);
+    HostSim::RunUntil(sStartUS + 200 * kMS);
+    ExpectNoEvent(button);
+}
+
+/* Poll() consumes events up to the next press or release, and the state methods reflect it.
+ */
+void TestPoll(void)
+{
+    Button button;
+
+    InitButton(button);
+    Press(100 * kMS);
+    Release(300 * kMS);
+    HostSim::RunUntil(sStartUS + 400 * kMS);
+
+    EXPECT(button.Poll());
+    EXPECT(button.IsPressed());
+    EXPECT(button.Poll());
+    EXPECT(!button.IsPressed());
+    EXPECT_EQ(button.GetPrevStateDuration(), 200);
+    EXPECT_EQ(button.GetStateDuration(), 100);
+    EXPECT(!button.Poll());
+}
+
+} // unnamed namespace
+
+int main(void)
+{
+    RUN_TEST(TestClick);
+    RUN_TEST(TestBouncesIgnored);
+    RUN_TEST(TestSettleAfterBounce);
+    RUN_TEST(TestGlitchIgnored);
+    RUN_TEST(TestDoubleClick);
+    RUN_TEST(TestSlowClicks);
+    RUN_TEST(TestLongPress);
+    RUN_TEST(TestLongPressCancelled);
+    RUN_TEST(TestEdgesQueuedWhilePending);
+    RUN_TEST(TestPoll);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,269 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host tests for the merging of dirty regions by Compositor, and for the windowed
+ *      transfers in which it sends them to the display.
+ */
+
+#include "HostSim.h"
+#include "HostDisplay.h"
+#include "HostTest.h"
+#include "Compositor.h"
+
+namespace {
+
+enum
+{
+    kWindowSetupBytes = 11,         // Per-transfer overhead counted by the compositor
+    kStripLines = Compositor::kStripBufPixels / HostDisplay::kWidth,
+};
+
+const color_t kFillColor = { 4, 172, 200 };
+
+/* A drawable that fills its bounds with a single color.
+ */
+class FillDrawable : public Drawable
+{
+public:
+    DisplayRect Bounds;
+
+    virtual DisplayRect GetBounds() const { return Bounds; }
+    virtual void Render(Canvas & canvas) { canvas.FillRect(Bounds.X, Bounds.Y, Bounds.Width, Bounds.Height, kFillColor); }
+};
+
+FillDrawable sBackground;
+
+/* Start the display and compositor, and draw a full-screen scene, leaving the transfer log empty.
+ */
+void InitCompositor(void)
+{
+    DisplayRect fullRect = { 0, 0, HostDisplay::kWidth, HostDisplay::kHeight };
+    Drawable * scene[] = { &sBackground };
+
+    HostSim::Reset();
+    HostDisplay::Reset();
+    EXPECT_EQ(InitDisplay(), ESP_OK);
+    EXPECT_EQ(DisplayCompositor.Init(), ESP_OK);
+
+    sBackground.Bounds = fullRect;
+    DisplayCompositor.Lock();
+    DisplayCompositor.SetScene(scene, 1);
+    DisplayCompositor.Unlock();
+    DisplayCompositor.WaitForIdle();
+
+    HostDisplay::ClearTransfers();
+}
+
+void Invalidate(int16_t x, int16_t y, uint16_t width, uint16_t height)
+{
+    DisplayRect rect = { x, y, width, height };
+
+    DisplayCompositor.Lock();
+    DisplayCompositor.Invalidate(rect);
+    DisplayCompositor.Unlock();
+}
+
+bool ExpectTransfer(size_t index, int x, int y, int width, int height)
+{
+    const std::vector<HostDisplay::Transfer> & transfers = HostDisplay::GetTransfers();
+
+    return EXPECT(index < transfers.size()) &&
+           EXPECT_EQ(transfers[index].X1, x) &&
+           EXPECT_EQ(transfers[index].Y1, y) &&
+           EXPECT_EQ(transfers[index].X2, x + width - 1) &&
+           EXPECT_EQ(transfers[index].Y2, y + height - 1) &&
+           EXPECT_EQ(transfers[index].Pixels, width * height);
+}
+
+/* The byte and transfer counts kept by the compositor match what was sent to the display.
+ */
+void ExpectCounts(uint32_t bytesBefore, uint32_t transfersBefore)
+{
+    const std::vector<HostDisplay::Transfer> & transfers = HostDisplay::GetTransfers();
+    uint32_t bytes = 0;
+
+    for (size_t i = 0; i < transfers.size(); i++)
+    {
+        bytes += transfers[i].Pixels * sizeof(color_t) + kWindowSetupBytes;
+    }
+
+    EXPECT_EQ(DisplayCompositor.Transfers - transfersBefore, transfers.size());
+    EXPECT_EQ(DisplayCompositor.BytesTransferred - bytesBefore, bytes);
+}
+
+/* The first scene clears the whole display, in strips that each fit in one transfer.
+ */
+void TestFirstSceneClearsDisplay(void)
+{
+    const std::vector<HostDisplay::Transfer> & transfers = HostDisplay::GetTransfers();
+    DisplayRect fullRect = { 0, 0, HostDisplay::kWidth, HostDisplay::kHeight };
+    Drawable * scene[] = { &sBackground };
+
+    HostSim::Reset();
+    HostDisplay::Reset();
+    EXPECT_EQ(InitDisplay(), ESP_OK);
+    EXPECT_EQ(DisplayCompositor.Init(), ESP_OK);
+
+    sBackground.Bounds = fullRect;
+    DisplayCompositor.Lock();
+    DisplayCompositor.SetScene(scene, 1);
+    DisplayCompositor.Unlock();
+    DisplayCompositor.WaitForIdle();
+
+    // 240 lines in strips of 6 lines (2048 pixels of 320 each).
+    EXPECT_EQ(transfers.size(), (HostDisplay::kHeight + kStripLines - 1) / kStripLines);
+    for (size_t i = 0; i < transfers.size(); i++)
+    {
+        ExpectTransfer(i, 0, (int)i * kStripLines, HostDisplay::kWidth, kStripLines);
+    }
+    EXPECT_EQ(DisplayCompositor.Transfers, transfers.size());
+    EXPECT_EQ(DisplayCompositor.BytesTransferred,
+              HostDisplay::kWidth * HostDisplay::kHeight * sizeof(color_t) + transfers.size() * kWindowSetupBytes);
+
+    color_t pixel = HostDisplay::GetPixel(HostDisplay::kWidth - 1, HostDisplay::kHeight - 1);
+    EXPECT(pixel.r == kFillColor.r && pixel.g == kFillColor.g && pixel.b == kFillColor.b);
+}
+
+/* Overlapping regions are drawn as one.
+ */
+void TestOverlappingRectsMerge(void)
+{
+    InitCompositor();
+    uint32_t bytesBefore = DisplayCompositor.BytesTransferred, transfersBefore = DisplayCompositor.Transfers;
+
+    Invalidate(10, 10, 20, 20);
+    Invalidate(20, 20, 20, 20);
+    DisplayCompositor.WaitForIdle();
+
+    EXPECT_EQ(HostDisplay::GetTransfers().size(), 1);
+    ExpectTransfer(0, 10, 10, 30, 30);
+    ExpectCounts(bytesBefore, transfersBefore);
+}
+
+/* Disjoint regions are merged if redrawing the pixels between them costs no more than 32 pixels,
+ * and drawn separately otherwise.
+ */
+void TestMergeSlack(void)
+{
+    InitCompositor();
+    uint32_t bytesBefore = DisplayCompositor.BytesTransferred, transfersBefore = DisplayCompositor.Transfers;
+
+    // Two rows of 16 pixels with two rows between them: exactly 32 extra pixels.
+    Invalidate(0, 0, 16, 1);
+    Invalidate(0, 3, 16, 1);
+
+    // Two rows of 16 pixels with three rows between them: 48 extra pixels.
+    Invalidate(100, 0, 16, 1);
+    Invalidate(100, 4, 16, 1);
+
+    DisplayCompositor.WaitForIdle();
+
+    // Dirty rects are drawn most recent first.
+    EXPECT_EQ(HostDisplay::GetTransfers().size(), 3);
+    ExpectTransfer(0, 100, 4, 16, 1);
+    ExpectTransfer(1, 100, 0, 16, 1);
+    ExpectTransfer(2, 0, 0, 16, 4);
+    ExpectCounts(bytesBefore, transfersBefore);
+}
+
+/* Once 32 regions are dirty, a further region is merged with the one that grows least.
+ */
+void TestDirtyRectCap(void)
+{
+    InitCompositor();
+    uint32_t bytesBefore = DisplayCompositor.BytesTransferred, transfersBefore = DisplayCompositor.Transfers;
+    uint32_t pixels = 0;
+
+    // 32 single pixels, 40 pixels apart, too far apart to merge.
+    for (int i = 0; i < Compositor::kMaxDirtyRects; i++)
+    {
+        Invalidate((int16_t)((i % 8) * 40), (int16_t)((i / 8) * 40), 1, 1);
+    }
+
+    // 40 rows below the last pixel, so not merged on cost, but closest to it.
+    Invalidate(280, 160, 1, 1);
+
+    DisplayCompositor.WaitForIdle();
+
+    const std::vector<HostDisplay::Transfer> & transfers = HostDisplay::GetTransfers();
+    bool foundMerged = false;
+
+    EXPECT_EQ(transfers.size(), Compositor::kMaxDirtyRects);
+    for (size_t i = 0; i < transfers.size(); i++)
+    {
+        pixels += transfers[i].Pixels;
+        if (transfers[i].X1 == 280 && transfers[i].Y1 == 120)
+        {
+            foundMerged = ExpectTransfer(i, 280, 120, 1, 41);
+        }
+    }
+    EXPECT(foundMerged);
+    EXPECT_EQ(pixels, (Compositor::kMaxDirtyRects - 1) + 41);
+    ExpectCounts(bytesBefore, transfersBefore);
+}
+
+/* A region taller than a strip is sent in strips of as many whole lines as fit in the strip
+ * buffer, and the drawables are rendered into each.
+ */
+void TestStrips(void)
+{
+    InitCompositor();
+    uint32_t bytesBefore = DisplayCompositor.BytesTransferred, transfersBefore = DisplayCompositor.Transfers;
+
+    // 100 pixel wide strips hold 20 lines; 45 lines take 3 strips.
+    Invalidate(50, 100, 100, 45);
+    DisplayCompositor.WaitForIdle();
+
+    EXPECT_EQ(HostDisplay::GetTransfers().size(), 3);
+    ExpectTransfer(0, 50, 100, 100, 20);
+    ExpectTransfer(1, 50, 120, 100, 20);
+    ExpectTransfer(2, 50, 140, 100, 5);
+    ExpectCounts(bytesBefore, transfersBefore);
+    EXPECT_EQ(DisplayCompositor.BytesTransferred - bytesBefore, 100 * 45 * sizeof(color_t) + 3 * kWindowSetupBytes);
+}
+
+/* Nothing is sent if nothing is dirty, and WaitForIdle() returns at once.
+ */
+void TestIdle(void)
+{
+    InitCompositor();
+    uint32_t transfersBefore = DisplayCompositor.Transfers;
+
+    DisplayCompositor.WaitForIdle();
+    DisplayCompositor.Flush();
+    HostSim::RunTasks();
+
+    EXPECT_EQ(HostDisplay::GetTransfers().size(), 0);
+    EXPECT_EQ(DisplayCompositor.Transfers, transfersBefore);
+}
+
+} // unnamed namespace
+
+int main(void)
+{
+    RUN_TEST(TestFirstSceneClearsDisplay);
+    RUN_TEST(TestOverlappingRectsMerge);
+    RUN_TEST(TestMergeSlack);
+    RUN_TEST(TestDirtyRectCap);
+    RUN_TEST(TestStrips);
+    RUN_TEST(TestIdle);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,284 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host test for DeltaPatcher, applying a delta generated by tools/mkdelta.py
+ *      between two real images.
+ *
+ *      Usage: DeltaPatchTest <old-image> <new-image> <delta>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include <vector>
+
+#include "HostTest.h"
+#include "DeltaPatch.h"
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+struct PatchContext
+{
+    const Bytes * Old;
+    Bytes New;
+    bool FailRead;
+    bool FailWrite;
+};
+
+Bytes sOld;
+Bytes sNew;
+Bytes sRecords;
+DeltaPatchHeader sHeader;
+
+bool ReadFile(const char * path, Bytes & data)
+{
+    FILE * file = fopen(path, "rb");
+    uint8_t buf[4096];
+    size_t n;
+
+    if (file == NULL)
+    {
+        printf("Cannot open %s\n", path);
+        return false;
+    }
+    data.clear();
+    while ((n = fread(buf, 1, sizeof(buf), file)) > 0)
+    {
+        data.insert(data.end(), buf, buf + n);
+    }
+    fclose(file);
+    return true;
+}
+
+/* Decompress the records following the header of a delta, as DeltaOTAUpdater does on the device.
+ */
+bool DecodeDelta(const Bytes & delta)
+{
+    z_stream stream;
+    uint8_t buf[4096];
+    int status;
+
+    if (!EXPECT(delta.size() > sizeof(sHeader)))
+    {
+        return false;
+    }
+    memcpy(&sHeader, &delta[0], sizeof(sHeader));
+    if (!EXPECT_EQ(sHeader.Magic, DeltaPatchHeader::kMagic) || !EXPECT_EQ(sHeader.Version, DeltaPatchHeader::kVersion) ||
+        !EXPECT_EQ(sHeader.OldSize, sOld.size()) || !EXPECT_EQ(sHeader.NewSize, sNew.size()))
+    {
+        return false;
+    }
+
+    memset(&stream, 0, sizeof(stream));
+    if (!EXPECT_EQ(inflateInit2(&stream, -sHeader.WindowBits), Z_OK))
+    {
+        return false;
+    }
+    stream.next_in = (Bytef *)&delta[sizeof(sHeader)];
+    stream.avail_in = (uInt)(delta.size() - sizeof(sHeader));
+    sRecords.clear();
+    do
+    {
+        stream.next_out = buf;
+        stream.avail_out = sizeof(buf);
+        status = inflate(&stream, Z_NO_FLUSH);
+        sRecords.insert(sRecords.end(), buf, buf + (sizeof(buf) - stream.avail_out));
+    } while (status == Z_OK);
+    inflateEnd(&stream);
+
+    return EXPECT_EQ(status, Z_STREAM_END) && EXPECT_EQ(stream.avail_in, 0);
+}
+
+bool ReadOld(void * context, uint32_t offset, uint8_t * buf, uint32_t len)
+{
+    PatchContext * ctx = (PatchContext *)context;
+
+    if (ctx->FailRead || !EXPECT((uint64_t)offset + len <= ctx->Old->size()))
+    {
+        return false;
+    }
+    memcpy(buf, &(*ctx->Old)[offset], len);
+    return true;
+}
+
+bool WriteNew(void * context, const uint8_t * buf, uint32_t len)
+{
+    PatchContext * ctx = (PatchContext *)context;
+
+    if (ctx->FailWrite || !EXPECT(len > 0 && len <= DeltaPatcher::kBlockSize))
+    {
+        return false;
+    }
+    ctx->New.insert(ctx->New.end(), buf, buf + len);
+    return true;
+}
+
+/* Apply the given records to the old image, in pieces of the given size (or of random sizes up to
+ * the given size, if random is set), returning the status of the first failure or of Finish().
+ */
+int ApplyRecords(const Bytes & records, size_t pieceSize, bool random, PatchContext & ctx)
+{
+    DeltaPatcher patcher;
+    size_t pos = 0;
+    int status = DeltaPatcher::kStatus_OK;
+
+    ctx.Old = &sOld;
+    ctx.New.clear();
+    patcher.Init((uint32_t)sOld.size(), (uint32_t)sNew.size(), ReadOld, WriteNew, &ctx);
+
+    while (pos < records.size() && status == DeltaPatcher::kStatus_OK)
+    {
+        size_t n = (random) ? 1 + (size_t)rand() % pieceSize : pieceSize;
+        if (n > records.size() - pos)
+        {
+            n = records.size() - pos;
+        }
+        status = patcher.Apply(&records[pos], (uint32_t)n);
+        pos += n;
+        if (status == DeltaPatcher::kStatus_OK)
+        {
+            EXPECT(patcher.GetNewImageOffset() <= sNew.size());
+        }
+    }
+
+    if (status == DeltaPatcher::kStatus_OK)
+    {
+        status = patcher.Finish();
+    }
+
+    return status;
+}
+
+/* The new image is reproduced exactly however the records are divided.
+ */
+void TestApply(void)
+{
+    static const size_t kPieceSizes[] = { 1, 13, DeltaPatcher::kBlockSize - 1, DeltaPatcher::kBlockSize, 4096 };
+    PatchContext ctx = { NULL, Bytes(), false, false };
+
+    for (size_t i = 0; i < sizeof(kPieceSizes) / sizeof(kPieceSizes[0]); i++)
+    {
+        if (!EXPECT_EQ(ApplyRecords(sRecords, kPieceSizes[i], false, ctx), DeltaPatcher::kStatus_OK) ||
+            !EXPECT(ctx.New == sNew))
+        {
+            printf("  (pieces of %u bytes)\n", (unsigned)kPieceSizes[i]);
+        }
+    }
+
+    srand(1);
+    for (int i = 0; i < 4; i++)
+    {
+        if (!EXPECT_EQ(ApplyRecords(sRecords, 5000, true, ctx), DeltaPatcher::kStatus_OK) || !EXPECT(ctx.New == sNew))
+        {
+            printf("  (random pieces, pass %d)\n", i);
+        }
+    }
+
+    EXPECT_EQ(ApplyRecords(sRecords, sRecords.size(), false, ctx), DeltaPatcher::kStatus_OK);
+    EXPECT(ctx.New == sNew);
+}
+
+/* Truncated records, or data following the last record, are rejected.
+ */
+void TestTruncatedOrExtended(void)
+{
+    PatchContext ctx = { NULL, Bytes(), false, false };
+    Bytes records;
+
+    records.assign(sRecords.begin(), sRecords.end() - 1);
+    EXPECT_EQ(ApplyRecords(records, 4096, false, ctx), DeltaPatcher::kStatus_InvalidPatch);
+
+    records.assign(sRecords.begin(), sRecords.begin() + 6);
+    EXPECT_EQ(ApplyRecords(records, 4096, false, ctx), DeltaPatcher::kStatus_InvalidPatch);
+
+    records = sRecords;
+    records.push_back(0);
+    EXPECT_EQ(ApplyRecords(records, 4096, false, ctx), DeltaPatcher::kStatus_InvalidPatch);
+}
+
+/* A record reaching beyond the end of either image is rejected without reading outside the old
+ * image.
+ */
+void TestRecordOutOfBounds(void)
+{
+    PatchContext ctx = { NULL, Bytes(), false, false };
+    Bytes records = sRecords;
+
+    // Make the diff length of the first record exceed the size of the new image.
+    records[0] = records[1] = records[2] = 0xFF;
+    records[3] = 0x7F;
+    EXPECT_EQ(ApplyRecords(records, 4096, false, ctx), DeltaPatcher::kStatus_InvalidPatch);
+
+    // Make the first record seek before the start of the old image, and give the next a diff.
+    records = sRecords;
+    memset(&records[0], 0, 12);
+    records[8] = records[9] = records[10] = records[11] = 0xFF;
+    records.insert(records.begin() + 12, records.begin(), records.begin() + 12);
+    records[12] = 1;
+    records[20] = records[21] = records[22] = records[23] = 0;
+    EXPECT_EQ(ApplyRecords(records, 4096, false, ctx), DeltaPatcher::kStatus_InvalidPatch);
+}
+
+/* Failures to read the old image or write the new one are reported as such.
+ */
+void TestCallbackFailures(void)
+{
+    PatchContext ctx = { NULL, Bytes(), true, false };
+
+    EXPECT_EQ(ApplyRecords(sRecords, 4096, false, ctx), DeltaPatcher::kStatus_ReadError);
+
+    ctx.FailRead = false;
+    ctx.FailWrite = true;
+    EXPECT_EQ(ApplyRecords(sRecords, 4096, false, ctx), DeltaPatcher::kStatus_WriteError);
+}
+
+} // unnamed namespace
+
+int main(int argc, char * argv[])
+{
+    Bytes delta;
+
+    if (argc != 4)
+    {
+        printf("Usage: %s <old-image> <new-image> <delta>\n", argv[0]);
+        return 2;
+    }
+    if (!ReadFile(argv[1], sOld) || !ReadFile(argv[2], sNew) || !ReadFile(argv[3], delta))
+    {
+        return 2;
+    }
+
+    printf("%s (%u bytes) -> %s (%u bytes): %u byte delta\n", argv[1], (unsigned)sOld.size(), argv[2], (unsigned)sNew.size(),
+           (unsigned)delta.size());
+
+    if (!DecodeDelta(delta))
+    {
+        return 1;
+    }
+
+    RUN_TEST(TestApply);
+    RUN_TEST(TestTruncatedOrExtended);
+    RUN_TEST(TestRecordOutOfBounds);
+    RUN_TEST(TestCallbackFailures);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,155 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host tests for the calibration of the display's SPI write clock in InitDisplay(),
+ *      against a simulated display that corrupts pixel writes above a set clock.
+ */
+
+#include "HostSim.h"
+#include "HostDisplay.h"
+#include "HostTest.h"
+#include "nvs.h"
+#include "Display.h"
+
+namespace {
+
+const uint32_t kClocks[] = { 40000000, 26666667, 20000000, 16000000, 13333333, 10000000 };
+
+/* Start the display, with writes reliable up to the given clock, without clearing NVS.
+ */
+void BootDisplay(uint32_t maxWriteClock)
+{
+    HostDisplay::Reset();
+    HostDisplay::SetMaxWriteClock(maxWriteClock);
+    EXPECT_EQ(InitDisplay(), ESP_OK);
+}
+
+uint32_t GetStoredClock(const char * key)
+{
+    nvs_handle handle;
+    uint32_t clock = 0;
+
+    EXPECT_EQ(nvs_open("display", NVS_READONLY, &handle), ESP_OK);
+    EXPECT_EQ(nvs_get_u32(handle, key, &clock), ESP_OK);
+    nvs_close(handle);
+
+    return clock;
+}
+
+/* Expect the clocks tried, in order, ending with the clock finally set.
+ */
+void ExpectClockChanges(const uint32_t * clocks, size_t count)
+{
+    const std::vector<uint32_t> & changes = HostDisplay::GetClockChanges();
+
+    if (EXPECT_EQ(changes.size(), count))
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            EXPECT_EQ(changes[i], clocks[i]);
+        }
+    }
+}
+
+/* The clock chosen is one step slower than the fastest that passes, and is tested again.
+ */
+void TestStepsBackOneCandidate(void)
+{
+    const uint32_t kExpectedChanges[] = { kClocks[0], kClocks[1], kClocks[2], kClocks[2] };
+
+    HostSim::Reset();
+    BootDisplay(kClocks[1]);
+
+    ExpectClockChanges(kExpectedChanges, sizeof(kExpectedChanges) / sizeof(kExpectedChanges[0]));
+    EXPECT_EQ(HostDisplay::GetReadClockProbes(), 1);
+    EXPECT_EQ(max_rdclock, HostDisplay::kReadClock);
+    EXPECT_EQ(GetStoredClock("wr-clock"), kClocks[2]);
+    EXPECT_EQ(GetStoredClock("rd-clock"), HostDisplay::kReadClock);
+}
+
+/* If only the slowest candidate passes, it is used.
+ */
+void TestSlowestCandidate(void)
+{
+    const uint32_t kExpectedChanges[] = { kClocks[0], kClocks[1], kClocks[2], kClocks[3], kClocks[4], kClocks[5],
+                                          kClocks[5], kClocks[5] };
+
+    HostSim::Reset();
+    BootDisplay(kClocks[5]);
+
+    ExpectClockChanges(kExpectedChanges, sizeof(kExpectedChanges) / sizeof(kExpectedChanges[0]));
+    EXPECT_EQ(GetStoredClock("wr-clock"), kClocks[5]);
+}
+
+/* If no candidate passes, the library's default clock is used.
+ */
+void TestNoCandidatePasses(void)
+{
+    HostSim::Reset();
+    BootDisplay(kClocks[5] - 1);
+
+    EXPECT_EQ(HostDisplay::GetClockChanges().back(), DEFAULT_SPI_CLOCK);
+    EXPECT_EQ(GetStoredClock("wr-clock"), DEFAULT_SPI_CLOCK);
+}
+
+/* On later boots the stored clocks are verified and reused, without probing.
+ */
+void TestReusesStoredClock(void)
+{
+    const uint32_t kExpectedChanges[] = { kClocks[2], kClocks[2] };
+
+    HostSim::Reset();
+    BootDisplay(kClocks[1]);
+    BootDisplay(kClocks[1]);
+
+    ExpectClockChanges(kExpectedChanges, sizeof(kExpectedChanges) / sizeof(kExpectedChanges[0]));
+    EXPECT_EQ(HostDisplay::GetReadClockProbes(), 0);
+    EXPECT_EQ(max_rdclock, HostDisplay::kReadClock);
+    EXPECT_EQ(GetStoredClock("wr-clock"), kClocks[2]);
+}
+
+/* If the stored write clock no longer passes, the clocks are calibrated and stored again.
+ */
+void TestRecalibratesWhenStoredClockFails(void)
+{
+    const uint32_t kExpectedChanges[] = { kClocks[2], kClocks[0], kClocks[1], kClocks[2], kClocks[3], kClocks[4],
+                                          kClocks[4] };
+
+    HostSim::Reset();
+    BootDisplay(kClocks[1]);
+    BootDisplay(kClocks[3]);
+
+    ExpectClockChanges(kExpectedChanges, sizeof(kExpectedChanges) / sizeof(kExpectedChanges[0]));
+    EXPECT_EQ(HostDisplay::GetReadClockProbes(), 1);
+    EXPECT_EQ(GetStoredClock("wr-clock"), kClocks[4]);
+}
+
+} // unnamed namespace
+
+int main(void)
+{
+    RUN_TEST(TestStepsBackOneCandidate);
+    RUN_TEST(TestSlowestCandidate);
+    RUN_TEST(TestNoCandidatePasses);
+    RUN_TEST(TestReusesStoredClock);
+    RUN_TEST(TestRecalibratesWhenStoredClockFails);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,76 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host tests for the log2 histograms kept by the application's diagnostics.
+ */
+
+#include <string.h>
+
+#include "HostTest.h"
+#include "Histogram.h"
+
+namespace {
+
+/* Each bucket counts the values from the limit of the bucket before it up to, but not
+ * including, its own limit.
+ */
+void TestBucketBoundaries(void)
+{
+    uint32_t histogram[4];
+
+    memset(histogram, 0, sizeof(histogram));
+    AddToLog2Histogram(histogram, 0, 64);
+    AddToLog2Histogram(histogram, 63, 64);
+    AddToLog2Histogram(histogram, 64, 64);
+    AddToLog2Histogram(histogram, 127, 64);
+    AddToLog2Histogram(histogram, 128, 64);
+    AddToLog2Histogram(histogram, 255, 64);
+
+    EXPECT_EQ(histogram[0], 2u);
+    EXPECT_EQ(histogram[1], 2u);
+    EXPECT_EQ(histogram[2], 2u);
+    EXPECT_EQ(histogram[3], 0u);
+    EXPECT_EQ(Log2HistogramBucketLimit(64, 2), 256u);
+}
+
+/* Values beyond the second-to-last bucket, however large, land in the last bucket.
+ */
+void TestOverflowBucket(void)
+{
+    uint32_t histogram[12];
+
+    memset(histogram, 0, sizeof(histogram));
+    AddToLog2Histogram(histogram, 1023, 1);
+    AddToLog2Histogram(histogram, 1024, 1);
+    AddToLog2Histogram(histogram, UINT32_MAX, 1);
+
+    EXPECT_EQ(histogram[10], 1u);
+    EXPECT_EQ(histogram[11], 2u);
+}
+
+} // unnamed namespace
+
+int main(void)
+{
+    RUN_TEST(TestBucketBoundaries);
+    RUN_TEST(TestOverflowBucket);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,156 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host driver for the trait benchmark (main/TraitBenchmark.cpp).  Times the benchmarks on
+ *      the host's clock, and counts their allocations with a stand-in for the ESP-IDF heap
+ *      tracer (stub/esp_heap_trace.h) that traces calls to operator new.
+ */
+
+#include <stdlib.h>
+#include <new>
+
+#include "esp_heap_trace.h"
+
+#include "HostSim.h"
+#include "HostWeave.h"
+#include "AliveTimer.h"
+#include "TraitBenchmark.h"
+
+void BeginEventLoopActivity(EventLoopActivity activity)
+{
+}
+
+void EndEventLoopActivity(void)
+{
+}
+
+bool GetLatestTelemetrySample(TelemetrySample & sample)
+{
+    return false;
+}
+
+uint32_t GetMaxEventLoopLatenessMS(void)
+{
+    return 0;
+}
+
+namespace {
+
+heap_trace_record_t * sTraceRecords;
+size_t sNumTraceRecords;
+size_t sTraceCount;
+bool sTracing;
+
+void * TraceAllocation(size_t size)
+{
+    void * p = malloc((size != 0) ? size : 1);
+
+    if (p == NULL)
+    {
+        throw std::bad_alloc();
+    }
+
+    // As in standalone mode, allocations made once the record buffer is full are not recorded.
+    if (sTracing && sTraceCount < sNumTraceRecords)
+    {
+        sTraceRecords[sTraceCount].address = p;
+        sTraceRecords[sTraceCount].size = size;
+        sTraceCount++;
+    }
+
+    return p;
+}
+
+} // unnamed namespace
+
+void * operator new(size_t size)
+{
+    return TraceAllocation(size);
+}
+
+void * operator new[](size_t size)
+{
+    return TraceAllocation(size);
+}
+
+void operator delete(void * p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void * p) noexcept
+{
+    free(p);
+}
+
+esp_err_t heap_trace_init_standalone(heap_trace_record_t * record_buffer, size_t num_records)
+{
+    if (sTracing)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    sTraceRecords = record_buffer;
+    sNumTraceRecords = num_records;
+    sTraceCount = 0;
+
+    return ESP_OK;
+}
+
+esp_err_t heap_trace_start(heap_trace_mode_t mode)
+{
+    if (sTraceRecords == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    sTraceCount = 0;
+    sTracing = true;
+
+    return ESP_OK;
+}
+
+esp_err_t heap_trace_stop(void)
+{
+    if (!sTracing)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    sTracing = false;
+
+    return ESP_OK;
+}
+
+size_t heap_trace_get_count(void)
+{
+    return sTraceCount;
+}
+
+int main(void)
+{
+    HostSim::Reset();
+    HostWeave::Reset();
+    HostSim::UseHostClock();
+
+    TraitBenchmark::Run(CONFIG_TRAIT_BENCHMARK_ITERATIONS);
+
+    return 0;
+}
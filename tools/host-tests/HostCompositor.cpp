@@ -0,0 +1,254 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Implementation of the compositor stand-in used by the host tests of individual widgets.
+ */
+
+#include <string.h>
+
+#include "HostCompositor.h"
+
+Compositor DisplayCompositor;
+
+namespace {
+
+std::vector<DisplayRect> sInvalidations;
+std::vector<DisplayRect> sPendingRects;
+std::vector<HostCompositor::DrawCall> sDrawCalls;
+uint32_t sGlyphLookups;
+uint8_t sGlyphBitmaps[256][8];
+
+void LogDrawCall(HostCompositor::DrawOp op, const DisplayRect & clip, int16_t x, int16_t y, uint16_t width, uint16_t height,
+                 color_t color)
+{
+    HostCompositor::DrawCall call;
+
+    call.Op = op;
+    call.Clip = clip;
+    call.Rect.X = x;
+    call.Rect.Y = y;
+    call.Rect.Width = width;
+    call.Rect.Height = height;
+    call.Color = color;
+    call.Mask = NULL;
+    sDrawCalls.push_back(call);
+}
+
+} // unnamed namespace
+
+namespace HostCompositor {
+
+void Reset(void)
+{
+    DisplayCompositor.SetScene(NULL, 0);
+    sPendingRects.clear();
+    sGlyphLookups = 0;
+    ClearLogs();
+}
+
+const std::vector<DisplayRect> & GetInvalidations(void)
+{
+    return sInvalidations;
+}
+
+const std::vector<DrawCall> & GetDrawCalls(void)
+{
+    return sDrawCalls;
+}
+
+void ClearLogs(void)
+{
+    sInvalidations.clear();
+    sDrawCalls.clear();
+}
+
+uint32_t GetGlyphLookups(void)
+{
+    return sGlyphLookups;
+}
+
+} // namespace HostCompositor
+
+bool DisplayRect::Intersects(const DisplayRect & other) const
+{
+    return !IsEmpty() && !other.IsEmpty() &&
+           X < other.Right() && other.X < Right() &&
+           Y < other.Bottom() && other.Y < Bottom();
+}
+
+DisplayRect DisplayRect::Intersection(const DisplayRect & other) const
+{
+    DisplayRect res = { 0, 0, 0, 0 };
+    if (Intersects(other))
+    {
+        res.X = (X > other.X) ? X : other.X;
+        res.Y = (Y > other.Y) ? Y : other.Y;
+        res.Width = (uint16_t)(((Right() < other.Right()) ? Right() : other.Right()) - res.X);
+        res.Height = (uint16_t)(((Bottom() < other.Bottom()) ? Bottom() : other.Bottom()) - res.Y);
+    }
+    return res;
+}
+
+DisplayRect DisplayRect::Union(const DisplayRect & other) const
+{
+    if (IsEmpty())
+    {
+        return other;
+    }
+    if (other.IsEmpty())
+    {
+        return *this;
+    }
+    DisplayRect res;
+    res.X = (X < other.X) ? X : other.X;
+    res.Y = (Y < other.Y) ? Y : other.Y;
+    res.Width = (uint16_t)(((Right() > other.Right()) ? Right() : other.Right()) - res.X);
+    res.Height = (uint16_t)(((Bottom() > other.Bottom()) ? Bottom() : other.Bottom()) - res.Y);
+    return res;
+}
+
+/* Return an 8 x 8 glyph whose bitmap varies with the character.
+ */
+bool GetFontGlyph(char ch, FontGlyph & glyph)
+{
+    uint8_t * bitmap = sGlyphBitmaps[(uint8_t)ch];
+
+    sGlyphLookups++;
+
+    for (int i = 0; i < 8; i++)
+    {
+        bitmap[i] = (uint8_t)(ch ^ (i * 37));
+    }
+
+    glyph.Bitmap = bitmap;
+    glyph.Width = 8;
+    glyph.Height = 8;
+    glyph.XOffset = 0;
+    glyph.YOffset = 4;
+    glyph.XAdvance = 9;
+
+    return true;
+}
+
+void Canvas::FillRect(int16_t x, int16_t y, uint16_t width, uint16_t height, color_t color)
+{
+    LogDrawCall(HostCompositor::kDrawOp_FillRect, mClip, x, y, width, height, color);
+}
+
+void Canvas::DrawRect(int16_t x, int16_t y, uint16_t width, uint16_t height, color_t color)
+{
+    LogDrawCall(HostCompositor::kDrawOp_DrawRect, mClip, x, y, width, height, color);
+}
+
+void Canvas::DrawText(const char * str, int16_t x, int16_t y, color_t color)
+{
+    LogDrawCall(HostCompositor::kDrawOp_DrawText, mClip, x, y, 0, 0, color);
+    sDrawCalls.back().Text = str;
+}
+
+void Canvas::DrawMask(int16_t x, int16_t y, uint16_t width, uint16_t height, const uint8_t * mask, color_t fgColor, color_t bgColor)
+{
+    LogDrawCall(HostCompositor::kDrawOp_DrawMask, mClip, x, y, width, height, fgColor);
+    sDrawCalls.back().Mask = mask;
+    sDrawCalls.back().MaskData.assign(mask, mask + (width * height + 7) / 8);
+}
+
+void Canvas::DrawAsset(int16_t x, int16_t y, const DisplayAsset & asset)
+{
+    LogDrawCall(HostCompositor::kDrawOp_DrawAsset, mClip, x, y, asset.Width, asset.Height, TFT_BLACK);
+}
+
+void Canvas::CopyRow(int16_t x, int16_t srcY, uint16_t width, int16_t destY)
+{
+    LogDrawCall(HostCompositor::kDrawOp_CopyRow, mClip, x, destY, width, 1, TFT_BLACK);
+}
+
+void Drawable::Invalidate(const DisplayRect & rect)
+{
+    if (mShown)
+    {
+        DisplayCompositor.Invalidate(rect);
+    }
+}
+
+void Compositor::Lock()
+{
+}
+
+void Compositor::Unlock()
+{
+}
+
+/* Replace the scene, laying out the drawables that enter it.  Unlike the real compositor, nothing
+ * is invalidated for the drawables that enter or leave.
+ */
+void Compositor::SetScene(Drawable * const * drawables, uint8_t count)
+{
+    for (uint8_t i = 0; i < mNumDrawables; i++)
+    {
+        mDrawables[i]->mShown = false;
+    }
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (!drawables[i]->mShown)
+        {
+            drawables[i]->Layout();
+            drawables[i]->mShown = true;
+        }
+    }
+    mNumDrawables = count;
+    if (count > 0)
+    {
+        memcpy(mDrawables, drawables, count * sizeof(Drawable *));
+    }
+}
+
+void Compositor::Invalidate(const DisplayRect & rect)
+{
+    sInvalidations.push_back(rect);
+    sPendingRects.push_back(rect);
+}
+
+/* Render each region invalidated since the last flush, in order, into the logging canvas.
+ */
+void Compositor::Flush()
+{
+    for (size_t i = 0; i < sPendingRects.size(); i++)
+    {
+        RenderRect(sPendingRects[i]);
+    }
+    sPendingRects.clear();
+}
+
+void Compositor::RenderRect(const DisplayRect & rect)
+{
+    Canvas canvas;
+
+    canvas.mBuf = NULL;
+    canvas.mClip = rect;
+
+    for (uint8_t i = 0; i < mNumDrawables; i++)
+    {
+        if (mDrawables[i]->GetBounds().Intersects(rect))
+        {
+            mDrawables[i]->Render(canvas);
+        }
+    }
+}
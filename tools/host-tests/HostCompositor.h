@@ -0,0 +1,67 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Stand-in for the compositor (Compositor.cpp) for host tests of individual widgets.
+ *
+ *      Regions invalidated by the widgets in the scene are logged, and Compositor::Flush()
+ *      renders each of them, unmerged, into a canvas that logs the drawing operations instead
+ *      of drawing.  GetFontGlyph() returns synthetic glyphs, and counts the lookups.
+ */
+
+#ifndef HOST_COMPOSITOR_H
+#define HOST_COMPOSITOR_H
+
+#include <string>
+#include <vector>
+
+#include "Compositor.h"
+
+namespace HostCompositor {
+
+enum DrawOp
+{
+    kDrawOp_FillRect,
+    kDrawOp_DrawRect,
+    kDrawOp_DrawText,
+    kDrawOp_DrawMask,
+    kDrawOp_DrawAsset,
+    kDrawOp_CopyRow,
+};
+
+struct DrawCall
+{
+    DrawOp Op;
+    DisplayRect Clip;
+    DisplayRect Rect;
+    color_t Color;
+    const uint8_t * Mask;           // DrawMask only
+    std::vector<uint8_t> MaskData;  // DrawMask only
+    std::string Text;               // DrawText only
+};
+
+void Reset(void);
+const std::vector<DisplayRect> & GetInvalidations(void);
+const std::vector<DrawCall> & GetDrawCalls(void);
+void ClearLogs(void);
+uint32_t GetGlyphLookups(void);
+
+} // namespace HostCompositor
+
+#endif // HOST_COMPOSITOR_H
@@ -0,0 +1,362 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Implementation of the simulated M5Stack display used by the host tests.
+ */
+
+#include <string.h>
+#include <vector>
+
+#include "esp_system.h"
+#include "esp_partition.h"
+
+#include "HostDisplay.h"
+
+spi_lobo_device_handle_t disp_spi;
+uint8_t tft_disp_type;
+int _width;
+int _height;
+uint32_t max_rdclock;
+Font cfont;
+dispWin_t dispWin;
+
+const color_t TFT_BLACK = { 0, 0, 0 };
+const color_t TFT_WHITE = { 252, 252, 252 };
+const color_t TFT_BLUE = { 0, 0, 252 };
+const color_t TFT_DARKGREY = { 120, 120, 120 };
+
+namespace {
+
+enum
+{
+    kFontHeight = 24,
+    kFirstChar = 0x20,
+    kLastChar = 0x7E,
+};
+
+color_t sPixels[HostDisplay::kWidth * HostDisplay::kHeight];
+std::vector<HostDisplay::Transfer> sTransfers;
+std::vector<uint32_t> sClockChanges;
+std::vector<uint8_t> sFont;
+uint32_t sClock;
+uint32_t sMaxWriteClock;
+uint32_t sReadClockProbes;
+bool sSelected;
+int sDevice;
+esp_partition_t sAssetPartition;
+const uint8_t * sAssetImage;
+
+/* Build a proportional font in the format of the TFT library's fonts: a 4 byte header, then
+ * for each glyph its character code, y offset, width, height, x offset, x advance and bitmap,
+ * and finally 0xFF.  Glyph widths, offsets and bitmaps vary with the character code, so that
+ * each character draws differently.
+ */
+void BuildFont(void)
+{
+    sFont.clear();
+    sFont.push_back(0);                     // Proportional
+    sFont.push_back(kFontHeight);
+    sFont.push_back(kFirstChar);
+    sFont.push_back(kLastChar - kFirstChar + 1);
+
+    for (int ch = kFirstChar; ch <= kLastChar; ch++)
+    {
+        uint8_t width = (uint8_t)(6 + ch % 4);
+        uint8_t height = 14;
+        std::vector<uint8_t> bitmap((width * height + 7) / 8, 0);
+
+        for (int bit = 0; bit < width * height; bit++)
+        {
+            if ((bit * 7 + ch) % 3 == 0)
+            {
+                bitmap[bit / 8] |= (uint8_t)(0x80 >> (bit % 8));
+            }
+        }
+
+        sFont.push_back((uint8_t)ch);
+        sFont.push_back((uint8_t)(4 + ch % 3));     // y offset
+        sFont.push_back(width);
+        sFont.push_back(height);
+        sFont.push_back((uint8_t)(ch % 2));         // x offset
+        sFont.push_back((uint8_t)(width + 2));      // x advance
+        sFont.insert(sFont.end(), bitmap.begin(), bitmap.end());
+    }
+
+    sFont.push_back(0xFF);
+}
+
+} // unnamed namespace
+
+namespace HostDisplay {
+
+/* Restore the initial state of the display: all pixels black, no transfers logged, and pixel
+ * writes reliable at any clock.
+ */
+void Reset(void)
+{
+    memset(sPixels, 0, sizeof(sPixels));
+    sTransfers.clear();
+    sClockChanges.clear();
+    sClock = 0;
+    sMaxWriteClock = UINT32_MAX;
+    sReadClockProbes = 0;
+    sSelected = false;
+    max_rdclock = 0;
+    memset(&cfont, 0, sizeof(cfont));
+    BuildFont();
+    sAssetImage = NULL;
+}
+
+color_t GetPixel(int x, int y)
+{
+    return sPixels[y * kWidth + x];
+}
+
+const std::vector<Transfer> & GetTransfers(void)
+{
+    return sTransfers;
+}
+
+void ClearTransfers(void)
+{
+    sTransfers.clear();
+}
+
+/* Set the fastest SPI clock at which pixel data reaches the display intact.  Above it, a bit
+ * of the first pixel of each transfer is lost.
+ */
+void SetMaxWriteClock(uint32_t clock)
+{
+    sMaxWriteClock = clock;
+}
+
+const std::vector<uint32_t> & GetClockChanges(void)
+{
+    return sClockChanges;
+}
+
+uint32_t GetReadClockProbes(void)
+{
+    return sReadClockProbes;
+}
+
+/* Set the contents of the display assets partition.  The partition is absent until this is called.
+ */
+void SetAssetImage(const uint8_t * image, uint32_t size)
+{
+    memset(&sAssetPartition, 0, sizeof(sAssetPartition));
+    sAssetPartition.type = ESP_PARTITION_TYPE_DATA;
+    sAssetPartition.subtype = 0x40;
+    sAssetPartition.size = size;
+    strcpy(sAssetPartition.label, "assets");
+    sAssetImage = image;
+}
+
+} // namespace HostDisplay
+
+const esp_partition_t * esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char * label)
+{
+    if (sAssetImage == NULL || type != sAssetPartition.type || subtype != sAssetPartition.subtype ||
+        (label != NULL && strcmp(label, sAssetPartition.label) != 0))
+    {
+        return NULL;
+    }
+    return &sAssetPartition;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t * partition, uint32_t offset, uint32_t size,
+                             spi_flash_mmap_memory_t memory, const void ** out_ptr, spi_flash_mmap_handle_t * out_handle)
+{
+    *out_ptr = sAssetImage + offset;
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle)
+{
+}
+
+esp_err_t spi_lobo_bus_add_device(int host, spi_lobo_bus_config_t * bus_config,
+                                  spi_lobo_device_interface_config_t * dev_config, spi_lobo_device_handle_t * handle)
+{
+    sClock = (uint32_t)dev_config->clock_speed_hz;
+    *handle = (spi_lobo_device_handle_t)&sDevice;
+    return ESP_OK;
+}
+
+esp_err_t spi_lobo_device_select(spi_lobo_device_handle_t handle, int force)
+{
+    return ESP_OK;
+}
+
+esp_err_t spi_lobo_device_deselect(spi_lobo_device_handle_t handle)
+{
+    return ESP_OK;
+}
+
+uint32_t spi_lobo_set_speed(spi_lobo_device_handle_t handle, uint32_t speed)
+{
+    sClock = speed;
+    sClockChanges.push_back(speed);
+    return speed;
+}
+
+uint32_t spi_lobo_get_speed(spi_lobo_device_handle_t handle)
+{
+    return sClock;
+}
+
+esp_err_t disp_select(void)
+{
+    sSelected = true;
+    return ESP_OK;
+}
+
+esp_err_t disp_deselect(void)
+{
+    sSelected = false;
+    return ESP_OK;
+}
+
+void send_data(int x1, int y1, int x2, int y2, uint32_t len, color_t * buf)
+{
+    HostDisplay::Transfer transfer = { x1, y1, x2, y2, len };
+    uint32_t i = 0;
+
+    sTransfers.push_back(transfer);
+
+    if (!sSelected)
+    {
+        return;
+    }
+
+    for (int y = y1; y <= y2 && i < len; y++)
+    {
+        for (int x = x1; x <= x2 && i < len; x++, i++)
+        {
+            sPixels[y * HostDisplay::kWidth + x] = buf[i];
+        }
+    }
+
+    if (sClock > sMaxWriteClock && len > 0)
+    {
+        sPixels[y1 * HostDisplay::kWidth + x1].g ^= 0x80;
+    }
+}
+
+/* Read pixel data from a window of the display.  As on the ILI9341, the first byte read is a
+ * dummy byte.
+ */
+esp_err_t read_data(int x1, int y1, int x2, int y2, int len, uint8_t * buf, uint8_t set_sp)
+{
+    int i = 0;
+
+    buf[0] = 0xA5;
+
+    for (int y = y1; y <= y2 && i < len; y++)
+    {
+        for (int x = x1; x <= x2 && i < len; x++)
+        {
+            const color_t & pixel = sPixels[y * HostDisplay::kWidth + x];
+            buf[1 + i++] = pixel.r;
+            if (i < len)
+            {
+                buf[1 + i++] = pixel.g;
+            }
+            if (i < len)
+            {
+                buf[1 + i++] = pixel.b;
+            }
+        }
+    }
+
+    return ESP_OK;
+}
+
+uint32_t find_rd_speed(void)
+{
+    sReadClockProbes++;
+    return HostDisplay::kReadClock;
+}
+
+void TFT_PinsInit(void)
+{
+}
+
+void TFT_display_init(void)
+{
+}
+
+void TFT_setFont(uint8_t font, const char * font_file)
+{
+    cfont.font = &sFont[0];
+    cfont.x_size = sFont[0];
+    cfont.y_size = sFont[1];
+    cfont.offset = sFont[2];
+    cfont.numchars = sFont[3];
+}
+
+int TFT_getStringWidth(char * str)
+{
+    int width = 0;
+
+    for (; *str != 0; str++)
+    {
+        const uint8_t * p = &sFont[4];
+
+        while (p[0] != 0xFF)
+        {
+            uint8_t glyphWidth = p[2];
+            uint8_t xAdvance = p[5];
+
+            if (p[0] == (uint8_t)*str)
+            {
+                width += ((glyphWidth > xAdvance) ? glyphWidth : xAdvance) + 1;
+                break;
+            }
+            p += 6 + (glyphWidth * p[3] + 7) / 8;
+        }
+    }
+
+    return width;
+}
+
+int TFT_getfontheight(void)
+{
+    return cfont.y_size;
+}
+
+void TFT_setGammaCurve(uint8_t gm)
+{
+}
+
+void TFT_setRotation(uint8_t rot)
+{
+    _width = (rot == LANDSCAPE) ? HostDisplay::kWidth : HostDisplay::kHeight;
+    _height = (rot == LANDSCAPE) ? HostDisplay::kHeight : HostDisplay::kWidth;
+}
+
+void TFT_resetclipwin(void)
+{
+    dispWin.x1 = 0;
+    dispWin.y1 = 0;
+    dispWin.x2 = (uint16_t)(_width - 1);
+    dispWin.y2 = (uint16_t)(_height - 1);
+}
@@ -0,0 +1,65 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Simulated M5Stack display for host tests, standing in for the TFT display library:
+ *      a 320 x 240 pixel display memory written by send_data() and read by read_data(), a
+ *      log of windowed transfers, an SPI clock above which pixel writes are corrupted, and
+ *      a synthetic proportional font.  Also simulates the display assets partition.
+ */
+
+#ifndef HOST_DISPLAY_H
+#define HOST_DISPLAY_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "tftspi.h"
+#include "tft.h"
+
+namespace HostDisplay {
+
+enum
+{
+    kWidth = 320,
+    kHeight = 240,
+    kReadClock = 16000000,          // Clock returned by find_rd_speed()
+};
+
+struct Transfer
+{
+    int X1;
+    int Y1;
+    int X2;                         // Inclusive
+    int Y2;                         // Inclusive
+    uint32_t Pixels;
+};
+
+void Reset(void);
+color_t GetPixel(int x, int y);
+const std::vector<Transfer> & GetTransfers(void);
+void ClearTransfers(void);
+void SetMaxWriteClock(uint32_t clock);
+const std::vector<uint32_t> & GetClockChanges(void);
+uint32_t GetReadClockProbes(void);
+void SetAssetImage(const uint8_t * image, uint32_t size);
+
+} // namespace HostDisplay
+
+#endif // HOST_DISPLAY_H
@@ -0,0 +1,664 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Implementation of the simulated ESP32 environment used by the host tests.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ucontext.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "nvs.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+
+#include "HostSim.h"
+#include "HostTest.h"
+
+const char * TAG = "host-test";
+
+int HostTest::sFailures = 0;
+
+struct esp_timer
+{
+    esp_timer_cb_t Callback;
+    void * Arg;
+    int64_t DueTimeUS;
+    uint64_t PeriodUS;
+    uint64_t Seq;
+    bool Armed;
+};
+
+struct HostQueue
+{
+    std::deque<std::vector<uint8_t> > Items;
+    uint32_t Length;
+    uint32_t ItemSize;
+};
+
+struct HostTask
+{
+    ucontext_t Context;
+    TaskFunction_t Function;
+    void * Arg;
+    std::vector<uint8_t> Stack;
+    uint32_t NotifyCount;
+    bool Started;
+};
+
+namespace {
+
+struct PendedCall
+{
+    PendedFunction_t Function;
+    void * Arg1;
+    uint32_t Arg2;
+    int64_t DueTimeUS;
+    uint64_t Seq;
+};
+
+int64_t sNowUS;
+int64_t sLatencyUS;
+bool sUseHostClock;
+uint64_t sNextSeq;
+std::vector<esp_timer *> sTimers;
+std::vector<PendedCall> sPendedCalls;
+int sLevels[GPIO_NUM_MAX];
+gpio_isr_t sISRs[GPIO_NUM_MAX];
+void * sISRArgs[GPIO_NUM_MAX];
+bool sIntrEnabled[GPIO_NUM_MAX];
+uint32_t sDuty[LEDC_CHANNEL_MAX];
+uint32_t sFadeTarget[LEDC_CHANNEL_MAX];
+int sFadeMS[LEDC_CHANNEL_MAX];
+std::vector<HostSim::LEDCCommand> sLEDCCommands;
+HostTask sMainTask;
+HostTask * sCurrentTask = &sMainTask;
+std::vector<HostTask *> sTasks;
+std::vector<std::string> sNVSNamespaces;
+std::map<std::string, uint32_t> sNVSValues;
+
+enum
+{
+    kMinTaskStackSize = 256 * 1024,     // Host code (e.g. printf) needs far more stack than the target
+};
+
+void LogLEDCCommand(ledc_channel_t channel, uint32_t duty, int fadeMS)
+{
+    HostSim::LEDCCommand cmd = { sNowUS, channel, duty, fadeMS };
+    sLEDCCommands.push_back(cmd);
+}
+
+void TaskEntry(void)
+{
+    sCurrentTask->Function(sCurrentTask->Arg);
+
+    // FreeRTOS task functions must not return.
+    printf("task function returned\n");
+    abort();
+}
+
+/* Switch to the first task that is ready to run, returning once it blocks.  Returns false if
+ * no task is ready.
+ */
+bool RunReadyTask(void)
+{
+    for (size_t i = 0; i < sTasks.size(); i++)
+    {
+        HostTask * task = sTasks[i];
+        if (!task->Started || task->NotifyCount != 0)
+        {
+            task->Started = true;
+            sCurrentTask = task;
+            swapcontext(&sMainTask.Context, &task->Context);
+            sCurrentTask = &sMainTask;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string NVSKey(nvs_handle handle, const char * key)
+{
+    return sNVSNamespaces[handle] + "/" + key;
+}
+
+} // unnamed namespace
+
+namespace HostSim {
+
+/* Restore the initial state of the simulation.  All GPIOs read high (buttons released), and
+ * NVS is empty.
+ *
+ * NOTE: Timers and tasks created by previous tests are abandoned, rather than freed, since the
+ * objects that own them may still refer to them.
+ */
+void Reset(void)
+{
+    sTasks.clear();
+    sMainTask.NotifyCount = 0;
+    sNVSNamespaces.clear();
+    sNVSValues.clear();
+    sNowUS = 1000000;
+    sLatencyUS = 0;
+    sUseHostClock = false;
+    sNextSeq = 0;
+    for (size_t i = 0; i < sTimers.size(); i++)
+    {
+        sTimers[i]->Armed = false;
+    }
+    sTimers.clear();
+    sPendedCalls.clear();
+    for (int i = 0; i < GPIO_NUM_MAX; i++)
+    {
+        sLevels[i] = 1;
+        sISRs[i] = NULL;
+        sISRArgs[i] = NULL;
+        sIntrEnabled[i] = false;
+    }
+    memset(sDuty, 0, sizeof(sDuty));
+    memset(sFadeTarget, 0, sizeof(sFadeTarget));
+    memset(sFadeMS, 0, sizeof(sFadeMS));
+    sLEDCCommands.clear();
+}
+
+int64_t Now(void)
+{
+    return sNowUS;
+}
+
+/* Advance the clock to the given time, running each timer callback and deferred function call
+ * that falls due on the way, in order of due time.
+ */
+void RunUntil(int64_t timeUS)
+{
+    while (true)
+    {
+        esp_timer * timer = NULL;
+        int callIndex = -1;
+        int64_t dueTimeUS = timeUS + 1;
+        uint64_t seq = 0;
+
+        for (size_t i = 0; i < sTimers.size(); i++)
+        {
+            esp_timer * t = sTimers[i];
+            if (t->Armed && (t->DueTimeUS < dueTimeUS || (t->DueTimeUS == dueTimeUS && t->Seq < seq)))
+            {
+                timer = t;
+                dueTimeUS = t->DueTimeUS;
+                seq = t->Seq;
+            }
+        }
+        for (size_t i = 0; i < sPendedCalls.size(); i++)
+        {
+            const PendedCall & c = sPendedCalls[i];
+            if (c.DueTimeUS < dueTimeUS || (c.DueTimeUS == dueTimeUS && c.Seq < seq))
+            {
+                timer = NULL;
+                callIndex = (int)i;
+                dueTimeUS = c.DueTimeUS;
+                seq = c.Seq;
+            }
+        }
+
+        if (timer == NULL && callIndex < 0)
+        {
+            break;
+        }
+
+        if (dueTimeUS > sNowUS)
+        {
+            sNowUS = dueTimeUS;
+        }
+
+        if (timer != NULL)
+        {
+            if (timer->PeriodUS != 0)
+            {
+                timer->DueTimeUS += timer->PeriodUS;
+                timer->Seq = sNextSeq++;
+            }
+            else
+            {
+                timer->Armed = false;
+            }
+            timer->Callback(timer->Arg);
+        }
+        else
+        {
+            PendedCall call = sPendedCalls[callIndex];
+            sPendedCalls.erase(sPendedCalls.begin() + callIndex);
+            call.Function(call.Arg1, call.Arg2);
+        }
+    }
+
+    if (timeUS > sNowUS)
+    {
+        sNowUS = timeUS;
+    }
+}
+
+/* Advance the clock without running any timer callbacks or deferred function calls, standing in
+ * for CPU time spent by the code under test.  Anything falling due in the meantime runs late,
+ * from the next call to RunUntil().
+ */
+void Spend(int64_t durationUS)
+{
+    sNowUS += durationUS;
+}
+
+/* Make esp_timer_get_time() read the host's monotonic clock, rather than the virtual clock, so
+ * that benchmarks can time the code under test.  Timers still run on the virtual clock.
+ */
+void UseHostClock(void)
+{
+    sUseHostClock = true;
+}
+
+/* Set the delay between a timer or deferred function call falling due and its being run,
+ * standing in for the latency of the timer tasks.
+ */
+void SetLatency(int64_t latencyUS)
+{
+    sLatencyUS = latencyUS;
+}
+
+/* Set the level of a GPIO, running its interrupt handler if the level changed.
+ */
+void SetLevel(gpio_num_t gpioNum, int level)
+{
+    if (sLevels[gpioNum] != level)
+    {
+        sLevels[gpioNum] = level;
+        RaiseInterrupt(gpioNum);
+    }
+}
+
+/* Run the interrupt handler of a GPIO without changing its level, as happens for the glitches
+ * seen on GPIOs 36 and 39 when certain RTC peripherals are powered up.
+ */
+void RaiseInterrupt(gpio_num_t gpioNum)
+{
+    if (sIntrEnabled[gpioNum] && sISRs[gpioNum] != NULL)
+    {
+        sISRs[gpioNum](sISRArgs[gpioNum]);
+    }
+}
+
+/* Run each task that is ready, until all are blocked in ulTaskNotifyTake().
+ */
+void RunTasks(void)
+{
+    while (RunReadyTask())
+    {
+    }
+}
+
+const std::vector<LEDCCommand> & GetLEDCCommands(void)
+{
+    return sLEDCCommands;
+}
+
+void ClearLEDCCommands(void)
+{
+    sLEDCCommands.clear();
+}
+
+} // namespace HostSim
+
+const char * esp_err_to_name(esp_err_t err)
+{
+    return (err == ESP_OK) ? "ESP_OK" : "ESP_ERR";
+}
+
+void * heap_caps_malloc(size_t size, uint32_t caps)
+{
+    return malloc(size);
+}
+
+esp_err_t nvs_open(const char * name, nvs_open_mode open_mode, nvs_handle * out_handle)
+{
+    sNVSNamespaces.push_back(name);
+    *out_handle = (nvs_handle)(sNVSNamespaces.size() - 1);
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_u32(nvs_handle handle, const char * key, uint32_t * out_value)
+{
+    std::map<std::string, uint32_t>::const_iterator it = sNVSValues.find(NVSKey(handle, key));
+    if (it == sNVSValues.end())
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *out_value = it->second;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u32(nvs_handle handle, const char * key, uint32_t value)
+{
+    sNVSValues[NVSKey(handle, key)] = value;
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle handle)
+{
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle handle)
+{
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t * create_args, esp_timer_handle_t * out_handle)
+{
+    esp_timer * timer = new esp_timer();
+
+    timer->Callback = create_args->callback;
+    timer->Arg = create_args->arg;
+    timer->Armed = false;
+    sTimers.push_back(timer);
+    *out_handle = timer;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer->Armed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->DueTimeUS = sNowUS + (int64_t)timeout_us + sLatencyUS;
+    timer->PeriodUS = 0;
+    timer->Seq = sNextSeq++;
+    timer->Armed = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    if (timer->Armed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->DueTimeUS = sNowUS + (int64_t)period;
+    timer->PeriodUS = period;
+    timer->Seq = sNextSeq++;
+    timer->Armed = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer->Armed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->Armed = false;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    if (sUseHostClock)
+    {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    return sNowUS;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    return sLevels[gpio_num];
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void * args)
+{
+    sISRs[gpio_num] = isr_handler;
+    sISRArgs[gpio_num] = args;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num)
+{
+    sIntrEnabled[gpio_num] = true;
+    return ESP_OK;
+}
+
+uint32_t HostReadReg(uint32_t reg)
+{
+    uint32_t value = 0;
+    int first = (reg == GPIO_IN_REG) ? 0 : 32;
+    int last = (reg == GPIO_IN_REG) ? 32 : GPIO_NUM_MAX;
+
+    for (int i = first; i < last; i++)
+    {
+        value |= (uint32_t)(sLevels[i] != 0) << (i - first);
+    }
+
+    return value;
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t * timer_conf)
+{
+    return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t * ledc_conf)
+{
+    sDuty[ledc_conf->channel] = ledc_conf->duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_func_install(int intr_alloc_flags)
+{
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty)
+{
+    sDuty[channel] = duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    LogLEDCCommand(channel, sDuty[channel], 0);
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t target_duty, int max_fade_time_ms)
+{
+    sFadeTarget[channel] = target_duty;
+    sFadeMS[channel] = max_fade_time_ms;
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_start(ledc_mode_t speed_mode, ledc_channel_t channel, ledc_fade_mode_t wait_done)
+{
+    LogLEDCCommand(channel, sFadeTarget[channel], sFadeMS[channel]);
+    sDuty[channel] = sFadeTarget[channel];
+    return ESP_OK;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    HostSim::RunUntil(sNowUS + (int64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+QueueHandle_t xQueueCreate(uint32_t length, uint32_t itemSize)
+{
+    HostQueue * queue = new HostQueue();
+
+    queue->Length = length;
+    queue->ItemSize = itemSize;
+
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void * item, TickType_t ticksToWait)
+{
+    if (queue->Items.size() >= queue->Length)
+    {
+        return pdFALSE;
+    }
+    queue->Items.push_back(std::vector<uint8_t>((const uint8_t *)item, (const uint8_t *)item + queue->ItemSize));
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void * item, BaseType_t * higherPriorityTaskWoken)
+{
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void * item, TickType_t ticksToWait)
+{
+    if (queue->Items.empty())
+    {
+        return pdFALSE;
+    }
+    if (queue->ItemSize != 0)
+    {
+        memcpy(item, &queue->Items.front()[0], queue->ItemSize);
+    }
+    queue->Items.pop_front();
+    return pdTRUE;
+}
+
+/* Create a mutex, which is a binary semaphore that starts out given.
+ *
+ * NOTE: Since tasks only switch when blocked in ulTaskNotifyTake(), a mutex is never contended.
+ */
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t mutex = xSemaphoreCreateBinary();
+    xSemaphoreGive(mutex);
+    return mutex;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char * name, uint32_t stackDepth, void * arg,
+                       UBaseType_t priority, TaskHandle_t * createdTask)
+{
+    HostTask * task = new HostTask();
+
+    task->Function = function;
+    task->Arg = arg;
+    task->NotifyCount = 0;
+    task->Started = false;
+    task->Stack.resize((stackDepth > kMinTaskStackSize) ? stackDepth : kMinTaskStackSize);
+    getcontext(&task->Context);
+    task->Context.uc_stack.ss_sp = &task->Stack[0];
+    task->Context.uc_stack.ss_size = task->Stack.size();
+    task->Context.uc_link = NULL;
+    makecontext(&task->Context, TaskEntry, 0);
+    sTasks.push_back(task);
+
+    if (createdTask != NULL)
+    {
+        *createdTask = task;
+    }
+
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return sCurrentTask;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    task->NotifyCount++;
+    return pdPASS;
+}
+
+/* Take a task's notification count, blocking while it is zero.
+ *
+ * A task blocks by switching back to the test's (main) task.  The main task blocks by running
+ * the tasks that are ready, and returns 0, as if timed out, if they all block without notifying it.
+ */
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+    HostTask * self = sCurrentTask;
+    uint32_t count;
+
+    if (self == &sMainTask)
+    {
+        while (self->NotifyCount == 0 && RunReadyTask())
+        {
+        }
+    }
+    else
+    {
+        while (self->NotifyCount == 0)
+        {
+            swapcontext(&self->Context, &sMainTask.Context);
+        }
+    }
+
+    count = self->NotifyCount;
+    if (count != 0)
+    {
+        self->NotifyCount = (clearCountOnExit) ? 0 : count - 1;
+    }
+
+    return count;
+}
+
+BaseType_t xTimerPendFunctionCallFromISR(PendedFunction_t function, void * arg1, uint32_t arg2,
+                                         BaseType_t * higherPriorityTaskWoken)
+{
+    PendedCall call = { function, arg1, arg2, sNowUS + sLatencyUS, sNextSeq++ };
+    sPendedCalls.push_back(call);
+    return pdPASS;
+}
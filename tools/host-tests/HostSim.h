@@ -0,0 +1,67 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Simulated ESP32 environment for host tests: a virtual clock, the esp_timer
+ *      service, GPIO levels and interrupts, FreeRTOS tasks, queues and deferred function
+ *      calls, NVS, and a log of LEDC duty changes.
+ *
+ *      Time only advances when a test calls RunUntil(), or when a stand-in charges the
+ *      code under test for CPU time with Spend().  Timer callbacks and deferred function
+ *      calls run, in order of due time, from within RunUntil(), as they would on the
+ *      esp_timer and FreeRTOS timer tasks; GPIO interrupt handlers run from within
+ *      SetLevel().  Tasks created with xTaskCreate() run from within RunTasks(),
+ *      or while the test blocks in ulTaskNotifyTake(), until each blocks in turn.
+ */
+
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "esp_system.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+
+namespace HostSim {
+
+struct LEDCCommand
+{
+    int64_t TimeUS;
+    ledc_channel_t Channel;
+    uint32_t Duty;
+    int FadeMS;                     // 0 if the duty was set directly
+};
+
+void Reset(void);
+int64_t Now(void);
+void RunUntil(int64_t timeUS);
+void Spend(int64_t durationUS);
+void UseHostClock(void);
+void SetLatency(int64_t latencyUS);
+void RunTasks(void);
+void SetLevel(gpio_num_t gpioNum, int level);
+void RaiseInterrupt(gpio_num_t gpioNum);
+const std::vector<LEDCCommand> & GetLEDCCommands(void);
+void ClearLEDCCommands(void);
+
+} // namespace HostSim
+
+#endif // HOST_SIM_H
@@ -0,0 +1,69 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Minimal test framework for host tests.
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+
+namespace HostTest {
+
+extern int sFailures;
+
+inline bool Check(bool pass, const char * expr, const char * file, int line)
+{
+    if (!pass)
+    {
+        printf("%s:%d: check failed: %s\n", file, line, expr);
+        sFailures++;
+    }
+    return pass;
+}
+
+inline bool CheckEqual(long long actual, long long expected, const char * expr, const char * file, int line)
+{
+    if (actual != expected)
+    {
+        printf("%s:%d: check failed: %s (%lld != %lld)\n", file, line, expr, actual, expected);
+        sFailures++;
+    }
+    return actual == expected;
+}
+
+} // namespace HostTest
+
+#define EXPECT(cond) HostTest::Check((cond), #cond, __FILE__, __LINE__)
+#define EXPECT_EQ(actual, expected) \
+    HostTest::CheckEqual((long long)(actual), (long long)(expected), #actual " == " #expected, __FILE__, __LINE__)
+
+#define RUN_TEST(test)                                                          \
+    do                                                                          \
+    {                                                                           \
+        int failuresBefore = HostTest::sFailures;                               \
+        test();                                                                 \
+        printf("%s %s\n", (HostTest::sFailures == failuresBefore) ? "PASS" : "FAIL", #test); \
+    } while (0)
+
+#define HOST_TEST_RESULT() ((HostTest::sFailures == 0) ? 0 : 1)
+
+#endif // HOST_TEST_H
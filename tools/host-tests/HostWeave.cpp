@@ -0,0 +1,1624 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Implementation of the OpenWeave stand-ins (stub/SystemLayer and stub/Weave) used by the
+ *      host tests.
+ */
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "esp_timer.h"
+
+#include <SystemLayer/SystemStats.h>
+#include <Weave/Core/WeaveTLV.h>
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+#include <Weave/Profiles/data-management/DataManagement.h>
+#include <Weave/Profiles/echo/Next/WeaveEchoClient.h>
+
+#include "HostSim.h"
+#include "HostWeave.h"
+
+using namespace ::nl::Weave;
+using namespace ::nl::Weave::TLV;
+using namespace ::nl::Weave::DeviceLayer;
+using namespace ::nl::Weave::Profiles::DataManagement_Current;
+using namespace ::nl::Weave::Profiles::Echo_Next;
+
+namespace {
+
+struct SystemTimer
+{
+    System::Layer::TimerCompleteFunct OnComplete;
+    void * AppState;
+    System::Layer * Layer;
+    esp_timer_handle_t Timer;
+};
+
+struct EventHandler
+{
+    PlatformManager::EventHandlerFunct Handler;
+    intptr_t Arg;
+};
+
+struct Subscription
+{
+    TraitDataSource * DataSource;
+    int64_t RoundTripUS;
+    std::vector<PropertyPathHandle> DirtyHandles;
+    int64_t DirtySinceUS;
+    PacketBuffer * NotifyInFlight;
+    esp_timer_handle_t AckTimer;
+    HostWeave::SubscriberStats Stats;
+};
+
+const HostWeave::EchoPath kDefaultEchoPath = { 50000, System::PacketBuffer::kBufferSize, 0, 0 };
+
+std::vector<SystemTimer *> sSystemTimers;
+std::vector<EventHandler> sEventHandlers;
+std::vector<TraitDataSource *> sPublishedTraits;
+std::vector<Subscription *> sSubscriptions;
+size_t sNextSubscription;
+uint16_t sNotifiesInFlight;
+HostWeave::PublisherLimits sPublisherLimits;
+HostWeave::PublisherStats sPublisherStats;
+HostWeave::EchoPath sEchoPath = kDefaultEchoPath;
+uint32_t sEchosSent;
+uint32_t sFragmentedEchos;
+uint16_t sPacketBufsInUse;
+uint16_t sPacketBufsHighWater;
+System::Stats::count_t sResourcesInUse[System::Stats::kNumEntries];
+System::Stats::count_t sHighWatermarks[System::Stats::kNumEntries];
+
+enum
+{
+    kTLVTagControl_Anonymous            = 0x00,
+    kTLVTagControl_ContextSpecific      = 0x20,
+    kTLVTagControl_FullyQualified_6Bytes = 0xC0,
+    kTLVTagControl_FullyQualified_8Bytes = 0xE0,
+
+    kTLVTagControlMask                  = 0xE0,
+    kTLVElementTypeMask                 = 0x1F,
+
+    kTLVElementType_BooleanFalse        = 0x08,
+    kTLVElementType_BooleanTrue         = 0x09,
+    kTLVElementType_EndOfContainer      = 0x18,
+};
+
+uint32_t TagLength(uint64_t tag)
+{
+    if (tag == AnonymousTag)
+    {
+        return 0;
+    }
+    if (IsContextTag(tag))
+    {
+        return 1;
+    }
+    return (TagNumFromTag(tag) <= 0xFFFF) ? 6 : 8;
+}
+
+/* Return the number of bytes (1, 2, 4 or 8) needed to hold a value, as a power of two index.
+ */
+uint8_t SignedIntSizeIndex(int64_t v)
+{
+    if (v >= INT8_MIN && v <= INT8_MAX)
+    {
+        return 0;
+    }
+    if (v >= INT16_MIN && v <= INT16_MAX)
+    {
+        return 1;
+    }
+    if (v >= INT32_MIN && v <= INT32_MAX)
+    {
+        return 2;
+    }
+    return 3;
+}
+
+uint8_t UnsignedIntSizeIndex(uint64_t v)
+{
+    if (v <= UINT8_MAX)
+    {
+        return 0;
+    }
+    if (v <= UINT16_MAX)
+    {
+        return 1;
+    }
+    if (v <= UINT32_MAX)
+    {
+        return 2;
+    }
+    return 3;
+}
+
+void HandleSystemTimer(void * arg)
+{
+    SystemTimer * timer = (SystemTimer *)arg;
+
+    timer->OnComplete(timer->Layer, timer->AppState, WEAVE_SYSTEM_NO_ERROR);
+}
+
+SystemTimer * FindSystemTimer(System::Layer::TimerCompleteFunct onComplete, void * appState)
+{
+    for (size_t i = 0; i < sSystemTimers.size(); i++)
+    {
+        if (sSystemTimers[i]->OnComplete == onComplete && sSystemTimers[i]->AppState == appState)
+        {
+            return sSystemTimers[i];
+        }
+    }
+    return NULL;
+}
+
+/* Write the tags of the path from the root of a trait to one of its properties, as the null
+ * elements that follow the instance locator in a WDM path.
+ */
+WEAVE_ERROR WritePathTags(const TraitSchemaEngine * schemaEngine, PropertyPathHandle handle, TLVWriter & writer)
+{
+    WEAVE_ERROR err = WEAVE_NO_ERROR;
+
+    if (handle != kRootPropertyPathHandle)
+    {
+        err = WritePathTags(schemaEngine, schemaEngine->GetParent(handle), writer);
+        SuccessOrExit(err);
+
+        err = writer.PutNull(schemaEngine->GetTag(handle));
+        SuccessOrExit(err);
+    }
+
+exit:
+    return err;
+}
+
+/* Encode a notification carrying a data element for each of the subscription's dirty
+ * properties.
+ */
+WEAVE_ERROR EncodeNotification(const Subscription & sub, uint64_t subscriptionId, TLVWriter & writer)
+{
+    const TraitSchemaEngine * schemaEngine = sub.DataSource->GetSchemaEngine();
+    TLVType notification, dataList, dataElement, path, instanceLocator;
+    WEAVE_ERROR err;
+
+    err = writer.StartContainer(AnonymousTag, kTLVType_Structure, notification);
+    SuccessOrExit(err);
+
+    err = writer.Put(ContextTag(NotificationRequest::kCsTag_SubscriptionId), subscriptionId);
+    SuccessOrExit(err);
+
+    err = writer.StartContainer(ContextTag(NotificationRequest::kCsTag_DataList), kTLVType_Array, dataList);
+    SuccessOrExit(err);
+
+    for (size_t i = 0; i < sub.DirtyHandles.size(); i++)
+    {
+        err = writer.StartContainer(AnonymousTag, kTLVType_Structure, dataElement);
+        SuccessOrExit(err);
+
+        err = writer.StartContainer(ContextTag(DataElement::kCsTag_Path), kTLVType_Path, path);
+        SuccessOrExit(err);
+
+        err = writer.StartContainer(ContextTag(Path::kCsTag_InstanceLocator), kTLVType_Structure, instanceLocator);
+        SuccessOrExit(err);
+
+        err = writer.Put(ContextTag(Path::kCsTag_TraitProfileID), schemaEngine->mSchema.mProfileId);
+        SuccessOrExit(err);
+
+        err = writer.EndContainer(instanceLocator);
+        SuccessOrExit(err);
+
+        err = WritePathTags(schemaEngine, sub.DirtyHandles[i], writer);
+        SuccessOrExit(err);
+
+        err = writer.EndContainer(path);
+        SuccessOrExit(err);
+
+        err = writer.Put(ContextTag(DataElement::kCsTag_Version), sub.DataSource->GetVersion());
+        SuccessOrExit(err);
+
+        err = sub.DataSource->ReadData(sub.DirtyHandles[i], ContextTag(DataElement::kCsTag_Data), writer);
+        SuccessOrExit(err);
+
+        err = writer.EndContainer(dataElement);
+        SuccessOrExit(err);
+    }
+
+    err = writer.EndContainer(dataList);
+    SuccessOrExit(err);
+
+    err = writer.EndContainer(notification);
+    SuccessOrExit(err);
+
+    err = writer.Finalize();
+    SuccessOrExit(err);
+
+exit:
+    return err;
+}
+
+/* Send a notification of its dirty properties to a subscriber, which holds the PacketBuffer
+ * carrying it until the notification is acknowledged.  The notification arrives half a round
+ * trip after it is sent.
+ */
+WEAVE_ERROR SendNotification(Subscription & sub, uint64_t subscriptionId)
+{
+    PacketBuffer * buf = PacketBuffer::New();
+    TLVWriter writer;
+    int64_t latencyUS;
+    WEAVE_ERROR err;
+
+    VerifyOrExit(buf != NULL, err = WEAVE_ERROR_NO_MEMORY);
+
+    writer.Init(buf);
+    err = EncodeNotification(sub, subscriptionId, writer);
+    SuccessOrExit(err);
+
+    HostSim::Spend(sPublisherLimits.NotifyCPUTimeUS);
+    sPublisherStats.NotifyCPUTimeUS += sPublisherLimits.NotifyCPUTimeUS;
+
+    latencyUS = HostSim::Now() + sub.RoundTripUS / 2 - sub.DirtySinceUS;
+    sub.Stats.Notifications++;
+    sub.Stats.DataElements += sub.DirtyHandles.size();
+    sub.Stats.Bytes += buf->DataLength();
+    sub.Stats.Version = sub.DataSource->GetVersion();
+    sub.Stats.TotalLatencyUS += latencyUS;
+    if (latencyUS > sub.Stats.MaxLatencyUS)
+    {
+        sub.Stats.MaxLatencyUS = latencyUS;
+    }
+    sub.DirtyHandles.clear();
+
+    sub.NotifyInFlight = buf;
+    buf = NULL;
+    sNotifiesInFlight++;
+    if (sNotifiesInFlight > sPublisherStats.MaxNotifiesInFlight)
+    {
+        sPublisherStats.MaxNotifiesInFlight = sNotifiesInFlight;
+    }
+    esp_timer_start_once(sub.AckTimer, sub.RoundTripUS);
+
+exit:
+    PacketBuffer::Free(buf);
+    return err;
+}
+
+/* Mark a property dirty for each subscriber to the data source, noting when each subscriber
+ * last went from having nothing to send to having something.  Marking the root supersedes any
+ * properties already marked.
+ */
+void MarkDirty(TraitDataSource * dataSource, PropertyPathHandle handle)
+{
+    for (size_t i = 0; i < sSubscriptions.size(); i++)
+    {
+        std::vector<PropertyPathHandle> & dirtyHandles = sSubscriptions[i]->DirtyHandles;
+
+        if (sSubscriptions[i]->DataSource != dataSource)
+        {
+            continue;
+        }
+        if (dirtyHandles.empty())
+        {
+            sSubscriptions[i]->DirtySinceUS = HostSim::Now();
+        }
+        if (handle == kRootPropertyPathHandle || (!dirtyHandles.empty() && dirtyHandles[0] == kRootPropertyPathHandle))
+        {
+            dirtyHandles.assign(1, kRootPropertyPathHandle);
+        }
+        else if (std::find(dirtyHandles.begin(), dirtyHandles.end(), handle) == dirtyHandles.end())
+        {
+            dirtyHandles.push_back(handle);
+        }
+    }
+}
+
+/* Release the PacketBuffer of an acknowledged notification, and run the notification engine
+ * again, as WDM does, in case further properties have been marked dirty in the meantime.
+ */
+void HandleNotificationAck(void * arg)
+{
+    Subscription * sub = (Subscription *)arg;
+
+    PacketBuffer::Free(sub->NotifyInFlight);
+    sub->NotifyInFlight = NULL;
+    sNotifiesInFlight--;
+
+    SubscriptionEngine::GetInstance()->GetNotificationEngine()->Run();
+}
+
+} // unnamed namespace
+
+namespace HostWeave {
+
+/* Forget the System Layer timers, device event handlers, published traits and subscribers,
+ * whose timers HostSim::Reset() has orphaned, freeing the PacketBuffers of unacknowledged
+ * notifications, and restore the default publisher limits and echo path.  PacketBuffers still
+ * held by the code under test remain counted as in use.
+ */
+void Reset(void)
+{
+    for (size_t i = 0; i < sSystemTimers.size(); i++)
+    {
+        delete sSystemTimers[i];
+    }
+    sSystemTimers.clear();
+    for (size_t i = 0; i < sSubscriptions.size(); i++)
+    {
+        PacketBuffer::Free(sSubscriptions[i]->NotifyInFlight);
+        delete sSubscriptions[i];
+    }
+    sSubscriptions.clear();
+    sEventHandlers.clear();
+    sPublishedTraits.clear();
+    sNextSubscription = 0;
+    sNotifiesInFlight = 0;
+    memset(&sPublisherLimits, 0, sizeof(sPublisherLimits));
+    memset(&sPublisherStats, 0, sizeof(sPublisherStats));
+    sEchoPath = kDefaultEchoPath;
+    sEchosSent = 0;
+    sFragmentedEchos = 0;
+    sPacketBufsHighWater = sPacketBufsInUse;
+}
+
+/* Deliver a device event to the handlers registered with PlatformMgr().AddEventHandler().
+ */
+void DispatchEvent(const WeaveDeviceEvent & event)
+{
+    for (size_t i = 0; i < sEventHandlers.size(); i++)
+    {
+        sEventHandlers[i].Handler(&event, sEventHandlers[i].Arg);
+    }
+}
+
+void SetEchoPath(const EchoPath & path)
+{
+    sEchoPath = path;
+}
+
+uint32_t GetEchosSent(void)
+{
+    return sEchosSent;
+}
+
+uint16_t GetPacketBuffersInUse(void)
+{
+    return sPacketBufsInUse;
+}
+
+/* Subscribe the given number of simulated subscribers to a published trait data source, up to
+ * the capacity of the subscription engine.  Returns the number subscribed.
+ */
+uint16_t AddSubscribers(TraitDataSource & dataSource, uint16_t count, int64_t roundTripUS)
+{
+    uint16_t added = 0;
+
+    if (std::find(sPublishedTraits.begin(), sPublishedTraits.end(), &dataSource) == sPublishedTraits.end())
+    {
+        return 0;
+    }
+
+    while (added < count && sSubscriptions.size() < SubscriptionEngine::kMaxNumSubscriptionHandlers)
+    {
+        Subscription * sub = new Subscription();
+        esp_timer_create_args_t args;
+
+        sub->DataSource = &dataSource;
+        sub->RoundTripUS = roundTripUS;
+        sub->DirtyHandles.assign(1, kRootPropertyPathHandle);
+        sub->DirtySinceUS = HostSim::Now();
+        sub->NotifyInFlight = NULL;
+        memset(&sub->Stats, 0, sizeof(sub->Stats));
+
+        memset(&args, 0, sizeof(args));
+        args.callback = HandleNotificationAck;
+        args.arg = sub;
+        args.name = "notify-ack";
+        esp_timer_create(&args, &sub->AckTimer);
+
+        sSubscriptions.push_back(sub);
+        added++;
+    }
+
+    return added;
+}
+
+uint16_t GetNumSubscribers(void)
+{
+    return (uint16_t)sSubscriptions.size();
+}
+
+const SubscriberStats & GetSubscriberStats(uint16_t index)
+{
+    return sSubscriptions[index]->Stats;
+}
+
+void SetPublisherLimits(const PublisherLimits & limits)
+{
+    sPublisherLimits = limits;
+}
+
+const PublisherStats & GetPublisherStats(void)
+{
+    return sPublisherStats;
+}
+
+/* Clear the subscriber and publisher statistics, leaving the subscribers and any notifications
+ * in flight in place.
+ */
+void ResetStats(void)
+{
+    for (size_t i = 0; i < sSubscriptions.size(); i++)
+    {
+        memset(&sSubscriptions[i]->Stats, 0, sizeof(sSubscriptions[i]->Stats));
+    }
+    memset(&sPublisherStats, 0, sizeof(sPublisherStats));
+    sPublisherStats.MaxNotifiesInFlight = sNotifiesInFlight;
+}
+
+} // namespace HostWeave
+
+namespace nl {
+namespace Weave {
+
+namespace System {
+
+uint8_t * PacketBuffer::Start(void) const
+{
+    return mStart;
+}
+
+/* Move the start of the data, keeping its end where it is.
+ */
+void PacketBuffer::SetStart(uint8_t * aNewStart)
+{
+    uint8_t * end = mStart + mDataLen;
+
+    if (aNewStart < mBuf)
+    {
+        aNewStart = mBuf;
+    }
+    if (aNewStart > end)
+    {
+        aNewStart = end;
+    }
+    mStart = aNewStart;
+    mDataLen = (uint16_t)(end - aNewStart);
+}
+
+uint16_t PacketBuffer::DataLength(void) const
+{
+    return mDataLen;
+}
+
+void PacketBuffer::SetDataLength(uint16_t aNewLen)
+{
+    mDataLen = (aNewLen <= MaxDataLength()) ? aNewLen : MaxDataLength();
+}
+
+uint16_t PacketBuffer::MaxDataLength(void) const
+{
+    return (uint16_t)(mBuf + kBufferSize - mStart);
+}
+
+uint16_t PacketBuffer::AvailableDataLength(void) const
+{
+    return MaxDataLength() - mDataLen;
+}
+
+void PacketBuffer::AddRef(void)
+{
+    mRefCount++;
+}
+
+PacketBuffer * PacketBuffer::New(void)
+{
+    PacketBuffer * buf;
+
+    if (sPublisherLimits.NumPacketBuffers != 0 && sPacketBufsInUse >= sPublisherLimits.NumPacketBuffers)
+    {
+        sPublisherStats.PacketBufferExhaustions++;
+        return NULL;
+    }
+
+    buf = new PacketBuffer();
+
+    buf->mStart = buf->mBuf + kHeaderReserve;
+    buf->mDataLen = 0;
+    buf->mRefCount = 1;
+    sPacketBufsInUse++;
+    if (sPacketBufsInUse > sPacketBufsHighWater)
+    {
+        sPacketBufsHighWater = sPacketBufsInUse;
+    }
+
+    return buf;
+}
+
+void PacketBuffer::Free(PacketBuffer * aPacket)
+{
+    if (aPacket != NULL && --aPacket->mRefCount == 0)
+    {
+        delete aPacket;
+        sPacketBufsInUse--;
+    }
+}
+
+/* Start a timer, or restart it if it is already running, as identified by its completion
+ * function and application state.
+ */
+Error Layer::StartTimer(uint32_t aMilliseconds, TimerCompleteFunct aComplete, void * aAppState)
+{
+    SystemTimer * timer = FindSystemTimer(aComplete, aAppState);
+
+    if (timer == NULL)
+    {
+        esp_timer_create_args_t args;
+
+        timer = new SystemTimer();
+        timer->OnComplete = aComplete;
+        timer->AppState = aAppState;
+        memset(&args, 0, sizeof(args));
+        args.callback = HandleSystemTimer;
+        args.arg = timer;
+        args.name = "weave";
+        esp_timer_create(&args, &timer->Timer);
+        sSystemTimers.push_back(timer);
+    }
+    else
+    {
+        esp_timer_stop(timer->Timer);
+    }
+
+    timer->Layer = this;
+    esp_timer_start_once(timer->Timer, (uint64_t)aMilliseconds * 1000);
+
+    return WEAVE_SYSTEM_NO_ERROR;
+}
+
+void Layer::CancelTimer(TimerCompleteFunct aOnComplete, void * aAppState)
+{
+    SystemTimer * timer = FindSystemTimer(aOnComplete, aAppState);
+
+    if (timer != NULL)
+    {
+        esp_timer_stop(timer->Timer);
+    }
+}
+
+/* The simulated device never has its real time clock set.
+ */
+Error Layer::GetClock_RealTimeMS(uint64_t & curTime)
+{
+    curTime = 0;
+    return WEAVE_SYSTEM_ERROR_REAL_TIME_NOT_SYNCED;
+}
+
+namespace Stats {
+
+count_t * GetResourcesInUse(void)
+{
+    return sResourcesInUse;
+}
+
+count_t * GetHighWatermarks(void)
+{
+    return sHighWatermarks;
+}
+
+void UpdateLwipPbufCounts(void)
+{
+    sResourcesInUse[kSystemLayer_NumPacketBufs] = sPacketBufsInUse;
+    sHighWatermarks[kSystemLayer_NumPacketBufs] = sPacketBufsHighWater;
+}
+
+} // namespace Stats
+} // namespace System
+
+Binding::Binding(EventCallback eventCallback, void * appState)
+    : AppState(appState),
+      mState(kState_NotConfigured),
+      mEventCallback(eventCallback),
+      mResponseTimeoutMsec(0)
+{
+}
+
+Binding::Configuration Binding::BeginConfiguration(void)
+{
+    Configuration config;
+
+    config.mBinding = this;
+    return config;
+}
+
+/* Ask the application to configure and prepare the binding.  As no connection or session needs
+ * to be established, the binding becomes ready as soon as the application prepares it.
+ */
+WEAVE_ERROR Binding::RequestPrepare(void)
+{
+    InEventParam inParam;
+    OutEventParam outParam;
+
+    memset(&inParam, 0, sizeof(inParam));
+    memset(&outParam, 0, sizeof(outParam));
+    inParam.Source = this;
+    outParam.PrepareRequested.PrepareError = WEAVE_NO_ERROR;
+
+    mState = kState_Preparing;
+    mEventCallback(AppState, kEvent_PrepareRequested, inParam, outParam);
+    if (outParam.PrepareRequested.PrepareError != WEAVE_NO_ERROR)
+    {
+        mState = kState_Failed;
+    }
+
+    return outParam.PrepareRequested.PrepareError;
+}
+
+Binding::State Binding::GetState(void) const
+{
+    return mState;
+}
+
+bool Binding::IsPreparing(void) const
+{
+    return mState == kState_Preparing;
+}
+
+uint32_t Binding::GetDefaultResponseTimeout(void) const
+{
+    return mResponseTimeoutMsec;
+}
+
+WEAVE_ERROR Binding::NewExchangeContext(ExchangeContext *& appExchangeContext)
+{
+    WEAVE_ERROR err = WEAVE_NO_ERROR;
+
+    VerifyOrExit(mState == kState_Ready, err = WEAVE_ERROR_INCORRECT_STATE);
+
+    appExchangeContext = new ExchangeContext();
+    memset(appExchangeContext, 0, sizeof(*appExchangeContext));
+
+exit:
+    return err;
+}
+
+void Binding::DefaultEventHandler(void * apAppState, EventType aEvent, const InEventParam & aInParam, OutEventParam & aOutParam)
+{
+    aOutParam.DefaultHandlerCalled = true;
+}
+
+Binding::Configuration & Binding::Configuration::Target_NodeId(uint64_t aNodeId)
+{
+    return *this;
+}
+
+Binding::Configuration & Binding::Configuration::Target_ServiceEndpoint(uint64_t serviceEndpointId)
+{
+    return *this;
+}
+
+Binding::Configuration & Binding::Configuration::TargetAddress_WeaveFabric(uint8_t aSubnetId)
+{
+    return *this;
+}
+
+Binding::Configuration & Binding::Configuration::Transport_DefaultWRMPConfig(const WRMPConfig & aWRMPConfig)
+{
+    return *this;
+}
+
+Binding::Configuration & Binding::Configuration::Transport_UDP_WRM(void)
+{
+    return *this;
+}
+
+Binding::Configuration & Binding::Configuration::Security_SharedCASESession(void)
+{
+    return *this;
+}
+
+Binding::Configuration & Binding::Configuration::Security_None(void)
+{
+    return *this;
+}
+
+Binding::Configuration & Binding::Configuration::Exchange_ResponseTimeoutMsec(uint32_t aResponseTimeoutMsec)
+{
+    mBinding->mResponseTimeoutMsec = aResponseTimeoutMsec;
+    return *this;
+}
+
+WEAVE_ERROR Binding::Configuration::PrepareBinding(void)
+{
+    InEventParam inParam;
+    OutEventParam outParam;
+
+    memset(&inParam, 0, sizeof(inParam));
+    memset(&outParam, 0, sizeof(outParam));
+    inParam.Source = mBinding;
+
+    mBinding->mState = kState_Ready;
+    mBinding->mEventCallback(mBinding->AppState, kEvent_BindingReady, inParam, outParam);
+
+    return WEAVE_NO_ERROR;
+}
+
+Binding * WeaveExchangeManager::NewBinding(Binding::EventCallback eventCallback, void * appState)
+{
+    return new Binding(eventCallback, appState);
+}
+
+/* Discard a message, which is neither delivered nor acknowledged.
+ */
+WEAVE_ERROR ExchangeContext::SendMessage(uint32_t profileId, uint8_t msgType, PacketBuffer * msgPayload)
+{
+    PacketBuffer::Free(msgPayload);
+    return WEAVE_NO_ERROR;
+}
+
+void ExchangeContext::Abort(void)
+{
+    delete this;
+}
+
+namespace DeviceLayer {
+
+WeaveFabricState FabricState;
+WeaveExchangeManager ExchangeMgr;
+System::Layer SystemLayer;
+
+WEAVE_ERROR TraitManager::PublishTrait(const uint64_t & instanceId, TraitDataSource * dataSource)
+{
+    sPublishedTraits.push_back(dataSource);
+    return WEAVE_NO_ERROR;
+}
+
+WEAVE_ERROR PlatformManager::AddEventHandler(EventHandlerFunct handler, intptr_t arg)
+{
+    EventHandler entry = { handler, arg };
+
+    sEventHandlers.push_back(entry);
+    return WEAVE_NO_ERROR;
+}
+
+void PlatformManager::LockWeaveStack(void)
+{
+}
+
+void PlatformManager::UnlockWeaveStack(void)
+{
+}
+
+PlatformManager & PlatformMgr(void)
+{
+    static PlatformManager sPlatformMgr;
+    return sPlatformMgr;
+}
+
+TraitManager & TraitMgr(void)
+{
+    static TraitManager sTraitMgr;
+    return sTraitMgr;
+}
+
+} // namespace DeviceLayer
+
+namespace TLV {
+
+void TLVWriter::Init(uint8_t * buf, uint32_t maxLen)
+{
+    mBuf = buf;
+    mMaxLen = maxLen;
+    mLenWritten = 0;
+    mContainerType = kTLVType_NotSpecified;
+    mPacketBuf = NULL;
+}
+
+/* Write after any data already in the buffer.  Finalize() adds the bytes written to the
+ * buffer's data length.
+ */
+void TLVWriter::Init(PacketBuffer * buf)
+{
+    Init(buf->Start() + buf->DataLength(), buf->AvailableDataLength());
+    mPacketBuf = buf;
+}
+
+WEAVE_ERROR TLVWriter::Put(uint64_t tag, int8_t v)
+{
+    return Put(tag, (int64_t)v);
+}
+
+WEAVE_ERROR TLVWriter::Put(uint64_t tag, int16_t v)
+{
+    return Put(tag, (int64_t)v);
+}
+
+WEAVE_ERROR TLVWriter::Put(uint64_t tag, int32_t v)
+{
+    return Put(tag, (int64_t)v);
+}
+
+WEAVE_ERROR TLVWriter::Put(uint64_t tag, int64_t v)
+{
+    uint8_t sizeIndex = SignedIntSizeIndex(v);
+
+    return WriteInteger(tag, kTLVType_SignedInteger | sizeIndex, (uint64_t)v, 1u << sizeIndex);
+}
+
+WEAVE_ERROR TLVWriter::Put(uint64_t tag, uint8_t v)
+{
+    return Put(tag, (uint64_t)v);
+}
+
+WEAVE_ERROR TLVWriter::Put(uint64_t tag, uint16_t v)
+{
+    return Put(tag, (uint64_t)v);
+}
+
+WEAVE_ERROR TLVWriter::Put(uint64_t tag, uint32_t v)
+{
+    return Put(tag, (uint64_t)v);
+}
+
+WEAVE_ERROR TLVWriter::Put(uint64_t tag, uint64_t v)
+{
+    uint8_t sizeIndex = UnsignedIntSizeIndex(v);
+
+    return WriteInteger(tag, kTLVType_UnsignedInteger | sizeIndex, v, 1u << sizeIndex);
+}
+
+WEAVE_ERROR TLVWriter::PutBoolean(uint64_t tag, bool v)
+{
+    return WriteElementHead(v ? kTLVElementType_BooleanTrue : kTLVElementType_BooleanFalse, tag, 0);
+}
+
+WEAVE_ERROR TLVWriter::PutNull(uint64_t tag)
+{
+    return WriteElementHead(kTLVType_Null, tag, 0);
+}
+
+WEAVE_ERROR TLVWriter::StartContainer(uint64_t tag, TLVType containerType, TLVType & outerContainerType)
+{
+    WEAVE_ERROR err;
+
+    err = WriteElementHead((uint8_t)containerType, tag, 0);
+    SuccessOrExit(err);
+
+    outerContainerType = mContainerType;
+    mContainerType = containerType;
+
+exit:
+    return err;
+}
+
+WEAVE_ERROR TLVWriter::EndContainer(TLVType outerContainerType)
+{
+    WEAVE_ERROR err;
+
+    err = WriteElementHead(kTLVElementType_EndOfContainer, AnonymousTag, 0);
+    SuccessOrExit(err);
+
+    mContainerType = outerContainerType;
+
+exit:
+    return err;
+}
+
+WEAVE_ERROR TLVWriter::Finalize(void)
+{
+    if (mPacketBuf != NULL)
+    {
+        mPacketBuf->SetDataLength(mPacketBuf->DataLength() + mLenWritten);
+    }
+    return WEAVE_NO_ERROR;
+}
+
+uint32_t TLVWriter::GetLengthWritten(void)
+{
+    return mLenWritten;
+}
+
+/* Write the control byte and tag of an element, checking that the element, with a value of the
+ * given length, fits in the buffer.
+ */
+WEAVE_ERROR TLVWriter::WriteElementHead(uint8_t elemType, uint64_t tag, uint32_t valueLen)
+{
+    uint32_t tagLen = TagLength(tag);
+    uint8_t * p;
+
+    if (mLenWritten + 1 + tagLen + valueLen > mMaxLen)
+    {
+        return WEAVE_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    p = mBuf + mLenWritten;
+    switch (tagLen)
+    {
+    case 0:
+        *p++ = kTLVTagControl_Anonymous | elemType;
+        break;
+    case 1:
+        *p++ = kTLVTagControl_ContextSpecific | elemType;
+        *p++ = (uint8_t)TagNumFromTag(tag);
+        break;
+    default:
+        *p++ = ((tagLen == 6) ? kTLVTagControl_FullyQualified_6Bytes : kTLVTagControl_FullyQualified_8Bytes) | elemType;
+        // Vendor id, then profile number, then tag number, each little-endian.
+        *p++ = (uint8_t)(tag >> 48);
+        *p++ = (uint8_t)(tag >> 56);
+        *p++ = (uint8_t)(tag >> 32);
+        *p++ = (uint8_t)(tag >> 40);
+        for (uint32_t i = 0; i < tagLen - 4; i++)
+        {
+            *p++ = (uint8_t)(tag >> (8 * i));
+        }
+        break;
+    }
+    mLenWritten += 1 + tagLen;
+
+    return WEAVE_NO_ERROR;
+}
+
+WEAVE_ERROR TLVWriter::WriteInteger(uint64_t tag, uint8_t elemType, uint64_t v, uint32_t valueLen)
+{
+    WEAVE_ERROR err;
+
+    err = WriteElementHead(elemType, tag, valueLen);
+    SuccessOrExit(err);
+
+    for (uint32_t i = 0; i < valueLen; i++)
+    {
+        mBuf[mLenWritten++] = (uint8_t)(v >> (8 * i));
+    }
+
+exit:
+    return err;
+}
+
+void TLVReader::Init(const uint8_t * data, uint32_t dataLen)
+{
+    mBuf = data;
+    mLen = dataLen;
+    mReadPoint = 0;
+    mElemType = -1;
+    mElemTag = AnonymousTag;
+    mElemValue = 0;
+    mContainerType = kTLVType_NotSpecified;
+    mContainerOpen = false;
+}
+
+void TLVReader::Init(PacketBuffer * buf)
+{
+    Init(buf->Start(), buf->DataLength());
+}
+
+/* Advance to the next element in the current container, skipping the contents of the current
+ * element if it is a container that has not been entered.  Returns WEAVE_END_OF_TLV at the end
+ * of the container.
+ */
+WEAVE_ERROR TLVReader::Next(void)
+{
+    WEAVE_ERROR err;
+
+    if (mContainerOpen)
+    {
+        err = SkipContainer();
+        SuccessOrExit(err);
+    }
+
+    mElemType = -1;
+    mElemTag = AnonymousTag;
+
+    VerifyOrExit(mReadPoint < mLen, err = (mContainerType == kTLVType_NotSpecified) ? WEAVE_END_OF_TLV : WEAVE_ERROR_TLV_UNDERRUN);
+
+    if (mBuf[mReadPoint] == kTLVElementType_EndOfContainer)
+    {
+        ExitNow(err = (mContainerType != kTLVType_NotSpecified) ? WEAVE_END_OF_TLV : WEAVE_ERROR_INVALID_TLV_ELEMENT);
+    }
+
+    err = ReadElement();
+    SuccessOrExit(err);
+
+exit:
+    return err;
+}
+
+TLVType TLVReader::GetType(void) const
+{
+    if (mElemType < 0)
+    {
+        return kTLVType_NotSpecified;
+    }
+    if (mElemType <= kTLVType_SignedInteger + 3)
+    {
+        return kTLVType_SignedInteger;
+    }
+    if (mElemType <= kTLVType_UnsignedInteger + 3)
+    {
+        return kTLVType_UnsignedInteger;
+    }
+    if (mElemType <= kTLVElementType_BooleanTrue)
+    {
+        return kTLVType_Boolean;
+    }
+    return (TLVType)mElemType;
+}
+
+uint64_t TLVReader::GetTag(void) const
+{
+    return mElemTag;
+}
+
+WEAVE_ERROR TLVReader::Get(bool & v)
+{
+    if (GetType() != kTLVType_Boolean)
+    {
+        return WEAVE_ERROR_WRONG_TLV_TYPE;
+    }
+    v = (mElemType == kTLVElementType_BooleanTrue);
+    return WEAVE_NO_ERROR;
+}
+
+/* As in OpenWeave, integers of either signedness can be read into any integer type, and are
+ * truncated to its size.
+ */
+WEAVE_ERROR TLVReader::Get(int8_t & v)
+{
+    uint64_t v64 = 0;
+    WEAVE_ERROR err = Get(v64);
+    v = (int8_t)v64;
+    return err;
+}
+
+WEAVE_ERROR TLVReader::Get(int16_t & v)
+{
+    uint64_t v64 = 0;
+    WEAVE_ERROR err = Get(v64);
+    v = (int16_t)v64;
+    return err;
+}
+
+WEAVE_ERROR TLVReader::Get(int32_t & v)
+{
+    uint64_t v64 = 0;
+    WEAVE_ERROR err = Get(v64);
+    v = (int32_t)v64;
+    return err;
+}
+
+WEAVE_ERROR TLVReader::Get(int64_t & v)
+{
+    uint64_t v64 = 0;
+    WEAVE_ERROR err = Get(v64);
+    v = (int64_t)v64;
+    return err;
+}
+
+WEAVE_ERROR TLVReader::Get(uint8_t & v)
+{
+    uint64_t v64 = 0;
+    WEAVE_ERROR err = Get(v64);
+    v = (uint8_t)v64;
+    return err;
+}
+
+WEAVE_ERROR TLVReader::Get(uint16_t & v)
+{
+    uint64_t v64 = 0;
+    WEAVE_ERROR err = Get(v64);
+    v = (uint16_t)v64;
+    return err;
+}
+
+WEAVE_ERROR TLVReader::Get(uint32_t & v)
+{
+    uint64_t v64 = 0;
+    WEAVE_ERROR err = Get(v64);
+    v = (uint32_t)v64;
+    return err;
+}
+
+WEAVE_ERROR TLVReader::Get(uint64_t & v)
+{
+    if (GetType() != kTLVType_SignedInteger && GetType() != kTLVType_UnsignedInteger)
+    {
+        return WEAVE_ERROR_WRONG_TLV_TYPE;
+    }
+    v = mElemValue;
+    return WEAVE_NO_ERROR;
+}
+
+WEAVE_ERROR TLVReader::EnterContainer(TLVType & outerContainerType)
+{
+    if (!mContainerOpen)
+    {
+        return WEAVE_ERROR_INCORRECT_STATE;
+    }
+
+    outerContainerType = mContainerType;
+    mContainerType = (TLVType)mElemType;
+    mContainerOpen = false;
+    mElemType = -1;
+    mElemTag = AnonymousTag;
+
+    return WEAVE_NO_ERROR;
+}
+
+/* Skip any elements remaining in the current container, and its end.
+ */
+WEAVE_ERROR TLVReader::ExitContainer(TLVType outerContainerType)
+{
+    WEAVE_ERROR err;
+
+    while ((err = Next()) == WEAVE_NO_ERROR)
+    {
+    }
+    VerifyOrExit(err == WEAVE_END_OF_TLV, /* */);
+
+    mReadPoint++;
+    mContainerType = outerContainerType;
+    mElemType = -1;
+    mElemTag = AnonymousTag;
+    err = WEAVE_NO_ERROR;
+
+exit:
+    return err;
+}
+
+/* Read the control byte, tag and value of the element at the read point, leaving the read point
+ * at the next element or, for a container, at its first member.
+ */
+WEAVE_ERROR TLVReader::ReadElement(void)
+{
+    uint8_t control = mBuf[mReadPoint];
+    uint8_t elemType = control & kTLVElementTypeMask;
+    uint32_t tagLen;
+    uint32_t valueLen = 0;
+    uint64_t value = 0;
+    const uint8_t * p;
+    WEAVE_ERROR err = WEAVE_NO_ERROR;
+
+    switch (control & kTLVTagControlMask)
+    {
+    case kTLVTagControl_Anonymous:
+        tagLen = 0;
+        break;
+    case kTLVTagControl_ContextSpecific:
+        tagLen = 1;
+        break;
+    case kTLVTagControl_FullyQualified_6Bytes:
+        tagLen = 6;
+        break;
+    case kTLVTagControl_FullyQualified_8Bytes:
+        tagLen = 8;
+        break;
+    default:
+        ExitNow(err = WEAVE_ERROR_INVALID_TLV_ELEMENT);
+    }
+
+    if (elemType <= kTLVType_UnsignedInteger + 3)
+    {
+        valueLen = 1u << (elemType & 3);
+    }
+    else
+    {
+        VerifyOrExit(elemType == kTLVElementType_BooleanFalse || elemType == kTLVElementType_BooleanTrue ||
+                     elemType == kTLVType_Null || elemType == kTLVType_Structure || elemType == kTLVType_Array ||
+                     elemType == kTLVType_Path, err = WEAVE_ERROR_INVALID_TLV_ELEMENT);
+    }
+
+    VerifyOrExit(mReadPoint + 1 + tagLen + valueLen <= mLen, err = WEAVE_ERROR_TLV_UNDERRUN);
+    p = mBuf + mReadPoint + 1;
+
+    switch (tagLen)
+    {
+    case 0:
+        mElemTag = AnonymousTag;
+        break;
+    case 1:
+        mElemTag = ContextTag(p[0]);
+        break;
+    default:
+        // Vendor id, then profile number, then tag number, each little-endian.
+        mElemTag = ((uint64_t)(p[0] | (p[1] << 8)) << 48) | ((uint64_t)(p[2] | (p[3] << 8)) << 32);
+        for (uint32_t i = 0; i < tagLen - 4; i++)
+        {
+            mElemTag |= (uint64_t)p[4 + i] << (8 * i);
+        }
+        break;
+    }
+    p += tagLen;
+
+    for (uint32_t i = 0; i < valueLen; i++)
+    {
+        value |= (uint64_t)p[i] << (8 * i);
+    }
+    if (elemType <= kTLVType_SignedInteger + 3 && valueLen < 8 && (value & (1ull << (8 * valueLen - 1))) != 0)
+    {
+        value |= ~0ull << (8 * valueLen);
+    }
+
+    mElemType = elemType;
+    mElemValue = value;
+    mContainerOpen = (elemType == kTLVType_Structure || elemType == kTLVType_Array || elemType == kTLVType_Path);
+    mReadPoint += 1 + tagLen + valueLen;
+
+exit:
+    return err;
+}
+
+/* Skip the members of the current element, a container that has not been entered, and its end.
+ */
+WEAVE_ERROR TLVReader::SkipContainer(void)
+{
+    uint32_t depth = 1;
+    WEAVE_ERROR err = WEAVE_NO_ERROR;
+
+    mContainerOpen = false;
+    while (depth > 0)
+    {
+        VerifyOrExit(mReadPoint < mLen, err = WEAVE_ERROR_TLV_UNDERRUN);
+
+        if (mBuf[mReadPoint] == kTLVElementType_EndOfContainer)
+        {
+            mReadPoint++;
+            depth--;
+        }
+        else
+        {
+            err = ReadElement();
+            SuccessOrExit(err);
+            if (mContainerOpen)
+            {
+                mContainerOpen = false;
+                depth++;
+            }
+        }
+    }
+
+exit:
+    return err;
+}
+
+} // namespace TLV
+
+namespace Profiles {
+namespace DataManagement_Current {
+
+/* The schema's property table has one entry for each property other than the root, indexed by
+ * handle - 2.
+ */
+PropertyPathHandle TraitSchemaEngine::GetParent(PropertyPathHandle aHandle) const
+{
+    return (aHandle > kRootPropertyPathHandle) ? mSchema.mSchemaHandleTbl[aHandle - 2].mParentHandle : kNullPropertyPathHandle;
+}
+
+uint64_t TraitSchemaEngine::GetTag(PropertyPathHandle aHandle) const
+{
+    return (aHandle > kRootPropertyPathHandle) ? ContextTag(mSchema.mSchemaHandleTbl[aHandle - 2].mContextTag) : AnonymousTag;
+}
+
+PropertyPathHandle TraitSchemaEngine::GetChildHandle(PropertyPathHandle aParentHandle, uint8_t aContextTag) const
+{
+    for (uint32_t i = 0; i < mSchema.mNumSchemaHandleEntries; i++)
+    {
+        if (mSchema.mSchemaHandleTbl[i].mParentHandle == aParentHandle && mSchema.mSchemaHandleTbl[i].mContextTag == aContextTag)
+        {
+            return (PropertyPathHandle)(i + 2);
+        }
+    }
+    return kNullPropertyPathHandle;
+}
+
+PropertyPathHandle TraitSchemaEngine::GetFirstChild(PropertyPathHandle aParentHandle) const
+{
+    return GetNextChild(aParentHandle, kRootPropertyPathHandle);
+}
+
+PropertyPathHandle TraitSchemaEngine::GetNextChild(PropertyPathHandle aParentHandle, PropertyPathHandle aChildHandle) const
+{
+    for (uint32_t i = aChildHandle - 1; i < mSchema.mNumSchemaHandleEntries; i++)
+    {
+        if (mSchema.mSchemaHandleTbl[i].mParentHandle == aParentHandle)
+        {
+            return (PropertyPathHandle)(i + 2);
+        }
+    }
+    return kNullPropertyPathHandle;
+}
+
+bool TraitSchemaEngine::IsLeaf(PropertyPathHandle aHandle) const
+{
+    return aHandle > kRootPropertyPathHandle && GetFirstChild(aHandle) == kNullPropertyPathHandle;
+}
+
+bool TraitSchemaEngine::IsNullable(PropertyPathHandle aHandle) const
+{
+    uint32_t index = aHandle - 2;
+
+    return aHandle > kRootPropertyPathHandle && mSchema.mIsNullableBitfield != NULL &&
+           (mSchema.mIsNullableBitfield[index / 8] & (1u << (index % 8))) != 0;
+}
+
+TraitDataSource::TraitDataSource(const TraitSchemaEngine * aEngine)
+    : mSchemaEngine(aEngine),
+      mVersion(0),
+      mSetDirtyCalled(false)
+{
+}
+
+WEAVE_ERROR TraitDataSource::Lock(void)
+{
+    return WEAVE_NO_ERROR;
+}
+
+/* As in WDM, the trait version is incremented once for all the properties marked dirty while
+ * the data source was locked.
+ */
+WEAVE_ERROR TraitDataSource::Unlock(void)
+{
+    if (mSetDirtyCalled)
+    {
+        mVersion++;
+        mSetDirtyCalled = false;
+    }
+    return WEAVE_NO_ERROR;
+}
+
+void TraitDataSource::SetDirty(PropertyPathHandle aPropertyHandle)
+{
+    mSetDirtyCalled = true;
+    MarkDirty(this, aPropertyHandle);
+}
+
+void TraitDataSource::OnCustomCommand(Command * aCommand, const WeaveMessageInfo * aMsgInfo, PacketBuffer * aPayload,
+        const uint64_t & aCommandType, const bool aIsExpiryTimeValid, const int64_t & aExpiryTimeMicroSecond,
+        const bool aIsMustBeVersionValid, const uint64_t & aMustBeVersion, TLV::TLVReader & aArgumentReader)
+{
+    aCommand->SendError(kWeaveProfile_Common, Common::kStatus_UnsupportedMessage, WEAVE_NO_ERROR);
+    aCommand->Close();
+    PacketBuffer::Free(aPayload);
+}
+
+/* Write the property identified by aHandle, with the given tag.  Leaves are written by the data
+ * source's GetLeafData(); other properties are written as structures containing their children.
+ */
+WEAVE_ERROR TraitDataSource::ReadData(PropertyPathHandle aHandle, uint64_t aTagToWrite, TLV::TLVWriter & aWriter)
+{
+    WEAVE_ERROR err;
+    TLV::TLVType container;
+
+    if (mSchemaEngine->IsLeaf(aHandle))
+    {
+        return GetLeafData(aHandle, aTagToWrite, aWriter);
+    }
+
+    err = aWriter.StartContainer(aTagToWrite, TLV::kTLVType_Structure, container);
+    SuccessOrExit(err);
+
+    for (PropertyPathHandle child = mSchemaEngine->GetFirstChild(aHandle); child != kNullPropertyPathHandle;
+         child = mSchemaEngine->GetNextChild(aHandle, child))
+    {
+        err = ReadData(child, mSchemaEngine->GetTag(child), aWriter);
+        SuccessOrExit(err);
+    }
+
+    err = aWriter.EndContainer(container);
+    SuccessOrExit(err);
+
+exit:
+    return err;
+}
+
+WEAVE_ERROR Command::SendResponse(uint32_t traitInstanceVersion, PacketBuffer * apPayload)
+{
+    PacketBuffer::Free(apPayload);
+    return WEAVE_NO_ERROR;
+}
+
+WEAVE_ERROR Command::SendError(uint32_t aProfileId, uint16_t aStatusCode, WEAVE_ERROR aWeaveError)
+{
+    return WEAVE_NO_ERROR;
+}
+
+void Command::Close(void)
+{
+}
+
+/* Send notifications to the subscribers with dirty properties, in the order they subscribed,
+ * skipping those still waiting for their previous notification to be acknowledged.
+ */
+/* Notify each subscriber with dirty properties in turn, starting from where the last run left
+ * off, until all have been notified, the limit of notifications in flight is reached or a
+ * notification cannot be sent.
+ */
+void NotificationEngine::Run(void)
+{
+    for (size_t i = 0; i < sSubscriptions.size(); i++)
+    {
+        Subscription & sub = *sSubscriptions[sNextSubscription];
+
+        if (sub.NotifyInFlight == NULL && !sub.DirtyHandles.empty())
+        {
+            if (sPublisherLimits.MaxNotifiesInFlight != 0 && sNotifiesInFlight >= sPublisherLimits.MaxNotifiesInFlight)
+            {
+                break;
+            }
+            if (SendNotification(sub, sNextSubscription) != WEAVE_NO_ERROR)
+            {
+                break;
+            }
+        }
+        sNextSubscription = (sNextSubscription + 1) % sSubscriptions.size();
+    }
+}
+
+SubscriptionEngine * SubscriptionEngine::GetInstance(void)
+{
+    static SubscriptionEngine sInstance;
+    return &sInstance;
+}
+
+uint16_t SubscriptionEngine::GetNumUnusedHandlers(void) const
+{
+    return (uint16_t)(kMaxNumSubscriptionHandlers - sSubscriptions.size());
+}
+
+NotificationEngine * SubscriptionEngine::GetNotificationEngine(void)
+{
+    return &mNotificationEngine;
+}
+
+} // namespace DataManagement_Current
+
+namespace Echo_Next {
+
+WeaveEchoClient::WeaveEchoClient(void)
+    : AppState(NULL),
+      mBinding(NULL),
+      mEventCallback(NULL),
+      mTimer(NULL),
+      mRequestLen(0),
+      mRequestLost(false)
+{
+}
+
+WEAVE_ERROR WeaveEchoClient::Init(Binding * binding, EventCallback eventCallback, void * appState)
+{
+    esp_timer_create_args_t args;
+
+    mBinding = binding;
+    mEventCallback = eventCallback;
+    AppState = appState;
+
+    memset(&args, 0, sizeof(args));
+    args.callback = HandleTimer;
+    args.arg = this;
+    args.name = "echo";
+    esp_timer_create(&args, &mTimer);
+
+    return WEAVE_NO_ERROR;
+}
+
+WEAVE_ERROR WeaveEchoClient::SendEchoRequest(void)
+{
+    InEventParam inParam;
+    OutEventParam outParam;
+
+    memset(&inParam, 0, sizeof(inParam));
+    memset(&outParam, 0, sizeof(outParam));
+    inParam.Source = this;
+    outParam.PreparePayload.PrepareError = WEAVE_NO_ERROR;
+
+    mEventCallback(AppState, kEvent_PreparePayload, inParam, outParam);
+    if (outParam.PreparePayload.PrepareError != WEAVE_NO_ERROR)
+    {
+        return outParam.PreparePayload.PrepareError;
+    }
+
+    return SendEchoRequest(outParam.PreparePayload.Payload);
+}
+
+/* Send an echo request to the simulated echo server, abandoning any request still outstanding.
+ * The response arrives after the round-trip time of the echo path, unless the path loses the
+ * request, in which case the request times out after the binding's response timeout (if any).
+ */
+WEAVE_ERROR WeaveEchoClient::SendEchoRequest(PacketBuffer * payloadBuf)
+{
+    WEAVE_ERROR err = WEAVE_NO_ERROR;
+    uint32_t numFragments;
+
+    Stop();
+
+    if (mBinding->GetState() != Binding::kState_Ready)
+    {
+        err = mBinding->RequestPrepare();
+        SuccessOrExit(err);
+        VerifyOrExit(mBinding->GetState() == Binding::kState_Ready, err = WEAVE_ERROR_INCORRECT_STATE);
+    }
+
+    mRequestLen = payloadBuf->DataLength();
+    numFragments = (mRequestLen + HostWeave::kEchoMessageOverhead + sEchoPath.FragmentLen - 1) / sEchoPath.FragmentLen;
+    mRequestLost = (numFragments > 1 && sEchoPath.FragmentedLossInterval != 0 &&
+                    ++sFragmentedEchos % sEchoPath.FragmentedLossInterval == 0);
+    sEchosSent++;
+
+    if (!mRequestLost)
+    {
+        esp_timer_start_once(mTimer, sEchoPath.RoundTripUS + (numFragments - 1) * sEchoPath.FragmentUS);
+    }
+    else if (mBinding->GetDefaultResponseTimeout() != 0)
+    {
+        esp_timer_start_once(mTimer, (uint64_t)mBinding->GetDefaultResponseTimeout() * 1000);
+    }
+
+exit:
+    // Sending the request releases the client's reference to the payload.
+    PacketBuffer::Free(payloadBuf);
+    return err;
+}
+
+void WeaveEchoClient::Stop(void)
+{
+    if (mTimer != NULL)
+    {
+        esp_timer_stop(mTimer);
+    }
+}
+
+void WeaveEchoClient::DefaultEventHandler(void * appState, EventType eventType, const InEventParam & inParam, OutEventParam & outParam)
+{
+    outParam.DefaultHandlerCalled = true;
+}
+
+/* Deliver the response to the outstanding request, carrying a payload of the same length, or
+ * report that the request has timed out.
+ */
+void WeaveEchoClient::HandleTimer(void * arg)
+{
+    WeaveEchoClient * client = (WeaveEchoClient *)arg;
+    InEventParam inParam;
+    OutEventParam outParam;
+    EventType eventType;
+
+    memset(&inParam, 0, sizeof(inParam));
+    memset(&outParam, 0, sizeof(outParam));
+    inParam.Source = client;
+
+    if (client->mRequestLost)
+    {
+        eventType = kEvent_ResponseTimeout;
+    }
+    else
+    {
+        PacketBuffer * response = PacketBuffer::New();
+
+        response->SetDataLength(client->mRequestLen);
+        eventType = kEvent_ResponseReceived;
+        inParam.ResponseReceived.Payload = response;
+    }
+
+    client->mEventCallback(client->AppState, eventType, inParam, outParam);
+}
+
+} // namespace Echo_Next
+} // namespace Profiles
+} // namespace Weave
+} // namespace nl
@@ -0,0 +1,109 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Controls for the OpenWeave stand-ins implemented by HostWeave.cpp.
+ *
+ *      Tests that use the System Layer timers, the Device Layer objects or the subscription
+ *      engine must call Reset() after HostSim::Reset().
+ *
+ *      Simulated subscribers subscribe to a published trait data source.  Each is first
+ *      notified of the whole trait, and then, each time the notification engine runs, of the
+ *      properties marked dirty since it was last notified.  A subscriber acknowledges each
+ *      notification after its round-trip time, and is not sent another until it has done so.
+ *
+ *      The notification engine visits subscribers in turn, resuming each run where the last left
+ *      off, as WDM's does.  Within the publisher limits set by SetPublisherLimits(), it stops when
+ *      the configured number of notifications are in flight or no PacketBuffer is available, and
+ *      each acknowledgement runs it again.  Each notification is charged the configured CPU time
+ *      on the virtual clock.
+ */
+
+#ifndef HOST_WEAVE_H
+#define HOST_WEAVE_H
+
+#include <stdint.h>
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+#include <Weave/Profiles/data-management/DataManagement.h>
+
+namespace HostWeave {
+
+enum
+{
+    kEchoMessageOverhead = 48,      // Bytes added to an echo payload by the Weave message and exchange headers and the message integrity check
+};
+
+/* The path between the echo client and the simulated echo server.
+ */
+struct EchoPath
+{
+    int64_t RoundTripUS;            // Round-trip time of an echo carried in a single fragment
+    uint16_t FragmentLen;           // Largest message carried in a single fragment, including kEchoMessageOverhead
+    int64_t FragmentUS;             // Time added to the round trip by each additional fragment
+    uint8_t FragmentedLossInterval; // If non-zero, one in this many fragmented echos is lost
+};
+
+/* What a simulated subscriber has been sent.
+ */
+struct SubscriberStats
+{
+    uint32_t Notifications;
+    uint32_t DataElements;
+    uint32_t Bytes;                 // Total TLV bytes of the notifications
+    uint64_t Version;               // Trait version carried by the latest notification
+    int64_t MaxLatencyUS;           // Longest time from a property being marked dirty to a notification of it arriving
+    int64_t TotalLatencyUS;
+};
+
+/* Limits on the simulated publisher, standing in for the OpenWeave build configuration.  Zero
+ * means unlimited.
+ */
+struct PublisherLimits
+{
+    uint16_t MaxNotifiesInFlight;   // As WDM_PUBLISHER_MAX_NOTIFIES_IN_FLIGHT
+    uint16_t NumPacketBuffers;      // PacketBuffers available to the code under test
+    int64_t NotifyCPUTimeUS;        // Weave task CPU time charged for encoding and sending each notification
+};
+
+/* What the simulated publisher has done.
+ */
+struct PublisherStats
+{
+    uint64_t NotifyCPUTimeUS;       // Total CPU time charged for notifications
+    uint16_t MaxNotifiesInFlight;
+    uint32_t PacketBufferExhaustions; // Allocations that failed because no PacketBuffer was available
+};
+
+void Reset(void);
+void DispatchEvent(const ::nl::Weave::DeviceLayer::WeaveDeviceEvent & event);
+uint16_t AddSubscribers(::nl::Weave::Profiles::DataManagement_Current::TraitDataSource & dataSource, uint16_t count,
+                        int64_t roundTripUS);
+uint16_t GetNumSubscribers(void);
+const SubscriberStats & GetSubscriberStats(uint16_t index);
+void SetPublisherLimits(const PublisherLimits & limits);
+const PublisherStats & GetPublisherStats(void);
+void ResetStats(void);
+void SetEchoPath(const EchoPath & path);
+uint32_t GetEchosSent(void);
+uint16_t GetPacketBuffersInUse(void);
+
+} // namespace HostWeave
+
+#endif // HOST_WEAVE_H
@@ -0,0 +1,175 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host tests for the timing of the LED patterns played by LEDWidget.
+ */
+
+#include "HostSim.h"
+#include "HostTest.h"
+#include "LEDWidget.h"
+
+namespace {
+
+const gpio_num_t kLEDGPIO = GPIO_NUM_2;
+const int64_t kMS = 1000;
+
+/* NOTE: Each LEDWidget takes an LEDC channel that is never released, so each test may create
+ * only one.
+ */
+int64_t InitLED(LEDWidget & led)
+{
+    HostSim::Reset();
+    EXPECT_EQ(led.Init(kLEDGPIO), ESP_OK);
+    return HostSim::Now();
+}
+
+bool ExpectCommand(size_t index, int64_t timeUS, uint32_t duty, int fadeMS = 0)
+{
+    const std::vector<HostSim::LEDCCommand> & cmds = HostSim::GetLEDCCommands();
+
+    return EXPECT(index < cmds.size()) &&
+           EXPECT_EQ(cmds[index].TimeUS, timeUS) &&
+           EXPECT_EQ(cmds[index].Duty, duty) &&
+           EXPECT_EQ(cmds[index].FadeMS, fadeMS);
+}
+
+/* Each step starts a fixed time after the start of the previous one, so latency in the timer
+ * task delays every step equally, rather than accumulating over the pattern.
+ */
+void TestBlinkDoesNotDrift(void)
+{
+    const int64_t kLatencyUS = 3 * kMS;
+    const int kCycles = 100;
+    LEDWidget led;
+    int64_t startUS = InitLED(led);
+
+    HostSim::SetLatency(kLatencyUS);
+    led.Blink(100, 300);
+    HostSim::RunUntil(startUS + kCycles * 400 * kMS);
+
+    // The first step starts when the timer first fires; every later step is delayed by one more
+    // timer latency than that.
+    ExpectCommand(0, startUS + kLatencyUS, 255);
+    for (int i = 1; i < 2 * kCycles; i++)
+    {
+        int64_t nominalUS = (i / 2) * 400 * kMS + ((i % 2) ? 100 * kMS : 0);
+
+        if (!ExpectCommand(i, startUS + 2 * kLatencyUS + nominalUS, (i % 2) ? 0 : 255))
+        {
+            break;
+        }
+    }
+}
+
+/* Fading steps are handed to the LEDC fade hardware with the step's duration.
+ */
+void TestBreathe(void)
+{
+    LEDWidget led;
+    int64_t startUS = InitLED(led);
+
+    led.Breathe(2000);
+    HostSim::RunUntil(startUS + 4000 * kMS);
+
+    EXPECT_EQ(HostSim::GetLEDCCommands().size(), 5);
+    ExpectCommand(0, startUS, 255, 1000);
+    ExpectCommand(1, startUS + 1000 * kMS, 0, 1000);
+    ExpectCommand(2, startUS + 2000 * kMS, 255, 1000);
+    ExpectCommand(3, startUS + 3000 * kMS, 0, 1000);
+    ExpectCommand(4, startUS + 4000 * kMS, 255, 1000);
+}
+
+void TestDoubleFlash(void)
+{
+    LEDWidget led;
+    int64_t startUS = InitLED(led);
+
+    led.DoubleFlash(800);
+    HostSim::RunUntil(startUS + 900 * kMS);
+
+    EXPECT_EQ(HostSim::GetLEDCCommands().size(), 6);
+    ExpectCommand(0, startUS, 255);
+    ExpectCommand(1, startUS + 100 * kMS, 0);
+    ExpectCommand(2, startUS + 200 * kMS, 255);
+    ExpectCommand(3, startUS + 300 * kMS, 0);
+    ExpectCommand(4, startUS + 800 * kMS, 255);
+    ExpectCommand(5, startUS + 900 * kMS, 0);
+}
+
+/* Setting the pattern already playing leaves it undisturbed; setting a different one starts it
+ * at once, from its first step, and a step with no duration is held.
+ */
+void TestPatternChange(void)
+{
+    LEDWidget led;
+    int64_t startUS = InitLED(led);
+
+    led.Blink(100, 300);
+    HostSim::RunUntil(startUS + 250 * kMS);
+    led.Blink(100, 300);
+    HostSim::RunUntil(startUS + 450 * kMS);
+
+    EXPECT_EQ(HostSim::GetLEDCCommands().size(), 3);
+    ExpectCommand(2, startUS + 400 * kMS, 255);
+
+    led.Set(false);
+    HostSim::RunUntil(startUS + 2000 * kMS);
+
+    EXPECT_EQ(HostSim::GetLEDCCommands().size(), 4);
+    ExpectCommand(3, startUS + 450 * kMS, 0);
+}
+
+/* If the timer falls more than a step behind, the pattern resynchronizes with the current time,
+ * rather than playing the missed steps back to back.
+ */
+void TestResynchronizeWhenBehind(void)
+{
+    const int64_t kLatencyUS = 150 * kMS;
+    LEDWidget led;
+    int64_t startUS = InitLED(led);
+
+    HostSim::SetLatency(kLatencyUS);
+    led.Blink(100, 100);
+    HostSim::RunUntil(startUS + 5000 * kMS);
+
+    const std::vector<HostSim::LEDCCommand> & cmds = HostSim::GetLEDCCommands();
+    EXPECT(cmds.size() > 10);
+    for (size_t i = 1; i < cmds.size(); i++)
+    {
+        if (!EXPECT(cmds[i].TimeUS - cmds[i - 1].TimeUS >= kLatencyUS) ||
+            !EXPECT(cmds[i].Duty != cmds[i - 1].Duty))
+        {
+            break;
+        }
+    }
+}
+
+} // unnamed namespace
+
+int main(void)
+{
+    RUN_TEST(TestBlinkDoesNotDrift);
+    RUN_TEST(TestBreathe);
+    RUN_TEST(TestDoubleFlash);
+    RUN_TEST(TestPatternChange);
+    RUN_TEST(TestResynchronizeWhenBehind);
+
+    return HOST_TEST_RESULT();
+}
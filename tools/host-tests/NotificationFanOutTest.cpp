@@ -0,0 +1,364 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host tests for the fan-out of light state changes to subscribers: the light controller's
+ *      dim sweep is run against simulated subscribers (HostWeave.cpp), and the trait leaves and
+ *      bytes it encodes into their notifications are checked.  Level changes are then driven at
+ *      a fixed rate against growing numbers of subscribers, checking the latency seen by each,
+ *      the Weave task CPU time and the PacketBuffers used under the publisher limits
+ *      recommended in the README, and what goes wrong without them.
+ *
+ *      The test is built with WDM_PUBLISHER_MAX_NUM_SUBSCRIPTION_HANDLERS set to the
+ *      recommended subscription handler pool size.
+ */
+
+#include <algorithm>
+
+#include "HostSim.h"
+#include "HostTest.h"
+#include "HostWeave.h"
+#include "AliveTimer.h"
+#include "LightController.h"
+#include "NotificationStats.h"
+
+using namespace ::nl::Weave::Profiles::DataManagement_Current;
+
+void BeginEventLoopActivity(EventLoopActivity activity)
+{
+}
+
+void EndEventLoopActivity(void)
+{
+}
+
+bool GetLatestTelemetrySample(TelemetrySample & sample)
+{
+    return false;
+}
+
+uint32_t GetMaxEventLoopLatenessMS(void)
+{
+    return 0;
+}
+
+namespace {
+
+const int64_t kMS = 1000;
+const gpio_num_t kLightGPIO = GPIO_NUM_2;
+const uint32_t kStepIntervalMS = 100;
+const int64_t kRoundTripUS = 20 * kMS;
+
+// The first sweep turns the light on at level 100, and then dims it to 5 in steps of 5.  The
+// following step, to 0, ends the sweep, logging and resetting the notification statistics.
+const uint32_t kStepsPerSweep = 20;
+const uint8_t kLastSweepLevel = 5;
+
+// A leaf is encoded as a control byte, a context tag and, for the state and for levels up to
+// 100, a one byte value.
+const uint32_t kLeafBytes = 3;
+
+// The scale tests change the level from 95 to 5 in steps of 5, once every change interval, and
+// charge the Weave task each notification's CPU time.
+const uint32_t kScaleChanges = 19;
+const int64_t kChangeIntervalUS = 100 * kMS;
+const int64_t kSettleUS = 1000 * kMS;
+const int64_t kNotifyCPUTimeUS = 1 * kMS;
+
+// The publisher limits recommended in the README, which must keep each subscriber's latency
+// within the change interval for the largest number of subscribers the handler pool admits.  The
+// README quotes the longest latency seen.
+const uint16_t kMaxNotifiesInFlight = 8;
+const int64_t kMaxLatencyUS = 60 * kMS;
+const HostWeave::PublisherLimits kRecommendedLimits = { kMaxNotifiesInFlight, kMaxNotifiesInFlight, kNotifyCPUTimeUS };
+const uint16_t kMaxSubscribers = SubscriptionEngine::kMaxNumSubscriptionHandlers;
+
+/* Initialize the light, subscribe the given number of subscribers to its state, and send each
+ * its initial notification of the whole trait.
+ */
+void InitLight(LightController & light, uint16_t numSubscribers)
+{
+    HostSim::Reset();
+    HostWeave::Reset();
+    EXPECT_EQ(light.Init(kLightGPIO), WEAVE_NO_ERROR);
+    EXPECT_EQ(HostWeave::AddSubscribers(light.GetStateDataSource(), numSubscribers, kRoundTripUS), numSubscribers);
+    RunNotificationEngine();
+    HostSim::RunUntil(HostSim::Now() + kRoundTripUS);
+    ResetNotificationStats();
+}
+
+/* Run the first sweep of the dim sweep up to, but not including, the step that ends it, and
+ * until the notifications of the last step have been acknowledged.
+ */
+void RunFirstSweep(LightController & light)
+{
+    int64_t startUS = HostSim::Now();
+
+    EXPECT_EQ(light.StartDimSweep(kStepIntervalMS), WEAVE_NO_ERROR);
+    HostSim::RunUntil(startUS + kStepsPerSweep * kStepIntervalMS * kMS + kRoundTripUS);
+    EXPECT_EQ(light.GetState(), LightController::ON);
+    EXPECT_EQ(light.GetLevel(), kLastSweepLevel);
+}
+
+/* Each step of a sweep changes one leaf, the state at the start and the level thereafter, so
+ * each subscriber is sent one leaf per step.
+ */
+void TestDimSweepEncodesOneLeafPerSubscriber(void)
+{
+    const uint16_t subscriberCounts[] = { 1, 4, 16 };
+
+    for (size_t i = 0; i < sizeof(subscriberCounts) / sizeof(subscriberCounts[0]); i++)
+    {
+        uint16_t numSubscribers = subscriberCounts[i];
+        LightController light;
+        NotificationStats stats;
+
+        InitLight(light, numSubscribers);
+        RunFirstSweep(light);
+
+        GetNotificationStats(stats);
+        EXPECT_EQ(stats.Runs, kStepsPerSweep);
+        EXPECT_EQ(stats.MaxSubscriptions, numSubscribers);
+        EXPECT_EQ(stats.EncodedLeaves, kStepsPerSweep * numSubscribers);
+        EXPECT_EQ(stats.EncodedLeafBytes, kStepsPerSweep * numSubscribers * kLeafBytes);
+
+        for (uint16_t j = 0; j < numSubscribers; j++)
+        {
+            const HostWeave::SubscriberStats & subStats = HostWeave::GetSubscriberStats(j);
+
+            // Each notification after the initial one carries a single data element.
+            EXPECT_EQ(subStats.Notifications, 1 + kStepsPerSweep);
+            EXPECT_EQ(subStats.DataElements, 1 + kStepsPerSweep);
+            EXPECT_EQ(subStats.Bytes, HostWeave::GetSubscriberStats(0).Bytes);
+            EXPECT_EQ(subStats.Version, light.GetStateDataSource().GetVersion());
+        }
+    }
+}
+
+/* A change to both the state and the level marks the whole trait dirty, which is encoded as one
+ * data element holding both leaves.  Setting the light to its current state sends nothing.
+ */
+void TestStateAndLevelChangeEncodesBothLeaves(void)
+{
+    const uint16_t numSubscribers = 4;
+    LightController light;
+    NotificationStats stats;
+
+    InitLight(light, numSubscribers);
+
+    light.Set(LightController::ON, 40, 0);
+    HostSim::RunUntil(HostSim::Now() + kRoundTripUS);
+    light.Set(LightController::ON, 40, 0);
+    HostSim::RunUntil(HostSim::Now() + kRoundTripUS);
+
+    GetNotificationStats(stats);
+    EXPECT_EQ(stats.Runs, 1u);
+    EXPECT_EQ(stats.EncodedLeaves, 2 * numSubscribers);
+    EXPECT_EQ(stats.EncodedLeafBytes, 2 * numSubscribers * kLeafBytes);
+    for (uint16_t i = 0; i < numSubscribers; i++)
+    {
+        EXPECT_EQ(HostWeave::GetSubscriberStats(i).Notifications, 2u);
+        EXPECT_EQ(HostWeave::GetSubscriberStats(i).DataElements, 2u);
+    }
+}
+
+/* Initialize the light under the given publisher limits, subscribe the given number of
+ * subscribers to its state, turn it on at level 100, and wait for every subscriber to be
+ * notified.
+ */
+void InitScaleTest(LightController & light, uint16_t numSubscribers, const HostWeave::PublisherLimits & limits)
+{
+    HostSim::Reset();
+    HostWeave::Reset();
+    HostWeave::SetPublisherLimits(limits);
+    EXPECT_EQ(light.Init(kLightGPIO), WEAVE_NO_ERROR);
+    EXPECT_EQ(HostWeave::AddSubscribers(light.GetStateDataSource(), numSubscribers, kRoundTripUS), numSubscribers);
+    RunNotificationEngine();
+    light.Set(LightController::ON, 100, 0);
+    HostSim::RunUntil(HostSim::Now() + kSettleUS);
+    ResetNotificationStats();
+    HostWeave::ResetStats();
+}
+
+/* Change the level once every change interval, and then wait for every subscriber to be
+ * notified of the last change.
+ */
+void DriveLevelChanges(LightController & light)
+{
+    for (uint32_t i = 1; i <= kScaleChanges; i++)
+    {
+        light.Set(LightController::ON, (uint8_t)(100 - i * 5), 0);
+        HostSim::RunUntil(HostSim::Now() + kChangeIntervalUS);
+    }
+    HostSim::RunUntil(HostSim::Now() + kSettleUS);
+}
+
+/* Check that every subscriber has been notified of the light's current state.
+ */
+void ExpectSubscribersUpToDate(LightController & light, uint16_t numSubscribers)
+{
+    EXPECT_EQ(HostWeave::GetPacketBuffersInUse(), 0);
+    for (uint16_t i = 0; i < numSubscribers; i++)
+    {
+        EXPECT_EQ(HostWeave::GetSubscriberStats(i).Version, light.GetStateDataSource().GetVersion());
+    }
+}
+
+/* The subscription handler pool admits no more than its size in subscribers.
+ */
+void TestSubscriptionPoolLimit(void)
+{
+    LightController light;
+    NotificationStats stats;
+
+    InitScaleTest(light, kMaxSubscribers, kRecommendedLimits);
+    EXPECT_EQ(HostWeave::AddSubscribers(light.GetStateDataSource(), 1, kRoundTripUS), 0);
+    EXPECT_EQ(HostWeave::GetNumSubscribers(), kMaxSubscribers);
+
+    light.Set(LightController::ON, 50, 0);
+    GetNotificationStats(stats);
+    EXPECT_EQ(stats.MaxSubscriptions, kMaxSubscribers);
+}
+
+/* Under the recommended limits, every subscriber is notified of every change within the change
+ * interval, up to the size of the handler pool.  Each notification costs the Weave task the same
+ * CPU time, so the total grows with the number of subscribers, but the in-flight limit bounds
+ * both the PacketBuffers in use and the length of the run started by a change; the rest of the
+ * notifications are sent from later runs, as earlier ones are acknowledged.
+ */
+void TestFanOutScalesUnderRecommendedLimits(void)
+{
+    const uint16_t subscriberCounts[] = { 1, 8, 16, kMaxSubscribers };
+    int64_t prevMaxLatencyUS = 0;
+
+    for (size_t i = 0; i < sizeof(subscriberCounts) / sizeof(subscriberCounts[0]); i++)
+    {
+        uint16_t numSubscribers = subscriberCounts[i];
+        uint16_t firstWave = std::min(numSubscribers, kMaxNotifiesInFlight);
+        int64_t maxLatencyUS = 0;
+        LightController light;
+        NotificationStats stats;
+
+        InitScaleTest(light, numSubscribers, kRecommendedLimits);
+        DriveLevelChanges(light);
+        ExpectSubscribersUpToDate(light, numSubscribers);
+
+        for (uint16_t j = 0; j < numSubscribers; j++)
+        {
+            const HostWeave::SubscriberStats & subStats = HostWeave::GetSubscriberStats(j);
+
+            EXPECT_EQ(subStats.Notifications, kScaleChanges);
+            EXPECT_EQ(subStats.Bytes, HostWeave::GetSubscriberStats(0).Bytes);
+            maxLatencyUS = std::max(maxLatencyUS, subStats.MaxLatencyUS);
+        }
+        EXPECT(maxLatencyUS <= kMaxLatencyUS && kMaxLatencyUS < kChangeIntervalUS);
+        EXPECT(maxLatencyUS >= prevMaxLatencyUS);
+        prevMaxLatencyUS = maxLatencyUS;
+
+        const HostWeave::PublisherStats & pubStats = HostWeave::GetPublisherStats();
+        EXPECT_EQ(pubStats.NotifyCPUTimeUS, (uint64_t)(kScaleChanges * numSubscribers * kNotifyCPUTimeUS));
+        EXPECT_EQ(pubStats.MaxNotifiesInFlight, firstWave);
+        EXPECT_EQ(pubStats.PacketBufferExhaustions, 0u);
+
+        GetNotificationStats(stats);
+        EXPECT_EQ(stats.Runs, kScaleChanges);
+        EXPECT_EQ(stats.MaxRunTimeUS, (uint32_t)(firstWave * kNotifyCPUTimeUS));
+        EXPECT_EQ(stats.MaxSubscriptions, numSubscribers);
+        EXPECT_EQ(stats.PacketBufsHighWater, firstWave);
+    }
+}
+
+/* With too few notifications in flight for the number of subscribers, the fan-out of a change
+ * takes longer than the change interval.  Subscribers fall behind, and are sent several changes
+ * at once, late, though all eventually catch up.
+ */
+void TestFanOutFallsBehindWithFewNotifiesInFlight(void)
+{
+    HostWeave::PublisherLimits limits = kRecommendedLimits;
+    uint32_t notifications = 0;
+    int64_t maxLatencyUS = 0;
+    LightController light;
+
+    limits.MaxNotifiesInFlight = 2;
+    InitScaleTest(light, kMaxSubscribers, limits);
+    DriveLevelChanges(light);
+    ExpectSubscribersUpToDate(light, kMaxSubscribers);
+
+    for (uint16_t i = 0; i < kMaxSubscribers; i++)
+    {
+        notifications += HostWeave::GetSubscriberStats(i).Notifications;
+        maxLatencyUS = std::max(maxLatencyUS, HostWeave::GetSubscriberStats(i).MaxLatencyUS);
+    }
+    EXPECT(notifications < kScaleChanges * kMaxSubscribers);
+    EXPECT(maxLatencyUS > kChangeIntervalUS);
+    EXPECT_EQ(HostWeave::GetPublisherStats().MaxNotifiesInFlight, 2);
+}
+
+/* Without a limit on notifications in flight, a change takes a PacketBuffer for every subscriber
+ * at once; when there are fewer PacketBuffers than subscribers, the pool is exhausted by each
+ * change, leaving none for other traffic until the notifications are acknowledged.
+ */
+void TestFanOutExhaustsPacketBuffersWithoutInFlightLimit(void)
+{
+    const uint16_t subscriberCounts[] = { 8, 16, kMaxSubscribers };
+
+    for (size_t i = 0; i < sizeof(subscriberCounts) / sizeof(subscriberCounts[0]); i++)
+    {
+        uint16_t numSubscribers = subscriberCounts[i];
+        HostWeave::PublisherLimits limits = kRecommendedLimits;
+        LightController light;
+        NotificationStats stats;
+
+        limits.MaxNotifiesInFlight = 0;
+        limits.NumPacketBuffers = 0;
+        InitScaleTest(light, numSubscribers, limits);
+        DriveLevelChanges(light);
+        ExpectSubscribersUpToDate(light, numSubscribers);
+        GetNotificationStats(stats);
+        EXPECT_EQ(stats.PacketBufsHighWater, numSubscribers);
+        EXPECT_EQ(stats.MaxRunTimeUS, (uint32_t)(numSubscribers * kNotifyCPUTimeUS));
+
+        limits.NumPacketBuffers = kRecommendedLimits.NumPacketBuffers;
+        InitScaleTest(light, numSubscribers, limits);
+        DriveLevelChanges(light);
+        ExpectSubscribersUpToDate(light, numSubscribers);
+        if (numSubscribers > limits.NumPacketBuffers)
+        {
+            EXPECT(HostWeave::GetPublisherStats().PacketBufferExhaustions >= kScaleChanges);
+        }
+        else
+        {
+            EXPECT_EQ(HostWeave::GetPublisherStats().PacketBufferExhaustions, 0u);
+        }
+    }
+}
+
+} // unnamed namespace
+
+int main(void)
+{
+    RUN_TEST(TestDimSweepEncodesOneLeafPerSubscriber);
+    RUN_TEST(TestStateAndLevelChangeEncodesBothLeaves);
+    RUN_TEST(TestSubscriptionPoolLimit);
+    RUN_TEST(TestFanOutScalesUnderRecommendedLimits);
+    RUN_TEST(TestFanOutFallsBehindWithFewNotifiesInFlight);
+    RUN_TEST(TestFanOutExhaustsPacketBuffersWithoutInFlightLimit);
+
+    return HOST_TEST_RESULT();
+}
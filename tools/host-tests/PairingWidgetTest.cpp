@@ -0,0 +1,306 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host tests for the QR code drawn by PairingWidget, comparing every pixel drawn
+ *      on the simulated display with the modules of the code.
+ *
+ *      The QRCode library and the Weave device descriptor are replaced by stand-ins:
+ *      the stand-in library fills the modules with a pattern derived from the text, rather
+ *      than encoding it, which is enough to check that each module is drawn where the library
+ *      puts it.
+ */
+
+#include <string.h>
+#include <string>
+
+#include "HostSim.h"
+#include "HostDisplay.h"
+#include "HostTest.h"
+
+#include <Weave/Profiles/device-description/DeviceDescription.h>
+
+#include "PairingWidget.h"
+
+using namespace ::nl::Weave;
+using namespace ::nl::Weave::Profiles::DeviceDescription;
+
+namespace {
+
+enum
+{
+    kQRCodeQuietZone = 2,
+    kQRCodeMaxModuleSizePix = 4,
+    kQRCodeMaxHeightPix = (HostDisplay::kHeight * 70) / 100,
+    kQRCodeY = (HostDisplay::kHeight * 7) / 100,
+};
+
+std::string sDescriptorPrefix;
+uint8_t sQRCodeVersion;
+uint32_t sQRCodeInits;
+
+} // unnamed namespace
+
+// ==================== Stand-ins ====================
+
+namespace nl {
+namespace Weave {
+
+namespace DeviceLayer {
+
+WeaveFabricState FabricState;
+
+void PlatformManager::LockWeaveStack(void)
+{
+}
+
+void PlatformManager::UnlockWeaveStack(void)
+{
+}
+
+PlatformManager & PlatformMgr(void)
+{
+    static PlatformManager sPlatformMgr;
+    return sPlatformMgr;
+}
+
+WEAVE_ERROR ConfigurationManager::GetDeviceDescriptor(WeaveDeviceDescriptor & deviceDesc)
+{
+    memset(&deviceDesc, 0, sizeof(deviceDesc));
+    return WEAVE_NO_ERROR;
+}
+
+ConfigurationManager & ConfigurationMgr(void)
+{
+    static ConfigurationManager sConfigurationMgr;
+    return sConfigurationMgr;
+}
+
+} // namespace DeviceLayer
+
+namespace Profiles {
+namespace DeviceDescription {
+
+/* Encode the descriptor as the prefix chosen by the test followed by the pairing code.
+ */
+WEAVE_ERROR WeaveDeviceDescriptor::EncodeText(const WeaveDeviceDescriptor & desc, char * buf, uint32_t bufLen,
+                                              uint32_t & outEncodedLength)
+{
+    std::string text = sDescriptorPrefix + desc.PairingCode;
+
+    if (text.size() + 1 > bufLen)
+    {
+        return WEAVE_ERROR_BUFFER_TOO_SMALL;
+    }
+    strcpy(buf, text.c_str());
+    outEncodedLength = (uint32_t)text.size();
+    return WEAVE_NO_ERROR;
+}
+
+} // namespace DeviceDescription
+} // namespace Profiles
+
+} // namespace Weave
+} // namespace nl
+
+int8_t qrcode_initText(QRCode * qrcode, uint8_t * modules, uint8_t version, uint8_t ecc, const char * data)
+{
+    uint32_t hash = 2166136261u;
+
+    for (const char * p = data; *p != 0; p++)
+    {
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+
+    qrcode->version = version;
+    qrcode->size = (uint8_t)(17 + 4 * version);
+    qrcode->ecc = ecc;
+    qrcode->modules = modules;
+    memset(modules, 0, (qrcode->size * qrcode->size + 7) / 8);
+
+    for (uint32_t i = 0; i < (uint32_t)qrcode->size * qrcode->size; i++)
+    {
+        if ((((i + hash) * 2654435761u) >> 13) & 1)
+        {
+            modules[i / 8] |= (uint8_t)(0x80 >> (i % 8));
+        }
+    }
+
+    sQRCodeVersion = version;
+    sQRCodeInits++;
+
+    return 0;
+}
+
+bool qrcode_getModule(QRCode * qrcode, uint8_t x, uint8_t y)
+{
+    uint32_t i = (uint32_t)y * qrcode->size + x;
+    return (qrcode->modules[i / 8] & (0x80 >> (i % 8))) != 0;
+}
+
+// ==================== Tests ====================
+
+namespace {
+
+const char kPairingCode[] = "NESTUS";
+
+/* Start the display and compositor, and show a pairing widget for a descriptor of the given form.
+ */
+void ShowPairingWidget(PairingWidget & widget, const std::string & descriptorPrefix)
+{
+    Drawable * scene[] = { &widget };
+
+    HostSim::Reset();
+    HostDisplay::Reset();
+    EXPECT_EQ(InitDisplay(), ESP_OK);
+    EXPECT_EQ(DisplayCompositor.Init(), ESP_OK);
+
+    DeviceLayer::FabricState.PairingCode = kPairingCode;
+    sDescriptorPrefix = descriptorPrefix;
+    sQRCodeVersion = 0;
+    sQRCodeInits = 0;
+
+    widget.Init();
+
+    DisplayCompositor.Lock();
+    DisplayCompositor.SetScene(scene, 1);
+    DisplayCompositor.Unlock();
+    DisplayCompositor.WaitForIdle();
+}
+
+bool SameColor(const color_t & a, const color_t & b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+/* Compare every pixel of the QR code, including its quiet zone, with the module it falls in.
+ */
+void ExpectQRCodePixels(const PairingWidget & widget, uint8_t version)
+{
+    QRCode qrCode;
+    uint8_t modules[(57 * 57 + 7) / 8];
+    std::string text = sDescriptorPrefix + kPairingCode;
+
+    qrcode_initText(&qrCode, modules, version, ECC_LOW, text.c_str());
+
+    int moduleSize = kQRCodeMaxHeightPix / (qrCode.size + kQRCodeQuietZone * 2);
+    if (moduleSize > kQRCodeMaxModuleSizePix)
+    {
+        moduleSize = kQRCodeMaxModuleSizePix;
+    }
+    int sizePix = (qrCode.size + kQRCodeQuietZone * 2) * moduleSize;
+    int qrX = (HostDisplay::kWidth - sizePix) / 2;
+    int mismatches = 0;
+
+    for (int y = 0; y < sizePix; y++)
+    {
+        for (int x = 0; x < sizePix; x++)
+        {
+            int moduleX = x / moduleSize - kQRCodeQuietZone;
+            int moduleY = y / moduleSize - kQRCodeQuietZone;
+            bool dark = (moduleX >= 0 && moduleX < qrCode.size && moduleY >= 0 && moduleY < qrCode.size &&
+                         qrcode_getModule(&qrCode, (uint8_t)moduleX, (uint8_t)moduleY));
+            color_t pixel = HostDisplay::GetPixel(qrX + x, kQRCodeY + y);
+
+            if (!SameColor(pixel, (dark) ? TFT_BLACK : widget.QRCodeColor))
+            {
+                mismatches++;
+            }
+        }
+    }
+
+    EXPECT_EQ(mismatches, 0);
+
+    // Nothing is drawn immediately outside the code.
+    EXPECT(SameColor(HostDisplay::GetPixel(qrX - 1, kQRCodeY), TFT_BLACK));
+    EXPECT(SameColor(HostDisplay::GetPixel(qrX + sizePix, kQRCodeY + sizePix - 1), TFT_BLACK));
+    EXPECT(SameColor(HostDisplay::GetPixel(qrX, kQRCodeY - 1), TFT_BLACK));
+}
+
+/* The smallest version holding the descriptor is chosen, and every module is drawn in place,
+ * at each of the module sizes used.
+ */
+void TestVersion3(void)
+{
+    PairingWidget widget;
+
+    // 60 alphanumeric characters: version 3 holds 77.
+    ShowPairingWidget(widget, std::string(54, 'A'));
+    EXPECT_EQ(sQRCodeVersion, 3);
+    ExpectQRCodePixels(widget, 3);
+}
+
+void TestVersion5(void)
+{
+    PairingWidget widget;
+
+    // 100 characters in byte mode: version 4 holds 78, version 5 holds 106.
+    ShowPairingWidget(widget, std::string(94, 'a'));
+    EXPECT_EQ(sQRCodeVersion, 5);
+    ExpectQRCodePixels(widget, 5);
+}
+
+void TestVersion6(void)
+{
+    PairingWidget widget;
+
+    // 115 characters in byte mode: version 6 holds 134; its modules are 3 pixels.
+    ShowPairingWidget(widget, std::string(109, 'a'));
+    EXPECT_EQ(sQRCodeVersion, 6);
+    ExpectQRCodePixels(widget, 6);
+}
+
+/* The QR code is generated at Init(), and again only when the pairing code changes.
+ */
+void TestGeneratedOnce(void)
+{
+    PairingWidget widget;
+    static const char kNewPairingCode[] = "NEWCOD";
+
+    ShowPairingWidget(widget, std::string(54, 'A'));
+    EXPECT_EQ(sQRCodeInits, 1);
+    HostDisplay::ClearTransfers();
+
+    DisplayCompositor.Lock();
+    widget.Display();
+    DisplayCompositor.Unlock();
+    DisplayCompositor.WaitForIdle();
+    EXPECT_EQ(sQRCodeInits, 1);
+    EXPECT_EQ(HostDisplay::GetTransfers().size(), 0);
+
+    DeviceLayer::FabricState.PairingCode = kNewPairingCode;
+    DisplayCompositor.Lock();
+    widget.Display();
+    DisplayCompositor.Unlock();
+    DisplayCompositor.WaitForIdle();
+    EXPECT_EQ(sQRCodeInits, 2);
+    EXPECT(HostDisplay::GetTransfers().size() > 0);
+}
+
+} // unnamed namespace
+
+int main(void)
+{
+    RUN_TEST(TestVersion3);
+    RUN_TEST(TestVersion5);
+    RUN_TEST(TestVersion6);
+    RUN_TEST(TestGeneratedOnce);
+
+    return HOST_TEST_RESULT();
+}
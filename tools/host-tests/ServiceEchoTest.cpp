@@ -0,0 +1,217 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host tests for the ServiceEchoClient payload size sweep, run against a simulated echo
+ *      server (HostWeave.cpp) over paths that fragment and lose large echos.
+ */
+
+#include <string.h>
+
+#include "HostSim.h"
+#include "HostTest.h"
+#include "HostWeave.h"
+#include "AliveTimer.h"
+#include "ServiceEcho.h"
+
+using namespace ::nl::Weave::DeviceLayer;
+
+void BeginEventLoopActivity(EventLoopActivity activity)
+{
+}
+
+void EndEventLoopActivity(void)
+{
+}
+
+namespace {
+
+const int64_t kMS = 1000;
+const uint32_t kMinEchoIntervalMS = 1000;
+const uint32_t kMaxEchoIntervalMS = 60000;
+const int64_t kMaxSweepTimeUS = 120000 * kMS;
+const uint8_t kSamplesPerSize = CONFIG_SERVICE_ECHO_PAYLOAD_SWEEP_SAMPLES;
+
+/* A path that carries messages of up to 600 bytes in a single fragment, so that payloads of
+ * up to 512 bytes are echoed unfragmented, and those of 768 bytes and more in two fragments.
+ */
+const uint16_t kFragmentLen = 600;
+const uint16_t kFirstFragmentedPayloadLen = 768;
+
+uint16_t sPacketBufsInUse;
+
+void InitEcho(const HostWeave::EchoPath & path)
+{
+    HostSim::Reset();
+    HostWeave::Reset();
+    HostWeave::SetEchoPath(path);
+    EXPECT_EQ(ServiceEcho.Init(kMinEchoIntervalMS, kMaxEchoIntervalMS), WEAVE_NO_ERROR);
+    sPacketBufsInUse = HostWeave::GetPacketBuffersInUse();
+}
+
+void SetServiceTunnelState(ConnectivityChange result)
+{
+    WeaveDeviceEvent event;
+
+    memset(&event, 0, sizeof(event));
+    event.Type = DeviceEventType::kServiceTunnelStateChange;
+    event.ServiceTunnelStateChange.Result = result;
+    HostWeave::DispatchEvent(event);
+}
+
+/* Bring up the service tunnel, which starts the payload sweep, and run until the sweep is
+ * complete.
+ */
+void RunSweep(void)
+{
+    int64_t deadlineUS = HostSim::Now() + kMaxSweepTimeUS;
+
+    SetServiceTunnelState(kConnectivity_Established);
+    EXPECT(ServiceEcho.IsPayloadSweepActive());
+    while (ServiceEcho.IsPayloadSweepActive() && HostSim::Now() < deadlineUS)
+    {
+        HostSim::RunUntil(HostSim::Now() + 100 * kMS);
+    }
+    EXPECT(!ServiceEcho.IsPayloadSweepActive());
+}
+
+/* The sweep covers each size that fits in the payload buffer.  Over a path that carries every
+ * size in a single fragment, every echo is answered in the same time, and no knee is found.
+ */
+void TestSweepCoversSizesThatFit(void)
+{
+    const HostWeave::EchoPath path = { 50 * kMS, nl::Weave::PacketBuffer::kBufferSize, 0, 0 };
+    const uint16_t expectedSizes[] = { 0, 64, 128, 256, 384, 512, 768, 1024, 1152 };
+    uint8_t kneeIndex;
+
+    InitEcho(path);
+    RunSweep();
+
+    // The buffer holds 1216 bytes, less 32 reserved for the message integrity check, so the
+    // 1280 byte size is skipped.
+    EXPECT_EQ(ServiceEcho.GetNumPayloadSweepSizes(), sizeof(expectedSizes) / sizeof(expectedSizes[0]));
+    for (uint8_t i = 0; i < ServiceEcho.GetNumPayloadSweepSizes(); i++)
+    {
+        const ServiceEchoClient::PayloadSizeStats & stats = ServiceEcho.GetPayloadSweepStats(i);
+
+        EXPECT_EQ(stats.PayloadLen, expectedSizes[i]);
+        EXPECT_EQ(stats.Sent, kSamplesPerSize);
+        EXPECT_EQ(stats.Received, kSamplesPerSize);
+        EXPECT_EQ(stats.MinRTTUS, 50 * kMS);
+        EXPECT_EQ(stats.MaxRTTUS, 50 * kMS);
+        EXPECT_EQ(stats.TotalRTTUS, kSamplesPerSize * 50 * kMS);
+    }
+    EXPECT_EQ(HostWeave::GetEchosSent(), ServiceEcho.GetNumPayloadSweepSizes() * kSamplesPerSize);
+    EXPECT(!ServiceEcho.FindPayloadSweepKnee(kneeIndex));
+    EXPECT(ServiceEcho.ServiceAlive);
+    EXPECT_EQ(ServiceEcho.LastRTTUS, 50 * kMS);
+
+    // Each request reuses the payload buffer.
+    EXPECT_EQ(HostWeave::GetPacketBuffersInUse(), sPacketBufsInUse);
+}
+
+/* Over a path on which the second fragment adds to the round-trip time, the knee is found at
+ * the first fragmented size.
+ */
+void TestSweepFindsFragmentationLatency(void)
+{
+    const HostWeave::EchoPath path = { 40 * kMS, kFragmentLen, 30 * kMS, 0 };
+    uint8_t kneeIndex;
+
+    InitEcho(path);
+    RunSweep();
+
+    for (uint8_t i = 0; i < ServiceEcho.GetNumPayloadSweepSizes(); i++)
+    {
+        const ServiceEchoClient::PayloadSizeStats & stats = ServiceEcho.GetPayloadSweepStats(i);
+        uint32_t expectedRTTUS = (stats.PayloadLen < kFirstFragmentedPayloadLen) ? 40 * kMS : 70 * kMS;
+
+        EXPECT_EQ(stats.Received, kSamplesPerSize);
+        EXPECT_EQ(stats.MinRTTUS, expectedRTTUS);
+        EXPECT_EQ(stats.MaxRTTUS, expectedRTTUS);
+    }
+    EXPECT(ServiceEcho.FindPayloadSweepKnee(kneeIndex));
+    EXPECT_EQ(ServiceEcho.GetPayloadSweepStats(kneeIndex).PayloadLen, kFirstFragmentedPayloadLen);
+}
+
+/* Over a path that loses every second fragmented echo, without adding to the round-trip time,
+ * the knee is found at the first fragmented size, and the lost echos time out.  Each lost
+ * request gives up the payload buffer and a new one is allocated for the next echo, so no
+ * buffers are leaked.
+ */
+void TestSweepFindsFragmentationLoss(void)
+{
+    const HostWeave::EchoPath path = { 40 * kMS, kFragmentLen, 0, 2 };
+    uint8_t kneeIndex;
+
+    InitEcho(path);
+    RunSweep();
+
+    for (uint8_t i = 0; i < ServiceEcho.GetNumPayloadSweepSizes(); i++)
+    {
+        const ServiceEchoClient::PayloadSizeStats & stats = ServiceEcho.GetPayloadSweepStats(i);
+
+        EXPECT_EQ(stats.Sent, kSamplesPerSize);
+        EXPECT_EQ(stats.Received, (stats.PayloadLen < kFirstFragmentedPayloadLen) ? kSamplesPerSize : kSamplesPerSize / 2);
+        EXPECT_EQ(stats.MaxRTTUS, 40 * kMS);
+    }
+    EXPECT(ServiceEcho.FindPayloadSweepKnee(kneeIndex));
+    EXPECT_EQ(ServiceEcho.GetPayloadSweepStats(kneeIndex).PayloadLen, kFirstFragmentedPayloadLen);
+
+    // The last echo of the sweep was lost, so its buffer has been given up.
+    EXPECT_EQ(HostWeave::GetPacketBuffersInUse(), sPacketBufsInUse - 1);
+    HostSim::RunUntil(HostSim::Now() + 2 * kMinEchoIntervalMS * kMS);
+    EXPECT(ServiceEcho.ServiceAlive);
+    EXPECT_EQ(HostWeave::GetPacketBuffersInUse(), sPacketBufsInUse);
+}
+
+/* Losing the service tunnel aborts the sweep and stops the echos.
+ */
+void TestSweepAbortedWhenTunnelLost(void)
+{
+    const HostWeave::EchoPath path = { 50 * kMS, nl::Weave::PacketBuffer::kBufferSize, 0, 0 };
+    uint32_t echosSent;
+
+    InitEcho(path);
+    SetServiceTunnelState(kConnectivity_Established);
+    HostSim::RunUntil(HostSim::Now() + 1000 * kMS);
+    EXPECT(ServiceEcho.IsPayloadSweepActive());
+
+    SetServiceTunnelState(kConnectivity_Lost);
+    EXPECT(!ServiceEcho.IsPayloadSweepActive());
+    EXPECT(!ServiceEcho.ServiceAlive);
+
+    echosSent = HostWeave::GetEchosSent();
+    EXPECT(echosSent > 0);
+    HostSim::RunUntil(HostSim::Now() + 60000 * kMS);
+    EXPECT_EQ(HostWeave::GetEchosSent(), echosSent);
+    EXPECT(HostWeave::GetPacketBuffersInUse() <= sPacketBufsInUse);
+}
+
+} // unnamed namespace
+
+int main(void)
+{
+    RUN_TEST(TestSweepCoversSizesThatFit);
+    RUN_TEST(TestSweepFindsFragmentationLatency);
+    RUN_TEST(TestSweepFindsFragmentationLoss);
+    RUN_TEST(TestSweepAbortedWhenTunnelLost);
+
+    return HOST_TEST_RESULT();
+}
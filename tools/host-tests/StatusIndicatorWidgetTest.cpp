@@ -0,0 +1,264 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host tests for the glyph cache of StatusIndicatorWidget, rendering the widget
+ *      through the compositor stand-in (HostCompositor.cpp).
+ */
+
+#include "HostSim.h"
+#include "HostDisplay.h"
+#include "HostCompositor.h"
+#include "HostTest.h"
+#include "StatusIndicatorWidget.h"
+
+namespace {
+
+enum
+{
+    kNumIndicators = 5,
+    kMaxCachedGlyphs = 8,
+};
+
+const char kInitialChars[] = "WITSA";
+
+/* Show a status indicator widget with the initial characters, and draw it once.
+ */
+void InitWidget(StatusIndicatorWidget & widget)
+{
+    Drawable * scene[] = { &widget };
+
+    HostSim::Reset();
+    HostDisplay::Reset();
+    EXPECT_EQ(InitDisplay(), ESP_OK);
+    HostCompositor::Reset();
+
+    widget.Init(kNumIndicators);
+    for (uint8_t i = 0; i < kNumIndicators; i++)
+    {
+        widget.SetChar(i, kInitialChars[i]);
+    }
+
+    DisplayCompositor.SetScene(scene, 1);
+    DisplayCompositor.Invalidate(widget.GetBounds());
+    DisplayCompositor.Flush();
+}
+
+/* Return the masks drawn since the logs were last cleared.
+ */
+std::vector<const HostCompositor::DrawCall *> GetMaskDraws(void)
+{
+    const std::vector<HostCompositor::DrawCall> & calls = HostCompositor::GetDrawCalls();
+    std::vector<const HostCompositor::DrawCall *> maskDraws;
+
+    for (size_t i = 0; i < calls.size(); i++)
+    {
+        if (calls[i].Op == HostCompositor::kDrawOp_DrawMask)
+        {
+            maskDraws.push_back(&calls[i]);
+        }
+    }
+
+    return maskDraws;
+}
+
+/* Change the character of an indicator and redraw it, returning the mask drawn.
+ */
+const uint8_t * SetCharAndDraw(StatusIndicatorWidget & widget, uint8_t pos, char ch)
+{
+    HostCompositor::ClearLogs();
+    widget.SetChar(pos, ch);
+    DisplayCompositor.Flush();
+
+    std::vector<const HostCompositor::DrawCall *> maskDraws = GetMaskDraws();
+    return (EXPECT_EQ(maskDraws.size(), 1)) ? maskDraws[0]->Mask : NULL;
+}
+
+/* Each character is rasterized once, on first use, and later draws reuse the same mask.
+ */
+void TestHits(void)
+{
+    StatusIndicatorWidget widget;
+
+    InitWidget(widget);
+
+    std::vector<const HostCompositor::DrawCall *> maskDraws = GetMaskDraws();
+    EXPECT_EQ(maskDraws.size(), kNumIndicators);
+    EXPECT_EQ(HostCompositor::GetGlyphLookups(), kNumIndicators);
+
+    std::vector<const uint8_t *> masks;
+    std::vector<std::vector<uint8_t> > maskData;
+    for (size_t i = 0; i < maskDraws.size(); i++)
+    {
+        masks.push_back(maskDraws[i]->Mask);
+        maskData.push_back(maskDraws[i]->MaskData);
+    }
+
+    // Redraw every indicator, in the other state.
+    HostCompositor::ClearLogs();
+    for (uint8_t i = 0; i < kNumIndicators; i++)
+    {
+        widget.SetState(i, true);
+    }
+    DisplayCompositor.Flush();
+
+    maskDraws = GetMaskDraws();
+    EXPECT_EQ(HostCompositor::GetGlyphLookups(), kNumIndicators);
+    EXPECT_EQ(maskDraws.size(), kNumIndicators);
+    for (size_t i = 0; i < maskDraws.size() && i < masks.size(); i++)
+    {
+        EXPECT(maskDraws[i]->Mask == masks[i]);
+        EXPECT(maskDraws[i]->MaskData == maskData[i]);
+    }
+
+    // Each character has its own mask, and each mask has some pixels set.
+    for (size_t i = 0; i < masks.size(); i++)
+    {
+        bool anySet = false;
+        for (size_t j = 0; j < maskData[i].size(); j++)
+        {
+            anySet = anySet || maskData[i][j] != 0;
+        }
+        EXPECT(anySet);
+        for (size_t j = 0; j < i; j++)
+        {
+            EXPECT(masks[i] != masks[j]);
+            EXPECT(maskData[i] != maskData[j]);
+        }
+    }
+}
+
+/* Once 8 characters are cached, a new character replaces the one cached longest ago.
+ */
+void TestEviction(void)
+{
+    StatusIndicatorWidget widget;
+
+    InitWidget(widget);
+
+    // 'W', 'I', 'T', 'S' and 'A' take the first five slots; 'B', 'C' and 'D' take the rest.
+    std::vector<const HostCompositor::DrawCall *> maskDraws = GetMaskDraws();
+    const uint8_t * maskW = (EXPECT_EQ(maskDraws.size(), kNumIndicators)) ? maskDraws[0]->Mask : NULL;
+    const uint8_t * maskI = (maskDraws.size() > 1) ? maskDraws[1]->Mask : NULL;
+    const uint8_t * maskB = SetCharAndDraw(widget, 4, 'B');
+    SetCharAndDraw(widget, 3, 'C');
+    SetCharAndDraw(widget, 2, 'D');
+    EXPECT_EQ(HostCompositor::GetGlyphLookups(), kMaxCachedGlyphs);
+
+    // A ninth character replaces 'W'.
+    EXPECT(SetCharAndDraw(widget, 1, 'E') == maskW);
+    EXPECT_EQ(HostCompositor::GetGlyphLookups(), kMaxCachedGlyphs + 1);
+
+    // The other characters are still cached.
+    SetCharAndDraw(widget, 4, 'A');
+    EXPECT(SetCharAndDraw(widget, 4, 'B') == maskB);
+    SetCharAndDraw(widget, 3, 'S');
+    SetCharAndDraw(widget, 2, 'T');
+    EXPECT_EQ(HostCompositor::GetGlyphLookups(), kMaxCachedGlyphs + 1);
+
+    // 'W' is rasterized again, replacing 'I', which in turn is rasterized again.
+    EXPECT(SetCharAndDraw(widget, 1, 'W') == maskI);
+    EXPECT_EQ(HostCompositor::GetGlyphLookups(), kMaxCachedGlyphs + 2);
+    SetCharAndDraw(widget, 1, 'I');
+    EXPECT_EQ(HostCompositor::GetGlyphLookups(), kMaxCachedGlyphs + 3);
+}
+
+/* The cache is allocated once, with a slot for each of 8 characters.
+ */
+void TestSlots(void)
+{
+    StatusIndicatorWidget widget;
+    std::vector<const uint8_t *> masks;
+
+    InitWidget(widget);
+
+    uint16_t sizePix = (HostDisplay::kHeight * widget.Size) / 100;
+    size_t slotSize = (sizePix * sizePix + 7) / 8;
+
+    std::vector<const HostCompositor::DrawCall *> maskDraws = GetMaskDraws();
+    for (size_t i = 0; i < maskDraws.size(); i++)
+    {
+        masks.push_back(maskDraws[i]->Mask);
+    }
+    masks.push_back(SetCharAndDraw(widget, 0, 'B'));
+    masks.push_back(SetCharAndDraw(widget, 0, 'C'));
+    masks.push_back(SetCharAndDraw(widget, 0, 'D'));
+
+    EXPECT_EQ(masks.size(), kMaxCachedGlyphs);
+    for (size_t i = 0; i < masks.size(); i++)
+    {
+        EXPECT(masks[i] == masks[0] + i * slotSize);
+    }
+}
+
+/* The cache is flushed when the indicators change size, and is not used for indicators larger
+ * than those it was allocated for.
+ */
+void TestResize(void)
+{
+    StatusIndicatorWidget widget;
+    Drawable * scene[] = { &widget };
+
+    InitWidget(widget);
+
+    // Smaller indicators: each character is rasterized again.
+    widget.Size = 10;
+    DisplayCompositor.SetScene(NULL, 0);
+    DisplayCompositor.SetScene(scene, 1);
+    HostCompositor::ClearLogs();
+    DisplayCompositor.Invalidate(widget.GetBounds());
+    DisplayCompositor.Flush();
+
+    EXPECT_EQ(GetMaskDraws().size(), kNumIndicators);
+    EXPECT_EQ(HostCompositor::GetGlyphLookups(), 2 * kNumIndicators);
+
+    // Larger indicators: the characters are drawn as text.
+    widget.Size = 20;
+    DisplayCompositor.SetScene(NULL, 0);
+    DisplayCompositor.SetScene(scene, 1);
+    HostCompositor::ClearLogs();
+    DisplayCompositor.Invalidate(widget.GetBounds());
+    DisplayCompositor.Flush();
+
+    const std::vector<HostCompositor::DrawCall> & calls = HostCompositor::GetDrawCalls();
+    size_t textDraws = 0;
+    for (size_t i = 0; i < calls.size(); i++)
+    {
+        if (calls[i].Op == HostCompositor::kDrawOp_DrawText)
+        {
+            EXPECT_EQ(calls[i].Text.size(), 1);
+            textDraws++;
+        }
+    }
+    EXPECT_EQ(GetMaskDraws().size(), 0);
+    EXPECT_EQ(textDraws, kNumIndicators);
+    EXPECT_EQ(HostCompositor::GetGlyphLookups(), 2 * kNumIndicators);
+}
+
+} // unnamed namespace
+
+int main(void)
+{
+    RUN_TEST(TestHits);
+    RUN_TEST(TestEviction);
+    RUN_TEST(TestSlots);
+    RUN_TEST(TestResize);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,277 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host tests for the regions TitleWidget invalidates as its logo moves, using the
+ *      compositor stand-in (HostCompositor.cpp) and a logo in a simulated assets partition.
+ */
+
+#include <string.h>
+#include <vector>
+
+#include "HostSim.h"
+#include "HostDisplay.h"
+#include "HostCompositor.h"
+#include "HostTest.h"
+#include "Assets.h"
+#include "TitleWidget.h"
+
+namespace {
+
+enum
+{
+    kLogoWidth = 40,
+    kLogoHeight = 10,
+    kLogoX = (HostDisplay::kWidth - kLogoWidth) / 2,
+    kAssetNameLength = 16,
+};
+
+const int64_t kMS = 1000;
+const color_t kBarColor = { 200, 100, 52 };
+
+// Every row of the logo has three vertical bars: two 4 pixels apart, which are redrawn together,
+// and one 18 pixels from them, which is redrawn separately.
+const int kBars[][2] = { { 2, 5 }, { 9, 12 }, { 30, 33 } };
+const int kSpans[][2] = { { 2, 12 }, { 30, 33 } };
+
+std::vector<uint8_t> sAssetImage;
+
+void Append16(std::vector<uint8_t> & buf, uint16_t val)
+{
+    buf.push_back((uint8_t)val);
+    buf.push_back((uint8_t)(val >> 8));
+}
+
+void Append32(std::vector<uint8_t> & buf, uint32_t val)
+{
+    Append16(buf, (uint16_t)val);
+    Append16(buf, (uint16_t)(val >> 16));
+}
+
+void AppendPixel(std::vector<uint8_t> & buf, const color_t & pixel)
+{
+    buf.push_back(pixel.r);
+    buf.push_back(pixel.g);
+    buf.push_back(pixel.b);
+}
+
+const color_t & LogoPixel(int x)
+{
+    for (size_t i = 0; i < sizeof(kBars) / sizeof(kBars[0]); i++)
+    {
+        if (x >= kBars[i][0] && x < kBars[i][1])
+        {
+            return kBarColor;
+        }
+    }
+    return TFT_BLACK;
+}
+
+/* Build an asset image, in the format produced by tools/mkassets.py, holding the logo either raw
+ * or run-length encoded.
+ */
+void BuildAssetImage(uint8_t format)
+{
+    std::vector<uint8_t> data;
+
+    if (format == DisplayAsset::kFormat_Raw)
+    {
+        for (int y = 0; y < kLogoHeight; y++)
+        {
+            for (int x = 0; x < kLogoWidth; x++)
+            {
+                AppendPixel(data, LogoPixel(x));
+            }
+        }
+    }
+    else
+    {
+        // Each row is encoded as runs only; rows are identical, so share one encoding.
+        std::vector<uint8_t> row;
+        for (int x = 0; x < kLogoWidth;)
+        {
+            int runLen = 1;
+            while (x + runLen < kLogoWidth && memcmp(&LogoPixel(x + runLen), &LogoPixel(x), sizeof(color_t)) == 0)
+            {
+                runLen++;
+            }
+            row.push_back((uint8_t)(0x80 | (runLen - 1)));
+            AppendPixel(row, LogoPixel(x));
+            x += runLen;
+        }
+        for (int y = 0; y < kLogoHeight; y++)
+        {
+            Append32(data, (uint32_t)(4 * kLogoHeight + y * row.size()));
+        }
+        for (int y = 0; y < kLogoHeight; y++)
+        {
+            data.insert(data.end(), row.begin(), row.end());
+        }
+    }
+
+    char name[kAssetNameLength] = "OpenWeaveLogo";
+
+    sAssetImage.clear();
+    Append32(sAssetImage, 0x4144574F);
+    Append16(sAssetImage, 1);
+    Append16(sAssetImage, 1);
+    sAssetImage.insert(sAssetImage.end(), name, name + kAssetNameLength);
+    Append16(sAssetImage, kLogoWidth);
+    Append16(sAssetImage, kLogoHeight);
+    sAssetImage.push_back(format);
+    sAssetImage.insert(sAssetImage.end(), 3, 0);
+    Append32(sAssetImage, (uint32_t)(sAssetImage.size() + 8));
+    Append32(sAssetImage, (uint32_t)data.size());
+    sAssetImage.insert(sAssetImage.end(), data.begin(), data.end());
+}
+
+/* Show a title widget and start its animation, leaving the logo at the top of the display.
+ */
+int64_t StartTitle(TitleWidget & title, uint8_t format)
+{
+    Drawable * scene[] = { &title };
+
+    HostSim::Reset();
+    HostDisplay::Reset();
+    BuildAssetImage(format);
+    HostDisplay::SetAssetImage(&sAssetImage[0], (uint32_t)sAssetImage.size());
+    EXPECT_EQ(InitDisplay(), ESP_OK);
+    EXPECT_EQ(InitDisplayAssets(), ESP_OK);
+    HostCompositor::Reset();
+
+    title.Init("Test");
+    DisplayCompositor.SetScene(scene, 1);
+    title.Start();
+    title.Animate();
+
+    HostCompositor::ClearLogs();
+
+    return HostSim::Now();
+}
+
+/* Expect the spans that change on each display row as the logo moves down by the given number
+ * of rows: at the top, rows the logo leaves, and at the bottom, rows it enters.  Rows in between
+ * are unchanged, since every row of the logo is the same.
+ */
+void ExpectMoveSpans(uint16_t oldY, uint16_t newY)
+{
+    const std::vector<DisplayRect> & rects = HostCompositor::GetInvalidations();
+    const size_t numSpans = sizeof(kSpans) / sizeof(kSpans[0]);
+    std::vector<int> rows;
+    size_t i = 0;
+
+    for (int y = oldY; y < newY; y++)
+    {
+        rows.push_back(y);
+    }
+    for (int y = oldY + kLogoHeight; y < newY + kLogoHeight; y++)
+    {
+        rows.push_back(y);
+    }
+
+    EXPECT_EQ(rects.size(), rows.size() * numSpans);
+
+    for (size_t r = 0; r < rows.size(); r++)
+    {
+        for (size_t s = 0; s < numSpans && i < rects.size(); s++, i++)
+        {
+            EXPECT_EQ(rects[i].X, kLogoX + kSpans[s][0]);
+            EXPECT_EQ(rects[i].Y, rows[r]);
+            EXPECT_EQ(rects[i].Width, kSpans[s][1] - kSpans[s][0]);
+            EXPECT_EQ(rects[i].Height, 1);
+        }
+    }
+}
+
+/* Moving the logo down one row redraws only the changed spans of its first and last rows.
+ * (The logo falls 48 rows in 1000 ms, so 21 ms moves it one row.)
+ */
+void TestMoveOneRow(void)
+{
+    TitleWidget title;
+    int64_t startUS = StartTitle(title, DisplayAsset::kFormat_Raw);
+
+    HostSim::RunUntil(startUS + 21 * kMS);
+    title.Animate();
+
+    ExpectMoveSpans(0, 1);
+}
+
+/* Moving the logo down several rows redraws the changed spans of as many rows at each end.
+ */
+void TestMoveSeveralRows(void)
+{
+    TitleWidget title;
+    int64_t startUS = StartTitle(title, DisplayAsset::kFormat_Raw);
+
+    HostSim::RunUntil(startUS + 21 * kMS);
+    title.Animate();
+    HostCompositor::ClearLogs();
+
+    HostSim::RunUntil(startUS + 84 * kMS);
+    title.Animate();
+
+    ExpectMoveSpans(1, 4);
+}
+
+/* Run-length encoded logos give the same spans.
+ */
+void TestMoveRLE(void)
+{
+    TitleWidget title;
+    int64_t startUS = StartTitle(title, DisplayAsset::kFormat_RLE);
+
+    HostSim::RunUntil(startUS + 63 * kMS);
+    title.Animate();
+
+    ExpectMoveSpans(0, 3);
+}
+
+/* The logo stops at its final position, and later animation steps invalidate nothing more for it.
+ */
+void TestMoveEnds(void)
+{
+    TitleWidget title;
+    int64_t startUS = StartTitle(title, DisplayAsset::kFormat_Raw);
+
+    HostSim::RunUntil(startUS + 990 * kMS);
+    title.Animate();
+    HostCompositor::ClearLogs();
+
+    HostSim::RunUntil(startUS + 1000 * kMS);
+    title.Animate();
+    ExpectMoveSpans(47, 48);
+    HostCompositor::ClearLogs();
+
+    HostSim::RunUntil(startUS + 1100 * kMS);
+    title.Animate();
+    EXPECT_EQ(HostCompositor::GetInvalidations().size(), 0);
+}
+
+} // unnamed namespace
+
+int main(void)
+{
+    RUN_TEST(TestMoveOneRow);
+    RUN_TEST(TestMoveSeveralRows);
+    RUN_TEST(TestMoveRLE);
+    RUN_TEST(TestMoveEnds);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,335 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host tests comparing the trait schema tables and typed serializers generated by
+ *      tools/mktraits.py against the hand-written tables and GetLeafData() switch they
+ *      replaced.
+ */
+
+#include <string.h>
+#include <vector>
+
+#include "HostTest.h"
+#include <nest/trait/lighting/LogicalCircuitStateTrait.h>
+#include <nest/trait/lighting/LogicalCircuitControlTrait.h>
+#include <nest/trait/performance/DeviceMetricsTrait.h>
+
+using namespace ::nl::Weave::TLV;
+using namespace ::nl::Weave::Profiles::DataManagement_Current;
+using namespace ::Schema::Nest::Trait::Lighting;
+using namespace ::Schema::Nest::Trait::Performance;
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+enum
+{
+    kMaxEncodedLen = 128,
+};
+
+/* The schema tables as they were hand-maintained before tools/mktraits.py generated them.
+ */
+const TraitSchemaEngine::PropertyInfo HandWrittenStatePropertyMap[] =
+{
+    { LogicalCircuitStateTrait::kPropertyHandle_Root, 1 }, // state
+    { LogicalCircuitStateTrait::kPropertyHandle_Root, 2 }, // brightness
+};
+const uint8_t HandWrittenStateIsNullableHandleBitfield[] = { 0x2 };
+
+const TraitSchemaEngine::PropertyInfo HandWrittenMetricsPropertyMap[] =
+{
+    { DeviceMetricsTrait::kPropertyHandle_Root, 1 }, // uptime_sec
+    { DeviceMetricsTrait::kPropertyHandle_Root, 2 }, // commands_received
+    { DeviceMetricsTrait::kPropertyHandle_Root, 3 }, // commands_sent
+    { DeviceMetricsTrait::kPropertyHandle_Root, 4 }, // echo_rtt_ms
+    { DeviceMetricsTrait::kPropertyHandle_Root, 5 }, // free_heap
+    { DeviceMetricsTrait::kPropertyHandle_Root, 6 }, // min_free_heap
+    { DeviceMetricsTrait::kPropertyHandle_Root, 7 }, // largest_free_block
+    { DeviceMetricsTrait::kPropertyHandle_Root, 8 }, // max_event_loop_lateness_ms
+};
+
+/* The LogicalCircuitStateTrait data source as it was before the generated serializer, writing
+ * each leaf from a switch on its handle.
+ */
+class HandWrittenStateDataSource : public TraitDataSource
+{
+public:
+    HandWrittenStateDataSource(void) : TraitDataSource(&LogicalCircuitStateTrait::TraitSchema) { }
+
+    int8_t State;
+    uint8_t Level;
+
+private:
+    WEAVE_ERROR GetLeafData(PropertyPathHandle aLeafHandle, uint64_t aTagToWrite, TLVWriter & aWriter) __OVERRIDE
+    {
+        WEAVE_ERROR err = WEAVE_NO_ERROR;
+
+        switch (aLeafHandle)
+        {
+        case LogicalCircuitStateTrait::kPropertyHandle_State:
+            err = aWriter.Put(aTagToWrite, State);
+            SuccessOrExit(err);
+            break;
+
+        case LogicalCircuitStateTrait::kPropertyHandle_Brightness:
+            err = aWriter.Put(aTagToWrite, Level);
+            SuccessOrExit(err);
+            break;
+
+        default:
+            break;
+        }
+
+    exit:
+        return err;
+    }
+};
+
+/* The LogicalCircuitStateTrait data source as served by the light controller, through the
+ * generated serializer.
+ */
+class TypedStateDataSource : public TraitDataSource
+{
+public:
+    TypedStateDataSource(void) : TraitDataSource(&LogicalCircuitStateTrait::TraitSchema) { }
+
+    LogicalCircuitStateTrait::Data Data;
+
+private:
+    WEAVE_ERROR GetLeafData(PropertyPathHandle aLeafHandle, uint64_t aTagToWrite, TLVWriter & aWriter) __OVERRIDE
+    {
+        return LogicalCircuitStateTrait::Serializer::WriteLeaf(Data, aLeafHandle, aTagToWrite, aWriter);
+    }
+};
+
+Bytes ReadData(TraitDataSource & dataSource, PropertyPathHandle handle, uint64_t tag)
+{
+    uint8_t buf[kMaxEncodedLen];
+    TLVWriter writer;
+
+    writer.Init(buf, sizeof(buf));
+    EXPECT_EQ(dataSource.ReadData(handle, tag, writer), WEAVE_NO_ERROR);
+
+    return Bytes(buf, buf + writer.GetLengthWritten());
+}
+
+/* Write the leaves selected by a mask, in a structure, with WriteLeaves().
+ */
+template <typename SerializerT, typename DataT>
+Bytes WriteLeaves(const DataT & data, uint32_t leafMask)
+{
+    uint8_t buf[kMaxEncodedLen];
+    TLVWriter writer;
+    TLVType container;
+
+    writer.Init(buf, sizeof(buf));
+    EXPECT_EQ(writer.StartContainer(AnonymousTag, kTLVType_Structure, container), WEAVE_NO_ERROR);
+    EXPECT_EQ(SerializerT::WriteLeaves(data, leafMask, writer), WEAVE_NO_ERROR);
+    EXPECT_EQ(writer.EndContainer(container), WEAVE_NO_ERROR);
+
+    return Bytes(buf, buf + writer.GetLengthWritten());
+}
+
+/* Write the same leaves one at a time with WriteLeaf(), each with the tag given by the schema.
+ */
+template <typename SerializerT, typename DataT>
+Bytes WriteEachLeaf(const DataT & data, uint32_t leafMask, const TraitSchemaEngine & schema, PropertyPathHandle firstLeafHandle)
+{
+    uint8_t buf[kMaxEncodedLen];
+    TLVWriter writer;
+    TLVType container;
+
+    writer.Init(buf, sizeof(buf));
+    EXPECT_EQ(writer.StartContainer(AnonymousTag, kTLVType_Structure, container), WEAVE_NO_ERROR);
+    for (uint32_t i = 0; i < SerializerT::kNumLeaves; i++)
+    {
+        PropertyPathHandle handle = (PropertyPathHandle)(firstLeafHandle + i);
+
+        if (leafMask & SerializerT::LeafBit(handle))
+        {
+            EXPECT_EQ(SerializerT::WriteLeaf(data, handle, schema.GetTag(handle), writer), WEAVE_NO_ERROR);
+        }
+    }
+    EXPECT_EQ(writer.EndContainer(container), WEAVE_NO_ERROR);
+
+    return Bytes(buf, buf + writer.GetLengthWritten());
+}
+
+void CheckSchema(const TraitSchemaEngine & schema, uint32_t profileId, const TraitSchemaEngine::PropertyInfo * propertyMap,
+                 uint32_t numEntries, const uint8_t * isNullableBitfield)
+{
+    EXPECT_EQ(schema.mSchema.mProfileId, profileId);
+    EXPECT_EQ(schema.mSchema.mTreeDepth, 1u);
+    if (EXPECT_EQ(schema.mSchema.mNumSchemaHandleEntries, numEntries))
+    {
+        for (uint32_t i = 0; i < numEntries; i++)
+        {
+            EXPECT_EQ(schema.mSchema.mSchemaHandleTbl[i].mParentHandle, propertyMap[i].mParentHandle);
+            EXPECT_EQ(schema.mSchema.mSchemaHandleTbl[i].mContextTag, propertyMap[i].mContextTag);
+        }
+    }
+    if (isNullableBitfield == NULL)
+    {
+        EXPECT(schema.mSchema.mIsNullableBitfield == NULL);
+    }
+    else if (EXPECT(schema.mSchema.mIsNullableBitfield != NULL))
+    {
+        EXPECT_EQ(schema.mSchema.mIsNullableBitfield[0], isNullableBitfield[0]);
+    }
+    EXPECT(schema.mSchema.mIsDictionaryBitfield == NULL);
+    EXPECT(schema.mSchema.mIsOptionalBitfield == NULL);
+    EXPECT(schema.mSchema.mIsImplicitBitfield == NULL);
+    EXPECT(schema.mSchema.mIsEphemeralBitfield == NULL);
+}
+
+/* The generated schema tables match the hand-written ones.
+ */
+void TestSchemaTables(void)
+{
+    CheckSchema(LogicalCircuitStateTrait::TraitSchema, (0x235aU << 16) | 0x237U, HandWrittenStatePropertyMap,
+                sizeof(HandWrittenStatePropertyMap) / sizeof(HandWrittenStatePropertyMap[0]),
+                HandWrittenStateIsNullableHandleBitfield);
+    CheckSchema(DeviceMetricsTrait::TraitSchema, (0xfff1U << 16) | 0x1U, HandWrittenMetricsPropertyMap,
+                sizeof(HandWrittenMetricsPropertyMap) / sizeof(HandWrittenMetricsPropertyMap[0]), NULL);
+    CheckSchema(LogicalCircuitControlTrait::TraitSchema, (0x235aU << 16) | 0x20dU, NULL, 0, NULL);
+
+    EXPECT_EQ(LogicalCircuitStateTrait::kLastSchemaHandle, 3);
+    EXPECT_EQ(DeviceMetricsTrait::kLastSchemaHandle, 9);
+    EXPECT_EQ(LogicalCircuitStateTrait::Serializer::kNumLeaves, 2);
+    EXPECT_EQ(DeviceMetricsTrait::Serializer::kNumLeaves, 8);
+}
+
+/* The state trait, served through the generated serializer, encodes to the same bytes as the
+ * hand-written GetLeafData() switch, both as a whole and leaf by leaf.
+ */
+void TestStateMatchesHandWritten(void)
+{
+    static const int8_t states[] = { LogicalCircuitStateTrait::CIRCUIT_STATE_ON, LogicalCircuitStateTrait::CIRCUIT_STATE_OFF };
+    static const uint8_t levels[] = { 0, 1, 50, 100, 127, 128, 255 };
+    HandWrittenStateDataSource handWritten;
+    TypedStateDataSource typed;
+
+    for (size_t s = 0; s < sizeof(states); s++)
+    {
+        for (size_t l = 0; l < sizeof(levels); l++)
+        {
+            handWritten.State = states[s];
+            handWritten.Level = levels[l];
+            typed.Data.State = states[s];
+            typed.Data.Brightness = levels[l];
+            typed.Data.BrightnessIsNull = false;
+
+            for (PropertyPathHandle handle = LogicalCircuitStateTrait::kPropertyHandle_Root;
+                 handle <= LogicalCircuitStateTrait::kLastSchemaHandle; handle++)
+            {
+                EXPECT(ReadData(typed, handle, ContextTag(4)) == ReadData(handWritten, handle, ContextTag(4)));
+            }
+        }
+    }
+
+    // Pin the encoding itself: a structure holding state ON (1) and brightness 50.
+    {
+        static const uint8_t expected[] = { 0x15, 0x20, 0x01, 0x01, 0x24, 0x02, 0x32, 0x18 };
+
+        typed.Data.State = LogicalCircuitStateTrait::CIRCUIT_STATE_ON;
+        typed.Data.Brightness = 50;
+        EXPECT(ReadData(typed, LogicalCircuitStateTrait::kPropertyHandle_Root, AnonymousTag) == Bytes(expected, expected + sizeof(expected)));
+    }
+
+    // The nullable brightness, which the hand-written switch could not express, is written as null.
+    {
+        static const uint8_t expected[] = { 0x34, 0x02 };
+
+        typed.Data.BrightnessIsNull = true;
+        EXPECT(ReadData(typed, LogicalCircuitStateTrait::kPropertyHandle_Brightness, ContextTag(2)) == Bytes(expected, expected + sizeof(expected)));
+    }
+}
+
+/* WriteLeaves() writes the same bytes as WriteLeaf() called for each selected leaf, for every
+ * combination of leaves.
+ */
+void TestWriteLeavesMatchesWriteLeaf(void)
+{
+    LogicalCircuitStateTrait::Data state;
+    DeviceMetricsTrait::Data metrics;
+
+    state.State = LogicalCircuitStateTrait::CIRCUIT_STATE_OFF;
+    state.Brightness = 200;
+    for (int isNull = 0; isNull < 2; isNull++)
+    {
+        state.BrightnessIsNull = (isNull != 0);
+        for (uint32_t mask = 0; mask <= LogicalCircuitStateTrait::Serializer::kAllLeaves; mask++)
+        {
+            EXPECT((WriteLeaves<LogicalCircuitStateTrait::Serializer>(state, mask) ==
+                    WriteEachLeaf<LogicalCircuitStateTrait::Serializer>(state, mask, LogicalCircuitStateTrait::TraitSchema,
+                                                                       LogicalCircuitStateTrait::kPropertyHandle_State)));
+        }
+    }
+
+    // Values needing 1, 2, 3 and 4 bytes.
+    metrics.UptimeSec = 0;
+    metrics.CommandsReceived = 255;
+    metrics.CommandsSent = 256;
+    metrics.EchoRttMs = 65535;
+    metrics.FreeHeap = 65536;
+    metrics.MinFreeHeap = 150000;
+    metrics.LargestFreeBlock = 0x01000000;
+    metrics.MaxEventLoopLatenessMs = UINT32_MAX;
+    for (uint32_t mask = 0; mask <= DeviceMetricsTrait::Serializer::kAllLeaves; mask++)
+    {
+        EXPECT((WriteLeaves<DeviceMetricsTrait::Serializer>(metrics, mask) ==
+                WriteEachLeaf<DeviceMetricsTrait::Serializer>(metrics, mask, DeviceMetricsTrait::TraitSchema,
+                                                             DeviceMetricsTrait::kPropertyHandle_UptimeSec)));
+    }
+
+    // All leaves, with the integers in the fewest bytes that hold them.
+    EXPECT_EQ(WriteLeaves<DeviceMetricsTrait::Serializer>(metrics, DeviceMetricsTrait::Serializer::kAllLeaves).size(),
+              1 + (3 + 3 + 4 + 4 + 6 + 6 + 6 + 6) + 1);
+}
+
+/* As GetLeafData() must, WriteLeaf() writes nothing for handles that are not leaves of the trait.
+ */
+void TestWriteLeafIgnoresOtherHandles(void)
+{
+    LogicalCircuitStateTrait::Data state;
+    uint8_t buf[kMaxEncodedLen];
+    TLVWriter writer;
+
+    memset(&state, 0, sizeof(state));
+    writer.Init(buf, sizeof(buf));
+    EXPECT_EQ(LogicalCircuitStateTrait::Serializer::WriteLeaf(state, LogicalCircuitStateTrait::kPropertyHandle_Root, AnonymousTag, writer),
+              WEAVE_NO_ERROR);
+    EXPECT_EQ(LogicalCircuitStateTrait::Serializer::WriteLeaf(state, LogicalCircuitStateTrait::kLastSchemaHandle + 1, AnonymousTag, writer),
+              WEAVE_NO_ERROR);
+    EXPECT_EQ(writer.GetLengthWritten(), 0u);
+}
+
+} // unnamed namespace
+
+int main(void)
+{
+    RUN_TEST(TestSchemaTables);
+    RUN_TEST(TestStateMatchesHandWritten);
+    RUN_TEST(TestWriteLeavesMatchesWriteLeaf);
+    RUN_TEST(TestWriteLeafIgnoresOtherHandles);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,83 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host stand-in for the parts of the OpenWeave System Layer used by the code under test,
+ *      implemented by HostWeave.cpp: PacketBuffers, allocated from a pool that can be limited
+ *      (see HostWeave.h), and timers, which run on the simulated esp_timer service.
+ */
+
+#ifndef HOST_SYSTEM_LAYER_H
+#define HOST_SYSTEM_LAYER_H
+
+#include <inttypes.h>
+
+#define WEAVE_SYSTEM_NO_ERROR                       0
+#define WEAVE_SYSTEM_CONFIG_NO_ERROR                0
+#define WEAVE_SYSTEM_ERROR_REAL_TIME_NOT_SYNCED     10010
+
+namespace nl {
+namespace Weave {
+namespace System {
+
+typedef int32_t Error;
+
+class PacketBuffer
+{
+public:
+    enum
+    {
+        kBufferSize = 1280,         // Bytes of data space in each buffer
+        kHeaderReserve = 64,        // Space reserved for message headers ahead of the initial start of the data
+    };
+
+    uint8_t * Start(void) const;
+    void SetStart(uint8_t * aNewStart);
+    uint16_t DataLength(void) const;
+    void SetDataLength(uint16_t aNewLen);
+    uint16_t MaxDataLength(void) const;
+    uint16_t AvailableDataLength(void) const;
+    void AddRef(void);
+
+    static PacketBuffer * New(void);
+    static void Free(PacketBuffer * aPacket);
+
+private:
+    uint8_t * mStart;
+    uint16_t mDataLen;
+    uint16_t mRefCount;
+    uint8_t mBuf[kBufferSize];
+};
+
+class Layer
+{
+public:
+    typedef void (*TimerCompleteFunct)(Layer * aLayer, void * aAppState, Error aError);
+
+    Error StartTimer(uint32_t aMilliseconds, TimerCompleteFunct aComplete, void * aAppState);
+    void CancelTimer(TimerCompleteFunct aOnComplete, void * aAppState);
+
+    static Error GetClock_RealTimeMS(uint64_t & curTime);
+};
+
+} // namespace System
+} // namespace Weave
+} // namespace nl
+
+#endif // HOST_SYSTEM_LAYER_H
@@ -0,0 +1,57 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host stand-in for the OpenWeave System Layer statistics, implemented by HostWeave.cpp.
+ *      Only the PacketBuffer counts are kept.
+ */
+
+#ifndef HOST_SYSTEM_STATS_H
+#define HOST_SYSTEM_STATS_H
+
+#include <SystemLayer/SystemLayer.h>
+
+#define WEAVE_SYSTEM_CONFIG_PROVIDE_STATISTICS 1
+#define LWIP_STATS 1
+#define MEMP_STATS 1
+
+namespace nl {
+namespace Weave {
+namespace System {
+namespace Stats {
+
+enum
+{
+    kSystemLayer_NumPacketBufs,
+
+    kNumEntries
+};
+
+typedef int32_t count_t;
+
+count_t * GetResourcesInUse(void);
+count_t * GetHighWatermarks(void);
+void UpdateLwipPbufCounts(void);
+
+} // namespace Stats
+} // namespace System
+} // namespace Weave
+} // namespace nl
+
+#endif // HOST_SYSTEM_STATS_H
@@ -0,0 +1,217 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host stand-in for the parts of the OpenWeave core used by the code under test: error
+ *      codes, the error handling macros, profile and status codes, bindings, which become ready
+ *      as soon as they are prepared, and exchange contexts, which discard the messages sent on
+ *      them.  Bindings and exchange contexts are implemented by HostWeave.cpp.
+ */
+
+#ifndef HOST_WEAVE_CORE_H
+#define HOST_WEAVE_CORE_H
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "esp_system.h"
+#include <SystemLayer/SystemLayer.h>
+
+typedef int32_t WEAVE_ERROR;
+
+#define WEAVE_NO_ERROR                  0
+#define WEAVE_ERROR_INCORRECT_STATE     4003
+#define WEAVE_ERROR_NO_MEMORY           4011
+#define WEAVE_ERROR_BUFFER_TOO_SMALL    4019
+#define WEAVE_END_OF_TLV                4021
+#define WEAVE_ERROR_TLV_UNDERRUN        4022
+#define WEAVE_ERROR_INVALID_TLV_ELEMENT 4023
+#define WEAVE_ERROR_WRONG_TLV_TYPE      4035
+#define WEAVE_ERROR_UNEXPECTED_TLV_ELEMENT 4037
+#define WEAVE_ERROR_INVALID_ARGUMENT    4047
+#define WEAVE_ERROR_TIMEOUT             4050
+
+#define __OVERRIDE override
+
+#define SuccessOrExit(err) do { if ((err) != 0) goto exit; } while (0)
+#define VerifyOrExit(cond, action) do { if (!(cond)) { action; goto exit; } } while (0)
+#define ExitNow(...) do { __VA_ARGS__; goto exit; } while (0)
+
+inline const char * ErrorStr(int err)
+{
+    return esp_err_to_name(err);
+}
+
+namespace nl {
+
+namespace Inet {
+} // namespace Inet
+
+namespace Weave {
+
+using System::PacketBuffer;
+
+namespace Profiles {
+
+enum
+{
+    kWeaveProfile_Common = 0x00000000,
+    kWeaveProfile_WDM = 0x0000000B,
+};
+
+namespace Common {
+
+enum
+{
+    kStatus_Success = 0x0000,
+    kStatus_BadRequest = 0x0010,
+    kStatus_UnsupportedMessage = 0x0011,
+    kStatus_InternalError = 0x0050,
+};
+
+} // namespace Common
+} // namespace Profiles
+
+enum
+{
+    kWeaveSubnetId_PrimaryWiFi = 1,
+};
+
+struct WeaveMessageInfo
+{
+    uint64_t SourceNodeId;
+};
+
+struct WRMPConfig
+{
+    uint32_t mInitialRetransTimeout;
+    uint32_t mActiveRetransTimeout;
+    uint16_t mAckPiggybackTimeout;
+    uint8_t mMaxRetrans;
+};
+
+class ExchangeContext
+{
+public:
+    typedef void (*WRMPAckRcvdFunct)(ExchangeContext * ec, void * msgCtxt);
+    typedef void (*WRMPSendErrorFunct)(ExchangeContext * ec, WEAVE_ERROR err, void * msgCtxt);
+
+    void * AppState;
+    WRMPAckRcvdFunct OnAckRcvd;
+    WRMPSendErrorFunct OnSendError;
+
+    WEAVE_ERROR SendMessage(uint32_t profileId, uint8_t msgType, PacketBuffer * msgPayload);
+    void Abort(void);
+};
+
+class Binding
+{
+public:
+    enum State
+    {
+        kState_NotAllocated = 0,
+        kState_NotConfigured,
+        kState_Preparing,
+        kState_Ready,
+        kState_Failed,
+    };
+
+    enum EventType
+    {
+        kEvent_BindingReady = 1,
+        kEvent_PrepareFailed = 2,
+        kEvent_BindingFailed = 3,
+        kEvent_PrepareRequested = 4,
+        kEvent_DefaultCheck = 100,
+    };
+
+    struct InEventParam
+    {
+        Binding * Source;
+        union
+        {
+            struct
+            {
+                WEAVE_ERROR Reason;
+            } PrepareFailed;
+        };
+    };
+
+    struct OutEventParam
+    {
+        bool DefaultHandlerCalled;
+        union
+        {
+            struct
+            {
+                WEAVE_ERROR PrepareError;
+            } PrepareRequested;
+        };
+    };
+
+    typedef void (*EventCallback)(void * apAppState, EventType aEvent, const InEventParam & aInParam, OutEventParam & aOutParam);
+
+    class Configuration
+    {
+    public:
+        Configuration & Target_NodeId(uint64_t aNodeId);
+        Configuration & Target_ServiceEndpoint(uint64_t serviceEndpointId);
+        Configuration & TargetAddress_WeaveFabric(uint8_t aSubnetId);
+        Configuration & Transport_UDP_WRM(void);
+        Configuration & Transport_DefaultWRMPConfig(const WRMPConfig & aWRMPConfig);
+        Configuration & Security_SharedCASESession(void);
+        Configuration & Security_None(void);
+        Configuration & Exchange_ResponseTimeoutMsec(uint32_t aResponseTimeoutMsec);
+        WEAVE_ERROR PrepareBinding(void);
+
+    private:
+        friend class Binding;
+
+        Binding * mBinding;
+    };
+
+    Binding(EventCallback eventCallback, void * appState);
+
+    Configuration BeginConfiguration(void);
+    WEAVE_ERROR RequestPrepare(void);
+    State GetState(void) const;
+    bool IsPreparing(void) const;
+    uint32_t GetDefaultResponseTimeout(void) const;
+    WEAVE_ERROR NewExchangeContext(ExchangeContext *& appExchangeContext);
+
+    static void DefaultEventHandler(void * apAppState, EventType aEvent, const InEventParam & aInParam, OutEventParam & aOutParam);
+
+    void * AppState;
+
+private:
+    State mState;
+    EventCallback mEventCallback;
+    uint32_t mResponseTimeoutMsec;
+};
+
+class WeaveExchangeManager
+{
+public:
+    Binding * NewBinding(Binding::EventCallback eventCallback = Binding::DefaultEventHandler, void * appState = NULL);
+};
+
+} // namespace Weave
+} // namespace nl
+
+#endif // HOST_WEAVE_CORE_H
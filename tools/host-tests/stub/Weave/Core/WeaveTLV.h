@@ -0,0 +1,146 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host stand-in for the OpenWeave TLV writer and reader, implemented by HostWeave.cpp.
+ *      Elements are encoded as by OpenWeave, with integers in the fewest bytes that hold their
+ *      value, so encoded lengths match those seen on the device.  Only the element types and
+ *      tag forms that the writer produces can be read.
+ */
+
+#ifndef HOST_WEAVE_TLV_H
+#define HOST_WEAVE_TLV_H
+
+#include <Weave/Core/WeaveCore.h>
+
+namespace nl {
+namespace Weave {
+namespace TLV {
+
+enum TLVType
+{
+    kTLVType_NotSpecified       = -1,
+    kTLVType_SignedInteger      = 0x00,
+    kTLVType_UnsignedInteger    = 0x04,
+    kTLVType_Boolean            = 0x08,
+    kTLVType_Null               = 0x14,
+    kTLVType_Structure          = 0x15,
+    kTLVType_Array              = 0x16,
+    kTLVType_Path               = 0x17,
+};
+
+const uint64_t kProfileIdMask = 0xFFFFFFFF00000000ULL;
+const uint64_t kTagNumMask = 0x00000000FFFFFFFFULL;
+const uint64_t kSpecialTagMarker = 0xFFFFFFFF00000000ULL;
+const uint64_t AnonymousTag = kSpecialTagMarker | 0x00000000FFFFFFFFULL;
+
+inline uint64_t ProfileTag(uint32_t profileId, uint32_t tagNum)
+{
+    return (((uint64_t)profileId) << 32) | tagNum;
+}
+
+inline uint64_t ContextTag(uint8_t tagNum)
+{
+    return kSpecialTagMarker | tagNum;
+}
+
+inline uint32_t TagNumFromTag(uint64_t tag)
+{
+    return (uint32_t)(tag & kTagNumMask);
+}
+
+inline bool IsContextTag(uint64_t tag)
+{
+    return (tag & kProfileIdMask) == kSpecialTagMarker && tag != AnonymousTag;
+}
+
+class TLVWriter
+{
+public:
+    void Init(uint8_t * buf, uint32_t maxLen);
+    void Init(PacketBuffer * buf);
+
+    WEAVE_ERROR Put(uint64_t tag, int8_t v);
+    WEAVE_ERROR Put(uint64_t tag, int16_t v);
+    WEAVE_ERROR Put(uint64_t tag, int32_t v);
+    WEAVE_ERROR Put(uint64_t tag, int64_t v);
+    WEAVE_ERROR Put(uint64_t tag, uint8_t v);
+    WEAVE_ERROR Put(uint64_t tag, uint16_t v);
+    WEAVE_ERROR Put(uint64_t tag, uint32_t v);
+    WEAVE_ERROR Put(uint64_t tag, uint64_t v);
+    WEAVE_ERROR PutBoolean(uint64_t tag, bool v);
+    WEAVE_ERROR PutNull(uint64_t tag);
+    WEAVE_ERROR StartContainer(uint64_t tag, TLVType containerType, TLVType & outerContainerType);
+    WEAVE_ERROR EndContainer(TLVType outerContainerType);
+    WEAVE_ERROR Finalize(void);
+    uint32_t GetLengthWritten(void);
+
+private:
+    uint8_t * mBuf;
+    uint32_t mMaxLen;
+    uint32_t mLenWritten;
+    TLVType mContainerType;
+    PacketBuffer * mPacketBuf;
+
+    WEAVE_ERROR WriteElementHead(uint8_t elemType, uint64_t tag, uint32_t valueLen);
+    WEAVE_ERROR WriteInteger(uint64_t tag, uint8_t baseType, uint64_t v, uint32_t valueLen);
+};
+
+class TLVReader
+{
+public:
+    void Init(const uint8_t * data, uint32_t dataLen);
+    void Init(PacketBuffer * buf);
+
+    WEAVE_ERROR Next(void);
+    TLVType GetType(void) const;
+    uint64_t GetTag(void) const;
+
+    WEAVE_ERROR Get(bool & v);
+    WEAVE_ERROR Get(int8_t & v);
+    WEAVE_ERROR Get(int16_t & v);
+    WEAVE_ERROR Get(int32_t & v);
+    WEAVE_ERROR Get(int64_t & v);
+    WEAVE_ERROR Get(uint8_t & v);
+    WEAVE_ERROR Get(uint16_t & v);
+    WEAVE_ERROR Get(uint32_t & v);
+    WEAVE_ERROR Get(uint64_t & v);
+
+    WEAVE_ERROR EnterContainer(TLVType & outerContainerType);
+    WEAVE_ERROR ExitContainer(TLVType outerContainerType);
+
+private:
+    const uint8_t * mBuf;
+    uint32_t mLen;
+    uint32_t mReadPoint;
+    int mElemType;                  // Element type of the current element, or -1 if none
+    uint64_t mElemTag;
+    uint64_t mElemValue;
+    TLVType mContainerType;
+    bool mContainerOpen;            // The current element is a container that has not been entered
+
+    WEAVE_ERROR ReadElement(void);
+    WEAVE_ERROR SkipContainer(void);
+};
+
+} // namespace TLV
+} // namespace Weave
+} // namespace nl
+
+#endif // HOST_WEAVE_TLV_H
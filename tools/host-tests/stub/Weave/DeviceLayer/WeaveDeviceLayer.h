@@ -0,0 +1,114 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host stand-in for the parts of the OpenWeave Device Layer used by the code under test.
+ *      The Device Layer objects are implemented by HostWeave.cpp, or by the tests that use them
+ *      without it.  Device events are dispatched by HostWeave::DispatchEvent().
+ */
+
+#ifndef HOST_WEAVE_DEVICE_LAYER_H
+#define HOST_WEAVE_DEVICE_LAYER_H
+
+#include <Weave/Core/WeaveCore.h>
+
+namespace nl {
+namespace Weave {
+
+namespace Profiles {
+namespace DeviceDescription {
+class WeaveDeviceDescriptor;
+} // namespace DeviceDescription
+namespace DataManagement_Current {
+class TraitDataSource;
+} // namespace DataManagement_Current
+} // namespace Profiles
+
+class WeaveFabricState
+{
+public:
+    uint64_t LocalNodeId;
+    const char * PairingCode;
+};
+
+namespace DeviceLayer {
+
+namespace DeviceEventType {
+
+enum
+{
+    kServiceTunnelStateChange = 0x0100,
+};
+
+} // namespace DeviceEventType
+
+enum ConnectivityChange
+{
+    kConnectivity_NoChange = 0,
+    kConnectivity_Established = 1,
+    kConnectivity_Lost = -1,
+};
+
+struct WeaveDeviceEvent
+{
+    uint16_t Type;
+    union
+    {
+        struct
+        {
+            ConnectivityChange Result;
+        } ServiceTunnelStateChange;
+    };
+};
+
+class PlatformManager
+{
+public:
+    typedef void (*EventHandlerFunct)(const WeaveDeviceEvent * event, intptr_t arg);
+
+    WEAVE_ERROR AddEventHandler(EventHandlerFunct handler, intptr_t arg = 0);
+    void LockWeaveStack(void);
+    void UnlockWeaveStack(void);
+};
+
+class TraitManager
+{
+public:
+    WEAVE_ERROR PublishTrait(const uint64_t & instanceId, Profiles::DataManagement_Current::TraitDataSource * dataSource);
+};
+
+class ConfigurationManager
+{
+public:
+    WEAVE_ERROR GetDeviceDescriptor(Profiles::DeviceDescription::WeaveDeviceDescriptor & deviceDesc);
+};
+
+PlatformManager & PlatformMgr(void);
+TraitManager & TraitMgr(void);
+ConfigurationManager & ConfigurationMgr(void);
+
+extern WeaveFabricState FabricState;
+extern WeaveExchangeManager ExchangeMgr;
+extern System::Layer SystemLayer;
+
+} // namespace DeviceLayer
+} // namespace Weave
+} // namespace nl
+
+#endif // HOST_WEAVE_DEVICE_LAYER_H
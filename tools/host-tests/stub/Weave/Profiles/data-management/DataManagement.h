@@ -0,0 +1,211 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host stand-in for the parts of the OpenWeave Data Management profile used by the code
+ *      under test, implemented by HostWeave.cpp: the trait schema engine; trait data sources,
+ *      which write their data by walking the schema and calling GetLeafData() for each leaf, as
+ *      OpenWeave does; custom commands; and the subscription and notification engines, which
+ *      notify simulated subscribers (see HostWeave.h) of the properties marked dirty.
+ */
+
+#ifndef HOST_DATA_MANAGEMENT_H
+#define HOST_DATA_MANAGEMENT_H
+
+#include <Weave/Core/WeaveCore.h>
+#include <Weave/Core/WeaveTLV.h>
+
+#define TDM_EXTENSION_SUPPORT 0
+#define TDM_VERSIONING_SUPPORT 0
+
+// Size of the subscription handler pool, as configured for the OpenWeave build.
+#ifndef WDM_PUBLISHER_MAX_NUM_SUBSCRIPTION_HANDLERS
+#define WDM_PUBLISHER_MAX_NUM_SUBSCRIPTION_HANDLERS 64
+#endif
+
+namespace nl {
+namespace Weave {
+namespace Profiles {
+namespace DataManagement_Current {
+
+typedef uint16_t PropertyPathHandle;
+
+enum
+{
+    kNullPropertyPathHandle = 0,
+    kRootPropertyPathHandle = 1,
+};
+
+enum
+{
+    kMsgType_OneWayCommand = 0x2A,
+};
+
+enum
+{
+    kStatus_RequestExpiredInTime = 0x0051,
+    kStatus_VersionMismatch = 0x0052,
+};
+
+namespace Path {
+
+enum
+{
+    kCsTag_InstanceLocator = 1,     // In the path
+    kCsTag_TraitProfileID = 1,      // In the instance locator
+    kCsTag_TraitInstanceID = 2,     // In the instance locator
+};
+
+} // namespace Path
+
+namespace DataElement {
+
+enum
+{
+    kCsTag_Path = 1,
+    kCsTag_Version = 2,
+    kCsTag_Data = 4,
+};
+
+} // namespace DataElement
+
+namespace CustomCommand {
+
+enum
+{
+    kCsTag_Path = 1,
+    kCsTag_CommandType = 2,
+    kCsTag_ExpiryTime = 3,
+    kCsTag_MustBeVersion = 4,
+    kCsTag_Argument = 5,
+};
+
+} // namespace CustomCommand
+
+namespace NotificationRequest {
+
+enum
+{
+    kCsTag_SubscriptionId = 1,
+    kCsTag_DataList = 2,
+};
+
+} // namespace NotificationRequest
+
+class Command
+{
+public:
+    WEAVE_ERROR SendResponse(uint32_t traitInstanceVersion, PacketBuffer * apPayload);
+    WEAVE_ERROR SendError(uint32_t aProfileId, uint16_t aStatusCode, WEAVE_ERROR aWeaveError);
+    void Close(void);
+};
+
+class TraitSchemaEngine
+{
+public:
+    struct PropertyInfo
+    {
+        PropertyPathHandle mParentHandle;
+        uint8_t mContextTag;
+    };
+
+    struct Schema
+    {
+        uint32_t mProfileId;
+        const PropertyInfo * mSchemaHandleTbl;
+        uint32_t mNumSchemaHandleEntries;
+        uint32_t mTreeDepth;
+        uint8_t * mIsDictionaryBitfield;
+        uint8_t * mIsOptionalBitfield;
+        uint8_t * mIsImplicitBitfield;
+        uint8_t * mIsNullableBitfield;
+        uint8_t * mIsEphemeralBitfield;
+    };
+
+    PropertyPathHandle GetParent(PropertyPathHandle aHandle) const;
+    uint64_t GetTag(PropertyPathHandle aHandle) const;
+    PropertyPathHandle GetChildHandle(PropertyPathHandle aParentHandle, uint8_t aContextTag) const;
+    PropertyPathHandle GetFirstChild(PropertyPathHandle aParentHandle) const;
+    PropertyPathHandle GetNextChild(PropertyPathHandle aParentHandle, PropertyPathHandle aChildHandle) const;
+    bool IsLeaf(PropertyPathHandle aHandle) const;
+    bool IsNullable(PropertyPathHandle aHandle) const;
+
+    const Schema mSchema;
+};
+
+class TraitDataSource
+{
+public:
+    TraitDataSource(const TraitSchemaEngine * aEngine);
+    virtual ~TraitDataSource(void) { }
+
+    const TraitSchemaEngine * GetSchemaEngine(void) const { return mSchemaEngine; }
+    uint64_t GetVersion(void) const { return mVersion; }
+
+    WEAVE_ERROR ReadData(PropertyPathHandle aHandle, uint64_t aTagToWrite, TLV::TLVWriter & aWriter);
+
+    WEAVE_ERROR Lock(void);
+    WEAVE_ERROR Unlock(void);
+    void SetDirty(PropertyPathHandle aPropertyHandle);
+
+    virtual void OnCustomCommand(Command * aCommand, const WeaveMessageInfo * aMsgInfo, PacketBuffer * aPayload,
+            const uint64_t & aCommandType, const bool aIsExpiryTimeValid, const int64_t & aExpiryTimeMicroSecond,
+            const bool aIsMustBeVersionValid, const uint64_t & aMustBeVersion, TLV::TLVReader & aArgumentReader);
+
+protected:
+    virtual WEAVE_ERROR GetLeafData(PropertyPathHandle aLeafHandle, uint64_t aTagToWrite, TLV::TLVWriter & aWriter) = 0;
+
+private:
+    const TraitSchemaEngine * mSchemaEngine;
+    uint64_t mVersion;
+    bool mSetDirtyCalled;
+};
+
+class NotificationEngine
+{
+public:
+    void Run(void);
+};
+
+class SubscriptionEngine
+{
+public:
+    enum
+    {
+        kMaxNumSubscriptionHandlers = WDM_PUBLISHER_MAX_NUM_SUBSCRIPTION_HANDLERS,
+    };
+
+    static SubscriptionEngine * GetInstance(void);
+
+    uint16_t GetNumUnusedHandlers(void) const;
+    NotificationEngine * GetNotificationEngine(void);
+
+private:
+    NotificationEngine mNotificationEngine;
+};
+
+} // namespace DataManagement_Current
+
+namespace DataManagement = DataManagement_Current;
+
+} // namespace Profiles
+} // namespace Weave
+} // namespace nl
+
+#endif // HOST_DATA_MANAGEMENT_H
@@ -0,0 +1,52 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host stand-in for the OpenWeave device descriptor, implemented by the tests that use it.
+ */
+
+#ifndef HOST_DEVICE_DESCRIPTION_H
+#define HOST_DEVICE_DESCRIPTION_H
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+
+namespace nl {
+namespace Weave {
+namespace Profiles {
+namespace DeviceDescription {
+
+class WeaveDeviceDescriptor
+{
+public:
+    enum
+    {
+        kMaxPairingCodeLength = 16,
+    };
+
+    char PairingCode[kMaxPairingCodeLength + 1];
+
+    static WEAVE_ERROR EncodeText(const WeaveDeviceDescriptor & desc, char * buf, uint32_t bufLen, uint32_t & outEncodedLength);
+};
+
+} // namespace DeviceDescription
+} // namespace Profiles
+} // namespace Weave
+} // namespace nl
+
+#endif // HOST_DEVICE_DESCRIPTION_H
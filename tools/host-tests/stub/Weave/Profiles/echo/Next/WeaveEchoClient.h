@@ -0,0 +1,107 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host stand-in for the OpenWeave Echo client, implemented by HostWeave.cpp.  Requests are
+ *      answered by a simulated echo server at the far end of a path whose round-trip time,
+ *      fragmentation and loss are set by HostWeave::SetEchoPath().
+ */
+
+#ifndef HOST_WEAVE_ECHO_CLIENT_H
+#define HOST_WEAVE_ECHO_CLIENT_H
+
+#include <Weave/Core/WeaveCore.h>
+#include "esp_timer.h"
+
+namespace nl {
+namespace Weave {
+namespace Profiles {
+namespace Echo_Next {
+
+class WeaveEchoClient
+{
+public:
+    enum EventType
+    {
+        kEvent_PreparePayload = 1,
+        kEvent_ResponseReceived = 2,
+        kEvent_CommunicationError = 3,
+        kEvent_ResponseTimeout = 4,
+        kEvent_RequestSent = 5,
+        kEvent_DefaultCheck = 100,
+    };
+
+    struct InEventParam
+    {
+        WeaveEchoClient * Source;
+        union
+        {
+            struct
+            {
+                PacketBuffer * Payload;
+            } ResponseReceived;
+            struct
+            {
+                WEAVE_ERROR Reason;
+            } CommunicationError;
+        };
+    };
+
+    struct OutEventParam
+    {
+        bool DefaultHandlerCalled;
+        union
+        {
+            struct
+            {
+                PacketBuffer * Payload;
+                WEAVE_ERROR PrepareError;
+            } PreparePayload;
+        };
+    };
+
+    typedef void (*EventCallback)(void * appState, EventType eventType, const InEventParam & inParam, OutEventParam & outParam);
+
+    WeaveEchoClient(void);
+
+    WEAVE_ERROR Init(Binding * binding, EventCallback eventCallback, void * appState = NULL);
+    WEAVE_ERROR SendEchoRequest(void);
+    WEAVE_ERROR SendEchoRequest(PacketBuffer * payloadBuf);
+    void Stop(void);
+
+    static void DefaultEventHandler(void * appState, EventType eventType, const InEventParam & inParam, OutEventParam & outParam);
+
+    void * AppState;
+
+private:
+    Binding * mBinding;
+    EventCallback mEventCallback;
+    esp_timer_handle_t mTimer;
+    uint16_t mRequestLen;
+    bool mRequestLost;
+
+    static void HandleTimer(void * arg);
+};
+
+} // namespace Echo_Next
+} // namespace Profiles
+} // namespace Weave
+} // namespace nl
+
+#endif // HOST_WEAVE_ECHO_CLIENT_H
@@ -0,0 +1,47 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host stand-in for the ESP-IDF esp_heap_trace.h, in standalone mode, implemented by
+ *      HostBenchmark.cpp.  Only C++ allocations (operator new) are traced.
+ */
+
+#ifndef HOST_ESP_HEAP_TRACE_H
+#define HOST_ESP_HEAP_TRACE_H
+
+#include "esp_system.h"
+
+typedef enum
+{
+    HEAP_TRACE_ALL,
+    HEAP_TRACE_LEAKS,
+} heap_trace_mode_t;
+
+typedef struct
+{
+    void * address;
+    size_t size;
+} heap_trace_record_t;
+
+esp_err_t heap_trace_init_standalone(heap_trace_record_t * record_buffer, size_t num_records);
+esp_err_t heap_trace_start(heap_trace_mode_t mode);
+esp_err_t heap_trace_stop(void);
+size_t heap_trace_get_count(void);
+
+#endif // HOST_ESP_HEAP_TRACE_H
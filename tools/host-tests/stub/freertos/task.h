@@ -0,0 +1,44 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host stand-in for the FreeRTOS task API, implemented by HostSim.cpp.
+ *
+ *      Tasks run as coroutines on the single host thread.  A task runs only while the
+ *      test's own (main) task is blocked in ulTaskNotifyTake(), or within HostSim::RunTasks(),
+ *      and runs until it blocks in ulTaskNotifyTake() itself.
+ */
+
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+#define tskIDLE_PRIORITY        ((UBaseType_t)0)
+
+typedef void (*TaskFunction_t)(void * arg);
+typedef struct HostTask * TaskHandle_t;
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char * name, uint32_t stackDepth, void * arg,
+                       UBaseType_t priority, TaskHandle_t * createdTask);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+
+#endif // HOST_FREERTOS_TASK_H
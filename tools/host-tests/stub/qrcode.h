@@ -0,0 +1,56 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host stand-in for the QRCode library, implemented by the tests that use it.
+ */
+
+#ifndef HOST_QRCODE_H
+#define HOST_QRCODE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ECC_LOW                 0
+#define ECC_MEDIUM              1
+#define ECC_QUARTILE            2
+#define ECC_HIGH                3
+
+typedef struct QRCode
+{
+    uint8_t version;
+    uint8_t size;
+    uint8_t ecc;
+    uint8_t mode;
+    uint8_t mask;
+    uint8_t * modules;
+} QRCode;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int8_t qrcode_initText(QRCode * qrcode, uint8_t * modules, uint8_t version, uint8_t ecc, const char * data);
+bool qrcode_getModule(QRCode * qrcode, uint8_t x, uint8_t y);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // HOST_QRCODE_H
@@ -0,0 +1,33 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host stand-in for the ESP32 soc/soc.h, implemented by HostSim.cpp.
+ */
+
+#ifndef HOST_SOC_H
+#define HOST_SOC_H
+
+#include <stdint.h>
+
+uint32_t HostReadReg(uint32_t reg);
+
+#define REG_READ(reg) HostReadReg(reg)
+
+#endif // HOST_SOC_H
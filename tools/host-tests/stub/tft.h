@@ -0,0 +1,71 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host stand-in for the drawing interface of the TFT display library (tft.h),
+ *      implemented by HostDisplay.cpp.
+ */
+
+#ifndef HOST_TFT_H
+#define HOST_TFT_H
+
+#include "tftspi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    uint8_t * font;
+    uint8_t x_size;
+    uint8_t y_size;
+    uint8_t offset;
+    uint16_t numchars;
+    uint16_t size;
+    uint8_t max_x_size;
+    uint8_t bitmap;
+    color_t color;
+} Font;
+
+#define DEJAVU24_FONT           2
+
+#define PORTRAIT                0
+#define LANDSCAPE               1
+
+extern Font cfont;
+extern dispWin_t dispWin;
+
+extern const color_t TFT_BLACK;
+extern const color_t TFT_WHITE;
+extern const color_t TFT_BLUE;
+extern const color_t TFT_DARKGREY;
+
+void TFT_setFont(uint8_t font, const char * font_file);
+int TFT_getStringWidth(char * str);
+int TFT_getfontheight(void);
+void TFT_setGammaCurve(uint8_t gm);
+void TFT_setRotation(uint8_t rot);
+void TFT_resetclipwin(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // HOST_TFT_H
@@ -0,0 +1,112 @@
+/*
+ *
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+ *    Description:
+ *      Host stand-in for the SPI interface of the TFT display library (tftspi.h),
+ *      implemented by HostDisplay.cpp.
+ */
+
+#ifndef HOST_TFTSPI_H
+#define HOST_TFTSPI_H
+
+#include "esp_system.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+} color_t;
+
+typedef struct
+{
+    uint16_t x1;
+    uint16_t y1;
+    uint16_t x2;
+    uint16_t y2;
+} dispWin_t;
+
+typedef struct
+{
+    int mosi_io_num;
+    int miso_io_num;
+    int sclk_io_num;
+    int quadwp_io_num;
+    int quadhd_io_num;
+    int max_transfer_sz;
+} spi_lobo_bus_config_t;
+
+typedef struct
+{
+    uint8_t command_bits;
+    uint8_t address_bits;
+    uint8_t dummy_bits;
+    uint8_t mode;
+    uint8_t duty_cycle_pos;
+    uint8_t cs_ena_pretrans;
+    uint8_t cs_ena_posttrans;
+    int clock_speed_hz;
+    int spics_io_num;
+    int spics_ext_io_num;
+    uint32_t flags;
+} spi_lobo_device_interface_config_t;
+
+typedef struct spi_lobo_device_t * spi_lobo_device_handle_t;
+
+#define LB_SPI_DEVICE_HALFDUPLEX    (1 << 4)
+
+#define TFT_HSPI_HOST               1
+#define PIN_NUM_MISO                19
+#define PIN_NUM_MOSI                23
+#define PIN_NUM_CLK                 18
+#define PIN_NUM_CS                  14
+
+#define DISP_TYPE_ILI9341           0
+#define DEFAULT_SPI_CLOCK           26000000
+
+extern spi_lobo_device_handle_t disp_spi;
+extern uint8_t tft_disp_type;
+extern int _width;
+extern int _height;
+extern uint32_t max_rdclock;
+
+esp_err_t spi_lobo_bus_add_device(int host, spi_lobo_bus_config_t * bus_config,
+                                  spi_lobo_device_interface_config_t * dev_config, spi_lobo_device_handle_t * handle);
+esp_err_t spi_lobo_device_select(spi_lobo_device_handle_t handle, int force);
+esp_err_t spi_lobo_device_deselect(spi_lobo_device_handle_t handle);
+uint32_t spi_lobo_set_speed(spi_lobo_device_handle_t handle, uint32_t speed);
+uint32_t spi_lobo_get_speed(spi_lobo_device_handle_t handle);
+
+esp_err_t disp_select(void);
+esp_err_t disp_deselect(void);
+void send_data(int x1, int y1, int x2, int y2, uint32_t len, color_t * buf);
+esp_err_t read_data(int x1, int y1, int x2, int y2, int len, uint8_t * buf, uint8_t set_sp);
+uint32_t find_rd_speed(void);
+void TFT_PinsInit(void);
+void TFT_display_init(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // HOST_TFTSPI_H
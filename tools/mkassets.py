@@ -0,0 +1,170 @@
+#!/usr/bin/env python
+#
+#    Copyright (c) 2018 Nest Labs, Inc.
+#    All rights reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License");
+#    you may not use this file except in compliance with the License.
+#    You may obtain a copy of the License at
+#
+#        http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS,
+#    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#    See the License for the specific language governing permissions and
+#    limitations under the License.
+#
+#    Description:
+#      Converts 24-bit BMP images into a display asset image suitable for
+#      flashing into the 'assets' partition of the OpenWeave ESP32 demo
+#      application.
+#
+#      Pixels are stored in the native format of the display panel (one byte
+#      each of red, green and blue, rows top to bottom), so that they can be
+#      copied to the display without conversion.  Images may optionally be
+#      run-length encoded.  The image layout must match that expected by
+#      main/Assets.cpp.
+#
+
+from __future__ import print_function
+
+import argparse
+import os
+import struct
+import sys
+
+ASSET_IMAGE_MAGIC = 0x4144574f     # 'OWDA'
+ASSET_IMAGE_VERSION = 1
+ASSET_NAME_LEN = 16
+
+ASSET_FORMAT_RAW = 0
+ASSET_FORMAT_RLE = 1
+
+HEADER_FORMAT = '<IHH'
+ENTRY_FORMAT = '<%dsHHB3xII' % ASSET_NAME_LEN
+
+MAX_RLE_COUNT = 128
+
+
+def pad4(data):
+    return data + b'\0' * (-len(data) % 4)
+
+
+def read_bmp(fileName):
+    '''Read a 24-bit uncompressed BMP file, returning its width, height and a
+    list of rows, top to bottom, each containing the row's RGB pixel data.'''
+    with open(fileName, 'rb') as f:
+        data = f.read()
+    if data[0:2] != b'BM':
+        raise ValueError('%s: not a BMP file' % fileName)
+    dataOffset, = struct.unpack_from('<I', data, 10)
+    width, height, planes, bitsPerPixel, compression = struct.unpack_from('<iiHHI', data, 18)
+    if bitsPerPixel != 24 or compression != 0:
+        raise ValueError('%s: only uncompressed 24-bit BMP files are supported' % fileName)
+    bottomUp = height > 0
+    height = abs(height)
+    rowSize = (width * 3 + 3) & ~3
+    rows = []
+    for y in range(height):
+        srcRow = (height - 1 - y) if bottomUp else y
+        start = dataOffset + srcRow * rowSize
+        bgr = bytearray(data[start : start + width * 3])
+        rgb = bytearray(len(bgr))
+        rgb[0::3] = bgr[2::3]
+        rgb[1::3] = bgr[1::3]
+        rgb[2::3] = bgr[0::3]
+        rows.append(bytes(rgb))
+    return width, height, rows
+
+
+def rle_encode_row(row):
+    '''Run-length encode a single row of pixels.  Each packet begins with a control
+    byte: if the high bit is set, the low 7 bits give (count - 1) and a single pixel
+    follows, which is repeated count times; otherwise the low 7 bits give (count - 1)
+    and count literal pixels follow.'''
+    pixels = [row[i : i + 3] for i in range(0, len(row), 3)]
+    out = bytearray()
+    literals = []
+
+    def flush_literals():
+        while literals:
+            chunk = literals[:MAX_RLE_COUNT]
+            del literals[:MAX_RLE_COUNT]
+            out.append(len(chunk) - 1)
+            for p in chunk:
+                out.extend(p)
+
+    i = 0
+    while i < len(pixels):
+        runLen = 1
+        while i + runLen < len(pixels) and runLen < MAX_RLE_COUNT and pixels[i + runLen] == pixels[i]:
+            runLen += 1
+        if runLen >= 2:
+            flush_literals()
+            out.append(0x80 | (runLen - 1))
+            out.extend(pixels[i])
+        else:
+            literals.append(pixels[i])
+        i += runLen
+    flush_literals()
+    return bytes(out)
+
+
+def encode_asset(width, height, rows, useRLE):
+    '''Encode an image, returning its format and data.  RLE data begins with a table
+    of 32-bit row offsets, relative to the start of the asset data, so that a clipped
+    region of the image can be decoded without decoding the rows above it.'''
+    raw = b''.join(rows)
+    if not useRLE:
+        return ASSET_FORMAT_RAW, raw
+    encodedRows = [rle_encode_row(row) for row in rows]
+    offset = 4 * height
+    offsets = []
+    for row in encodedRows:
+        offsets.append(offset)
+        offset += len(row)
+    rle = struct.pack('<%dI' % height, *offsets) + b''.join(encodedRows)
+    if len(rle) >= len(raw):
+        return ASSET_FORMAT_RAW, raw
+    return ASSET_FORMAT_RLE, rle
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Build a display asset image from BMP files.')
+    parser.add_argument('-o', '--output', required=True, help='Output asset image file')
+    parser.add_argument('--rle', action='store_true', help='Run-length encode images where this reduces their size')
+    parser.add_argument('--max-size', type=lambda s: int(s, 0), default=0, help='Fail if the image exceeds this size (the partition size)')
+    parser.add_argument('images', nargs='+', help='24-bit BMP files; each asset is named after its file name without extension')
+    args = parser.parse_args()
+
+    entries = []
+    for fileName in args.images:
+        name = os.path.splitext(os.path.basename(fileName))[0]
+        if len(name) >= ASSET_NAME_LEN:
+            parser.error('%s: asset name must be less than %d characters' % (name, ASSET_NAME_LEN))
+        width, height, rows = read_bmp(fileName)
+        fmt, data = encode_asset(width, height, rows, args.rle)
+        entries.append((name, width, height, fmt, data))
+        print('%-16s %3dx%-3d %s %6d bytes' % (name, width, height, 'RLE' if fmt == ASSET_FORMAT_RLE else 'RAW', len(data)))
+
+    offset = struct.calcsize(HEADER_FORMAT) + len(entries) * struct.calcsize(ENTRY_FORMAT)
+    image = struct.pack(HEADER_FORMAT, ASSET_IMAGE_MAGIC, ASSET_IMAGE_VERSION, len(entries))
+    body = b''
+    for name, width, height, fmt, data in entries:
+        image += struct.pack(ENTRY_FORMAT, name.encode('ascii'), width, height, fmt, offset + len(body), len(data))
+        body += pad4(data)
+    image += body
+
+    if args.max_size and len(image) > args.max_size:
+        print('Asset image size (%d bytes) exceeds maximum (%d bytes)' % (len(image), args.max_size), file=sys.stderr)
+        return 1
+
+    with open(args.output, 'wb') as f:
+        f.write(image)
+    print('Wrote %s (%d bytes)' % (args.output, len(image)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,367 @@
+#!/usr/bin/env python
+#
+#    Copyright (c) 2018 Nest Labs, Inc.
+#    All rights reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License");
+#    you may not use this file except in compliance with the License.
+#    You may obtain a copy of the License at
+#
+#        http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS,
+#    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#    See the License for the specific language governing permissions and
+#    limitations under the License.
+#
+#    Description:
+#      Generates a compressed binary delta between two firmware images of the
+#      OpenWeave ESP32 demo application, suitable for applying on the device
+#      with a delta OTA update, and optionally pushes it to a device.
+#
+#      A delta consists of a fixed header followed by a raw deflate stream of
+#      records.  The header ends with an HMAC-SHA256 of its other fields, keyed
+#      with the key configured on the device (DELTA_OTA_KEY); since it includes
+#      the SHA-256 of the new image, this authenticates the whole delta.  Each
+#      record contains:
+#
+#        - a control block giving a diff length, an extra length and an old
+#          image seek adjustment (little-endian u32, u32, s32);
+#        - diff length bytes, each added (mod 256) to the byte at the current
+#          position in the old image to produce the next byte of the new image;
+#        - extra length bytes, copied to the new image as-is.
+#
+#      After each record, the old image position is advanced by the diff
+#      length plus the seek adjustment.  Code that moves between images
+#      differs mostly in the addresses it contains, so the diff bytes are
+#      largely zero and compress well.  The format must match that expected
+#      by main/DeltaPatch.cpp and main/DeltaOTA.cpp.
+#
+
+from __future__ import print_function
+
+import argparse
+import binascii
+import hashlib
+import hmac
+import os
+import socket
+import struct
+import sys
+import time
+import zlib
+
+PATCH_MAGIC = 0x5044574f           # 'OWDP'
+PATCH_VERSION = 2
+
+HEADER_FORMAT = '<IBBHII32s32s'     # Header fields covered by the HMAC
+HMAC_LEN = 32
+KEY_LEN = 32
+CONTROL_FORMAT = '<IIi'
+
+DEFAULT_WINDOW_BITS = 12
+DEFAULT_PUSH_PORT = 3232
+
+SEED_LEN = 16                       # Length of the exact matches used to align the images
+INDEX_STEP = 4                      # Spacing of the old image positions that are indexed
+MIN_MATCH_LEN = 24                  # Shortest exact match worth a record of its own
+
+
+def match_len(a, ai, b, bi, limit):
+    '''Return the length of the common prefix of a[ai:] and b[bi:], up to limit bytes.'''
+    n = 0
+    step = 256
+    while n < limit:
+        step = min(step, limit - n)
+        if a[ai + n : ai + n + step] == b[bi + n : bi + n + step]:
+            n += step
+        elif step > 1:
+            step //= 2
+        else:
+            break
+    return n
+
+
+def match_len_back(a, ai, b, bi, limit):
+    '''Return the length of the common suffix of a[:ai] and b[:bi], up to limit bytes.'''
+    n = 0
+    while n < limit and a[ai - n - 1] == b[bi - n - 1]:
+        n += 1
+    return n
+
+
+def find_matches(old, new):
+    '''Find exact matches between the new and old images, returning a list of (newStart, newEnd,
+    align) tuples, in order of position in the new image, where align is the offset from a
+    position in the new image to the matching position in the old image.'''
+    index = {}
+    for i in range(0, len(old) - SEED_LEN + 1, INDEX_STEP):
+        index.setdefault(old[i : i + SEED_LEN], i)
+
+    matches = []
+    prevEnd = 0
+    prevAlign = None
+    pos = 0
+    while pos + SEED_LEN <= len(new):
+        seed = new[pos : pos + SEED_LEN]
+        oldPos = None
+
+        # Prefer continuing the alignment of the previous match, which is typical after a
+        # small change to the image.
+        if prevAlign is not None:
+            o = pos + prevAlign
+            if 0 <= o and o + SEED_LEN <= len(old) and old[o : o + SEED_LEN] == seed:
+                oldPos = o
+        if oldPos is None:
+            oldPos = index.get(seed)
+        if oldPos is None:
+            pos += 1
+            continue
+
+        back = match_len_back(new, pos, old, oldPos, min(pos - prevEnd, oldPos))
+        fwd = match_len(new, pos, old, oldPos, min(len(new) - pos, len(old) - oldPos))
+        if back + fwd < MIN_MATCH_LEN:
+            pos += 1
+            continue
+
+        matches.append((pos - back, pos + fwd, oldPos - pos))
+        prevEnd = pos + fwd
+        prevAlign = oldPos - pos
+        pos = prevEnd
+
+    return matches
+
+
+def approx_extend(old, new, start, stop, align, step):
+    '''Extend a match with the given alignment from start towards stop (exclusive) in the new
+    image, one byte at a time in the direction of step, returning the scores of each extension
+    length, where the score is the number of matching bytes less the number of mismatches.'''
+    scores = [0]
+    score = 0
+    pos = start
+    while pos != stop:
+        o = pos + align
+        if o < 0 or o >= len(old):
+            break
+        score += 1 if old[o] == new[pos] else -1
+        scores.append(score)
+        pos += step
+    return scores
+
+
+def best_extension(scores, limit):
+    '''Return the extension length, no more than limit, with the highest score.'''
+    best = 0
+    for k in range(1, min(limit, len(scores) - 1) + 1):
+        if scores[k] > scores[best]:
+            best = k
+    return best
+
+
+def build_blocks(old, new, matches):
+    '''Widen each exact match into the gaps on either side of it, for as long as the bytes at
+    the same alignment mostly match, returning a list of (newStart, newEnd, align) diff blocks.
+    Whatever is left of each gap becomes extra (literal) data.'''
+    blocks = []
+    for start, end, align in matches:
+        gapStart = blocks[-1][1] if blocks else 0
+        back = approx_extend(old, new, start - 1, gapStart - 1, align, -1)
+
+        if not blocks:
+            b = best_extension(back, start)
+        else:
+            # Split the gap between the previous block, extending forwards, and this one,
+            # extending backwards, at the point that maximizes their combined score.
+            prevStart, prevEnd, prevAlign = blocks[-1]
+            fwd = approx_extend(old, new, prevEnd, start, prevAlign, 1)
+            gap = start - prevEnd
+            bestBack = [0]
+            for k in range(1, len(back)):
+                bestBack.append(k if back[k] > back[bestBack[-1]] else bestBack[-1])
+            f, b = 0, 0
+            for fk in range(len(fwd)):
+                bk = bestBack[min(gap - fk, len(back) - 1)]
+                if fwd[fk] + back[bk] > fwd[f] + back[b]:
+                    f, b = fk, bk
+            blocks[-1] = (prevStart, prevEnd + f, prevAlign)
+
+        blocks.append((start - b, end, align))
+
+    # Extend the last block forwards to the end of the image.
+    if blocks:
+        start, end, align = blocks[-1]
+        fwd = approx_extend(old, new, end, len(new), align, 1)
+        blocks[-1] = (start, end + best_extension(fwd, len(new) - end), align)
+
+    return blocks
+
+
+def encode_records(old, new, blocks):
+    '''Encode the diff blocks as a sequence of records.'''
+    out = bytearray()
+    oldPos = 0
+
+    # Any data before the first block is sent as extra data in a leading record.
+    firstStart = blocks[0][0] if blocks else len(new)
+    if not blocks or firstStart > 0 or blocks[0][0] + blocks[0][2] != 0:
+        seek = (blocks[0][0] + blocks[0][2]) if blocks else 0
+        out += struct.pack(CONTROL_FORMAT, 0, firstStart, seek)
+        out += new[0:firstStart]
+        oldPos += seek
+
+    for i, (start, end, align) in enumerate(blocks):
+        extraEnd = blocks[i + 1][0] if i + 1 < len(blocks) else len(new)
+        nextOldPos = (blocks[i + 1][0] + blocks[i + 1][2]) if i + 1 < len(blocks) else oldPos + (end - start)
+        assert oldPos == start + align
+        out += struct.pack(CONTROL_FORMAT, end - start, extraEnd - end, nextOldPos - (oldPos + end - start))
+        out += bytes(bytearray((n - o) & 0xFF for n, o in zip(bytearray(new[start:end]), bytearray(old[oldPos : oldPos + end - start]))))
+        out += new[end:extraEnd]
+        oldPos = nextOldPos
+
+    return bytes(out)
+
+
+def header_hmac(key, fields):
+    '''Return the HMAC of the header fields, or zeros for an unsigned delta.'''
+    if key is None:
+        return b'\0' * HMAC_LEN
+    return hmac.new(key, fields, hashlib.sha256).digest()
+
+
+def make_delta(old, new, windowBits, key):
+    '''Generate a delta that transforms the old image into the new image, signed with the given
+    key.'''
+    blocks = build_blocks(old, new, find_matches(old, new))
+    records = encode_records(old, new, blocks)
+    compressor = zlib.compressobj(9, zlib.DEFLATED, -windowBits, 9)
+    body = compressor.compress(records) + compressor.flush()
+    fields = struct.pack(HEADER_FORMAT, PATCH_MAGIC, PATCH_VERSION, windowBits, 0, len(old), len(new),
+                         hashlib.sha256(old).digest(), hashlib.sha256(new).digest())
+    return fields + header_hmac(key, fields) + body, len(blocks)
+
+
+def apply_delta(old, delta, key):
+    '''Apply a delta to the old image, returning the new image.  This is a reference
+    implementation of the algorithm in main/DeltaPatch.cpp.'''
+    fieldsLen = struct.calcsize(HEADER_FORMAT)
+    headerLen = fieldsLen + HMAC_LEN
+    magic, version, windowBits, _, oldSize, newSize, oldHash, newHash = struct.unpack_from(HEADER_FORMAT, delta)
+    if magic != PATCH_MAGIC or version != PATCH_VERSION:
+        raise ValueError('not a delta image')
+    if key is not None and not hmac.compare_digest(delta[fieldsLen : headerLen], header_hmac(key, delta[:fieldsLen])):
+        raise ValueError('delta is not signed with this key')
+    if oldSize != len(old) or hashlib.sha256(old).digest() != oldHash:
+        raise ValueError('delta does not apply to this image')
+    records = zlib.decompressobj(-windowBits).decompress(delta[headerLen:])
+
+    new = bytearray()
+    oldPos = 0
+    pos = 0
+    controlLen = struct.calcsize(CONTROL_FORMAT)
+    while len(new) < newSize:
+        diffLen, extraLen, seek = struct.unpack_from(CONTROL_FORMAT, records, pos)
+        pos += controlLen
+        if oldPos < 0 or oldPos + diffLen > oldSize or len(new) + diffLen + extraLen > newSize:
+            raise ValueError('invalid delta record')
+        new += bytearray((d + o) & 0xFF for d, o in zip(bytearray(records[pos : pos + diffLen]), bytearray(old[oldPos : oldPos + diffLen])))
+        pos += diffLen
+        new += records[pos : pos + extraLen]
+        pos += extraLen
+        oldPos += diffLen + seek
+    if pos != len(records) or hashlib.sha256(bytes(new)).digest() != newHash:
+        raise ValueError('delta produced an incorrect image')
+    return bytes(new)
+
+
+def push_delta(delta, target):
+    '''Send a delta to a device's delta OTA port, returning the device's response.'''
+    host, _, port = target.partition(':')
+    sock = socket.create_connection((host, int(port) if port else DEFAULT_PUSH_PORT))
+    try:
+        sock.sendall(delta)
+        sock.shutdown(socket.SHUT_WR)
+        response = b''
+        while True:
+            data = sock.recv(256)
+            if not data:
+                break
+            response += data
+    finally:
+        sock.close()
+    return response.decode('ascii', 'replace').strip()
+
+
+def parse_key(keyHex):
+    '''Parse a delta OTA key given as hex digits.'''
+    try:
+        key = binascii.unhexlify(keyHex.strip())
+    except (TypeError, ValueError):
+        key = b''
+    if len(key) != KEY_LEN:
+        raise argparse.ArgumentTypeError('key must be %d hex digits' % (2 * KEY_LEN))
+    return key
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate a delta OTA update between two firmware images.')
+    parser.add_argument('-o', '--output', help='Output delta file')
+    parser.add_argument('--window-bits', type=int, default=DEFAULT_WINDOW_BITS, choices=range(9, 16),
+                        help='Deflate window size (log2); the device needs a buffer of this size (default %d)' % DEFAULT_WINDOW_BITS)
+    parser.add_argument('--key', type=parse_key, default=os.environ.get('DELTA_OTA_KEY'),
+                        help='Key with which to sign the delta, as %d hex digits, matching the device\'s '
+                             'DELTA_OTA_KEY setting (default $DELTA_OTA_KEY)' % (2 * KEY_LEN))
+    parser.add_argument('--verify', action='store_true', help='Apply the delta to the old image and check the result')
+    parser.add_argument('--push', metavar='HOST[:PORT]', help='Send the delta to a device (default port %d)' % DEFAULT_PUSH_PORT)
+    parser.add_argument('old', help='Firmware image currently running on the device')
+    parser.add_argument('new', help='Firmware image to update to')
+    args = parser.parse_args()
+
+    if args.key is None:
+        if args.push:
+            parser.error('--push requires a key (--key or $DELTA_OTA_KEY)')
+        print('Warning: no key given; devices will reject the delta', file=sys.stderr)
+
+    with open(args.old, 'rb') as f:
+        old = f.read()
+    with open(args.new, 'rb') as f:
+        new = f.read()
+
+    startTime = time.time()
+    delta, blockCount = make_delta(old, new, args.window_bits, args.key)
+    diffTime = time.time() - startTime
+
+    fullCompressedLen = len(zlib.compress(new, 9))
+    print('Old image:  %8d bytes' % len(old))
+    print('New image:  %8d bytes (%d bytes compressed)' % (len(new), fullCompressedLen))
+    print('Delta:      %8d bytes (%.1f%% of new image, %.1f%% of compressed new image), %d blocks, generated in %.1f s' %
+          (len(delta), 100.0 * len(delta) / max(len(new), 1), 100.0 * len(delta) / max(fullCompressedLen, 1), blockCount, diffTime))
+
+    if args.verify:
+        startTime = time.time()
+        try:
+            result = apply_delta(old, delta, args.key)
+        except ValueError as ex:
+            print('Verification failed: %s' % ex, file=sys.stderr)
+            return 1
+        if result != new:
+            print('Verification failed: delta produced an incorrect image', file=sys.stderr)
+            return 1
+        print('Verified:   delta applied in %.2f s' % (time.time() - startTime))
+
+    if args.output:
+        with open(args.output, 'wb') as f:
+            f.write(delta)
+        print('Wrote %s' % args.output)
+
+    if args.push:
+        response = push_delta(delta, args.push)
+        print('Device response: %s' % response)
+        if not response.startswith('OK'):
+            return 1
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,349 @@
+#!/usr/bin/env python
+#
+#    Copyright (c) 2018 Nest Labs, Inc.
+#    All rights reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License");
+#    you may not use this file except in compliance with the License.
+#    You may obtain a copy of the License at
+#
+#        http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS,
+#    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#    See the License for the specific language governing permissions and
+#    limitations under the License.
+#
+#    Description:
+#      Generates the WDM trait schema headers and support files used by the
+#      OpenWeave ESP32 demo application from the trait descriptions in
+#      main/trait-support/traits.json.
+#
+#      For each trait a header is written to main/include/<path>.h giving the
+#      profile id, property handles, enums and command ids, and (unless the
+#      trait is header-only) a support file is written to
+#      main/trait-support/<path>.cpp containing the TraitSchemaEngine tables.
+#
+#      For traits with properties, the header also declares a typed Data
+#      struct holding a value for each leaf, and a Serializer type that
+#      writes leaves of the struct to a TLVWriter (see TraitSerializer.h).
+#
+#      Only flat traits, whose properties are all leaves directly beneath the
+#      root, are supported.
+#
+#      With --verify, the files are generated in memory and compared against
+#      those in the tree, and any difference is reported as an error.
+#
+
+from __future__ import print_function
+
+import argparse
+import difflib
+import json
+import os
+import re
+import sys
+
+PROJECT_DIR = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+DEFAULT_SCHEMA = os.path.join(PROJECT_DIR, 'main', 'trait-support', 'traits.json')
+INCLUDE_DIR = os.path.join(PROJECT_DIR, 'main', 'include')
+SUPPORT_DIR = os.path.join(PROJECT_DIR, 'main', 'trait-support')
+
+FIRST_LEAF_HANDLE = 2
+
+# C type used in the typed Data struct for each TLV type, unless overridden by the property's cType.
+TLV_C_TYPES = {
+    'bool': 'bool',
+    'int': 'int32_t',
+    'int8': 'int8_t',
+    'int16': 'int16_t',
+    'int32': 'int32_t',
+    'int64': 'int64_t',
+    'uint8': 'uint8_t',
+    'uint16': 'uint16_t',
+    'uint32': 'uint32_t',
+    'uint64': 'uint64_t',
+}
+
+COPYRIGHT = '''/**
+ *    Copyright (c) 2018 Nest Labs, Inc.
+ *    All rights reserved.
+ *
+'''
+
+
+def camel_case(name):
+    return ''.join(part[0].upper() + part[1:] for part in name.split('_') if part)
+
+
+def upper_snake_case(name):
+    return re.sub(r'(?<=[a-z0-9])(?=[A-Z])', '_', name).upper()
+
+
+def trait_path(trait):
+    return '/'.join(part.lower() for part in trait['namespace']) + '/' + trait['name']
+
+
+def include_guard(trait):
+    return '_%s__%s_H_' % ('_'.join(upper_snake_case(part) for part in trait['namespace']),
+                           upper_snake_case(trait['name']))
+
+
+def banner(trait, template):
+    lines = ['\n' if 'proto' in trait else '', COPYRIGHT]
+    lines.append(' *    THIS FILE IS GENERATED BY tools/mktraits.py. DO NOT MODIFY.\n')
+    lines.append(' *\n')
+    if 'proto' in trait:
+        lines.append(' *    SOURCE TEMPLATE: %s\n' % template)
+        lines.append(' *    SOURCE PROTO: %s\n' % trait['proto'])
+    else:
+        for line in trait['description']:
+            lines.append(' *    %s\n' % line)
+    lines.append(' *\n')
+    lines.append(' */\n')
+    return ''.join(lines)
+
+
+def open_namespaces(trait):
+    return ''.join('namespace %s {\n' % ns for ns in ['Schema'] + trait['namespace'] + [trait['name']])
+
+
+def close_namespaces(trait):
+    return ''.join('} // namespace %s\n' % ns for ns in reversed(['Schema'] + trait['namespace'] + [trait['name']]))
+
+
+def leaf_name(prop):
+    return camel_case(prop['name'])
+
+
+def leaf_c_type(prop):
+    return prop.get('cType', TLV_C_TYPES[prop['tlvType']])
+
+
+def gen_header(trait):
+    props = trait.get('properties', [])
+    out = [banner(trait, 'trait.cpp.h')]
+    guard = include_guard(trait)
+
+    out.append('#ifndef %s\n' % guard)
+    out.append('#define %s\n' % guard)
+    out.append('\n')
+    out.append('#include <Weave/Profiles/data-management/DataManagement.h>\n')
+    out.append('#include <Weave/Support/SerializationUtils.h>\n')
+    if props:
+        out.append('#include <TraitSerializer.h>\n')
+    out.append('\n')
+    for include in trait.get('includes', []):
+        out.append('#include <%s>\n' % include)
+    out.append('\n')
+    out.append('\n')
+
+    out.append(open_namespaces(trait))
+    out.append('\n')
+    out.append('extern const nl::Weave::Profiles::DataManagement::TraitSchemaEngine TraitSchema;\n')
+    out.append('\n')
+    out.append('enum {\n')
+    out.append('      kWeaveProfileId = (%sU << 16) | %sU\n' % tuple(trait['profileId']))
+    out.append('};\n')
+
+    if props:
+        out.append('\n')
+        out.append('//\n')
+        out.append('// Properties\n')
+        out.append('//\n')
+        out.append('\n')
+        out.append('enum {\n')
+        out.append('    kPropertyHandle_Root = 1,\n')
+        out.append('\n')
+        out.append('    //' + '-' * 123 + '//\n')
+        out.append('    //  %-36s%-36s%-19s%-16s%-14s//\n' % ('Name', 'IDL Type', 'TLV Type', 'Optional?', 'Nullable?'))
+        out.append('    //' + '-' * 123 + '//\n')
+        out.append('\n')
+        for i, prop in enumerate(props):
+            out.append('    //\n')
+            out.append('    //  %-36s%-37s%-18s%-16s%s\n' % (prop['name'], prop['idlType'], prop['tlvType'],
+                                                           'YES' if prop.get('optional') else 'NO',
+                                                           'YES' if prop.get('nullable') else 'NO'))
+            out.append('    //\n')
+            out.append('    kPropertyHandle_%s = %d,\n' % (leaf_name(prop), FIRST_LEAF_HANDLE + i))
+            out.append('\n')
+        out.append('    //\n')
+        out.append('    // Enum for last handle\n')
+        out.append('    //\n')
+        out.append('    kLastSchemaHandle = %d,\n' % (FIRST_LEAF_HANDLE + len(props) - 1))
+        out.append('};\n')
+
+    if trait.get('enums'):
+        out.append('\n')
+        out.append('//\n')
+        out.append('// Enums\n')
+        out.append('//\n')
+        for enum in trait['enums']:
+            out.append('\n')
+            out.append('enum %s {\n' % enum['name'])
+            for name, value in enum['values']:
+                out.append('    %s = %d,\n' % (name, value))
+            out.append('};\n')
+
+    if trait.get('commands'):
+        out.append('\n')
+        out.append('//\n')
+        out.append('// Commands\n')
+        out.append('//\n')
+        out.append('\n')
+        out.append('enum {\n')
+        for command in trait['commands']:
+            out.append('    k%sRequestId = %s,\n' % (command['name'], command['id']))
+        out.append('};\n')
+        for command in trait['commands']:
+            out.append('\n')
+            out.append('enum %sRequestParameters {\n' % command['name'])
+            for name, tag in command['parameters']:
+                out.append('    k%sRequestParameter_%s = %d,\n' % (command['name'], name, tag))
+            out.append('};\n')
+
+    if props:
+        out.append('\n')
+        out.append('//\n')
+        out.append('// Typed Data\n')
+        out.append('//\n')
+        out.append('\n')
+        out.append('struct Data {\n')
+        for prop in props:
+            out.append('    %s %s;\n' % (leaf_c_type(prop), leaf_name(prop)))
+            if prop.get('nullable'):
+                out.append('    bool %sIsNull;\n' % leaf_name(prop))
+        out.append('};\n')
+        out.append('\n')
+        out.append('typedef TraitSerializer<Data, kPropertyHandle_%s,\n' % leaf_name(props[0]))
+        for i, prop in enumerate(props):
+            name = leaf_name(prop)
+            if prop.get('nullable'):
+                leaf = 'NullableTraitLeaf<Data, %s, &Data::%s, &Data::%sIsNull>' % (leaf_c_type(prop), name, name)
+            else:
+                leaf = 'TraitLeaf<Data, %s, &Data::%s>' % (leaf_c_type(prop), name)
+            out.append('        %s%s\n' % (leaf, ' > Serializer;' if i == len(props) - 1 else ','))
+
+    out.append('\n')
+    out.append(close_namespaces(trait))
+    out.append('#endif // %s\n' % guard)
+    return ''.join(out)
+
+
+def gen_support(trait):
+    props = trait.get('properties', [])
+    nullable = [i for i, prop in enumerate(props) if prop.get('nullable')]
+    out = [banner(trait, 'trait.cpp')]
+
+    out.append('\n')
+    out.append('#include <%s.h>\n' % trait_path(trait))
+    out.append('\n')
+    out.append(open_namespaces(trait))
+    out.append('\n')
+    out.append('using namespace ::nl::Weave::Profiles::DataManagement;\n')
+    out.append('\n')
+    out.append('//\n')
+    out.append('// Property Table\n')
+    out.append('//\n')
+    out.append('\n')
+    out.append('constexpr TraitSchemaEngine::PropertyInfo PropertyMap[] = {\n')
+    for i, prop in enumerate(props):
+        out.append('    { kPropertyHandle_Root, %d }, // %s\n' % (i + 1, prop['name']))
+    out.append('};\n')
+
+    if nullable:
+        bitfield = [0] * ((len(props) + 7) // 8)
+        for i in nullable:
+            bitfield[i // 8] |= 1 << (i % 8)
+        out.append('\n')
+        out.append('//\n')
+        out.append('// IsNullable Table\n')
+        out.append('//\n')
+        out.append('\n')
+        out.append('uint8_t IsNullableHandleBitfield[] = {\n')
+        out.append('        %s\n' % ', '.join('0x%x' % b for b in bitfield))
+        out.append('};\n')
+
+    out.append('\n')
+    out.append('//\n')
+    out.append('// Schema\n')
+    out.append('//\n')
+    out.append('\n')
+    out.append('const TraitSchemaEngine TraitSchema = {\n')
+    out.append('    {\n')
+    out.append('        kWeaveProfileId,\n')
+    out.append('        PropertyMap,\n')
+    out.append('        sizeof(PropertyMap) / sizeof(PropertyMap[0]),\n')
+    out.append('        1,\n')
+    out.append('#if (TDM_EXTENSION_SUPPORT) || (TDM_VERSIONING_SUPPORT)\n')
+    out.append('        2,\n')
+    out.append('#endif\n')
+    out.append('        NULL,\n')
+    out.append('        NULL,\n')
+    out.append('        NULL,\n')
+    out.append('        %s,\n' % ('&IsNullableHandleBitfield[0]' if nullable else 'NULL'))
+    out.append('        NULL,\n')
+    out.append('#if (TDM_EXTENSION_SUPPORT)\n')
+    out.append('        NULL,\n')
+    out.append('#endif\n')
+    out.append('#if (TDM_VERSIONING_SUPPORT)\n')
+    out.append('        NULL,\n')
+    out.append('#endif\n')
+    out.append('    }\n')
+    out.append('};\n')
+    out.append('\n')
+    out.append(close_namespaces(trait))
+    return ''.join(out)
+
+
+def generate(schema):
+    '''Return a list of (file name, contents) pairs for all traits in the schema.'''
+    files = []
+    for trait in schema['traits']:
+        path = trait_path(trait)
+        files.append((os.path.join(INCLUDE_DIR, path + '.h'), gen_header(trait)))
+        if not trait.get('headerOnly'):
+            files.append((os.path.join(SUPPORT_DIR, path + '.cpp'), gen_support(trait)))
+    return files
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate WDM trait schema headers and support files.')
+    parser.add_argument('--schema', default=DEFAULT_SCHEMA, help='Trait description file (default %(default)s)')
+    parser.add_argument('--verify', action='store_true', help='Check that the generated files in the tree are up to date')
+    args = parser.parse_args()
+
+    with open(args.schema) as f:
+        schema = json.load(f)
+
+    errors = 0
+    for fileName, contents in generate(schema):
+        relName = os.path.relpath(fileName, PROJECT_DIR)
+        if args.verify:
+            try:
+                with open(fileName) as f:
+                    existing = f.read()
+            except IOError:
+                existing = ''
+            if existing != contents:
+                print('%s: out of date' % relName, file=sys.stderr)
+                sys.stderr.writelines(difflib.unified_diff(existing.splitlines(True), contents.splitlines(True),
+                                                           relName, relName + ' (generated)'))
+                errors += 1
+        else:
+            dirName = os.path.dirname(fileName)
+            if not os.path.isdir(dirName):
+                os.makedirs(dirName)
+            with open(fileName, 'w') as f:
+                f.write(contents)
+            print('Generated %s' % relName)
+
+    if errors:
+        print('%d generated file(s) out of date; run tools/mktraits.py to regenerate' % errors, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())